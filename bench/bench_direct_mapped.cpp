@@ -0,0 +1,76 @@
+#include <benchmark/benchmark.h>
+#include <vector>
+#include "../cache sim/direct-way/include/direct_mapped_cache.h"
+#include "workloads.h"
+
+// ============================================================================
+// memsim::DirectMappedCache::access() / access_batch()
+// ============================================================================
+
+namespace {
+
+constexpr size_t TRACE_LENGTH = 1 << 20;
+constexpr uint64_t FOOTPRINT = 8 << 20;
+constexpr size_t BATCH = 4096;
+
+const std::vector<memsim::MemoryRequest>& requests_for(Stream stream) {
+    static std::vector<memsim::MemoryRequest> traces[3];
+    std::vector<memsim::MemoryRequest>& trace = traces[static_cast<int>(stream)];
+    if (trace.empty()) {
+        std::vector<uint64_t> addresses = make_stream(stream, TRACE_LENGTH, FOOTPRINT);
+        trace.reserve(TRACE_LENGTH);
+        for (size_t i = 0; i < TRACE_LENGTH; i++) {
+            trace.emplace_back(addresses[i], 0,
+                               is_write(i) ? memsim::AccessType::WRITE : memsim::AccessType::READ,
+                               8);
+        }
+    }
+    return trace;
+}
+
+double hit_rate(const memsim::Statistics& stats) {
+    return stats.total_accesses() > 0
+        ? static_cast<double>(stats.total_hits()) / stats.total_accesses()
+        : 0.0;
+}
+
+}  // namespace
+
+// Arguments: size KB, stream
+static void BM_DirectMappedAccess(benchmark::State& state) {
+    Stream stream = static_cast<Stream>(state.range(1));
+    memsim::DirectMappedCache cache(
+        memsim::CacheConfig(static_cast<uint32_t>(state.range(0)), 64, 1));
+    const std::vector<memsim::MemoryRequest>& trace = requests_for(stream);
+
+    size_t i = 0;
+    for (auto _ : state) {
+        const memsim::MemoryRequest& r = trace[i++ & (TRACE_LENGTH - 1)];
+        benchmark::DoNotOptimize(cache.access(r.addr, r.type));
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(stream_name(stream));
+    state.counters["hit_rate"] = hit_rate(cache.get_stats());
+}
+BENCHMARK(BM_DirectMappedAccess)
+    ->ArgNames({"KB", "stream"})
+    ->ArgsProduct({{32, 2048}, {0, 1, 2}});
+
+static void BM_DirectMappedAccessBatch(benchmark::State& state) {
+    Stream stream = static_cast<Stream>(state.range(1));
+    memsim::DirectMappedCache cache(
+        memsim::CacheConfig(static_cast<uint32_t>(state.range(0)), 64, 1));
+    const std::vector<memsim::MemoryRequest>& trace = requests_for(stream);
+
+    size_t offset = 0;
+    for (auto _ : state) {
+        cache.access_batch(trace.data() + offset, BATCH);
+        offset = (offset + BATCH) & (TRACE_LENGTH - 1);
+    }
+    state.SetItemsProcessed(state.iterations() * BATCH);
+    state.SetLabel(stream_name(stream));
+    state.counters["hit_rate"] = hit_rate(cache.get_stats());
+}
+BENCHMARK(BM_DirectMappedAccessBatch)
+    ->ArgNames({"KB", "stream"})
+    ->ArgsProduct({{32, 2048}, {0, 1, 2}});
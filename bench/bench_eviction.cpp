@@ -0,0 +1,92 @@
+#include <benchmark/benchmark.h>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "eviction_policies.hpp"
+#include "workloads.h"
+
+// ============================================================================
+// EvictionPolicy::access() / get_victim() (cpp/src way-number policies)
+//
+// One policy object per set of a 1024-set cache, called through the virtual
+// interface the way a per-set simulator uses them. Set and way sequences are
+// precomputed so only the policy calls are timed.
+// ============================================================================
+
+namespace {
+
+constexpr size_t NUM_SETS = 1024;
+constexpr size_t SEQUENCE_LENGTH = 1 << 16;
+
+struct Touch {
+    uint16_t set;
+    uint16_t way;
+};
+
+std::vector<Touch> make_touches(int ways) {
+    std::vector<Touch> touches;
+    touches.reserve(SEQUENCE_LENGTH);
+    uint64_t state = 7;
+    for (size_t i = 0; i < SEQUENCE_LENGTH; i++) {
+        uint64_t r = splitmix64(state);
+        touches.push_back({static_cast<uint16_t>(r % NUM_SETS),
+                           static_cast<uint16_t>((r >> 32) % ways)});
+    }
+    return touches;
+}
+
+template <typename Policy>
+std::vector<std::unique_ptr<EvictionPolicy>> make_policies(int ways) {
+    std::vector<std::unique_ptr<EvictionPolicy>> policies;
+    for (size_t s = 0; s < NUM_SETS; s++) {
+        policies.emplace_back(new Policy(ways));
+        for (int w = 0; w < ways; w++) {
+            policies.back()->access(w);     // Warm: every way in the list
+        }
+    }
+    return policies;
+}
+
+}  // namespace
+
+// Hit path: mark a way as used
+template <typename Policy>
+static void BM_EvictionAccess(benchmark::State& state) {
+    int ways = static_cast<int>(state.range(0));
+    auto policies = make_policies<Policy>(ways);
+    std::vector<Touch> touches = make_touches(ways);
+
+    size_t i = 0;
+    for (auto _ : state) {
+        const Touch& t = touches[i++ & (SEQUENCE_LENGTH - 1)];
+        policies[t.set]->access(t.way);
+    }
+    benchmark::DoNotOptimize(policies[0]->get_victim());
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Miss path: pick a victim and fill it
+template <typename Policy>
+static void BM_EvictionVictim(benchmark::State& state) {
+    int ways = static_cast<int>(state.range(0));
+    auto policies = make_policies<Policy>(ways);
+    std::vector<Touch> touches = make_touches(ways);
+
+    size_t i = 0;
+    for (auto _ : state) {
+        EvictionPolicy& p = *policies[touches[i++ & (SEQUENCE_LENGTH - 1)].set];
+        int victim = p.get_victim();
+        benchmark::DoNotOptimize(victim);
+        p.access(victim);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_TEMPLATE(BM_EvictionAccess, LRU)->ArgName("ways")->Arg(4)->Arg(16);
+BENCHMARK_TEMPLATE(BM_EvictionAccess, FIFO)->ArgName("ways")->Arg(4)->Arg(16);
+BENCHMARK_TEMPLATE(BM_EvictionAccess, Random)->ArgName("ways")->Arg(4)->Arg(16)->Arg(64);
+BENCHMARK_TEMPLATE(BM_EvictionAccess, PseudoLRU)->ArgName("ways")->Arg(4)->Arg(16)->Arg(64);
+BENCHMARK_TEMPLATE(BM_EvictionVictim, LRU)->ArgName("ways")->Arg(4)->Arg(16);
+BENCHMARK_TEMPLATE(BM_EvictionVictim, FIFO)->ArgName("ways")->Arg(4)->Arg(16);
+BENCHMARK_TEMPLATE(BM_EvictionVictim, Random)->ArgName("ways")->Arg(4)->Arg(16)->Arg(64);
+BENCHMARK_TEMPLATE(BM_EvictionVictim, PseudoLRU)->ArgName("ways")->Arg(4)->Arg(16)->Arg(64);
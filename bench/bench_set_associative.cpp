@@ -0,0 +1,160 @@
+#include <benchmark/benchmark.h>
+#include <vector>
+#include <string>
+#include "set_associative_cache.h"
+#include "fixed_cache.h"
+#include "workloads.h"
+
+// ============================================================================
+// SetAssociativeCache::access() / access_batch() across geometries
+// ============================================================================
+
+namespace {
+
+constexpr size_t TRACE_LENGTH = 1 << 20;        // Replayed in a loop
+constexpr uint64_t FOOTPRINT = 8 << 20;         // 8 MB touched by every stream
+constexpr size_t BATCH = 4096;
+
+const std::vector<TraceEntry>& trace_for(Stream stream) {
+    static std::vector<TraceEntry> traces[3];
+    std::vector<TraceEntry>& trace = traces[static_cast<int>(stream)];
+    if (trace.empty()) {
+        std::vector<uint64_t> addresses = make_stream(stream, TRACE_LENGTH, FOOTPRINT);
+        trace.reserve(TRACE_LENGTH);
+        for (size_t i = 0; i < TRACE_LENGTH; i++) {
+            trace.push_back({addresses[i], is_write(i) ? AccessType::WRITE : AccessType::READ});
+        }
+    }
+    return trace;
+}
+
+// Arguments: size KB, ways, storage mode (0 = PER_SET, 1 = FLAT), stream
+void geometries(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"KB", "ways", "flat", "stream"});
+    const int64_t configs[][2] = {{32, 8}, {256, 8}, {2048, 16}};
+    for (const auto& g : configs) {
+        for (int64_t flat = 0; flat <= 1; flat++) {
+            for (int64_t stream = 0; stream < 3; stream++) {
+                b->Args({g[0], g[1], flat, stream});
+            }
+        }
+    }
+}
+
+
+}  // namespace
+
+static void BM_SetAssociativeAccess(benchmark::State& state) {
+    StorageMode mode = state.range(2) ? StorageMode::FLAT : StorageMode::PER_SET;
+    Stream stream = static_cast<Stream>(state.range(3));
+    SetAssociativeCache cache(state.range(0) * 1024, 64, state.range(1), 64, mode,
+                              PolicyType::LRU, false);
+    const std::vector<TraceEntry>& trace = trace_for(stream);
+
+    size_t i = 0;
+    for (auto _ : state) {
+        const TraceEntry& e = trace[i++ & (TRACE_LENGTH - 1)];
+        benchmark::DoNotOptimize(cache.access(e.address, e.type));
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(stream_name(stream));
+    state.counters["hit_rate"] = cache.get_stats().hit_rate();
+}
+BENCHMARK(BM_SetAssociativeAccess)->Apply(geometries);
+
+static void BM_SetAssociativeAccessBatch(benchmark::State& state) {
+    StorageMode mode = state.range(2) ? StorageMode::FLAT : StorageMode::PER_SET;
+    Stream stream = static_cast<Stream>(state.range(3));
+    SetAssociativeCache cache(state.range(0) * 1024, 64, state.range(1), 64, mode,
+                              PolicyType::LRU, false);
+    const std::vector<TraceEntry>& trace = trace_for(stream);
+
+    size_t offset = 0;
+    for (auto _ : state) {
+        cache.access_batch(trace.data() + offset, BATCH);
+        offset = (offset + BATCH) & (TRACE_LENGTH - 1);
+    }
+    state.SetItemsProcessed(state.iterations() * BATCH);
+    state.SetLabel(stream_name(stream));
+    state.counters["hit_rate"] = cache.get_stats().hit_rate();
+}
+BENCHMARK(BM_SetAssociativeAccessBatch)->Apply(geometries);
+
+// The same geometries on the FixedCache instantiation (as memory_sweep uses)
+static void BM_FixedCacheAccess(benchmark::State& state) {
+    Stream stream = static_cast<Stream>(state.range(2));
+    const std::vector<TraceEntry>& trace = trace_for(stream);
+    bool dispatched = dispatch_fixed_cache(state.range(0) * 1024, 64, state.range(1),
+                                           [&](auto& cache) {
+        size_t i = 0;
+        for (auto _ : state) {
+            const TraceEntry& e = trace[i++ & (TRACE_LENGTH - 1)];
+            benchmark::DoNotOptimize(cache.access(e.address, e.type));
+        }
+        state.counters["hit_rate"] = cache.get_stats().hit_rate();
+    });
+    if (!dispatched) {
+        state.SkipWithError("no FixedCache instantiation");
+        return;
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(stream_name(stream));
+}
+BENCHMARK(BM_FixedCacheAccess)
+    ->ArgNames({"KB", "ways", "stream"})
+    ->Args({32, 8, 0})->Args({32, 8, 1})->Args({32, 8, 2})
+    ->Args({256, 8, 0})->Args({256, 8, 1})->Args({256, 8, 2})
+    ->Args({2048, 16, 0})->Args({2048, 16, 1})->Args({2048, 16, 2});
+
+// Every replacement policy on a 1 MB 16-way FLAT cache
+static void BM_ReplacementPolicy(benchmark::State& state) {
+    PolicyType policy = static_cast<PolicyType>(state.range(0));
+    Stream stream = static_cast<Stream>(state.range(1));
+    SetAssociativeCache cache(1 << 20, 64, 16, 64, StorageMode::FLAT, policy, false);
+    const std::vector<TraceEntry>& trace = trace_for(stream);
+
+    size_t i = 0;
+    for (auto _ : state) {
+        const TraceEntry& e = trace[i++ & (TRACE_LENGTH - 1)];
+        benchmark::DoNotOptimize(cache.access(e.address, e.type));
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(std::string(policy_name(policy)) + " " + stream_name(stream));
+    state.counters["hit_rate"] = cache.get_stats().hit_rate();
+}
+BENCHMARK(BM_ReplacementPolicy)
+    ->ArgNames({"policy", "stream"})
+    ->ArgsProduct({{0, 1, 2, 3, 4, 5, 6, 7, 8}, {1, 2}});
+
+// Build a 256 MB 16-way cache and replay the 8 MB trace once: FLAT pays for
+// every set up front, SPARSE only for the pages the trace touches
+static void BM_HugeCacheStartup(benchmark::State& state) {
+    StorageMode mode = state.range(0) ? StorageMode::SPARSE : StorageMode::FLAT;
+    const std::vector<TraceEntry>& trace = trace_for(Stream::ZIPFIAN);
+    size_t allocated = 0;
+    for (auto _ : state) {
+        SetAssociativeCache cache(256 << 20, 64, 16, 64, mode, PolicyType::LRU, false);
+        cache.access_batch(trace.data(), trace.size());
+        allocated = cache.get_allocated_sets();
+        benchmark::DoNotOptimize(cache.get_stats().hits);
+    }
+    state.SetItemsProcessed(state.iterations() * trace.size());
+    state.SetLabel(storage_name(mode));
+    state.counters["allocated_sets"] = static_cast<double>(allocated);
+}
+BENCHMARK(BM_HugeCacheStartup)->ArgNames({"sparse"})->DenseRange(0, 1)
+    ->Unit(benchmark::kMillisecond);
+
+// reset() of a warmed 8 MB 16-way cache (mode: 0 = PER_SET, 1 = FLAT, 2 = SPARSE)
+static void BM_Reset(benchmark::State& state) {
+    StorageMode mode = static_cast<StorageMode>(state.range(0));
+    SetAssociativeCache cache(8 << 20, 64, 16, 64, mode, PolicyType::LRU, false);
+    const std::vector<TraceEntry>& trace = trace_for(Stream::SEQUENTIAL);
+    cache.access_batch(trace.data(), trace.size());
+    for (auto _ : state) {
+        cache.reset();
+        benchmark::ClobberMemory();
+    }
+    state.SetLabel(storage_name(mode));
+}
+BENCHMARK(BM_Reset)->ArgNames({"mode"})->DenseRange(0, 2);
@@ -0,0 +1,95 @@
+#include <benchmark/benchmark.h>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cstdio>
+#include <cstdint>
+#include <filesystem>
+#include <unistd.h>
+#include "address_trace.h"
+#include "trace_reader.h"
+#include "workloads.h"
+
+// ============================================================================
+// Trace input: text parsing vs the mmap'ed binary format
+//
+// Both read the same 256K-access random trace. Text is the "R 0x1234" format
+// memory_sim and the 4-way drivers accept (parsed by read_address_trace());
+// binary is a .mtr file read in place through memsim::TraceReader.
+// ============================================================================
+
+namespace {
+
+constexpr size_t TRACE_LENGTH = 1 << 18;
+
+const std::vector<uint64_t>& addresses() {
+    static std::vector<uint64_t> a = make_stream(Stream::RANDOM, TRACE_LENGTH, 1ULL << 32);
+    return a;
+}
+
+const std::string& text_trace() {
+    static std::string text;
+    if (text.empty()) {
+        std::ostringstream out;
+        const std::vector<uint64_t>& a = addresses();
+        for (size_t i = 0; i < a.size(); i++) {
+            out << (is_write(i) ? "W" : "R") << " 0x" << std::hex << a[i] << "\n";
+        }
+        text = out.str();
+    }
+    return text;
+}
+
+// Written once per process, removed at exit
+struct BinaryTrace {
+    std::string path;
+
+    BinaryTrace() {
+        path = (std::filesystem::temp_directory_path() /
+                ("cachesim_bench_" + std::to_string(getpid()) + ".mtr")).string();
+        memsim::TraceWriter writer(path, 64);
+        const std::vector<uint64_t>& a = addresses();
+        for (size_t i = 0; i < a.size(); i++) {
+            writer.write(memsim::TraceRecord::make(
+                a[i], is_write(i) ? memsim::AccessType::WRITE : memsim::AccessType::READ, 8));
+        }
+        writer.close();
+    }
+    ~BinaryTrace() { std::remove(path.c_str()); }
+};
+
+const std::string& binary_trace() {
+    static BinaryTrace trace;
+    return trace.path;
+}
+
+}  // namespace
+
+static void BM_ParseTextTrace(benchmark::State& state) {
+    const std::string& text = text_trace();
+    for (auto _ : state) {
+        std::istringstream in(text);
+        std::vector<TraceEntry> trace = read_address_trace(in);
+        benchmark::DoNotOptimize(trace.data());
+    }
+    state.SetItemsProcessed(state.iterations() * TRACE_LENGTH);
+    state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_ParseTextTrace)->Unit(benchmark::kMillisecond);
+
+// Open (mmap) and walk every record
+static void BM_ReadBinaryTrace(benchmark::State& state) {
+    const std::string& path = binary_trace();
+    for (auto _ : state) {
+        memsim::TraceReader reader(path);
+        uint64_t writes = 0;
+        for (const memsim::TraceRecord& r : reader.records()) {
+            writes += r.op;
+            benchmark::DoNotOptimize(r.addr);
+        }
+        benchmark::DoNotOptimize(writes);
+    }
+    state.SetItemsProcessed(state.iterations() * TRACE_LENGTH);
+    state.SetBytesProcessed(state.iterations() * TRACE_LENGTH * sizeof(memsim::TraceRecord));
+}
+BENCHMARK(BM_ReadBinaryTrace)->Unit(benchmark::kMillisecond);
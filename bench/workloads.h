@@ -0,0 +1,120 @@
+#ifndef BENCH_WORKLOADS_H
+#define BENCH_WORKLOADS_H
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+
+// ============================================================================
+// Synthetic address streams shared by every benchmark
+//
+// All streams are deterministic (seeded splitmix64) and block-aligned plus a
+// random offset inside the block, over a power-of-two footprint:
+//
+//   SEQUENTIAL  8-byte stride through the footprint, wrapping around
+//   RANDOM      uniform blocks
+//   ZIPFIAN     block popularity ~ 1 / rank^0.99 (YCSB's generator), ranks
+//               scattered over the footprint so hot blocks share no sets
+// ============================================================================
+
+enum class Stream {
+    SEQUENTIAL,
+    RANDOM,
+    ZIPFIAN
+};
+
+inline const char* stream_name(Stream stream) {
+    switch (stream) {
+        case Stream::SEQUENTIAL: return "sequential";
+        case Stream::RANDOM:     return "random";
+        case Stream::ZIPFIAN:    return "zipfian";
+    }
+    return "unknown";
+}
+
+inline uint64_t splitmix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * ZipfGenerator - Ranks 0..n-1 with P(rank) ~ 1 / (rank+1)^theta
+ * Gray et al.'s closed-form sampler: O(n) setup, O(1) per sample.
+ */
+class ZipfGenerator {
+public:
+    ZipfGenerator(uint64_t n, double theta = 0.99) : n(n), theta(theta) {
+        double zeta2 = 1.0 + std::pow(0.5, theta);
+        zetan = 0.0;
+        for (uint64_t i = 1; i <= n; i++) {
+            zetan += 1.0 / std::pow(static_cast<double>(i), theta);
+        }
+        alpha = 1.0 / (1.0 - theta);
+        eta = (1.0 - std::pow(2.0 / n, 1.0 - theta)) / (1.0 - zeta2 / zetan);
+    }
+
+    /** @param u Uniform sample in [0, 1) */
+    uint64_t sample(double u) const {
+        double uz = u * zetan;
+        if (uz < 1.0) return 0;
+        if (uz < 1.0 + std::pow(0.5, theta)) return 1;
+        uint64_t rank = static_cast<uint64_t>(n * std::pow(eta * u - eta + 1.0, alpha));
+        return rank < n ? rank : n - 1;
+    }
+
+private:
+    uint64_t n;
+    double theta;
+    double zetan;
+    double alpha;
+    double eta;
+};
+
+/**
+ * Generate a synthetic address stream
+ * @param stream Access pattern
+ * @param count Number of addresses
+ * @param footprint Bytes touched (power of 2, >= block)
+ * @param block Block size in bytes (power of 2)
+ * @param seed Generator seed
+ */
+inline std::vector<uint64_t> make_stream(Stream stream, size_t count, uint64_t footprint,
+                                         uint64_t block = 64, uint64_t seed = 42) {
+    std::vector<uint64_t> addresses;
+    addresses.reserve(count);
+    uint64_t blocks = footprint / block;
+    uint64_t state = seed;
+
+    if (stream == Stream::SEQUENTIAL) {
+        for (size_t i = 0; i < count; i++) {
+            addresses.push_back((i * 8) & (footprint - 1));
+        }
+        return addresses;
+    }
+
+    ZipfGenerator zipf(stream == Stream::ZIPFIAN ? blocks : 2);
+    for (size_t i = 0; i < count; i++) {
+        uint64_t r = splitmix64(state);
+        uint64_t b;
+        if (stream == Stream::RANDOM) {
+            b = r & (blocks - 1);
+        } else {
+            double u = static_cast<double>(r >> 11) * (1.0 / 9007199254740992.0);
+            // Odd multiplier: a bijection on the power-of-two block count
+            b = (zipf.sample(u) * 0x9E3779B97F4A7C15ULL) & (blocks - 1);
+        }
+        uint64_t offset = (splitmix64(state) & (block - 1)) & ~7ULL;
+        addresses.push_back(b * block + offset);
+    }
+    return addresses;
+}
+
+/** One write in four, decided by index so every benchmark sees the same mix */
+inline bool is_write(size_t i) {
+    return ((i * 0x9E3779B97F4A7C15ULL) >> 62) == 0;
+}
+
+#endif // BENCH_WORKLOADS_H
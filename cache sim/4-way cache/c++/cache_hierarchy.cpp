@@ -0,0 +1,182 @@
+#include "cache_hierarchy.h"
+#include <iomanip>
+#include <sstream>
+#include <cassert>
+
+const char* inclusion_name(InclusionPolicy policy) {
+    switch (policy) {
+        case InclusionPolicy::INCLUSIVE: return "inclusive";
+        case InclusionPolicy::EXCLUSIVE: return "exclusive";
+        case InclusionPolicy::NINE:      return "nine";
+    }
+    return "unknown";
+}
+
+// ============================================================================
+// Constructor
+// ============================================================================
+
+CacheHierarchy::CacheHierarchy(const std::vector<CacheLevelConfig>& configs,
+                               InclusionPolicy policy, size_t addr_bits)
+    : level_stats(configs.size()), inclusion(policy), memory_reads(0), memory_writes(0) {
+    assert(!configs.empty() && "Hierarchy needs at least one level");
+
+    levels.reserve(configs.size());
+    for (const CacheLevelConfig& cfg : configs) {
+        assert(cfg.block == configs[0].block && "All levels must share one block size");
+        levels.emplace_back(cfg.size, cfg.block, cfg.assoc, addr_bits, cfg.storage, cfg.policy);
+        names.push_back(cfg.name);
+    }
+}
+
+// ============================================================================
+// Core Access Logic
+// ============================================================================
+
+HierarchyResult CacheHierarchy::access(uint64_t address, AccessType type) {
+    HierarchyResult result;
+    const size_t n = levels.size();
+    const bool write = (type == AccessType::WRITE);
+
+    // Look up top-down until some level holds the block
+    size_t hit = n;
+    for (size_t i = 0; i < n; i++) {
+        level_stats[i].accesses++;
+        if (levels[i].probe(address)) {
+            level_stats[i].hits++;
+            hit = i;
+            break;
+        }
+        level_stats[i].misses++;
+    }
+    result.hit_level = hit;
+    if (hit == n) {
+        memory_reads++;
+    }
+
+    if (inclusion == InclusionPolicy::EXCLUSIVE) {
+        if (hit == 0) {
+            levels[0].install(address, write);
+            return result;
+        }
+        // Move the block up into L1; its old slot becomes free
+        bool dirty = write;
+        if (hit < n) {
+            bool was_dirty = false;
+            levels[hit].invalidate(address, &was_dirty);
+            dirty = dirty || was_dirty;
+        }
+        place(0, address, dirty, result);
+        return result;
+    }
+
+    // INCLUSIVE / NINE: touch the hit level, then fill bottom-up
+    if (hit < n) {
+        levels[hit].install(address, hit == 0 && write);
+    }
+    for (size_t i = hit; i-- > 0;) {
+        place(i, address, i == 0 && write, result);
+    }
+    return result;
+}
+
+/**
+ * Install a block at one level and route whatever it displaces
+ */
+void CacheHierarchy::place(size_t level, uint64_t address, bool dirty, HierarchyResult& result) {
+    AccessResult r = levels[level].install(address, dirty);
+    if (!r.evicted) {
+        return;
+    }
+
+    level_stats[level].evictions++;
+    uint64_t victim = levels[level].reconstruct_address(r.evicted_tag, r.set_index);
+    bool victim_dirty = r.evicted_dirty;
+
+    if (inclusion == InclusionPolicy::INCLUSIVE) {
+        // Back-invalidate: upper levels may not keep a block this level dropped
+        for (size_t up = 0; up < level; up++) {
+            bool was_dirty = false;
+            if (levels[up].invalidate(victim, &was_dirty)) {
+                level_stats[up].back_invalidations++;
+                victim_dirty = victim_dirty || was_dirty;
+            }
+        }
+    }
+
+    send_down(level, victim, victim_dirty, result);
+}
+
+/**
+ * Hand a victim of `level` to the level below (or memory)
+ */
+void CacheHierarchy::send_down(size_t level, uint64_t address, bool dirty, HierarchyResult& result) {
+    if (dirty) {
+        level_stats[level].writebacks_out++;
+    }
+
+    size_t next = level + 1;
+    if (next == levels.size()) {
+        if (dirty) {
+            memory_writes++;
+            result.memory_writes++;
+        }
+        return;
+    }
+
+    // Exclusive lower levels take every victim; otherwise only write-backs
+    if (inclusion == InclusionPolicy::EXCLUSIVE || dirty) {
+        if (dirty) {
+            level_stats[next].writebacks_in++;
+        }
+        place(next, address, dirty, result);
+    }
+}
+
+// ============================================================================
+// Reporting
+// ============================================================================
+
+void CacheHierarchy::print_report(std::ostream& out) const {
+    out << std::string(86, '=') << "\n";
+    out << "Cache hierarchy (" << inclusion_name(inclusion) << ", "
+        << levels[0].get_block_size() << "B blocks)\n";
+    out << std::string(86, '=') << "\n";
+    out << std::left << std::setw(8) << "Level"
+        << std::setw(10) << "Size"
+        << std::setw(6) << "Ways"
+        << std::setw(12) << "Accesses"
+        << std::setw(11) << "Hits"
+        << std::setw(11) << "Hit Rate"
+        << std::setw(10) << "WB In"
+        << std::setw(10) << "WB Out"
+        << "Back-Inv\n";
+    out << std::string(86, '-') << "\n";
+    for (size_t i = 0; i < levels.size(); i++) {
+        const LevelStats& s = level_stats[i];
+        std::ostringstream rate;
+        rate << std::fixed << std::setprecision(2) << (s.hit_rate() * 100) << "%";
+        out << std::left << std::setw(8) << names[i]
+            << std::setw(10) << (std::to_string(levels[i].get_cache_size() / 1024) + "KB")
+            << std::setw(6) << levels[i].get_associativity()
+            << std::setw(12) << s.accesses
+            << std::setw(11) << s.hits
+            << std::setw(11) << rate.str()
+            << std::setw(10) << s.writebacks_in
+            << std::setw(10) << s.writebacks_out
+            << s.back_invalidations << "\n";
+    }
+    out << std::string(86, '-') << "\n";
+    out << "Memory reads: " << memory_reads << ", memory writes: " << memory_writes << "\n";
+}
+
+void CacheHierarchy::reset() {
+    for (SetAssociativeCache& level : levels) {
+        level.reset();
+    }
+    for (LevelStats& s : level_stats) {
+        s = LevelStats();
+    }
+    memory_reads = 0;
+    memory_writes = 0;
+}
@@ -0,0 +1,181 @@
+#include "cache_instrument.h"
+#include <stdexcept>
+#include <iomanip>
+
+// ============================================================================
+// Construction / teardown
+// ============================================================================
+
+CacheInstrument::CacheInstrument(size_t num_sets, const InstrumentConfig& config)
+    : unit(config.unit), interval(config.interval), sets(num_sets),
+      window_base_misses(num_sets, 0), position(0), snapshots(0),
+      finished(false), heatmap_path(config.heatmap_csv),
+      ring(config.ring_slots > 0 ? config.ring_slots : 1),
+      head(0), tail(0), filled(0), stopping(false) {
+    if (num_sets == 0) {
+        throw std::invalid_argument("CacheInstrument needs at least one set");
+    }
+    if (interval == 0) {
+        throw std::invalid_argument("Instrument interval must be positive");
+    }
+    window.start = 0;
+    window.end = interval;
+
+    if (!config.interval_csv.empty()) {
+        interval_out.open(config.interval_csv);
+        if (!interval_out) {
+            throw std::runtime_error("Cannot create " + config.interval_csv);
+        }
+        interval_out << "interval,start,end,hits,misses,hit_rate,evictions,"
+                        "dirty_evictions,hottest_set,hottest_set_misses\n";
+        writer = std::thread(&CacheInstrument::drain, this);
+    }
+}
+
+CacheInstrument::~CacheInstrument() {
+    try {
+        finish();
+    } catch (...) {
+        // Never throw from a destructor; finish() reports on explicit calls
+    }
+}
+
+// ============================================================================
+// Windows
+// ============================================================================
+
+void CacheInstrument::advance(uint64_t now) {
+    if (unit != IntervalUnit::CYCLES) {
+        return;
+    }
+    while (now >= window.end) {
+        if (window.hits + window.misses == 0 && window.evictions == 0) {
+            // Idle window: jump straight to the one containing now
+            uint64_t start = now - now % interval;
+            window.start = start;
+            window.end = start + interval;
+            break;
+        }
+        close_window(window.end);
+    }
+}
+
+/**
+ * Snapshot the current window and start the next one at end
+ * Costs one pass over the sets to find the hottest; with an interval of at
+ * least num_sets accesses that is under one step per access.
+ */
+void CacheInstrument::close_window(uint64_t end) {
+    window.end = end;
+    for (size_t s = 0; s < sets.size(); s++) {
+        uint64_t delta = sets[s].misses - window_base_misses[s];
+        if (delta > window.hottest_set_misses) {
+            window.hottest_set = s;
+            window.hottest_set_misses = delta;
+        }
+        window_base_misses[s] = sets[s].misses;
+    }
+
+    if (writer.joinable()) {
+        push(window);
+    }
+    snapshots++;
+
+    IntervalSnapshot next;
+    next.index = window.index + 1;
+    next.start = end;
+    next.end = end + interval;
+    window = next;
+}
+
+void CacheInstrument::push(const IntervalSnapshot& snapshot) {
+    std::unique_lock<std::mutex> lock(mutex);
+    not_full.wait(lock, [this] { return filled < ring.size(); });
+    ring[tail] = snapshot;
+    tail = (tail + 1) % ring.size();
+    filled++;
+    lock.unlock();
+    not_empty.notify_one();
+}
+
+/**
+ * Writer thread: move everything in the ring to a local batch, then format
+ * it without holding the lock
+ */
+void CacheInstrument::drain() {
+    std::vector<IntervalSnapshot> batch;
+    batch.reserve(ring.size());
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            not_empty.wait(lock, [this] { return filled > 0 || stopping; });
+            if (filled == 0) {
+                break;
+            }
+            while (filled > 0) {
+                batch.push_back(ring[head]);
+                head = (head + 1) % ring.size();
+                filled--;
+            }
+        }
+        not_full.notify_one();
+
+        for (const IntervalSnapshot& s : batch) {
+            uint64_t accesses = s.hits + s.misses;
+            double hit_rate = accesses ? static_cast<double>(s.hits) / accesses : 0.0;
+            interval_out << s.index << ',' << s.start << ',' << s.end << ','
+                         << s.hits << ',' << s.misses << ','
+                         << std::fixed << std::setprecision(4) << hit_rate << ','
+                         << s.evictions << ',' << s.dirty_evictions << ','
+                         << s.hottest_set << ',' << s.hottest_set_misses << '\n';
+        }
+        batch.clear();
+    }
+    interval_out.flush();
+}
+
+// ============================================================================
+// Finish
+// ============================================================================
+
+void CacheInstrument::finish() {
+    if (finished) {
+        return;
+    }
+    finished = true;
+
+    // Partial last window (ACCESSES: position; CYCLES: its nominal end)
+    if (window.hits + window.misses > 0 || window.evictions > 0) {
+        close_window(unit == IntervalUnit::ACCESSES ? position : window.end);
+    }
+
+    if (writer.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        not_empty.notify_one();
+        writer.join();
+        interval_out.close();
+    }
+
+    if (!heatmap_path.empty()) {
+        write_heatmap();
+    }
+}
+
+void CacheInstrument::write_heatmap() const {
+    std::ofstream out(heatmap_path);
+    if (!out) {
+        throw std::runtime_error("Cannot create " + heatmap_path);
+    }
+    out << "set,hits,misses,hit_rate,evictions,dirty_evictions\n";
+    out << std::fixed << std::setprecision(4);
+    for (size_t s = 0; s < sets.size(); s++) {
+        const SetCounters& c = sets[s];
+        uint64_t accesses = c.hits + c.misses;
+        double hit_rate = accesses ? static_cast<double>(c.hits) / accesses : 0.0;
+        out << s << ',' << c.hits << ',' << c.misses << ',' << hit_rate << ','
+            << c.evictions << ',' << c.dirty_evictions << '\n';
+    }
+}
@@ -0,0 +1,1021 @@
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include "set_associative_cache.h"
+#include "cache_hierarchy.h"
+#include "stack_distance.h"
+#include "working_set.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ============================================================================
+// Python bindings for the cache engines (module "cachesim")
+//
+//   import cachesim
+//   s = cachesim.simulate(addrs, size=32768, block=64, assoc=8, policy="lru")
+//   h = cachesim.hierarchy(addrs, [(32768, 8), (262144, 8)], inclusion="nine")
+//   points = cachesim.sweep(addrs, sizes=[16384, 32768], assocs=[1, 2, 4, 8])
+//   d = cachesim.reuse_distances(addrs)             # -1 = first access
+//   curve = cachesim.miss_ratio_curve(addrs, max_blocks=256)
+//   ws = cachesim.working_set(addrs, window=10000)  # distinct blocks per window
+//   fp = cachesim.footprint(addrs, windows=[1000, 10000, 100000])
+//
+// Traces are read in place through the buffer protocol: a 1-D contiguous
+// array of 4- or 8-byte integers (numpy uint64/uint32/int64, array.array,
+// memoryview), read as unsigned. Other iterables of ints are copied first.
+// writes= is an optional same-length array of 1-byte flags (numpy bool,
+// bytes, bytearray); nonzero marks a write. The GIL is released while the
+// engines run.
+//
+// Counters come back as struct sequences (named tuples), per-access results
+// as typed memoryviews, which numpy.asarray() wraps without a copy. Plain
+// CPython API, so the module builds with nothing but the Python headers.
+// ============================================================================
+
+namespace {
+constexpr size_t CHUNK = 1024;                      // Accesses decoded per step
+constexpr size_t SPARSE_BYTES = 32u * 1024 * 1024;  // sweep(): SPARSE from here up
+
+const struct {
+    const char* name;
+    PolicyType type;
+} POLICY_NAMES[] = {
+    {"lru", PolicyType::LRU},     {"fifo", PolicyType::FIFO},   {"random", PolicyType::RANDOM},
+    {"plru", PolicyType::PLRU},   {"srrip", PolicyType::SRRIP}, {"brrip", PolicyType::BRRIP},
+    {"drrip", PolicyType::DRRIP}, {"ship", PolicyType::SHIP},   {"arc", PolicyType::ARC}};
+
+const char* short_name(PolicyType type) {
+    for (const auto& p : POLICY_NAMES) {
+        if (p.type == type) {
+            return p.name;
+        }
+    }
+    return "?";
+}
+
+bool power_of_2(Py_ssize_t n) { return n > 0 && (n & (n - 1)) == 0; }
+}
+
+// ============================================================================
+// Trace input
+// ============================================================================
+
+/**
+ * TraceBuffer - A trace or flag array, borrowed in place when possible
+ */
+class TraceBuffer {
+public:
+    TraceBuffer() : held(false), data(nullptr), count(0), width(8) {}
+    ~TraceBuffer() {
+        if (held) {
+            PyBuffer_Release(&view);
+        }
+    }
+    TraceBuffer(const TraceBuffer&) = delete;
+    TraceBuffer& operator=(const TraceBuffer&) = delete;
+
+    /**
+     * @param flags 1-byte flags (writes=) rather than 4- or 8-byte addresses
+     * @return false with a Python exception set on error
+     */
+    bool open(PyObject* obj, const char* what, bool flags) {
+        if (!PyObject_CheckBuffer(obj)) {
+            return flags ? type_error(what, flags) : copy_iterable(obj);
+        }
+        if (PyObject_GetBuffer(obj, &view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) < 0) {
+            return false;
+        }
+        held = true;
+        const char* format = view.format ? view.format : "B";
+        if (*format == '@' || *format == '=' || *format == '<') {
+            format++;
+        }
+        const size_t itemsize = static_cast<size_t>(view.itemsize);
+        const bool integer = format[0] != '\0' && format[1] == '\0' &&
+                             std::strchr(flags ? "?bB" : "iIlLqQnN", format[0]) != nullptr;
+        if (view.ndim > 1 || !integer ||
+            (flags ? itemsize != 1 : itemsize != 4 && itemsize != 8)) {
+            return type_error(what, flags);
+        }
+        data = static_cast<const char*>(view.buf);
+        count = static_cast<size_t>(view.len) / itemsize;
+        width = itemsize;
+        return true;
+    }
+
+    size_t size() const { return count; }
+
+    /**
+     * The whole trace as 64-bit values: in place for aligned 8-byte
+     * elements, otherwise widened into scratch
+     */
+    const uint64_t* widen(std::vector<uint64_t>& scratch) const {
+        if (width == 8 && reinterpret_cast<uintptr_t>(data) % alignof(uint64_t) == 0) {
+            return reinterpret_cast<const uint64_t*>(data);
+        }
+        scratch.resize(count);
+        decode(0, count, scratch.data());
+        return scratch.data();
+    }
+
+    /** Widen n elements starting at begin to 64 bits */
+    void decode(size_t begin, size_t n, uint64_t* out) const {
+        if (width == 8) {
+            std::memcpy(out, data + begin * 8, n * 8);
+        } else if (width == 4) {
+            for (size_t i = 0; i < n; i++) {
+                uint32_t v;
+                std::memcpy(&v, data + (begin + i) * 4, 4);
+                out[i] = v;
+            }
+        } else {
+            const uint8_t* p = reinterpret_cast<const uint8_t*>(data) + begin;
+            for (size_t i = 0; i < n; i++) {
+                out[i] = p[i];
+            }
+        }
+    }
+
+private:
+    Py_buffer view;
+    bool held;
+    const char* data;
+    size_t count;
+    size_t width;
+    std::vector<uint64_t> copy;         // Iterables that aren't buffers
+
+    static bool type_error(const char* what, bool flags) {
+        PyErr_Format(PyExc_TypeError,
+                     flags ? "%s must be a 1-D array of 1-byte flags"
+                           : "%s must be a 1-D array of 4- or 8-byte integers or an iterable of ints",
+                     what);
+        return false;
+    }
+
+    bool copy_iterable(PyObject* obj) {
+        PyObject* iter = PyObject_GetIter(obj);
+        if (!iter) {
+            return false;
+        }
+        PyObject* item;
+        while ((item = PyIter_Next(iter))) {
+            PyObject* index = PyNumber_Index(item);
+            Py_DECREF(item);
+            if (!index) {
+                Py_DECREF(iter);
+                return false;
+            }
+            copy.push_back(PyLong_AsUnsignedLongLongMask(index));
+            Py_DECREF(index);
+        }
+        Py_DECREF(iter);
+        if (PyErr_Occurred()) {
+            return false;
+        }
+        data = reinterpret_cast<const char*>(copy.data());
+        count = copy.size();
+        width = 8;
+        return true;
+    }
+};
+
+/**
+ * Open addresses and the optional writes= flags, checking their lengths
+ */
+static bool open_trace(PyObject* addresses, PyObject* writes, TraceBuffer& trace,
+                       TraceBuffer& flags, bool& has_writes) {
+    if (!trace.open(addresses, "addresses", false)) {
+        return false;
+    }
+    has_writes = writes && writes != Py_None;
+    if (has_writes) {
+        if (!flags.open(writes, "writes", true)) {
+            return false;
+        }
+        if (flags.size() != trace.size()) {
+            PyErr_SetString(PyExc_ValueError, "writes must have one flag per address");
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Decode accesses [begin, begin + n) into TraceEntry form
+ */
+static void decode_entries(const TraceBuffer& trace, const TraceBuffer* writes, size_t begin,
+                           size_t n, TraceEntry* out) {
+    uint64_t addr[CHUNK];
+    uint64_t flag[CHUNK];
+    trace.decode(begin, n, addr);
+    if (writes) {
+        writes->decode(begin, n, flag);
+    }
+    for (size_t i = 0; i < n; i++) {
+        out[i].address = addr[i];
+        out[i].type = writes && flag[i] ? AccessType::WRITE : AccessType::READ;
+    }
+}
+
+// ============================================================================
+// Arguments
+// ============================================================================
+
+static bool parse_policy(const char* name, PolicyType& out) {
+    for (const auto& p : POLICY_NAMES) {
+        if (std::strcmp(name, p.name) == 0) {
+            out = p.type;
+            return true;
+        }
+    }
+    PyErr_Format(PyExc_ValueError, "unknown policy '%s'", name);
+    return false;
+}
+
+static bool parse_storage(const char* name, StorageMode& out) {
+    const StorageMode modes[] = {StorageMode::PER_SET, StorageMode::FLAT, StorageMode::SPARSE};
+    for (StorageMode mode : modes) {
+        if (std::strcmp(name, storage_name(mode)) == 0) {
+            out = mode;
+            return true;
+        }
+    }
+    PyErr_Format(PyExc_ValueError, "unknown storage '%s' (per-set, flat or sparse)", name);
+    return false;
+}
+
+static bool parse_inclusion(const char* name, InclusionPolicy& out) {
+    const InclusionPolicy kinds[] = {InclusionPolicy::INCLUSIVE, InclusionPolicy::EXCLUSIVE,
+                                     InclusionPolicy::NINE};
+    for (InclusionPolicy kind : kinds) {
+        if (std::strcmp(name, inclusion_name(kind)) == 0) {
+            out = kind;
+            return true;
+        }
+    }
+    PyErr_Format(PyExc_ValueError, "unknown inclusion '%s' (inclusive, exclusive or nine)", name);
+    return false;
+}
+
+/**
+ * Whether SetAssociativeCache accepts the geometry (it asserts otherwise)
+ */
+static bool valid_geometry(Py_ssize_t size, Py_ssize_t block, Py_ssize_t assoc, StorageMode mode) {
+    return power_of_2(block) && power_of_2(assoc) && size >= block * assoc &&
+           power_of_2(size / block / assoc) && size % (block * assoc) == 0 &&
+           (mode == StorageMode::PER_SET || assoc <= static_cast<Py_ssize_t>(TagStore::MAX_WAYS));
+}
+
+static bool check_geometry(Py_ssize_t size, Py_ssize_t block, Py_ssize_t assoc, StorageMode mode) {
+    if (!valid_geometry(size, block, assoc, mode)) {
+        PyErr_Format(PyExc_ValueError,
+                     "invalid cache %zd B / %zd B blocks / %zd ways: block and ways must be "
+                     "powers of 2 with a power-of-2 number of sets (flat and sparse: <= 64 ways)",
+                     size, block, assoc);
+        return false;
+    }
+    return true;
+}
+
+static bool check_stack_geometry(Py_ssize_t block_size, Py_ssize_t num_sets) {
+    if (!power_of_2(block_size)) {
+        PyErr_SetString(PyExc_ValueError, "block_size must be a power of 2");
+        return false;
+    }
+    if (num_sets <= 0) {
+        PyErr_SetString(PyExc_ValueError, "num_sets must be positive");
+        return false;
+    }
+    return true;
+}
+
+static bool check_working_set(Py_ssize_t block_size, Py_ssize_t window, Py_ssize_t threads) {
+    if (!power_of_2(block_size)) {
+        PyErr_SetString(PyExc_ValueError, "block_size must be a power of 2");
+        return false;
+    }
+    if (window <= 0) {
+        PyErr_SetString(PyExc_ValueError, "window must be positive");
+        return false;
+    }
+    if (threads < 0) {
+        PyErr_SetString(PyExc_ValueError, "threads must be >= 0");
+        return false;
+    }
+    return true;
+}
+
+static bool check_precision(Py_ssize_t precision) {
+    if (precision < static_cast<Py_ssize_t>(HyperLogLog::MIN_PRECISION) ||
+        precision > static_cast<Py_ssize_t>(HyperLogLog::MAX_PRECISION)) {
+        PyErr_Format(PyExc_ValueError, "precision must be %u..%u", HyperLogLog::MIN_PRECISION,
+                     HyperLogLog::MAX_PRECISION);
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// Results
+// ============================================================================
+
+static PyTypeObject* CacheStatsType;
+static PyTypeObject* LevelStatsType;
+static PyTypeObject* HierarchyStatsType;
+static PyTypeObject* SweepPointType;
+static PyTypeObject* FootprintType;
+
+static PyStructSequence_Field cache_stats_fields[] = {
+    {"accesses", nullptr}, {"hits", nullptr}, {"misses", nullptr}, {"hit_rate", nullptr},
+    {"reads", nullptr}, {"writes", nullptr}, {"evictions", nullptr},
+    {"dirty_evictions", nullptr}, {nullptr, nullptr}};
+
+static PyStructSequence_Field level_stats_fields[] = {
+    {"name", nullptr}, {"size", nullptr}, {"ways", nullptr}, {"accesses", nullptr},
+    {"hits", nullptr}, {"misses", nullptr}, {"hit_rate", nullptr}, {"writebacks_in", nullptr},
+    {"writebacks_out", nullptr}, {"evictions", nullptr}, {"back_invalidations", nullptr},
+    {nullptr, nullptr}};
+
+static PyStructSequence_Field hierarchy_stats_fields[] = {
+    {"levels", "LevelStats per level, L1 first"}, {"memory_reads", nullptr},
+    {"memory_writes", nullptr}, {nullptr, nullptr}};
+
+static PyStructSequence_Field sweep_point_fields[] = {
+    {"size", nullptr}, {"block", nullptr}, {"assoc", nullptr}, {"policy", nullptr},
+    {"accesses", nullptr}, {"hits", nullptr}, {"misses", nullptr}, {"hit_rate", nullptr},
+    {"writebacks", nullptr}, {nullptr, nullptr}};
+
+static PyStructSequence_Field footprint_fields[] = {
+    {"accesses", nullptr}, {"unique_blocks", nullptr},
+    {"windows", "Window lengths, ascending (those outside 1..accesses dropped)"},
+    {"footprint", "Mean distinct blocks over all windows of each length"}, {nullptr, nullptr}};
+
+static PyStructSequence_Desc cache_stats_desc = {
+    "cachesim.CacheStats", "Counters of one cache", cache_stats_fields, 8};
+static PyStructSequence_Desc level_stats_desc = {
+    "cachesim.LevelStats", "Counters of one hierarchy level", level_stats_fields, 11};
+static PyStructSequence_Desc hierarchy_stats_desc = {
+    "cachesim.HierarchyStats", "Per-level counters and memory traffic", hierarchy_stats_fields, 3};
+static PyStructSequence_Desc sweep_point_desc = {
+    "cachesim.SweepPoint", "One configuration of a sweep", sweep_point_fields, 9};
+static PyStructSequence_Desc footprint_desc = {
+    "cachesim.Footprint", "All-window footprint curve of a trace", footprint_fields, 4};
+
+/**
+ * Fill a struct sequence from new references (steals them)
+ * @return nullptr if any is nullptr
+ */
+static PyObject* make_record(PyTypeObject* type, std::initializer_list<PyObject*> values) {
+    PyObject* record = PyStructSequence_New(type);
+    Py_ssize_t i = 0;
+    bool ok = record != nullptr;
+    for (PyObject* v : values) {
+        ok = ok && v;
+        if (record && v) {
+            PyStructSequence_SET_ITEM(record, i, v);
+        } else {
+            Py_XDECREF(v);
+        }
+        i++;
+    }
+    if (!ok) {
+        Py_XDECREF(record);
+        return nullptr;
+    }
+    return record;
+}
+
+static PyObject* u64(uint64_t v) { return PyLong_FromUnsignedLongLong(v); }
+
+static PyObject* make_cache_stats(const CacheStats& s) {
+    return make_record(CacheStatsType,
+                       {u64(s.hits + s.misses), u64(s.hits), u64(s.misses),
+                        PyFloat_FromDouble(s.hit_rate()), u64(s.reads), u64(s.writes),
+                        u64(s.evictions), u64(s.dirty_evictions)});
+}
+
+/**
+ * Wrap a bytearray as a memoryview of the given element format
+ */
+static PyObject* typed_view(PyObject* bytes, const char* format) {
+    if (!bytes) {
+        return nullptr;
+    }
+    PyObject* view = PyMemoryView_FromObject(bytes);
+    Py_DECREF(bytes);
+    if (!view) {
+        return nullptr;
+    }
+    PyObject* cast = PyObject_CallMethod(view, "cast", "s", format);
+    Py_DECREF(view);
+    return cast;
+}
+
+// ============================================================================
+// Caches
+// ============================================================================
+
+/**
+ * Run a whole trace through one cache, chunk by chunk
+ * Called without the GIL.
+ * @param hits Optional per-access hit flags
+ */
+static void run_cache(SetAssociativeCache& cache, const TraceBuffer& trace,
+                      const TraceBuffer* writes, uint8_t* hits) {
+    TraceEntry entries[CHUNK];
+    AccessResult results[CHUNK];
+    for (size_t begin = 0; begin < trace.size(); begin += CHUNK) {
+        size_t n = std::min(CHUNK, trace.size() - begin);
+        decode_entries(trace, writes, begin, n, entries);
+        cache.access_batch(entries, n, hits ? results : nullptr);
+        if (hits) {
+            for (size_t i = 0; i < n; i++) {
+                hits[begin + i] = results[i].hit;
+            }
+        }
+    }
+}
+
+static PyObject* simulate(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"addresses", "size", "block", "assoc", "policy",
+                                     "storage", "writes", "hits", nullptr};
+    PyObject* addresses;
+    Py_ssize_t size;
+    Py_ssize_t block = 64;
+    Py_ssize_t assoc = 8;
+    const char* policy_arg = "lru";
+    const char* storage_arg = "flat";
+    PyObject* writes = Py_None;
+    PyObject* hits = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "On|nnssOO", const_cast<char**>(keywords),
+                                     &addresses, &size, &block, &assoc, &policy_arg,
+                                     &storage_arg, &writes, &hits)) {
+        return nullptr;
+    }
+    PolicyType policy;
+    StorageMode storage;
+    if (!parse_policy(policy_arg, policy) || !parse_storage(storage_arg, storage) ||
+        !check_geometry(size, block, assoc, storage)) {
+        return nullptr;
+    }
+
+    TraceBuffer trace, flags;
+    bool has_writes;
+    if (!open_trace(addresses, writes, trace, flags, has_writes)) {
+        return nullptr;
+    }
+
+    // Optional output: one writable byte per access
+    Py_buffer out;
+    uint8_t* hit_flags = nullptr;
+    if (hits != Py_None) {
+        if (PyObject_GetBuffer(hits, &out, PyBUF_WRITABLE | PyBUF_C_CONTIGUOUS) < 0) {
+            return nullptr;
+        }
+        if (static_cast<size_t>(out.len) != trace.size() || out.itemsize != 1) {
+            PyBuffer_Release(&out);
+            PyErr_SetString(PyExc_ValueError, "hits must be a writable 1-byte array, one per address");
+            return nullptr;
+        }
+        hit_flags = static_cast<uint8_t*>(out.buf);
+    }
+
+    SetAssociativeCache cache(size, block, assoc, 64, storage, policy, false);
+    Py_BEGIN_ALLOW_THREADS
+    run_cache(cache, trace, has_writes ? &flags : nullptr, hit_flags);
+    Py_END_ALLOW_THREADS
+    if (hit_flags) {
+        PyBuffer_Release(&out);
+    }
+    return make_cache_stats(cache.get_stats());
+}
+
+static PyObject* hierarchy(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"addresses", "levels", "inclusion", "block", "writes",
+                                     nullptr};
+    PyObject* addresses;
+    PyObject* levels_arg;
+    const char* inclusion_arg = "nine";
+    Py_ssize_t block = 64;
+    PyObject* writes = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO|snO", const_cast<char**>(keywords),
+                                     &addresses, &levels_arg, &inclusion_arg, &block, &writes)) {
+        return nullptr;
+    }
+    InclusionPolicy inclusion;
+    if (!parse_inclusion(inclusion_arg, inclusion)) {
+        return nullptr;
+    }
+
+    // Levels: (size, ways) or (size, ways, policy), L1 first
+    PyObject* seq = PySequence_Fast(levels_arg, "levels must be a sequence of (size, ways)");
+    if (!seq) {
+        return nullptr;
+    }
+    std::vector<CacheLevelConfig> configs;
+    const Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    for (Py_ssize_t i = 0; i < n; i++) {
+        Py_ssize_t size, ways;
+        const char* policy_arg = "lru";
+        PolicyType policy;
+        PyObject* item = PySequence_Fast_GET_ITEM(seq, i);
+        if (!PyArg_ParseTuple(item, "nn|s;levels must be (size, ways[, policy])", &size, &ways,
+                              &policy_arg) ||
+            !parse_policy(policy_arg, policy) ||
+            !check_geometry(size, block, ways, StorageMode::FLAT)) {
+            Py_DECREF(seq);
+            return nullptr;
+        }
+        configs.emplace_back("L" + std::to_string(i + 1), size, block, ways, policy);
+    }
+    Py_DECREF(seq);
+    if (configs.empty()) {
+        PyErr_SetString(PyExc_ValueError, "levels must not be empty");
+        return nullptr;
+    }
+    if (configs.size() > 1) {
+        configs.back().name = "LLC";
+    }
+
+    TraceBuffer trace, flags;
+    bool has_writes;
+    if (!open_trace(addresses, writes, trace, flags, has_writes)) {
+        return nullptr;
+    }
+
+    CacheHierarchy h(configs, inclusion, 64);
+    Py_BEGIN_ALLOW_THREADS
+    TraceEntry entries[CHUNK];
+    for (size_t begin = 0; begin < trace.size(); begin += CHUNK) {
+        size_t count = std::min(CHUNK, trace.size() - begin);
+        decode_entries(trace, has_writes ? &flags : nullptr, begin, count, entries);
+        for (size_t i = 0; i < count; i++) {
+            h.access(entries[i].address, entries[i].type);
+        }
+    }
+    Py_END_ALLOW_THREADS
+
+    PyObject* levels = PyTuple_New(static_cast<Py_ssize_t>(configs.size()));
+    if (!levels) {
+        return nullptr;
+    }
+    for (size_t i = 0; i < configs.size(); i++) {
+        const LevelStats& s = h.get_level_stats(i);
+        PyObject* record = make_record(
+            LevelStatsType,
+            {PyUnicode_FromString(configs[i].name.c_str()), u64(configs[i].size),
+             u64(configs[i].assoc), u64(s.accesses), u64(s.hits), u64(s.misses),
+             PyFloat_FromDouble(s.hit_rate()), u64(s.writebacks_in), u64(s.writebacks_out),
+             u64(s.evictions), u64(s.back_invalidations)});
+        if (!record) {
+            Py_DECREF(levels);
+            return nullptr;
+        }
+        PyTuple_SET_ITEM(levels, static_cast<Py_ssize_t>(i), record);
+    }
+    return make_record(HierarchyStatsType,
+                       {levels, u64(h.get_memory_reads()), u64(h.get_memory_writes())});
+}
+
+/**
+ * Read a sequence of positive sizes
+ */
+static bool parse_sizes(PyObject* obj, const char* what, std::vector<Py_ssize_t>& out) {
+    PyObject* seq = PySequence_Fast(obj, what);
+    if (!seq) {
+        return false;
+    }
+    for (Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(seq); i++) {
+        Py_ssize_t v = PyNumber_AsSsize_t(PySequence_Fast_GET_ITEM(seq, i), PyExc_OverflowError);
+        if (v == -1 && PyErr_Occurred()) {
+            Py_DECREF(seq);
+            return false;
+        }
+        out.push_back(v);
+    }
+    Py_DECREF(seq);
+    return true;
+}
+
+static PyObject* sweep(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"addresses", "sizes", "assocs", "block", "policy",
+                                     "writes", "threads", nullptr};
+    PyObject* addresses;
+    PyObject* sizes_arg;
+    PyObject* assocs_arg;
+    Py_ssize_t block = 64;
+    const char* policy_arg = "lru";
+    PyObject* writes = Py_None;
+    Py_ssize_t threads = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OOO|nsOn", const_cast<char**>(keywords),
+                                     &addresses, &sizes_arg, &assocs_arg, &block, &policy_arg,
+                                     &writes, &threads)) {
+        return nullptr;
+    }
+    PolicyType policy;
+    std::vector<Py_ssize_t> sizes, assocs;
+    if (!parse_policy(policy_arg, policy) ||
+        !parse_sizes(sizes_arg, "sizes must be a sequence of ints", sizes) ||
+        !parse_sizes(assocs_arg, "assocs must be a sequence of ints", assocs)) {
+        return nullptr;
+    }
+
+    TraceBuffer trace, flags;
+    bool has_writes;
+    if (!open_trace(addresses, writes, trace, flags, has_writes)) {
+        return nullptr;
+    }
+
+    // Grid of sizes x ways, skipping combinations the cache can't build
+    std::vector<SetAssociativeCache> caches;
+    std::vector<std::pair<Py_ssize_t, Py_ssize_t>> points;
+    for (Py_ssize_t size : sizes) {
+        for (Py_ssize_t ways : assocs) {
+            StorageMode mode = static_cast<size_t>(size) >= SPARSE_BYTES ? StorageMode::SPARSE
+                                                                         : StorageMode::FLAT;
+            if (valid_geometry(size, block, ways, mode)) {
+                points.emplace_back(size, ways);
+            }
+        }
+    }
+    caches.reserve(points.size());
+    for (const auto& p : points) {
+        StorageMode mode = static_cast<size_t>(p.first) >= SPARSE_BYTES ? StorageMode::SPARSE
+                                                                        : StorageMode::FLAT;
+        caches.emplace_back(p.first, block, p.second, 64, mode, policy, false);
+    }
+
+    // Workers pull configurations off a shared counter; each reads the trace in place
+    size_t workers = threads > 0 ? static_cast<size_t>(threads)
+                                 : std::max(1u, std::thread::hardware_concurrency());
+    workers = std::min(workers, caches.size());
+    Py_BEGIN_ALLOW_THREADS
+    std::atomic<size_t> next(0);
+    auto work = [&]() {
+        for (size_t c = next++; c < caches.size(); c = next++) {
+            run_cache(caches[c], trace, has_writes ? &flags : nullptr, nullptr);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < workers; t++) {
+        pool.emplace_back(work);
+    }
+    work();
+    for (std::thread& t : pool) {
+        t.join();
+    }
+    Py_END_ALLOW_THREADS
+
+    PyObject* out = PyList_New(static_cast<Py_ssize_t>(caches.size()));
+    if (!out) {
+        return nullptr;
+    }
+    for (size_t c = 0; c < caches.size(); c++) {
+        CacheStats s = caches[c].get_stats();
+        PyObject* record = make_record(
+            SweepPointType,
+            {u64(points[c].first), u64(block), u64(points[c].second),
+             PyUnicode_FromString(short_name(policy)), u64(s.hits + s.misses), u64(s.hits),
+             u64(s.misses), PyFloat_FromDouble(s.hit_rate()), u64(s.dirty_evictions)});
+        if (!record) {
+            Py_DECREF(out);
+            return nullptr;
+        }
+        PyList_SET_ITEM(out, static_cast<Py_ssize_t>(c), record);
+    }
+    return out;
+}
+
+// ============================================================================
+// Stack distance
+// ============================================================================
+
+/**
+ * Feed a trace to the engine without the GIL
+ * @param out Optional per-access distances
+ */
+static void run_stack_distance(StackDistance& engine, const TraceBuffer& trace, int64_t* out) {
+    uint64_t addr[CHUNK];
+    for (size_t begin = 0; begin < trace.size(); begin += CHUNK) {
+        size_t n = std::min(CHUNK, trace.size() - begin);
+        trace.decode(begin, n, addr);
+        for (size_t i = 0; i < n; i++) {
+            int64_t d = engine.access(addr[i]);
+            if (out) {
+                out[begin + i] = d;
+            }
+        }
+    }
+}
+
+static PyObject* reuse_distances(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"addresses", "block_size", "num_sets", nullptr};
+    PyObject* addresses;
+    Py_ssize_t block_size = 64;
+    Py_ssize_t num_sets = 1;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|nn", const_cast<char**>(keywords),
+                                     &addresses, &block_size, &num_sets) ||
+        !check_stack_geometry(block_size, num_sets)) {
+        return nullptr;
+    }
+    TraceBuffer trace;
+    if (!trace.open(addresses, "addresses", false)) {
+        return nullptr;
+    }
+    PyObject* bytes = PyByteArray_FromStringAndSize(
+        nullptr, static_cast<Py_ssize_t>(trace.size() * sizeof(int64_t)));
+    if (!bytes) {
+        return nullptr;
+    }
+    int64_t* out = reinterpret_cast<int64_t*>(PyByteArray_AS_STRING(bytes));
+
+    StackDistance engine(block_size, num_sets);
+    Py_BEGIN_ALLOW_THREADS
+    run_stack_distance(engine, trace, out);
+    Py_END_ALLOW_THREADS
+    return typed_view(bytes, "q");
+}
+
+static PyObject* miss_ratio_curve(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"addresses", "block_size", "max_blocks", "num_sets",
+                                     nullptr};
+    PyObject* addresses;
+    Py_ssize_t block_size = 64;
+    Py_ssize_t max_blocks = 0;
+    Py_ssize_t num_sets = 1;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|nnn", const_cast<char**>(keywords),
+                                     &addresses, &block_size, &max_blocks, &num_sets) ||
+        !check_stack_geometry(block_size, num_sets)) {
+        return nullptr;
+    }
+    if (max_blocks < 0) {
+        PyErr_SetString(PyExc_ValueError, "max_blocks must be >= 0");
+        return nullptr;
+    }
+    TraceBuffer trace;
+    if (!trace.open(addresses, "addresses", false)) {
+        return nullptr;
+    }
+
+    StackDistance engine(block_size, num_sets);
+    std::vector<double> curve;
+    Py_BEGIN_ALLOW_THREADS
+    run_stack_distance(engine, trace, nullptr);
+    curve = engine.miss_ratio_curve(max_blocks);
+    Py_END_ALLOW_THREADS
+    PyObject* bytes = PyByteArray_FromStringAndSize(
+        reinterpret_cast<const char*>(curve.data()),
+        static_cast<Py_ssize_t>(curve.size() * sizeof(double)));
+    return typed_view(bytes, "d");
+}
+
+// ============================================================================
+// Working sets
+// ============================================================================
+
+static PyObject* working_set(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"addresses", "window", "block_size", "threads", nullptr};
+    PyObject* addresses;
+    Py_ssize_t window;
+    Py_ssize_t block_size = 64;
+    Py_ssize_t threads = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "On|nn", const_cast<char**>(keywords),
+                                     &addresses, &window, &block_size, &threads) ||
+        !check_working_set(block_size, window, threads)) {
+        return nullptr;
+    }
+    TraceBuffer trace;
+    if (!trace.open(addresses, "addresses", false)) {
+        return nullptr;
+    }
+
+    WorkingSetAnalyzer analyzer(block_size, threads);
+    std::vector<uint64_t> scratch;
+    std::vector<uint32_t> sizes;
+    Py_BEGIN_ALLOW_THREADS
+    sizes = analyzer.sliding(trace.widen(scratch), trace.size(), window);
+    Py_END_ALLOW_THREADS
+    PyObject* bytes = PyByteArray_FromStringAndSize(
+        reinterpret_cast<const char*>(sizes.data()),
+        static_cast<Py_ssize_t>(sizes.size() * sizeof(uint32_t)));
+    return typed_view(bytes, "I");
+}
+
+static PyObject* footprint(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"addresses", "windows", "block_size", "threads", nullptr};
+    PyObject* addresses;
+    PyObject* windows_arg;
+    Py_ssize_t block_size = 64;
+    Py_ssize_t threads = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO|nn", const_cast<char**>(keywords),
+                                     &addresses, &windows_arg, &block_size, &threads) ||
+        !check_working_set(block_size, 1, threads)) {
+        return nullptr;
+    }
+    std::vector<Py_ssize_t> requested;
+    if (!parse_sizes(windows_arg, "windows must be a sequence of ints", requested)) {
+        return nullptr;
+    }
+    std::vector<size_t> windows;
+    for (Py_ssize_t w : requested) {
+        if (w > 0) {
+            windows.push_back(static_cast<size_t>(w));
+        }
+    }
+    TraceBuffer trace;
+    if (!trace.open(addresses, "addresses", false)) {
+        return nullptr;
+    }
+
+    WorkingSetAnalyzer analyzer(block_size, threads);
+    std::vector<uint64_t> scratch;
+    FootprintCurve curve;
+    Py_BEGIN_ALLOW_THREADS
+    curve = analyzer.footprint(trace.widen(scratch), trace.size(), windows);
+    Py_END_ALLOW_THREADS
+
+    PyObject* lengths = PyList_New(static_cast<Py_ssize_t>(curve.windows.size()));
+    PyObject* values = PyList_New(static_cast<Py_ssize_t>(curve.footprint.size()));
+    if (!lengths || !values) {
+        Py_XDECREF(lengths);
+        Py_XDECREF(values);
+        return nullptr;
+    }
+    for (size_t i = 0; i < curve.windows.size(); i++) {
+        PyObject* w = PyLong_FromSize_t(curve.windows[i]);
+        PyObject* fp = PyFloat_FromDouble(curve.footprint[i]);
+        if (!w || !fp) {
+            Py_XDECREF(w);
+            Py_XDECREF(fp);
+            Py_DECREF(lengths);
+            Py_DECREF(values);
+            return nullptr;
+        }
+        PyList_SET_ITEM(lengths, static_cast<Py_ssize_t>(i), w);
+        PyList_SET_ITEM(values, static_cast<Py_ssize_t>(i), fp);
+    }
+    return make_record(FootprintType,
+                       {u64(curve.accesses), u64(curve.unique_blocks), lengths, values});
+}
+
+static PyObject* unique_blocks(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"addresses", "block_size", "precision", "threads",
+                                     nullptr};
+    PyObject* addresses;
+    Py_ssize_t block_size = 64;
+    Py_ssize_t precision = 0;
+    Py_ssize_t threads = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|nnn", const_cast<char**>(keywords),
+                                     &addresses, &block_size, &precision, &threads) ||
+        !check_working_set(block_size, 1, threads) ||
+        (precision != 0 && !check_precision(precision))) {
+        return nullptr;
+    }
+    TraceBuffer trace;
+    if (!trace.open(addresses, "addresses", false)) {
+        return nullptr;
+    }
+
+    WorkingSetAnalyzer analyzer(block_size, threads);
+    std::vector<uint64_t> scratch;
+    uint64_t exact = 0;
+    double estimate = 0.0;
+    Py_BEGIN_ALLOW_THREADS
+    const uint64_t* data = trace.widen(scratch);
+    if (precision == 0) {
+        exact = analyzer.unique_blocks(data, trace.size());
+    } else {
+        estimate = analyzer.sketch(data, trace.size(), static_cast<unsigned>(precision))
+                       .estimate();
+    }
+    Py_END_ALLOW_THREADS
+    return precision == 0 ? u64(exact) : PyFloat_FromDouble(estimate);
+}
+
+static PyObject* working_set_estimate(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"addresses", "window", "block_size", "precision",
+                                     "threads", nullptr};
+    PyObject* addresses;
+    Py_ssize_t window;
+    Py_ssize_t block_size = 64;
+    Py_ssize_t precision = 14;
+    Py_ssize_t threads = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "On|nnn", const_cast<char**>(keywords),
+                                     &addresses, &window, &block_size, &precision, &threads) ||
+        !check_working_set(block_size, window, threads) || !check_precision(precision)) {
+        return nullptr;
+    }
+    TraceBuffer trace;
+    if (!trace.open(addresses, "addresses", false)) {
+        return nullptr;
+    }
+
+    WorkingSetAnalyzer analyzer(block_size, threads);
+    std::vector<uint64_t> scratch;
+    std::vector<double> estimates;
+    Py_BEGIN_ALLOW_THREADS
+    estimates = analyzer.estimate_windows(trace.widen(scratch), trace.size(), window,
+                                          static_cast<unsigned>(precision));
+    Py_END_ALLOW_THREADS
+    PyObject* bytes = PyByteArray_FromStringAndSize(
+        reinterpret_cast<const char*>(estimates.data()),
+        static_cast<Py_ssize_t>(estimates.size() * sizeof(double)));
+    return typed_view(bytes, "d");
+}
+
+// ============================================================================
+// Module
+// ============================================================================
+
+static PyMethodDef cachesim_methods[] = {
+    {"simulate", (PyCFunction)(void (*)(void))simulate, METH_VARARGS | METH_KEYWORDS,
+     "simulate(addresses, size, block=64, assoc=8, policy='lru', storage='flat', writes=None, "
+     "hits=None) -> CacheStats\n\n"
+     "One SetAssociativeCache over the trace. hits, if given, is a writable 1-byte array that "
+     "receives each access's hit flag."},
+    {"hierarchy", (PyCFunction)(void (*)(void))hierarchy, METH_VARARGS | METH_KEYWORDS,
+     "hierarchy(addresses, levels, inclusion='nine', block=64, writes=None) -> HierarchyStats\n\n"
+     "levels is a sequence of (size, ways) or (size, ways, policy), L1 first."},
+    {"sweep", (PyCFunction)(void (*)(void))sweep, METH_VARARGS | METH_KEYWORDS,
+     "sweep(addresses, sizes, assocs, block=64, policy='lru', writes=None, threads=0) -> "
+     "list of SweepPoint\n\n"
+     "Every size x assocs combination the cache can build, simulated in parallel."},
+    {"reuse_distances", (PyCFunction)(void (*)(void))reuse_distances,
+     METH_VARARGS | METH_KEYWORDS,
+     "reuse_distances(addresses, block_size=64, num_sets=1) -> memoryview of int64 "
+     "(-1 = first access)"},
+    {"miss_ratio_curve", (PyCFunction)(void (*)(void))miss_ratio_curve,
+     METH_VARARGS | METH_KEYWORDS,
+     "miss_ratio_curve(addresses, block_size=64, max_blocks=0, num_sets=1) -> memoryview of "
+     "double where [c] is the LRU miss ratio with c blocks (ways when num_sets > 1)"},
+    {"working_set", (PyCFunction)(void (*)(void))working_set, METH_VARARGS | METH_KEYWORDS,
+     "working_set(addresses, window, block_size=64, threads=0) -> memoryview of uint32\n\n"
+     "[i] is the number of distinct blocks in accesses [i, i + window); a single value for "
+     "the whole trace when it is shorter than window."},
+    {"footprint", (PyCFunction)(void (*)(void))footprint, METH_VARARGS | METH_KEYWORDS,
+     "footprint(addresses, windows, block_size=64, threads=0) -> Footprint\n\n"
+     "Mean working set over every window of each length, all lengths in one pass."},
+    {"unique_blocks", (PyCFunction)(void (*)(void))unique_blocks,
+     METH_VARARGS | METH_KEYWORDS,
+     "unique_blocks(addresses, block_size=64, precision=0, threads=0) -> int or float\n\n"
+     "Exact distinct blocks, or a HyperLogLog estimate with 2^precision registers "
+     "(precision 4..18)."},
+    {"working_set_estimate", (PyCFunction)(void (*)(void))working_set_estimate,
+     METH_VARARGS | METH_KEYWORDS,
+     "working_set_estimate(addresses, window, block_size=64, precision=14, threads=0) -> "
+     "memoryview of double\n\n"
+     "HyperLogLog estimate of the distinct blocks in each tumbling window (the last may be "
+     "shorter), for windows too large to count exactly."},
+    {nullptr, nullptr, 0, nullptr}};
+
+static PyModuleDef cachesim_module = {
+    PyModuleDef_HEAD_INIT, "cachesim",
+    "Set-associative cache, hierarchy, sweep, stack-distance and working-set engines (native)", -1,
+    cachesim_methods, nullptr, nullptr, nullptr, nullptr};
+
+static bool add_type(PyObject* module, PyTypeObject*& type, PyStructSequence_Desc* desc,
+                     const char* name) {
+    type = PyStructSequence_NewType(desc);
+    if (!type) {
+        return false;
+    }
+    Py_INCREF(type);
+    if (PyModule_AddObject(module, name, reinterpret_cast<PyObject*>(type)) < 0) {
+        Py_DECREF(type);
+        return false;
+    }
+    return true;
+}
+
+PyMODINIT_FUNC PyInit_cachesim(void) {
+    PyObject* module = PyModule_Create(&cachesim_module);
+    if (!module) {
+        return nullptr;
+    }
+    PyObject* names = PyTuple_New(sizeof(POLICY_NAMES) / sizeof(POLICY_NAMES[0]));
+    if (!names) {
+        Py_DECREF(module);
+        return nullptr;
+    }
+    for (size_t i = 0; i < sizeof(POLICY_NAMES) / sizeof(POLICY_NAMES[0]); i++) {
+        PyTuple_SET_ITEM(names, static_cast<Py_ssize_t>(i),
+                         PyUnicode_FromString(POLICY_NAMES[i].name));
+    }
+    if (PyModule_AddObject(module, "POLICIES", names) < 0) {
+        Py_DECREF(names);
+        Py_DECREF(module);
+        return nullptr;
+    }
+    if (!add_type(module, CacheStatsType, &cache_stats_desc, "CacheStats") ||
+        !add_type(module, LevelStatsType, &level_stats_desc, "LevelStats") ||
+        !add_type(module, HierarchyStatsType, &hierarchy_stats_desc, "HierarchyStats") ||
+        !add_type(module, SweepPointType, &sweep_point_desc, "SweepPoint") ||
+        !add_type(module, FootprintType, &footprint_desc, "Footprint")) {
+        Py_DECREF(module);
+        return nullptr;
+    }
+    return module;
+}
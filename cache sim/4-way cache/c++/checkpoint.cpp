@@ -0,0 +1,171 @@
+#include "checkpoint.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+constexpr size_t HEADER_BYTES = 16;        // magic, version, flags
+constexpr size_t SECTION_HEADER = 16;      // tag, payload size
+constexpr size_t WRITE_BUFFER = 1 << 20;
+}
+
+// ============================================================================
+// CheckpointWriter
+// ============================================================================
+
+CheckpointWriter::CheckpointWriter(const std::string& path)
+    : file(std::fopen(path.c_str(), "wb")), path(path), failed(false) {
+    if (!file) {
+        throw std::runtime_error("Could not create checkpoint: " + path);
+    }
+    std::setvbuf(file, nullptr, _IOFBF, WRITE_BUFFER);
+    put_bytes(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    put(CHECKPOINT_VERSION);
+    put(static_cast<uint32_t>(0));     // Flags, reserved
+}
+
+CheckpointWriter::~CheckpointWriter() {
+    if (file) {
+        std::fclose(file);
+    }
+}
+
+void CheckpointWriter::begin_section(const char* tag) {
+    char name[8] = {};
+    std::memcpy(name, tag, strnlen(tag, sizeof(name)));
+    put_bytes(name, sizeof(name));
+    open_sections.push_back(std::ftell(file));
+    put(static_cast<uint64_t>(0));     // Patched by end_section()
+}
+
+void CheckpointWriter::end_section() {
+    if (open_sections.empty()) {
+        throw std::logic_error("end_section() without begin_section()");
+    }
+    long size_field = open_sections.back();
+    open_sections.pop_back();
+    long end = std::ftell(file);
+    uint64_t size = static_cast<uint64_t>(end - size_field) - sizeof(uint64_t);
+    failed |= std::fseek(file, size_field, SEEK_SET) != 0;
+    put(size);
+    failed |= std::fseek(file, end, SEEK_SET) != 0;
+}
+
+void CheckpointWriter::put_bytes(const void* data, size_t n) {
+    if (n == 0) {
+        return;                 // An empty vector's data() may be null
+    }
+    if (std::fwrite(data, 1, n, file) != n) {
+        failed = true;
+    }
+}
+
+void CheckpointWriter::close() {
+    if (!file) {
+        return;
+    }
+    if (!open_sections.empty()) {
+        throw std::logic_error("Checkpoint closed with an open section");
+    }
+    failed |= std::fclose(file) != 0;
+    file = nullptr;
+    if (failed) {
+        throw std::runtime_error("Error writing checkpoint: " + path);
+    }
+}
+
+// ============================================================================
+// CheckpointReader
+// ============================================================================
+
+CheckpointReader::CheckpointReader(const std::string& path)
+    : base(nullptr), size(0), cursor(HEADER_BYTES) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open checkpoint: " + path);
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < HEADER_BYTES) {
+        ::close(fd);
+        throw std::runtime_error("Not a checkpoint (too short): " + path);
+    }
+    size = static_cast<size_t>(st.st_size);
+    void* map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        throw std::runtime_error("Could not mmap checkpoint: " + path);
+    }
+    base = static_cast<const char*>(map);
+
+    uint32_t version;
+    std::memcpy(&version, base + sizeof(CHECKPOINT_MAGIC), sizeof(version));
+    if (std::memcmp(base, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0 ||
+        version != CHECKPOINT_VERSION) {
+        ::munmap(const_cast<char*>(base), size);
+        throw std::runtime_error("Not a version " + std::to_string(CHECKPOINT_VERSION) +
+                                 " checkpoint: " + path);
+    }
+}
+
+CheckpointReader::~CheckpointReader() {
+    ::munmap(const_cast<char*>(base), size);
+}
+
+std::string CheckpointReader::peek_section() const {
+    if (limit() - cursor < SECTION_HEADER) {
+        return "";
+    }
+    return std::string(base + cursor, strnlen(base + cursor, 8));
+}
+
+void CheckpointReader::enter_section(const char* tag) {
+    std::string found = peek_section();
+    if (found != std::string(tag).substr(0, 8)) {
+        throw std::runtime_error("checkpoint: expected section " + std::string(tag) +
+                                 ", found " + (found.empty() ? "none" : found));
+    }
+    uint64_t payload;
+    std::memcpy(&payload, base + cursor + 8, sizeof(payload));
+    cursor += SECTION_HEADER;
+    if (payload > limit() - cursor) {
+        throw std::runtime_error("checkpoint: truncated section " + found);
+    }
+    section_ends.push_back(cursor + payload);
+}
+
+void CheckpointReader::leave_section() {
+    if (section_ends.empty() || cursor != section_ends.back()) {
+        throw std::runtime_error("checkpoint: section not fully read");
+    }
+    section_ends.pop_back();
+}
+
+void CheckpointReader::skip_section() {
+    enter_section(peek_section().c_str());
+    skip_rest();
+}
+
+void CheckpointReader::skip_rest() {
+    if (section_ends.empty()) {
+        throw std::logic_error("skip_rest() outside a section");
+    }
+    cursor = section_ends.back();
+    section_ends.pop_back();
+}
+
+void CheckpointReader::rewind() {
+    cursor = HEADER_BYTES;
+    section_ends.clear();
+}
+
+void CheckpointReader::get_bytes(void* data, size_t n) {
+    if (n == 0) {
+        return;                 // An empty vector's data() may be null
+    }
+    if (n > limit() - cursor) {
+        throw std::runtime_error("checkpoint: read past end of section");
+    }
+    std::memcpy(data, base + cursor, n);
+    cursor += n;
+}
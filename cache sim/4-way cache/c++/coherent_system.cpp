@@ -0,0 +1,246 @@
+#include "coherent_system.h"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <cassert>
+
+const char* protocol_name(CoherenceProtocol protocol) {
+    switch (protocol) {
+        case CoherenceProtocol::MESI:  return "MESI";
+        case CoherenceProtocol::MOESI: return "MOESI";
+    }
+    return "unknown";
+}
+
+bool parse_protocol(const std::string& name, CoherenceProtocol& protocol) {
+    if (name == "mesi")  { protocol = CoherenceProtocol::MESI;  return true; }
+    if (name == "moesi") { protocol = CoherenceProtocol::MOESI; return true; }
+    return false;
+}
+
+// ============================================================================
+// Constructor
+// ============================================================================
+
+CoherentSystem::CoherentSystem(size_t num_cores, const CacheLevelConfig& l1_config,
+                               const CacheLevelConfig& llc_config,
+                               CoherenceProtocol protocol_kind, size_t addr_bits)
+    : protocol(protocol_kind),
+      llc(llc_config.size, llc_config.block, llc_config.assoc, addr_bits,
+          llc_config.storage, llc_config.policy, false),
+      core_stats(num_cores), lost(num_cores), block_mask(~(l1_config.block - 1)) {
+    assert(num_cores > 0 && "Need at least one core");
+    assert(l1_config.block == llc_config.block && "L1 and LLC must share one block size");
+
+    l1.reserve(num_cores);
+    for (size_t i = 0; i < num_cores; i++) {
+        l1.emplace_back(l1_config.size, l1_config.block, l1_config.assoc, addr_bits,
+                        l1_config.storage, l1_config.policy, false);
+        lost[i].assign(l1[i].get_num_sets() * l1[i].get_associativity(), NO_BLOCK);
+    }
+}
+
+// ============================================================================
+// Protocol
+// ============================================================================
+
+bool CoherentSystem::access(uint32_t core, uint64_t address, AccessType type) {
+    assert(core < l1.size() && "Core id out of range");
+    SetAssociativeCache& cache = l1[core];
+    uint64_t block = address & block_mask;
+    bool is_write = type == AccessType::WRITE;
+
+    CoherenceState current = cache.coherence_state(block);
+    if (current != CoherenceState::INVALID) {
+        cache.access(address, type);
+        if (is_write && (current == CoherenceState::SHARED || current == CoherenceState::OWNED)) {
+            // The data is already here: only the other copies have to go
+            core_stats[core].upgrades++;
+            bus.bus_upgrades++;
+            invalidate_peers(core, block);
+            cache.set_coherence_state(block, CoherenceState::MODIFIED);
+        }
+        return true;
+    }
+
+    size_t line = first_line(block);
+    for (size_t w = 0; w < cache.get_associativity(); w++) {
+        if (lost[core][line + w] == block) {
+            core_stats[core].coherence_misses++;
+            lost[core][line + w] = NO_BLOCK;
+            break;
+        }
+    }
+
+    bool supplied;
+    bool shared = false;
+    if (is_write) {
+        bus.bus_read_exclusive++;
+        supplied = invalidate_peers(core, block);
+    } else {
+        bus.bus_reads++;
+        supplied = snoop_read(core, block, shared);
+    }
+    if (supplied) {
+        bus.cache_to_cache++;
+    } else {
+        read_llc(block);
+    }
+
+    // Fills EXCLUSIVE on a read, MODIFIED on a write
+    AccessResult r = cache.access(address, type);
+    // The fill reuses the line, so whatever was lost from it is forgotten
+    lost[core][first_line(block) + r.way] = NO_BLOCK;
+    if (r.evicted_dirty) {
+        core_stats[core].writebacks++;
+        write_back(cache.reconstruct_address(r.evicted_tag, r.set_index));
+    }
+    if (shared) {
+        cache.set_coherence_state(block, CoherenceState::SHARED);
+    }
+    return false;
+}
+
+/**
+ * BusRd: every other copy drops to SHARED (a MOESI owner keeps ownership)
+ * @param shared Set when some peer still holds the block afterwards
+ * @return true if a peer supplied the data
+ */
+bool CoherentSystem::snoop_read(uint32_t core, uint64_t block, bool& shared) {
+    bool supplied = false;
+    for (uint32_t peer = 0; peer < l1.size(); peer++) {
+        if (peer == core) continue;
+        switch (l1[peer].coherence_state(block)) {
+            case CoherenceState::INVALID:
+                continue;
+            case CoherenceState::MODIFIED:
+                if (protocol == CoherenceProtocol::MOESI) {
+                    l1[peer].set_coherence_state(block, CoherenceState::OWNED);
+                } else {
+                    bus.flushes++;
+                    write_back(block);
+                    l1[peer].set_coherence_state(block, CoherenceState::SHARED);
+                }
+                supplied = true;
+                break;
+            case CoherenceState::EXCLUSIVE:
+                l1[peer].set_coherence_state(block, CoherenceState::SHARED);
+                supplied = true;
+                break;
+            case CoherenceState::OWNED:
+                supplied = true;
+                break;
+            case CoherenceState::SHARED:
+                break;
+        }
+        shared = true;
+    }
+    return supplied;
+}
+
+/**
+ * BusRdX / BusUpgr: drop every other copy
+ * @return true if a peer owned the block (and so can supply its data)
+ */
+bool CoherentSystem::invalidate_peers(uint32_t core, uint64_t block) {
+    bool supplied = false;
+    for (uint32_t peer = 0; peer < l1.size(); peer++) {
+        if (peer == core) continue;
+        CoherenceState s = l1[peer].coherence_state(block);
+        if (s == CoherenceState::INVALID) continue;
+        // Dirty data moves to the writer, nothing is written back
+        supplied = supplied || s != CoherenceState::SHARED;
+        int way = 0;
+        l1[peer].invalidate(block, nullptr, &way);
+        core_stats[peer].invalidations++;
+        bus.invalidations++;
+        lost[peer][first_line(block) + way] = block;
+    }
+    return supplied;
+}
+
+/**
+ * Index of the first of block's L1 lines in a lost[] record (L1s share one geometry)
+ */
+size_t CoherentSystem::first_line(uint64_t block) const {
+    const SetAssociativeCache& cache = l1.front();
+    size_t set = (block >> cache.get_offset_bits()) & (cache.get_num_sets() - 1);
+    return set * cache.get_associativity();
+}
+
+void CoherentSystem::read_llc(uint64_t block) {
+    AccessResult r = llc.access(block, AccessType::READ);
+    if (!r.hit) {
+        bus.memory_reads++;
+    }
+    if (r.evicted_dirty) {
+        bus.memory_writes++;
+    }
+}
+
+void CoherentSystem::write_back(uint64_t block) {
+    if (llc.install(block, true).evicted_dirty) {
+        bus.memory_writes++;
+    }
+}
+
+void CoherentSystem::run(const std::vector<CoreAccess>& trace) {
+    for (const CoreAccess& a : trace) {
+        access(a.core, a.address, a.type);
+    }
+}
+
+// ============================================================================
+// Reporting
+// ============================================================================
+
+void CoherentSystem::print_report(std::ostream& out) const {
+    out << std::string(86, '=') << "\n";
+    out << "Coherent system (" << protocol_name(protocol) << ", " << l1.size() << " cores, "
+        << l1[0].get_cache_size() / 1024 << "KB " << l1[0].get_associativity() << "-way L1s, "
+        << llc.get_cache_size() / 1024 << "KB " << llc.get_associativity() << "-way LLC)\n";
+    out << std::string(86, '=') << "\n";
+    out << std::left << std::setw(8) << "Core"
+        << std::setw(12) << "Accesses"
+        << std::setw(11) << "Hits"
+        << std::setw(11) << "Hit Rate"
+        << std::setw(11) << "Coh Miss"
+        << std::setw(11) << "Upgrades"
+        << std::setw(11) << "Inv In"
+        << "WB Out\n";
+    out << std::string(86, '-') << "\n";
+    for (size_t i = 0; i < l1.size(); i++) {
+        CacheStats c = l1[i].get_stats();
+        const CoreStats& s = core_stats[i];
+        std::ostringstream rate;
+        rate << std::fixed << std::setprecision(2) << (c.hit_rate() * 100) << "%";
+        out << std::left << std::setw(8) << i
+            << std::setw(12) << (c.hits + c.misses)
+            << std::setw(11) << c.hits
+            << std::setw(11) << rate.str()
+            << std::setw(11) << s.coherence_misses
+            << std::setw(11) << s.upgrades
+            << std::setw(11) << s.invalidations
+            << s.writebacks << "\n";
+    }
+    out << std::string(86, '-') << "\n";
+    CacheStats l = llc.get_stats();
+    out << "LLC: " << (l.hits + l.misses) << " accesses, " << std::fixed << std::setprecision(2)
+        << (l.hit_rate() * 100) << "% hit rate\n";
+    out << "Bus: " << bus.bus_reads << " BusRd, " << bus.bus_read_exclusive << " BusRdX, "
+        << bus.bus_upgrades << " BusUpgr, " << bus.invalidations << " invalidations, "
+        << bus.cache_to_cache << " cache-to-cache, " << bus.flushes << " flushes\n";
+    out << "Memory reads: " << bus.memory_reads << ", memory writes: " << bus.memory_writes << "\n";
+}
+
+void CoherentSystem::reset() {
+    for (SetAssociativeCache& cache : l1) {
+        cache.reset();
+    }
+    llc.reset();
+    for (size_t i = 0; i < l1.size(); i++) {
+        core_stats[i] = CoreStats();
+        std::fill(lost[i].begin(), lost[i].end(), NO_BLOCK);
+    }
+    bus = BusStats();
+}
@@ -0,0 +1,75 @@
+#include "address_trace.h"
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstdlib>
+
+// ============================================================================
+// Address-trace policy comparison
+//
+// Replays one address trace through SetAssociativeCache once per
+// replacement policy and prints a hit-rate table, the native equivalent of
+// compare_policies() in python/analysis/eviction_policies.py.
+//
+// Trace format (same as memory_sim): one access per line, "R 0x1234" or
+// "W 0x1234". Other lines are skipped.
+// ============================================================================
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <trace_file|-> [size_bytes] [block_bytes] [ways]\n";
+        std::cerr << "Example: " << argv[0] << " trace.txt 32768 64 8\n";
+        return 1;
+    }
+
+    std::string trace_file = argv[1];
+    size_t size = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 32768;
+    size_t block = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 64;
+    size_t ways = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 8;
+
+    std::vector<TraceEntry> trace;
+    if (trace_file == "-") {
+        trace = read_address_trace(std::cin);
+    } else {
+        std::ifstream file(trace_file);
+        if (!file.is_open()) {
+            std::cerr << "Error: Could not open trace file: " << trace_file << "\n";
+            return 1;
+        }
+        trace = read_address_trace(file);
+    }
+
+    const PolicyType policies[] = {PolicyType::LRU, PolicyType::FIFO, PolicyType::RANDOM,
+                                   PolicyType::PLRU, PolicyType::SRRIP, PolicyType::BRRIP,
+                                   PolicyType::DRRIP, PolicyType::SHIP, PolicyType::ARC};
+    std::vector<CacheStats> results;
+
+    for (PolicyType p : policies) {
+        SetAssociativeCache cache(size, block, ways, 64, StorageMode::FLAT, p, false);
+        cache.access_batch(trace);
+        results.push_back(cache.get_stats());
+    }
+
+    std::cout << std::string(60, '=') << "\n";
+    std::cout << "Trace: " << trace.size() << " accesses, " << size << "B, "
+              << block << "B blocks, " << ways << "-way\n";
+    std::cout << std::string(60, '=') << "\n";
+    std::cout << std::left << std::setw(15) << "Policy"
+              << std::setw(12) << "Hits"
+              << std::setw(12) << "Misses"
+              << std::setw(12) << "Writebacks"
+              << "Hit Rate\n";
+    std::cout << std::string(60, '-') << "\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const CacheStats& s = results[i];
+        std::cout << std::left << std::setw(15) << policy_name(policies[i])
+                  << std::setw(12) << s.hits
+                  << std::setw(12) << s.misses
+                  << std::setw(12) << s.dirty_evictions
+                  << std::fixed << std::setprecision(2) << (s.hit_rate() * 100) << "%\n";
+    }
+
+    return 0;
+}
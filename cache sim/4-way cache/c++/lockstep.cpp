@@ -0,0 +1,550 @@
+#include "lockstep.h"
+#include "fixed_cache.h"
+#include "sharded_simulator.h"
+#include "tag_store.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+
+namespace {
+constexpr size_t MTR_HEADER_BYTES = 32;
+constexpr size_t MTR_MIN_RECORD_BYTES = 16;
+constexpr size_t MTR_OP_OFFSET = 14;        // TraceRecord::op
+constexpr size_t SHARDED_THREADS = 4;       // Engine "sharded": 4 shards on any machine
+
+/** First field two results disagree on, nullptr if none */
+const char* first_difference(const AccessResult& expected, const AccessResult& actual) {
+    if (expected.hit != actual.hit) return "hit";
+    if (expected.set_index != actual.set_index) return "set_index";
+    if (expected.way != actual.way) return "way";
+    if (expected.evicted != actual.evicted) return "evicted";
+    if (expected.evicted && expected.evicted_tag != actual.evicted_tag) return "evicted_tag";
+    if (expected.evicted_dirty != actual.evicted_dirty) return "evicted_dirty";
+    return nullptr;
+}
+
+bool same_stats(const CacheStats& a, const CacheStats& b) {
+    return a.hits == b.hits && a.misses == b.misses && a.reads == b.reads &&
+           a.writes == b.writes && a.evictions == b.evictions &&
+           a.dirty_evictions == b.dirty_evictions;
+}
+
+std::string describe(const AccessResult& r) {
+    std::ostringstream s;
+    s << (r.hit ? "hit" : "miss") << " set=" << r.set_index << " way=" << r.way;
+    if (r.evicted) {
+        s << " evicted tag=0x" << std::hex << r.evicted_tag << std::dec
+          << (r.evicted_dirty ? " (dirty)" : " (clean)");
+    } else if (r.evicted_dirty) {
+        s << " evicted_dirty without eviction";
+    }
+    return s.str();
+}
+
+const char* type_name(AccessType type) {
+    return type == AccessType::WRITE ? "W" : "R";
+}
+
+// ============================================================================
+// Engines
+// ============================================================================
+
+/** SetAssociativeCache in one storage mode, per access or batched */
+class CacheEngine : public LockstepEngine {
+public:
+    CacheEngine(const std::string& name, size_t size, size_t block, size_t assoc,
+                StorageMode mode, bool batch)
+        : label(name), cache(size, block, assoc, 64, mode, PolicyType::LRU, false),
+          batch(batch) {}
+
+    const std::string& name() const override { return label; }
+
+    void run(const TraceEntry* entries, size_t n, AccessResult* results) override {
+        if (batch) {
+            cache.access_batch(entries, n, results);
+            return;
+        }
+        for (size_t i = 0; i < n; i++) {
+            results[i] = cache.access(entries[i].address, entries[i].type);
+        }
+    }
+
+    CacheStats get_stats() const override { return cache.get_stats(); }
+
+private:
+    std::string label;
+    SetAssociativeCache cache;
+    bool batch;
+};
+
+template <typename Cache>
+class FixedEngine : public LockstepEngine {
+public:
+    explicit FixedEngine(size_t size) : label("fixed"), cache(size) {}
+
+    const std::string& name() const override { return label; }
+
+    void run(const TraceEntry* entries, size_t n, AccessResult* results) override {
+        for (size_t i = 0; i < n; i++) {
+            results[i] = cache.access(entries[i].address, entries[i].type);
+        }
+    }
+
+    CacheStats get_stats() const override { return cache.get_stats(); }
+
+private:
+    std::string label;
+    Cache cache;
+};
+
+class ShardedEngine : public LockstepEngine {
+public:
+    ShardedEngine(size_t size, size_t block, size_t assoc)
+        : label("sharded"), sim(size, block, assoc, SHARDED_THREADS, 64) {}
+
+    const std::string& name() const override { return label; }
+
+    void run(const TraceEntry* entries, size_t n, AccessResult* results) override {
+        sim.run(entries, n, results);
+    }
+
+    CacheStats get_stats() const override { return sim.get_stats(); }
+
+private:
+    std::string label;
+    ShardedSimulator sim;
+};
+}
+
+// ============================================================================
+// Synthetic traces
+// ============================================================================
+
+const char* synthetic_pattern_name(SyntheticPattern pattern) {
+    switch (pattern) {
+        case SyntheticPattern::RANDOM:   return "random";
+        case SyntheticPattern::STREAM:   return "stream";
+        case SyntheticPattern::HOT:      return "hot";
+        case SyntheticPattern::CONFLICT: return "conflict";
+        case SyntheticPattern::MIXED:    return "mixed";
+    }
+    return "unknown";
+}
+
+bool parse_synthetic_pattern(const std::string& name, SyntheticPattern& pattern) {
+    const SyntheticPattern all[] = {SyntheticPattern::RANDOM, SyntheticPattern::STREAM,
+                                    SyntheticPattern::HOT, SyntheticPattern::CONFLICT,
+                                    SyntheticPattern::MIXED};
+    for (SyntheticPattern p : all) {
+        if (name == synthetic_pattern_name(p)) {
+            pattern = p;
+            return true;
+        }
+    }
+    return false;
+}
+
+SyntheticTrace::SyntheticTrace(const SyntheticTraceConfig& config)
+    : config(config), state(config.seed * 0x9E3779B97F4A7C15ULL + 1), produced(0),
+      stream_next(0), conflict_next(0) {
+    double w = std::min(1.0, std::max(0.0, config.write_fraction));
+    write_threshold = static_cast<uint64_t>(w * 4294967296.0);
+    this->config.footprint = std::max<uint64_t>(this->config.footprint, 64);
+    this->config.assoc = std::max<uint64_t>(this->config.assoc, 1);
+}
+
+/** xorshift64* */
+uint64_t SyntheticTrace::random_u64() {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545F4914F6CDD1DULL;
+}
+
+uint64_t SyntheticTrace::address_for(SyntheticPattern pattern) {
+    const uint64_t footprint = config.footprint;
+    switch (pattern) {
+        case SyntheticPattern::RANDOM:
+            return (random_u64() % footprint) & ~7ULL;
+        case SyntheticPattern::STREAM:
+            stream_next = (stream_next + 64) % footprint;
+            return stream_next;
+        case SyntheticPattern::HOT: {
+            uint64_t r = random_u64();
+            uint64_t span = r % 5 != 0 ? std::max<uint64_t>(footprint / 16, 64) : footprint;
+            return ((r >> 8) % span) & ~7ULL;
+        }
+        case SyntheticPattern::CONFLICT:
+            return (conflict_next++ % (2 * config.assoc)) * config.stride;
+        case SyntheticPattern::MIXED:
+            break;
+    }
+    return address_for(static_cast<SyntheticPattern>(random_u64() >> 62));
+}
+
+size_t SyntheticTrace::next(TraceEntry* out, size_t max) {
+    size_t n = static_cast<size_t>(std::min<uint64_t>(max, config.accesses - produced));
+    for (size_t i = 0; i < n; i++) {
+        out[i].address = address_for(config.pattern);
+        out[i].type = (random_u64() >> 32) < write_threshold ? AccessType::WRITE
+                                                             : AccessType::READ;
+    }
+    produced += n;
+    return n;
+}
+
+// ============================================================================
+// Trace files
+// ============================================================================
+
+TraceFile::TraceFile(const std::string& path)
+    : in(path, std::ios::binary), format(Format::TEXT), remaining(0),
+      record_bytes(sizeof(uint64_t)) {
+    if (!in) {
+        throw std::runtime_error("Can't open trace " + path);
+    }
+    char header[MTR_HEADER_BYTES] = {};
+    in.read(header, sizeof(header));
+    const size_t got = static_cast<size_t>(in.gcount());
+
+    if (got >= 8 && std::memcmp(header, "MEMTRACE", 8) == 0) {
+        uint32_t record_size;
+        std::memcpy(&record_size, header + 12, sizeof(record_size));
+        std::memcpy(&remaining, header + 16, sizeof(remaining));
+        if (got < MTR_HEADER_BYTES || record_size < MTR_MIN_RECORD_BYTES) {
+            throw std::runtime_error("Malformed .mtr header in " + path);
+        }
+        format = Format::MTR;
+        record_bytes = record_size;
+        return;
+    }
+    in.clear();
+    in.seekg(0);
+    const bool raw = path.size() >= 4 && path.compare(path.size() - 4, 4, ".bin") == 0;
+    format = raw ? Format::RAW : Format::TEXT;
+}
+
+size_t TraceFile::next(TraceEntry* out, size_t max) {
+    if (format == Format::MTR) {
+        size_t n = static_cast<size_t>(std::min<uint64_t>(max, remaining));
+        buffer.resize(n * record_bytes);
+        in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        n = static_cast<size_t>(in.gcount()) / record_bytes;
+        for (size_t i = 0; i < n; i++) {
+            const char* r = buffer.data() + i * record_bytes;
+            std::memcpy(&out[i].address, r, sizeof(uint64_t));
+            out[i].type = r[MTR_OP_OFFSET] == 1 ? AccessType::WRITE : AccessType::READ;
+        }
+        remaining = n > 0 ? remaining - n : 0;
+        return n;
+    }
+
+    if (format == Format::RAW) {
+        buffer.resize(max * sizeof(uint64_t));
+        in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        size_t n = static_cast<size_t>(in.gcount()) / sizeof(uint64_t);
+        for (size_t i = 0; i < n; i++) {
+            std::memcpy(&out[i].address, buffer.data() + i * sizeof(uint64_t), sizeof(uint64_t));
+            out[i].type = AccessType::READ;
+        }
+        return n;
+    }
+
+    size_t n = 0;
+    std::string line, first;
+    while (n < max && std::getline(in, line)) {
+        std::istringstream fields(line);
+        if (!(fields >> first) || first[0] == '#') {
+            continue;
+        }
+        uint64_t addr;
+        AccessType type = AccessType::READ;
+        if (first.size() == 1 && std::strchr("RrWw", first[0]) != nullptr) {
+            if (!(fields >> std::hex >> addr)) {
+                continue;
+            }
+            type = (first[0] == 'W' || first[0] == 'w') ? AccessType::WRITE : AccessType::READ;
+        } else {
+            // Bare address, as python/validation writes: hex with 0x, else decimal
+            char* end = nullptr;
+            bool hex = first.size() > 2 && first[0] == '0' && (first[1] == 'x' || first[1] == 'X');
+            addr = std::strtoull(first.c_str(), &end, hex ? 16 : 10);
+            if (end == first.c_str() || *end != '\0') {
+                continue;
+            }
+        }
+        out[n++] = {addr, type};
+    }
+    return n;
+}
+
+// ============================================================================
+// Engine registry
+// ============================================================================
+
+const std::vector<std::string>& lockstep_engine_names() {
+    static const std::vector<std::string> names = {"per-set", "flat", "sparse",
+                                                   "batch", "fixed", "sharded"};
+    return names;
+}
+
+std::unique_ptr<LockstepEngine> make_lockstep_engine(const std::string& name, size_t size,
+                                                     size_t block, size_t assoc) {
+    const bool flat_ok = assoc <= TagStore::MAX_WAYS;
+    if (name == "per-set") {
+        return std::make_unique<CacheEngine>(name, size, block, assoc, StorageMode::PER_SET,
+                                             false);
+    }
+    if (name == "flat" && flat_ok) {
+        return std::make_unique<CacheEngine>(name, size, block, assoc, StorageMode::FLAT, false);
+    }
+    if (name == "sparse" && flat_ok) {
+        return std::make_unique<CacheEngine>(name, size, block, assoc, StorageMode::SPARSE,
+                                             false);
+    }
+    if (name == "batch" && flat_ok) {
+        return std::make_unique<CacheEngine>(name, size, block, assoc, StorageMode::FLAT, true);
+    }
+    if (name == "fixed") {
+        // The dispatcher hands over a cache of the right type; build our own of it
+        std::unique_ptr<LockstepEngine> engine;
+        dispatch_fixed_cache(size, block, assoc, [&](auto& cache) {
+            using Cache = std::decay_t<decltype(cache)>;
+            engine = std::make_unique<FixedEngine<Cache>>(size);
+        });
+        return engine;
+    }
+    if (name == "sharded" && flat_ok) {
+        return std::make_unique<ShardedEngine>(size, block, assoc);
+    }
+    return nullptr;
+}
+
+// ============================================================================
+// Validator
+// ============================================================================
+
+LockstepValidator::LockstepValidator(size_t size, size_t block, size_t assoc, size_t chunk,
+                                     size_t history)
+    : reference(size, block, assoc), chunk(std::max<size_t>(chunk, 1)), history(history),
+      compared(0) {}
+
+void LockstepValidator::add_engine(std::unique_ptr<LockstepEngine> engine) {
+    engines.push_back(std::move(engine));
+}
+
+/**
+ * Fill d's context from the chunk being compared (chunks[1], up to offset)
+ * and the one before it (chunks[0])
+ */
+void LockstepValidator::record_divergence(Divergence& d,
+                                          const std::vector<TraceEntry>* chunks[2],
+                                          const std::vector<AccessResult>* results[2],
+                                          size_t offset) {
+    const uint64_t set = d.expected.set_index;
+    uint64_t base = d.index - offset;
+    size_t end = offset;
+    for (int c = 1; c >= 0 && d.history.size() < history; c--) {
+        for (size_t i = end; i-- > 0 && d.history.size() < history;) {
+            if ((*results[c])[i].set_index == set) {
+                d.history.push_back({base + i, (*chunks[c])[i], (*results[c])[i]});
+            }
+        }
+        if (c == 1) {
+            end = chunks[0]->size();
+            base -= end;
+        }
+    }
+    std::reverse(d.history.begin(), d.history.end());
+
+    d.lines = reference.get_set(set).lines;
+    d.lru_order = reference.get_lru_order(set);
+}
+
+LockstepReport LockstepValidator::run(TraceSource& source, uint64_t limit, uint64_t progress,
+                                      std::ostream& out) {
+    LockstepReport report;
+    const auto start = std::chrono::steady_clock::now();
+    const size_t E = engines.size();
+
+    // Three entry chunks (previous, being compared, in flight) and two sets
+    // of results (being compared, in flight). The previous chunk's entries
+    // and reference results stay around for the history; before chunk 1
+    // they are empty.
+    std::vector<TraceEntry> entries[3];
+    std::vector<AccessResult> expected[2];
+    std::vector<std::vector<AccessResult>> actual[2];
+    actual[0].resize(E);
+    actual[1].resize(E);
+    uint64_t pulled = 0;
+
+    auto fill = [&](std::vector<TraceEntry>& buf) {
+        size_t want = chunk;
+        if (limit > 0) {
+            want = static_cast<size_t>(std::min<uint64_t>(want, limit - pulled));
+        }
+        buf.resize(want);
+        size_t n = 0;
+        while (n < want) {
+            size_t got = source.next(buf.data() + n, want - n);
+            if (got == 0) {
+                break;
+            }
+            n += got;
+        }
+        buf.resize(n);
+        pulled += n;
+    };
+    auto launch = [&](const std::vector<TraceEntry>& buf, size_t slot) {
+        std::vector<std::thread> workers;
+        for (size_t e = 0; e < E && !buf.empty(); e++) {
+            actual[slot][e].resize(buf.size());
+            workers.emplace_back([&, e, slot] {
+                engines[e]->run(buf.data(), buf.size(), actual[slot][e].data());
+            });
+        }
+        return workers;
+    };
+
+    fill(entries[0]);
+    std::vector<std::thread> workers = launch(entries[0], 0);
+    uint64_t next_progress = progress;
+    for (uint64_t c = 0; !entries[c % 3].empty(); c++) {
+        for (std::thread& w : workers) {
+            w.join();
+        }
+        std::vector<TraceEntry>& now = entries[c % 3];
+        std::vector<AccessResult>& ref = expected[c % 2];
+        const std::vector<std::vector<AccessResult>>& got = actual[c % 2];
+
+        // Engines start on the next chunk while this one is compared
+        fill(entries[(c + 1) % 3]);
+        workers = launch(entries[(c + 1) % 3], (c + 1) % 2);
+
+        const size_t n = now.size();
+        ref.resize(n);
+        for (size_t i = 0; i < n && !report.diverged; i++) {
+            ref[i] = reference.access(now[i].address, now[i].type);
+            for (size_t e = 0; e < E; e++) {
+                const char* field = first_difference(ref[i], got[e][i]);
+                if (field) {
+                    Divergence& d = report.divergence;
+                    d.engine = engines[e]->name();
+                    d.index = compared + i;
+                    d.entry = now[i];
+                    d.field = field;
+                    d.expected = ref[i];
+                    d.actual = got[e][i];
+                    const std::vector<TraceEntry>* chunks[2] = {&entries[(c + 2) % 3], &now};
+                    const std::vector<AccessResult>* results[2] = {&expected[(c + 1) % 2],
+                                                                    &ref};
+                    record_divergence(d, chunks, results, i);
+                    report.diverged = true;
+                    compared += i + 1;
+                    break;
+                }
+            }
+        }
+        if (report.diverged) {
+            break;
+        }
+        compared += n;
+
+        if (progress > 0 && compared >= next_progress) {
+            double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+                           .count();
+            out << "  " << compared << " accesses, " << std::fixed << std::setprecision(1)
+                << (s > 0 ? compared / s / 1e6 : 0.0) << " M/s" << std::endl;
+            next_progress += progress;
+        }
+    }
+    for (std::thread& w : workers) {
+        w.join();
+    }
+
+    report.accesses = compared;
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+                         .count();
+    report.reference = reference.get_stats();
+    for (const auto& engine : engines) {
+        report.engines.push_back(engine->name());
+        report.engine_stats.push_back(engine->get_stats());
+    }
+    return report;
+}
+
+bool LockstepReport::passed() const {
+    if (diverged) {
+        return false;
+    }
+    for (const CacheStats& s : engine_stats) {
+        if (!same_stats(s, reference)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// ============================================================================
+// Reporting
+// ============================================================================
+
+void print_lockstep_report(const LockstepReport& report, std::ostream& out) {
+    out << std::string(70, '=') << "\n";
+    out << "Lockstep validation: " << report.accesses << " accesses in " << std::fixed
+        << std::setprecision(2) << report.seconds << " s ("
+        << std::setprecision(1) << report.accesses_per_second() / 1e6 << " M accesses/s)\n";
+    out << std::string(70, '=') << "\n";
+
+    if (!report.diverged) {
+        for (size_t e = 0; e < report.engines.size(); e++) {
+            const CacheStats& s = report.engine_stats[e];
+            bool ok = same_stats(s, report.reference);
+            out << std::left << std::setw(10) << report.engines[e]
+                << (ok ? "PASS" : "STATS DIFFER") << "  hits=" << s.hits
+                << " misses=" << s.misses << " dirty_evictions=" << s.dirty_evictions;
+            if (!ok) {
+                const CacheStats& r = report.reference;
+                out << " (reference hits=" << r.hits << " misses=" << r.misses
+                    << " dirty_evictions=" << r.dirty_evictions << ")";
+            }
+            out << "\n";
+        }
+        return;
+    }
+
+    const Divergence& d = report.divergence;
+    out << "DIVERGENCE in " << d.engine << " at access " << d.index << ": "
+        << type_name(d.entry.type) << " 0x" << std::hex << d.entry.address << std::dec
+        << ", field " << d.field << "\n";
+    out << "  expected: " << describe(d.expected) << "\n";
+    out << "  actual:   " << describe(d.actual) << "\n";
+
+    out << "Earlier accesses to set " << d.expected.set_index << " (reference results):\n";
+    if (d.history.empty()) {
+        out << "  (none in the last two chunks)\n";
+    }
+    for (const SetAccess& a : d.history) {
+        out << "  #" << std::setw(12) << std::left << a.index << type_name(a.entry.type)
+            << " 0x" << std::hex << a.entry.address << std::dec << "  " << describe(a.result)
+            << "\n";
+    }
+
+    out << "Reference set " << d.expected.set_index << " after the access:\n";
+    for (size_t way = 0; way < d.lines.size(); way++) {
+        const CacheLine& line = d.lines[way];
+        out << "  Way " << way << ": " << (line.valid ? "V" : "-") << (line.dirty ? "D" : "-")
+            << " Tag=0x" << std::hex << line.tag << std::dec << "\n";
+    }
+    out << "  LRU order: [";
+    for (size_t i = 0; i < d.lru_order.size(); i++) {
+        out << (i > 0 ? ", " : "") << d.lru_order[i];
+    }
+    out << "] (left=LRU, right=MRU)\n";
+}
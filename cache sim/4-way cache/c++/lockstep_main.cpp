@@ -0,0 +1,148 @@
+#include "lockstep.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+// ============================================================================
+// Lockstep differential validation
+//
+// Runs the reference LRU cache (ReferenceCache: CacheSet + LRUTracker, the
+// original model) in lockstep with the optimized engines and compares every
+// access's hit, way, set, eviction and victim. Stops at the first divergence
+// and prints the access, both results, the earlier accesses to that set and
+// the reference's view of it. Exit status 0 = every engine matched.
+//
+// The trace is a file (.mtr binary, .bin raw uint64 addresses, or text
+// "R 0x1234" lines) or, without one, a synthetic trace of --accesses
+// accesses. Either is streamed a chunk at a time, so run length is bounded
+// by time, not memory.
+// ============================================================================
+
+static std::vector<std::string> split(const std::string& s, char sep) {
+    std::vector<std::string> parts;
+    std::stringstream in(s);
+    std::string part;
+    while (std::getline(in, part, sep)) {
+        parts.push_back(part);
+    }
+    return parts;
+}
+
+static bool power_of_2(size_t n) { return n > 0 && (n & (n - 1)) == 0; }
+
+int main(int argc, char* argv[]) {
+    size_t size = 32768;
+    size_t block = 64;
+    size_t ways = 8;
+    size_t chunk = LockstepValidator::DEFAULT_CHUNK;
+    uint64_t limit = 0;
+    uint64_t progress = 0;
+    std::string engine_list;
+    std::string trace_file;
+    SyntheticTraceConfig synthetic;
+    synthetic.accesses = 100000000;
+    bool footprint_set = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--size" && has_value) {
+            size = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--block" && has_value) {
+            block = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--ways" && has_value) {
+            ways = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--engines" && has_value) {
+            engine_list = argv[++i];
+        } else if (arg == "--accesses" && has_value) {
+            synthetic.accesses = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--pattern" && has_value) {
+            if (!parse_synthetic_pattern(argv[++i], synthetic.pattern)) {
+                std::cerr << "Error: Pattern must be random, stream, hot, conflict or mixed, got "
+                          << argv[i] << "\n";
+                return 1;
+            }
+        } else if (arg == "--footprint" && has_value) {
+            synthetic.footprint = std::strtoull(argv[++i], nullptr, 10);
+            footprint_set = true;
+        } else if (arg == "--writes" && has_value) {
+            synthetic.write_fraction = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--seed" && has_value) {
+            synthetic.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--limit" && has_value) {
+            limit = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--chunk" && has_value) {
+            chunk = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--progress" && has_value) {
+            progress = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg.rfind("--", 0) != 0 && trace_file.empty()) {
+            trace_file = arg;
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--size B] [--block B] [--ways N] [--engines a,b,...] [--limit N]"
+                         " [--chunk N] [--progress N] [trace_file]\n"
+                      << "       synthetic (no trace_file): [--accesses N]"
+                         " [--pattern random|stream|hot|conflict|mixed] [--footprint B]"
+                         " [--writes F] [--seed S]\n";
+            std::cerr << "Engines: ";
+            for (const std::string& name : lockstep_engine_names()) {
+                std::cerr << name << " ";
+            }
+            std::cerr << "(default: all that support the geometry)\n";
+            std::cerr << "Example: " << argv[0] << " --size 1048576 --ways 16 --accesses 1000000000\n";
+            std::cerr << "         " << argv[0] << " --engines flat,batch trace.mtr\n";
+            return 1;
+        }
+    }
+
+    if (!power_of_2(block) || !power_of_2(ways) || size % (block * ways) != 0 ||
+        !power_of_2(size / block / ways)) {
+        std::cerr << "Error: Block size, ways and number of sets must be powers of 2\n";
+        return 1;
+    }
+
+    LockstepValidator validator(size, block, ways, chunk);
+    const bool all = engine_list.empty();
+    for (const std::string& name : all ? lockstep_engine_names() : split(engine_list, ',')) {
+        std::unique_ptr<LockstepEngine> engine = make_lockstep_engine(name, size, block, ways);
+        if (engine) {
+            validator.add_engine(std::move(engine));
+        } else if (all) {
+            std::cout << "Skipping " << name << ": no build for this geometry\n";
+        } else {
+            std::cerr << "Error: Unknown engine or unsupported geometry: " << name << "\n";
+            return 1;
+        }
+    }
+
+    std::unique_ptr<TraceSource> source;
+    try {
+        if (trace_file.empty()) {
+            synthetic.stride = size / ways;
+            synthetic.assoc = ways;
+            if (!footprint_set) {
+                synthetic.footprint = 8 * static_cast<uint64_t>(size);
+            }
+            source = std::make_unique<SyntheticTrace>(synthetic);
+            std::cout << "Trace: synthetic " << synthetic_pattern_name(synthetic.pattern) << ", "
+                      << synthetic.accesses << " accesses over " << synthetic.footprint
+                      << " B, seed " << synthetic.seed << "\n";
+        } else {
+            source = std::make_unique<TraceFile>(trace_file);
+            std::cout << "Trace: " << trace_file << "\n";
+        }
+    } catch (const std::runtime_error& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    std::cout << "Cache: " << size << "B, " << block << "B blocks, " << ways << "-way, "
+              << validator.get_num_engines() << " engines vs reference\n";
+
+    LockstepReport report = validator.run(*source, limit, progress);
+    print_lockstep_report(report);
+    return report.passed() ? 0 : 1;
+}
@@ -0,0 +1,81 @@
+#include "sharded_simulator.h"
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <cstdlib>
+
+// ============================================================================
+// Set-sharded parallel simulation
+//
+// Replays one address trace through a single cache configuration twice:
+// serially and with ShardedSimulator. Prints both timings and checks that
+// the stats agree.
+// ============================================================================
+
+static void print_stats(const char* label, const CacheStats& s, double ms) {
+    std::cout << std::left << std::setw(12) << label
+              << std::setw(12) << s.hits
+              << std::setw(12) << s.misses
+              << std::setw(12) << s.dirty_evictions
+              << std::fixed << std::setprecision(2) << std::setw(10) << (s.hit_rate() * 100)
+              << std::setprecision(1) << ms << " ms\n";
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <trace_file|-> [size_bytes] [block_bytes] [ways] [threads]\n";
+        std::cerr << "Example: " << argv[0] << " trace.txt 1048576 64 16 8\n";
+        return 1;
+    }
+
+    std::string trace_file = argv[1];
+    size_t size = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 32768;
+    size_t block = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 64;
+    size_t ways = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 8;
+    size_t threads = argc > 5 ? std::strtoull(argv[5], nullptr, 10) : 0;
+
+    std::vector<TraceEntry> trace;
+    if (trace_file == "-") {
+        trace = read_address_trace(std::cin);
+    } else {
+        std::ifstream file(trace_file);
+        if (!file.is_open()) {
+            std::cerr << "Error: Could not open trace file: " << trace_file << "\n";
+            return 1;
+        }
+        trace = read_address_trace(file);
+    }
+
+    using clock = std::chrono::steady_clock;
+
+    auto t0 = clock::now();
+    SetAssociativeCache serial(size, block, ways, 64, StorageMode::FLAT, PolicyType::LRU, false);
+    serial.access_batch(trace);
+    auto t1 = clock::now();
+    ShardedSimulator sharded(size, block, ways, threads, 64);
+    sharded.run(trace);
+    auto t2 = clock::now();
+
+    CacheStats a = serial.get_stats();
+    CacheStats b = sharded.get_stats();
+
+    std::cout << "Trace: " << std::dec << trace.size() << " accesses, " << size << "B, "
+              << block << "B blocks, " << ways << "-way, " << sharded.get_num_threads()
+              << " threads / " << sharded.get_num_shards() << " shards\n";
+    std::cout << std::left << std::setw(12) << "Run"
+              << std::setw(12) << "Hits"
+              << std::setw(12) << "Misses"
+              << std::setw(12) << "Writebacks"
+              << std::setw(10) << "Hit %"
+              << "Time\n";
+    print_stats("serial", a, std::chrono::duration<double, std::milli>(t1 - t0).count());
+    print_stats("sharded", b, std::chrono::duration<double, std::milli>(t2 - t1).count());
+
+    bool match = a.hits == b.hits && a.misses == b.misses &&
+                 a.dirty_evictions == b.dirty_evictions && a.evictions == b.evictions;
+    std::cout << (match ? "Results match\n" : "MISMATCH between serial and sharded runs\n");
+    return match ? 0 : 1;
+}
@@ -0,0 +1,264 @@
+#include "prefetcher.h"
+#include "checkpoint.h"
+#include <cassert>
+
+namespace {
+size_t block_shift_of(size_t block_size) {
+    assert(block_size > 0 && (block_size & (block_size - 1)) == 0 && "Block size must be power of 2");
+    return static_cast<size_t>(__builtin_ctzll(block_size));
+}
+
+/**
+ * Block number `steps` blocks away, false if it would leave the address space
+ */
+bool step_block(uint64_t block, int64_t steps, uint64_t& out) {
+    if (steps < 0 && block < static_cast<uint64_t>(-steps)) {
+        return false;
+    }
+    out = block + static_cast<uint64_t>(steps);
+    return true;
+}
+}
+
+// ============================================================================
+// NextLinePrefetcher
+// ============================================================================
+
+NextLinePrefetcher::NextLinePrefetcher(size_t block_size, size_t degree)
+    : block_shift(block_shift_of(block_size)), degree(degree) {}
+
+void NextLinePrefetcher::observe(const PrefetchEvent& event, std::vector<uint64_t>& candidates) {
+    if (event.hit && !event.prefetch_hit) {
+        return;
+    }
+    uint64_t block = event.address >> block_shift;
+    for (size_t k = 1; k <= degree; k++) {
+        candidates.push_back((block + k) << block_shift);
+    }
+}
+
+// ============================================================================
+// StridePrefetcher
+// ============================================================================
+
+StridePrefetcher::StridePrefetcher(size_t block_size, size_t degree, size_t table_size)
+    : block_shift(block_shift_of(block_size)), degree(degree), table(table_size) {
+    assert(table_size > 0 && (table_size & (table_size - 1)) == 0 &&
+           "Stride table size must be power of 2");
+}
+
+void StridePrefetcher::observe(const PrefetchEvent& event, std::vector<uint64_t>& candidates) {
+    uint64_t block = event.address >> block_shift;
+    uint64_t region = event.address >> REGION_BITS;
+    Entry& e = table[region & (table.size() - 1)];
+    
+    if (e.region != region) {
+        e = Entry();
+        e.region = region;
+        e.last_block = block;
+        return;
+    }
+    
+    int64_t stride = static_cast<int64_t>(block - e.last_block);
+    if (stride == 0) {
+        return;     // Same block again, nothing to learn
+    }
+    if (stride == e.stride) {
+        if (e.confidence < 3) e.confidence++;
+    } else {
+        e.stride = stride;
+        e.confidence = 0;
+    }
+    e.last_block = block;
+    
+    if (e.confidence == 0) {
+        return;
+    }
+    // Stay inside the region, like hardware that won't cross a page
+    for (size_t k = 1; k <= degree; k++) {
+        uint64_t target;
+        if (!step_block(block, e.stride * static_cast<int64_t>(k), target)) {
+            break;
+        }
+        uint64_t address = target << block_shift;
+        if ((address >> REGION_BITS) != region) {
+            break;
+        }
+        candidates.push_back(address);
+    }
+}
+
+void StridePrefetcher::reset() {
+    for (auto& e : table) {
+        e = Entry();
+    }
+}
+
+void StridePrefetcher::save(CheckpointWriter& out) const {
+    out.put(static_cast<uint64_t>(table.size()));
+    for (const Entry& e : table) {
+        out.put(e.region);
+        out.put(e.last_block);
+        out.put(e.stride);
+        out.put(e.confidence);
+    }
+}
+
+void StridePrefetcher::restore(CheckpointReader& in) {
+    in.expect(static_cast<uint64_t>(table.size()), "stride table size");
+    for (Entry& e : table) {
+        e.region = in.get<uint64_t>();
+        e.last_block = in.get<uint64_t>();
+        e.stride = in.get<int64_t>();
+        e.confidence = in.get<uint8_t>();
+    }
+}
+
+// ============================================================================
+// StreamPrefetcher
+// ============================================================================
+
+StreamPrefetcher::StreamPrefetcher(size_t block_size, size_t depth, size_t num_streams)
+    : block_shift(block_shift_of(block_size)), depth(depth), streams(num_streams), clock(0) {
+    assert(num_streams > 0 && "Need at least one stream");
+}
+
+void StreamPrefetcher::observe(const PrefetchEvent& event, std::vector<uint64_t>& candidates) {
+    if (event.hit && !event.prefetch_hit) {
+        return;
+    }
+    uint64_t block = event.address >> block_shift;
+    clock++;
+    
+    // Fetch from just past head up to depth blocks beyond the new position
+    auto advance = [&](Stream& s) {
+        s.last_block = block;
+        s.last_use = clock;
+        for (size_t k = 1; k <= depth; k++) {
+            uint64_t target;
+            if (!step_block(block, s.direction * static_cast<int64_t>(k), target)) {
+                break;
+            }
+            int64_t ahead = static_cast<int64_t>(target - s.head) * s.direction;
+            if (ahead > 0) {
+                candidates.push_back(target << block_shift);
+                s.head = target;
+            }
+        }
+    };
+    
+    // 1. Inside the window of a trained stream
+    for (Stream& s : streams) {
+        if (!s.valid || !s.trained) continue;
+        int64_t dist = static_cast<int64_t>(block - s.last_block) * s.direction;
+        if (dist > 0 && dist <= static_cast<int64_t>(depth)) {
+            advance(s);
+            return;
+        }
+    }
+    
+    // 2. Next to a recent miss: start prefetching in that direction
+    for (Stream& s : streams) {
+        if (!s.valid || s.trained) continue;
+        if (block == s.last_block + 1 || block + 1 == s.last_block) {
+            s.trained = true;
+            s.direction = block > s.last_block ? 1 : -1;
+            s.head = block;
+            advance(s);
+            return;
+        }
+    }
+    
+    // 3. Remember this miss in the least recently used slot
+    Stream* victim = &streams[0];
+    for (Stream& s : streams) {
+        if (!s.valid) {
+            victim = &s;
+            break;
+        }
+        if (s.last_use < victim->last_use) {
+            victim = &s;
+        }
+    }
+    *victim = Stream();
+    victim->valid = true;
+    victim->last_block = block;
+    victim->head = block;
+    victim->last_use = clock;
+}
+
+void StreamPrefetcher::reset() {
+    for (auto& s : streams) {
+        s = Stream();
+    }
+    clock = 0;
+}
+
+void StreamPrefetcher::save(CheckpointWriter& out) const {
+    out.put(static_cast<uint64_t>(streams.size()));
+    for (const Stream& s : streams) {
+        out.put(static_cast<uint8_t>(s.valid | s.trained << 1));
+        out.put(s.last_block);
+        out.put(s.head);
+        out.put(s.direction);
+        out.put(s.last_use);
+    }
+    out.put(clock);
+}
+
+void StreamPrefetcher::restore(CheckpointReader& in) {
+    in.expect(static_cast<uint64_t>(streams.size()), "stream count");
+    for (Stream& s : streams) {
+        uint8_t flags = in.get<uint8_t>();
+        s.valid = flags & 1;
+        s.trained = flags & 2;
+        s.last_block = in.get<uint64_t>();
+        s.head = in.get<uint64_t>();
+        s.direction = in.get<int64_t>();
+        s.last_use = in.get<uint64_t>();
+    }
+    clock = in.get<uint64_t>();
+}
+
+// ============================================================================
+// Runtime Selection
+// ============================================================================
+
+const char* prefetcher_name(PrefetcherType type) {
+    switch (type) {
+        case PrefetcherType::NONE:      return "none";
+        case PrefetcherType::NEXT_LINE: return "next-line";
+        case PrefetcherType::STRIDE:    return "stride";
+        case PrefetcherType::STREAM:    return "stream";
+    }
+    return "?";
+}
+
+bool parse_prefetcher(const std::string& name, PrefetcherType& type) {
+    for (PrefetcherType t : {PrefetcherType::NONE, PrefetcherType::NEXT_LINE,
+                             PrefetcherType::STRIDE, PrefetcherType::STREAM}) {
+        if (name == prefetcher_name(t)) {
+            type = t;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::unique_ptr<Prefetcher> make_prefetcher(PrefetcherType type, size_t block_size,
+                                            size_t degree) {
+    switch (type) {
+        case PrefetcherType::NEXT_LINE:
+            return std::unique_ptr<Prefetcher>(
+                new NextLinePrefetcher(block_size, degree ? degree : 1));
+        case PrefetcherType::STRIDE:
+            return std::unique_ptr<Prefetcher>(
+                new StridePrefetcher(block_size, degree ? degree : 2));
+        case PrefetcherType::STREAM:
+            return std::unique_ptr<Prefetcher>(
+                new StreamPrefetcher(block_size, degree ? degree : 4));
+        case PrefetcherType::NONE:
+        default:
+            return nullptr;
+    }
+}
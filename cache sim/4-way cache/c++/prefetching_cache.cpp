@@ -0,0 +1,150 @@
+#include "prefetching_cache.h"
+#include "checkpoint.h"
+
+PrefetchingCache::PrefetchingCache(size_t size, size_t block, size_t assoc,
+                                   PrefetcherType prefetcher_kind, size_t degree,
+                                   size_t addr_bits, StorageMode mode, PolicyType policy_kind)
+    : cache(size, block, assoc, addr_bits, mode, policy_kind, false),
+      prefetcher_type(prefetcher_kind),
+      prefetcher(make_prefetcher(prefetcher_kind, block, degree)),
+      block_mask(~static_cast<uint64_t>(block - 1)) {}
+
+PrefetchingCache::PrefetchingCache(const PrefetchingCache& other)
+    : cache(other.cache),
+      prefetcher_type(other.prefetcher_type),
+      prefetcher(other.prefetcher ? other.prefetcher->clone() : nullptr),
+      block_mask(other.block_mask),
+      in_cache(other.in_cache),
+      fills(other.fills),
+      pstats(other.pstats) {}
+
+void PrefetchingCache::note_eviction(const AccessResult& r) {
+    if (!r.evicted) {
+        return;
+    }
+    auto it = in_cache.find(cache.reconstruct_address(r.evicted_tag, r.set_index));
+    if (it != in_cache.end()) {
+        pstats.polluting++;
+        in_cache.erase(it);
+    }
+}
+
+AccessResult PrefetchingCache::access(uint64_t address, AccessType type, uint64_t now,
+                                      uint64_t* ready_cycle) {
+    fills.clear();
+    AccessResult r = cache.access(address, type);
+    note_eviction(r);
+    
+    // First demand use of a prefetched block
+    bool prefetch_hit = false;
+    auto it = in_cache.find(address & block_mask);
+    if (it != in_cache.end()) {
+        prefetch_hit = true;
+        if (it->second > now) {
+            pstats.late++;
+        } else {
+            pstats.useful++;
+        }
+        if (ready_cycle) *ready_cycle = it->second;
+        in_cache.erase(it);
+    }
+    
+    if (!prefetcher) {
+        return r;
+    }
+    candidates.clear();
+    prefetcher->observe({address, r.hit, prefetch_hit}, candidates);
+    for (uint64_t candidate : candidates) {
+        uint64_t block_addr = candidate & block_mask;
+        if (cache.probe(block_addr)) {
+            pstats.redundant++;
+            continue;
+        }
+        AccessResult fill = cache.install(block_addr, false);
+        note_eviction(fill);
+        pstats.issued++;
+        in_cache[block_addr] = now;
+        
+        PrefetchFill f;
+        f.address = block_addr;
+        f.evicted_dirty = fill.evicted_dirty;
+        f.victim_address = fill.evicted ? cache.reconstruct_address(fill.evicted_tag, fill.set_index) : 0;
+        fills.push_back(f);
+    }
+    return r;
+}
+
+void PrefetchingCache::set_ready(uint64_t address, uint64_t ready_cycle) {
+    auto it = in_cache.find(address & block_mask);
+    if (it != in_cache.end()) {
+        it->second = ready_cycle;
+    }
+}
+
+void PrefetchingCache::reset() {
+    cache.reset();
+    if (prefetcher) {
+        prefetcher->reset();
+    }
+    in_cache.clear();
+    fills.clear();
+    pstats = PrefetchStats();
+}
+
+void PrefetchingCache::save(CheckpointWriter& out) const {
+    out.begin_section("PFCACHE");
+    cache.save(out);
+    out.begin_section("PREFETCH");
+    out.put(static_cast<uint32_t>(prefetcher_type));
+    if (prefetcher) {
+        prefetcher->save(out);
+    }
+    out.end_section();
+    out.put(static_cast<uint64_t>(in_cache.size()));
+    for (const auto& entry : in_cache) {
+        out.put(entry.first);
+        out.put(entry.second);
+    }
+    out.put(pstats.issued);
+    out.put(pstats.redundant);
+    out.put(pstats.useful);
+    out.put(pstats.late);
+    out.put(pstats.polluting);
+    out.end_section();
+}
+
+void PrefetchingCache::restore(CheckpointReader& in) {
+    PrefetchingCache staged(*this);
+    staged.load(in);
+    *this = std::move(staged);
+}
+
+void PrefetchingCache::load(CheckpointReader& in) {
+    in.enter_section("PFCACHE");
+    cache.restore(in);
+    if (prefetcher) {
+        prefetcher->reset();
+    }
+    in.enter_section("PREFETCH");
+    if (static_cast<PrefetcherType>(in.get<uint32_t>()) == prefetcher_type) {
+        if (prefetcher) {
+            prefetcher->restore(in);
+        }
+        in.leave_section();
+    } else {
+        in.skip_rest();
+    }
+    in_cache.clear();
+    uint64_t unused = in.get<uint64_t>();
+    for (uint64_t i = 0; i < unused; i++) {
+        uint64_t block_addr = in.get<uint64_t>();
+        in_cache[block_addr] = in.get<uint64_t>();
+    }
+    fills.clear();
+    pstats.issued = in.get<uint64_t>();
+    pstats.redundant = in.get<uint64_t>();
+    pstats.useful = in.get<uint64_t>();
+    pstats.late = in.get<uint64_t>();
+    pstats.polluting = in.get<uint64_t>();
+    in.leave_section();
+}
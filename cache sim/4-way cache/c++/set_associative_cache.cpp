@@ -1,8 +1,38 @@
 #include "set_associative_cache.h"
+#ifdef CACHESIM_INSTRUMENT
+#include "cache_instrument.h"
+#endif
 #include <iostream>
 #include <iomanip>
 #include <cassert>
 #include <cmath>
+#include <algorithm>
+
+namespace {
+constexpr size_t BATCH_CHUNK = 64;         // Requests decoded per chunk
+constexpr size_t PREFETCH_DISTANCE = 8;    // Requests between prefetch and use
+
+// Field by field, so the snapshot doesn't depend on the struct's layout
+void save_stats(CheckpointWriter& out, const CacheStats& s) {
+    out.put(s.hits);
+    out.put(s.misses);
+    out.put(s.reads);
+    out.put(s.writes);
+    out.put(s.evictions);
+    out.put(s.dirty_evictions);
+}
+
+CacheStats restore_stats(CheckpointReader& in) {
+    CacheStats s;
+    s.hits = in.get<uint64_t>();
+    s.misses = in.get<uint64_t>();
+    s.reads = in.get<uint64_t>();
+    s.writes = in.get<uint64_t>();
+    s.evictions = in.get<uint64_t>();
+    s.dirty_evictions = in.get<uint64_t>();
+    return s;
+}
+}
 
 // ============================================================================
 // Helper Functions
@@ -12,12 +42,7 @@
  * Calculate log base 2 of n (n must be power of 2)
  */
 size_t SetAssociativeCache::log2(size_t n) {
-    size_t result = 0;
-    while (n > 1) {
-        n >>= 1;
-        result++;
-    }
-    return result;
+    return n > 1 ? static_cast<size_t>(__builtin_ctzll(n)) : 0;
 }
 
 /**
@@ -33,7 +58,7 @@ uint64_t SetAssociativeCache::get_offset(uint64_t address) const {
  * These bits identify which set the address maps to
  */
 uint64_t SetAssociativeCache::get_set_index(uint64_t address) const {
-    return (address >> offset_bits) & ((1ULL << index_bits) - 1);
+    return (address >> offset_bits) & index_mask;
 }
 
 /**
@@ -41,7 +66,7 @@ uint64_t SetAssociativeCache::get_set_index(uint64_t address) const {
  * The remaining high-order bits after offset and index
  */
 uint64_t SetAssociativeCache::get_tag(uint64_t address) const {
-    return address >> (offset_bits + index_bits);
+    return address >> tag_shift;
 }
 
 /**
@@ -56,8 +81,11 @@ uint64_t SetAssociativeCache::reconstruct_address(uint64_t tag, uint64_t set_ind
 // Constructor
 // ============================================================================
 
-SetAssociativeCache::SetAssociativeCache(size_t size, size_t block, size_t assoc, size_t addr_bits)
-    : cache_size(size), block_size(block), associativity(assoc) {
+SetAssociativeCache::SetAssociativeCache(size_t size, size_t block, size_t assoc, size_t addr_bits,
+                                         StorageMode mode, PolicyType policy_kind, bool verbose)
+    : cache_size(size), block_size(block), associativity(assoc), storage(mode),
+      policy_type(policy_kind), policy(make_policy(PolicyType::LRU, 0, 1)), first_set(0),
+      page_sets(0), page_shift(0), pages_used(0) {
     
     // Validate parameters
     assert(size > 0 && "Cache size must be positive");
@@ -77,21 +105,46 @@ SetAssociativeCache::SetAssociativeCache(size_t size, size_t block, size_t assoc
     offset_bits = log2(block_size);
     index_bits = log2(num_sets);
     tag_bits = addr_bits - offset_bits - index_bits;
+    index_mask = (1ULL << index_bits) - 1;
+    tag_shift = offset_bits + index_bits;
     
-    // Initialize sets
-    sets.reserve(num_sets);
-    for (size_t i = 0; i < num_sets; i++) {
-        sets.emplace_back(associativity);
+    // Initialize replacement state and sets (SPARSE pages bring their own
+    // per-set state; the cache-wide part stays here)
+    policy = make_policy(policy_type, storage == StorageMode::SPARSE ? 0 : num_sets,
+                         associativity, num_sets);
+    if (storage == StorageMode::FLAT) {
+        assert(associativity <= TagStore::MAX_WAYS && "FLAT storage supports up to 64 ways");
+        store = TagStore(num_sets, associativity);
+    } else if (storage == StorageMode::SPARSE) {
+        assert(associativity <= TagStore::MAX_WAYS && "SPARSE storage supports up to 64 ways");
+        page_sets = std::min(SPARSE_PAGE_SETS, num_sets);
+        page_shift = log2(page_sets);
+        page_table.assign(num_sets / page_sets, 0);
+    } else {
+        sets.reserve(num_sets);
+        for (size_t i = 0; i < num_sets; i++) {
+            sets.emplace_back(associativity);
+        }
     }
     
-    // Print cache configuration
+    if (verbose) {
+        print_config();
+    }
+}
+
+/**
+ * Print cache configuration
+ */
+void SetAssociativeCache::print_config() const {
     std::cout << "=== Cache Configuration ===" << std::endl;
     std::cout << "Size: " << cache_size << " bytes" << std::endl;
     std::cout << "Block size: " << block_size << " bytes" << std::endl;
     std::cout << "Associativity: " << associativity << "-way" << std::endl;
+    std::cout << "Storage: " << storage_name(storage) << std::endl;
+    std::cout << "Replacement: " << policy_name(policy_type) << std::endl;
     std::cout << "Number of lines: " << num_lines << std::endl;
     std::cout << "Number of sets: " << num_sets << std::endl;
-    std::cout << "Address bits: " << addr_bits << std::endl;
+    std::cout << "Address bits: " << (tag_bits + offset_bits + index_bits) << std::endl;
     std::cout << "  Offset bits: " << offset_bits << std::endl;
     std::cout << "  Index bits: " << index_bits << std::endl;
     std::cout << "  Tag bits: " << tag_bits << std::endl;
@@ -102,7 +155,18 @@ SetAssociativeCache::SetAssociativeCache(size_t size, size_t block, size_t assoc
 // Core Access Logic
 // ============================================================================
 
+/**
+ * Resolve the policy variant once, then run the fully inlined access path
+ */
 AccessResult SetAssociativeCache::access(uint64_t address, AccessType type) {
+    if (storage == StorageMode::SPARSE) {
+        return access_sparse(address, type);
+    }
+    return std::visit([&](auto& repl) { return access_with(repl, address, type); }, policy);
+}
+
+template <typename Policy>
+AccessResult SetAssociativeCache::access_with(Policy& repl, uint64_t address, AccessType type) {
     AccessResult result;
     
     // Update access type statistics
@@ -117,6 +181,14 @@ AccessResult SetAssociativeCache::access(uint64_t address, AccessType type) {
     uint64_t tag = get_tag(address);
     result.set_index = set_index;
     
+    if (storage == StorageMode::FLAT) {
+        access_flat(repl, store, set_index, tag, type, result);
+#ifdef CACHESIM_INSTRUMENT
+        if (instrument) instrument->record(set_index, result);
+#endif
+        return result;
+    }
+    
     CacheSet& set = sets[set_index];
     
     // Search for tag in the set
@@ -128,8 +200,8 @@ AccessResult SetAssociativeCache::access(uint64_t address, AccessType type) {
         result.way = way;
         stats.hits++;
         
-        // Update LRU (this line is now most recently used)
-        set.update_lru(way);
+        // Update replacement state (this line is now most recently used)
+        repl.on_hit(set_index, way);
         
         // If it's a write, mark the line as dirty
         if (type == AccessType::WRITE) {
@@ -140,8 +212,13 @@ AccessResult SetAssociativeCache::access(uint64_t address, AccessType type) {
         result.hit = false;
         stats.misses++;
         
-        // Find a victim (empty line or LRU line)
-        way = set.find_victim();
+        repl.on_miss(set_index, address >> offset_bits);
+        
+        // Find a victim (empty line first, otherwise ask the policy)
+        way = set.find_invalid();
+        if (way < 0) {
+            way = static_cast<int>(repl.victim(set_index));
+        }
         result.way = way;
         
         CacheLine& victim = set.lines[way];
@@ -165,11 +242,389 @@ AccessResult SetAssociativeCache::access(uint64_t address, AccessType type) {
         victim.valid = true;
         victim.tag = tag;
         victim.dirty = (type == AccessType::WRITE);  // Dirty if write-allocate
+        victim.shared = false;
+        
+        // Update replacement state (this line is now most recently used)
+        repl.on_fill(set_index, way);
+    }
+    
+#ifdef CACHESIM_INSTRUMENT
+    if (instrument) instrument->record(set_index, result);
+#endif
+    return result;
+}
+
+/**
+ * Same hit/miss/eviction logic as access_with(), against a flat TagStore.
+ * Stats for reads/writes are already counted by the caller.
+ * @param ts The cache's TagStore (FLAT) or the set's page (SPARSE)
+ * @param row The set's row in ts and repl
+ * @return The way that was hit or filled
+ */
+template <typename Policy>
+int SetAssociativeCache::access_flat(Policy& repl, TagStore& ts, size_t row, uint64_t tag,
+                                     AccessType type, AccessResult& result) {
+    int way = ts.find_line(row, tag);
+    
+    if (way >= 0) {
+        result.hit = true;
+        result.way = way;
+        stats.hits++;
+        repl.on_hit(row, way);
+        if (type == AccessType::WRITE) {
+            ts.set_dirty(row, way);
+        }
+        return way;
+    }
+    
+    stats.misses++;
+    if (ts.renew(row)) {
+        repl.reset_set(row);    // First fill since an epoch reset
+    }
+    repl.on_miss(row, (tag << index_bits) | result.set_index);
+    way = ts.find_invalid(row);
+    if (way < 0) {
+        way = static_cast<int>(repl.victim(row));
+    }
+    result.way = way;
+    
+    if (ts.is_valid(row, way)) {
+        result.evicted = true;
+        result.evicted_tag = ts.get_tag(row, way);
+        stats.evictions++;
+        if (ts.is_dirty(row, way)) {
+            result.evicted_dirty = true;
+            stats.dirty_evictions++;
+        }
+    }
+    
+    ts.fill(row, way, tag, type == AccessType::WRITE);
+    repl.on_fill(row, way);
+    return way;
+}
+
+/**
+ * SPARSE access: materialize the set's page, then run the FLAT logic on it
+ */
+AccessResult SetAssociativeCache::access_sparse(uint64_t address, AccessType type) {
+    AccessResult result;
+    if (type == AccessType::READ) {
+        stats.reads++;
+    } else {
+        stats.writes++;
+    }
+    
+    uint64_t set_index = get_set_index(address);
+    uint64_t tag = get_tag(address);
+    result.set_index = set_index;
+    
+    SparsePage& page = touch_page(set_index);
+    size_t row = set_index & (page_sets - 1);
+    std::visit([&](auto& repl) { access_flat(repl, page.store, row, tag, type, result); },
+               page_policy(page));
+#ifdef CACHESIM_INSTRUMENT
+    if (instrument) instrument->record(set_index, result);
+#endif
+    return result;
+}
+
+// ============================================================================
+// Sparse Pages
+// ============================================================================
+
+const SetAssociativeCache::SparsePage* SetAssociativeCache::find_page(uint64_t set_index) const {
+    uint32_t slot = page_table[set_index >> page_shift];
+    return slot ? &pages[slot - 1] : nullptr;
+}
+
+SetAssociativeCache::SparsePage& SetAssociativeCache::touch_page(uint64_t set_index) {
+    size_t directory_index = set_index >> page_shift;
+    uint32_t& slot = page_table[directory_index];
+    if (!slot) {
+        if (pages_used == pages.size()) {
+            pages.push_back(SparsePage{TagStore(page_sets, associativity),
+                                       make_policy(policy_type, page_sets, associativity, 0),
+                                       0});
+        } else {
+            pages[pages_used].store.reset();    // Recycled after reset()
+        }
+        pages[pages_used].directory_index = directory_index;
+        slot = static_cast<uint32_t>(++pages_used);
+    }
+    return pages[slot - 1];
+}
+
+/**
+ * Replacement state for a page's sets
+ * The page keeps per-set state and is attached to the cache-wide policy for
+ * the rest (see SharedState). Attaching on every use means a copied or
+ * moved cache never follows a stale pointer.
+ */
+ReplacementPolicy& SetAssociativeCache::page_policy(SparsePage& page) {
+    std::visit([&](auto& repl) {
+        using Policy = std::decay_t<decltype(repl)>;
+        repl.attach(std::get<Policy>(policy), first_set + (page.directory_index << page_shift));
+    }, page.policy);
+    return page.policy;
+}
+
+/**
+ * TagStore holding a FLAT or SPARSE set, and the set's row in it
+ * @return nullptr for a SPARSE set that was never filled
+ */
+const TagStore* SetAssociativeCache::find_store(uint64_t set_index, size_t& row) const {
+    if (storage == StorageMode::FLAT) {
+        row = set_index;
+        return &store;
+    }
+    const SparsePage* page = find_page(set_index);
+    row = set_index & (page_sets - 1);
+    return page ? &page->store : nullptr;
+}
+
+TagStore* SetAssociativeCache::find_store(uint64_t set_index, size_t& row) {
+    return const_cast<TagStore*>(
+        static_cast<const SetAssociativeCache*>(this)->find_store(set_index, row));
+}
+
+// ============================================================================
+// Batched Access
+// ============================================================================
+
+void SetAssociativeCache::access_batch(const TraceEntry* entries, size_t n,
+                                       AccessResult* results) {
+    if (storage == StorageMode::SPARSE) {
+        for (size_t i = 0; i < n; i++) {
+            AccessResult r = access_sparse(entries[i].address, entries[i].type);
+            if (results) {
+                results[i] = r;
+            }
+        }
+        return;
+    }
+    std::visit([&](auto& repl) { access_batch_with(repl, entries, n, results); }, policy);
+}
+
+template <typename Policy>
+void SetAssociativeCache::prefetch_set(const Policy& repl, uint64_t set_index) const {
+    if (storage == StorageMode::FLAT) {
+        store.prefetch(set_index);
+    } else {
+        __builtin_prefetch(&sets[set_index], 1);
+    }
+    repl.prefetch(set_index);
+}
+
+template <typename Policy>
+void SetAssociativeCache::access_batch_with(Policy& repl, const TraceEntry* entries, size_t n,
+                                            AccessResult* results) {
+    uint64_t set_index[BATCH_CHUNK];
+    for (size_t base = 0; base < n; base += BATCH_CHUNK) {
+        const TraceEntry* chunk = entries + base;
+        size_t count = std::min(BATCH_CHUNK, n - base);
+        
+        // Decode every set index of the chunk up front
+        for (size_t i = 0; i < count; i++) {
+            set_index[i] = get_set_index(chunk[i].address);
+        }
+        for (size_t i = 0; i < count && i < PREFETCH_DISTANCE; i++) {
+            prefetch_set(repl, set_index[i]);
+        }
         
-        // Update LRU (this line is now most recently used)
-        set.update_lru(way);
+        for (size_t i = 0; i < count; i++) {
+            if (i + PREFETCH_DISTANCE < count) {
+                prefetch_set(repl, set_index[i + PREFETCH_DISTANCE]);
+            }
+            AccessResult r = access_with(repl, chunk[i].address, chunk[i].type);
+            if (results) {
+                results[base + i] = r;
+            }
+        }
+    }
+}
+
+// ============================================================================
+// Multi-level Support
+// ============================================================================
+
+int SetAssociativeCache::find_way(uint64_t set_index, uint64_t tag) const {
+    if (storage != StorageMode::PER_SET) {
+        size_t row;
+        const TagStore* ts = find_store(set_index, row);
+        return ts ? ts->find_line(row, tag) : -1;
+    }
+    return sets[set_index].find_line(tag);
+}
+
+bool SetAssociativeCache::probe(uint64_t address) const {
+    return find_way(get_set_index(address), get_tag(address)) >= 0;
+}
+
+bool SetAssociativeCache::invalidate(uint64_t address, bool* was_dirty, int* found_way) {
+    uint64_t set_index = get_set_index(address);
+    int way = find_way(set_index, get_tag(address));
+    if (way < 0) {
+        return false;
+    }
+    if (found_way) *found_way = way;
+    
+    // Invalid ways are refilled first, so the policy needs no notification
+    if (storage != StorageMode::PER_SET) {
+        size_t row;
+        TagStore* ts = find_store(set_index, row);
+        if (was_dirty) *was_dirty = ts->is_dirty(row, way);
+        ts->invalidate(row, way);
+    } else {
+        CacheLine& line = sets[set_index].lines[way];
+        if (was_dirty) *was_dirty = line.dirty;
+        line.valid = false;
+        line.dirty = false;
+        line.shared = false;
+    }
+    return true;
+}
+
+const char* coherence_state_name(CoherenceState state) {
+    switch (state) {
+        case CoherenceState::INVALID:   return "I";
+        case CoherenceState::SHARED:    return "S";
+        case CoherenceState::EXCLUSIVE: return "E";
+        case CoherenceState::OWNED:     return "O";
+        case CoherenceState::MODIFIED:  return "M";
+    }
+    return "?";
+}
+
+CoherenceState SetAssociativeCache::coherence_state(uint64_t address) const {
+    uint64_t set_index = get_set_index(address);
+    int way = find_way(set_index, get_tag(address));
+    if (way < 0) {
+        return CoherenceState::INVALID;
+    }
+    bool dirty, shared;
+    if (storage != StorageMode::PER_SET) {
+        size_t row;
+        const TagStore* ts = find_store(set_index, row);
+        dirty = ts->is_dirty(row, way);
+        shared = ts->is_shared(row, way);
+    } else {
+        const CacheLine& line = sets[set_index].lines[way];
+        dirty = line.dirty;
+        shared = line.shared;
+    }
+    if (dirty) {
+        return shared ? CoherenceState::OWNED : CoherenceState::MODIFIED;
+    }
+    return shared ? CoherenceState::SHARED : CoherenceState::EXCLUSIVE;
+}
+
+bool SetAssociativeCache::set_coherence_state(uint64_t address, CoherenceState state) {
+    if (state == CoherenceState::INVALID) {
+        return invalidate(address);
+    }
+    uint64_t set_index = get_set_index(address);
+    int way = find_way(set_index, get_tag(address));
+    if (way < 0) {
+        return false;
+    }
+    bool dirty = state == CoherenceState::MODIFIED || state == CoherenceState::OWNED;
+    bool shared = state == CoherenceState::SHARED || state == CoherenceState::OWNED;
+    if (storage != StorageMode::PER_SET) {
+        size_t row;
+        find_store(set_index, row)->set_state(row, way, dirty, shared);
+    } else {
+        CacheLine& line = sets[set_index].lines[way];
+        line.dirty = dirty;
+        line.shared = shared;
+    }
+    return true;
+}
+
+AccessResult SetAssociativeCache::install(uint64_t address, bool dirty) {
+    uint64_t set_index = get_set_index(address);
+    if (storage == StorageMode::SPARSE) {
+        SparsePage& page = touch_page(set_index);
+        size_t row = set_index & (page_sets - 1);
+        return std::visit([&](auto& repl) {
+            return install_with(repl, page.store, row, address, dirty);
+        }, page_policy(page));
+    }
+    return std::visit([&](auto& repl) {
+        return install_with(repl, store, set_index, address, dirty);
+    }, policy);
+}
+
+/**
+ * @param ts TagStore holding the set (FLAT/SPARSE; unused for PER_SET)
+ * @param row The set's row in ts and repl (the set index unless SPARSE)
+ */
+template <typename Policy>
+AccessResult SetAssociativeCache::install_with(Policy& repl, TagStore& ts, size_t row,
+                                               uint64_t address, bool dirty) {
+    AccessResult result;
+    uint64_t set_index = get_set_index(address);
+    uint64_t tag = get_tag(address);
+    result.set_index = set_index;
+    bool per_set = storage == StorageMode::PER_SET;
+    
+    int way = per_set ? sets[set_index].find_line(tag) : ts.find_line(row, tag);
+    if (way >= 0) {
+        result.hit = true;
+        result.way = way;
+        repl.on_hit(row, way);
+        if (!per_set) {
+            if (dirty) ts.set_dirty(row, way);
+        } else if (dirty) {
+            sets[set_index].lines[way].dirty = true;
+        }
+        return result;
+    }
+    
+    if (!per_set) {
+        if (ts.renew(row)) {
+            repl.reset_set(row);
+        }
+        way = ts.find_invalid(row);
+    } else {
+        way = sets[set_index].find_invalid();
+    }
+    repl.on_miss(row, address >> offset_bits);
+    if (way < 0) {
+        way = static_cast<int>(repl.victim(row));
+    }
+    result.way = way;
+    
+    bool victim_valid, victim_dirty;
+    uint64_t victim_tag;
+    if (!per_set) {
+        victim_valid = ts.is_valid(row, way);
+        victim_dirty = ts.is_dirty(row, way);
+        victim_tag = ts.get_tag(row, way);
+        ts.fill(row, way, tag, dirty);
+    } else {
+        CacheLine& line = sets[set_index].lines[way];
+        victim_valid = line.valid;
+        victim_dirty = line.dirty;
+        victim_tag = line.tag;
+        line.valid = true;
+        line.tag = tag;
+        line.dirty = dirty;
+        line.shared = false;
     }
+    repl.on_fill(row, way);
     
+    if (victim_valid) {
+        result.evicted = true;
+        result.evicted_tag = victim_tag;
+        stats.evictions++;
+        if (victim_dirty) {
+            result.evicted_dirty = true;
+            stats.dirty_evictions++;
+        }
+#ifdef CACHESIM_INSTRUMENT
+        if (instrument) instrument->record_eviction(set_index, victim_dirty);
+#endif
+    }
     return result;
 }
 
@@ -183,11 +638,19 @@ void SetAssociativeCache::print_set_contents(size_t set_idx) const {
         return;
     }
     
-    const CacheSet& set = sets[set_idx];
     std::cout << "Set " << set_idx << ":" << std::endl;
     
+    size_t row = set_idx;
+    const TagStore* ts = storage == StorageMode::PER_SET ? nullptr : find_store(set_idx, row);
     for (size_t way = 0; way < associativity; way++) {
-        const CacheLine& line = set.lines[way];
+        CacheLine line;
+        if (ts) {
+            line.valid = ts->is_valid(row, way);
+            line.dirty = line.valid && ts->is_dirty(row, way);
+            line.tag = ts->get_tag(row, way);
+        } else if (storage == StorageMode::PER_SET) {
+            line = sets[set_idx].lines[way];
+        }
         std::cout << "  Way " << way << ": ";
         
         if (line.valid) {
@@ -213,8 +676,17 @@ void SetAssociativeCache::print_set_contents(size_t set_idx) const {
         std::cout << std::endl;
     }
     
-    // Print LRU order
-    std::vector<size_t> lru_order = set.get_lru_order();
+    // Print LRU order (only the LRU policy tracks one)
+    const ReplacementPolicy* repl = &policy;
+    if (storage == StorageMode::SPARSE) {
+        const SparsePage* page = find_page(set_idx);
+        repl = page ? &page->policy : nullptr;
+    }
+    const auto* lru = repl ? std::get_if<LRUPolicy<DYNAMIC_WAYS>>(repl) : nullptr;
+    if (!lru) {
+        return;
+    }
+    std::vector<size_t> lru_order = lru->get_order(row);
     std::cout << "  LRU order: [";
     for (size_t i = 0; i < lru_order.size(); i++) {
         if (i > 0) std::cout << ", ";
@@ -228,15 +700,7 @@ void SetAssociativeCache::print_all_contents() const {
     
     for (size_t set_idx = 0; set_idx < num_sets; set_idx++) {
         // Only print non-empty sets
-        bool has_valid = false;
-        for (size_t way = 0; way < associativity; way++) {
-            if (sets[set_idx].lines[way].valid) {
-                has_valid = true;
-                break;
-            }
-        }
-        
-        if (has_valid) {
+        if (set_has_valid(set_idx)) {
             print_set_contents(set_idx);
             std::cout << std::endl;
         }
@@ -245,18 +709,154 @@ void SetAssociativeCache::print_all_contents() const {
     std::cout << "======================" << std::endl;
 }
 
+bool SetAssociativeCache::set_has_valid(size_t set_idx) const {
+    if (storage != StorageMode::PER_SET) {
+        size_t row;
+        const TagStore* ts = find_store(set_idx, row);
+        return ts && ts->set_has_valid(row);
+    }
+    for (size_t way = 0; way < associativity; way++) {
+        if (sets[set_idx].lines[way].valid) {
+            return true;
+        }
+    }
+    return false;
+}
+
 CacheStats SetAssociativeCache::get_stats() const {
     return stats;
 }
 
 void SetAssociativeCache::reset() {
-    // Reset all sets
-    sets.clear();
-    sets.reserve(num_sets);
-    for (size_t i = 0; i < num_sets; i++) {
-        sets.emplace_back(associativity);
+    stats = CacheStats();
+    if (storage == StorageMode::PER_SET) {
+        // Clear every set in place; nothing is reallocated
+        std::visit([](auto& repl) { repl.reset(); }, policy);
+        for (CacheSet& set : sets) {
+            set.clear();
+        }
+        return;
     }
     
-    // Reset statistics
-    stats = CacheStats();
+    // FLAT/SPARSE: start a new epoch. Each set (and its policy state) is
+    // cleared when it is next filled, so this doesn't touch the sets at all.
+    std::visit([](auto& repl) { repl.begin_epoch(); }, policy);
+    if (storage == StorageMode::FLAT) {
+        store.reset();
+        return;
+    }
+    // SPARSE: unmap the pages in use; they are recycled by touch_page()
+    for (size_t i = 0; i < pages_used; i++) {
+        page_table[pages[i].directory_index] = 0;
+    }
+    pages_used = 0;
+}
+
+// ============================================================================
+// Checkpoints
+// ============================================================================
+
+void SetAssociativeCache::save_policy(CheckpointWriter& out, const ReplacementPolicy& repl) {
+    out.begin_section("POLICY");
+    std::visit([&out](const auto& p) { p.save(out); }, repl);
+    out.end_section();
+}
+
+/**
+ * Restore one policy section, or start repl cold if it was saved under
+ * another policy (its layout wouldn't match)
+ */
+void SetAssociativeCache::restore_policy(CheckpointReader& in, ReplacementPolicy& repl,
+                                         PolicyType saved, size_t policy_sets,
+                                         size_t shared_sets) {
+    if (saved != policy_type) {
+        in.skip_section();
+        repl = make_policy(policy_type, policy_sets, associativity, shared_sets);
+        return;
+    }
+    in.enter_section("POLICY");
+    std::visit([&in](auto& p) { p.restore(in); }, repl);
+    in.leave_section();
+}
+
+void SetAssociativeCache::save(CheckpointWriter& out) const {
+    out.begin_section("SETASSOC");
+    out.put(static_cast<uint64_t>(cache_size));
+    out.put(static_cast<uint64_t>(block_size));
+    out.put(static_cast<uint64_t>(associativity));
+    out.put(static_cast<uint64_t>(tag_bits));
+    out.put(static_cast<uint32_t>(storage));
+    out.put(static_cast<uint32_t>(policy_type));
+    save_stats(out, stats);
+    
+    if (storage == StorageMode::PER_SET) {
+        out.begin_section("SETS");
+        for (const CacheSet& set : sets) {
+            set.save(out);
+        }
+        out.end_section();
+    } else if (storage == StorageMode::FLAT) {
+        store.save(out);
+    } else {
+        // Only mapped pages; the page table is rebuilt from their indices
+        out.put(static_cast<uint64_t>(pages_used));
+        for (size_t i = 0; i < pages_used; i++) {
+            out.put(static_cast<uint64_t>(pages[i].directory_index));
+            pages[i].store.save(out);
+            save_policy(out, pages[i].policy);
+        }
+    }
+    save_policy(out, policy);
+    out.end_section();
+}
+
+void SetAssociativeCache::restore(CheckpointReader& in) {
+    SetAssociativeCache staged(*this);
+    staged.load(in);
+    *this = std::move(staged);
+}
+
+void SetAssociativeCache::load(CheckpointReader& in) {
+    in.enter_section("SETASSOC");
+    in.expect(static_cast<uint64_t>(cache_size), "cache size");
+    in.expect(static_cast<uint64_t>(block_size), "block size");
+    in.expect(static_cast<uint64_t>(associativity), "associativity");
+    in.expect(static_cast<uint64_t>(tag_bits), "address bits");
+    in.expect(static_cast<uint32_t>(storage), "storage mode");
+    PolicyType saved_policy = static_cast<PolicyType>(in.get<uint32_t>());
+    
+    reset();
+    stats = restore_stats(in);
+    if (storage == StorageMode::PER_SET) {
+        in.enter_section("SETS");
+        for (CacheSet& set : sets) {
+            set.restore(in);
+        }
+        in.leave_section();
+    } else if (storage == StorageMode::FLAT) {
+        store.restore(in);
+    } else {
+        uint64_t mapped = in.get<uint64_t>();
+        if (mapped > page_table.size()) {
+            throw std::runtime_error("checkpoint: more sparse pages than the cache has");
+        }
+        for (uint64_t i = 0; i < mapped; i++) {
+            uint64_t directory_index = in.get<uint64_t>();
+            if (directory_index >= page_table.size() || page_table[directory_index]) {
+                throw std::runtime_error("checkpoint: bad sparse page index");
+            }
+            SparsePage& page = touch_page(directory_index << page_shift);
+            page.store.restore(in);
+            restore_policy(in, page.policy, saved_policy, page_sets, 0);
+        }
+    }
+    restore_policy(in, policy, saved_policy, storage == StorageMode::SPARSE ? 0 : num_sets,
+                   num_sets);
+    set_first_set(first_set);   // A cold-started policy starts at set 0
+    in.leave_section();
+}
+
+void SetAssociativeCache::set_first_set(size_t first) {
+    first_set = first;
+    std::visit([first](auto& repl) { repl.attach(repl, first); }, policy);
 }
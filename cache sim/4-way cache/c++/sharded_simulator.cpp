@@ -0,0 +1,152 @@
+#include "sharded_simulator.h"
+#include <thread>
+#include <cassert>
+
+/**
+ * Run fn(0) .. fn(n - 1) on n threads (inline when n == 1)
+ */
+template <typename Fn>
+static void parallel_for(size_t n, Fn fn) {
+    if (n == 1) {
+        fn(0);
+        return;
+    }
+    std::vector<std::thread> workers;
+    workers.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        workers.emplace_back(fn, i);
+    }
+    for (std::thread& w : workers) {
+        w.join();
+    }
+}
+
+static size_t log2_size(size_t n) {
+    return n > 1 ? static_cast<size_t>(__builtin_ctzll(n)) : 0;
+}
+
+// ============================================================================
+// Constructor
+// ============================================================================
+
+ShardedSimulator::ShardedSimulator(size_t size, size_t block, size_t assoc, size_t threads,
+                                   size_t addr_bits, StorageMode mode, PolicyType policy_kind) {
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    if (threads == 0) {
+        threads = 1;
+    }
+
+    size_t num_sets = size / block / assoc;
+    assert(num_sets > 0 && (num_sets & (num_sets - 1)) == 0 && "Number of sets must be power of 2");
+
+    // Shard counts are powers of two (a shard is a slice of index bits);
+    // round up so every thread gets work, then cap at one set per shard.
+    // BRRIP, DRRIP and SHiP update cache-wide state in trace order, which
+    // shards replaying in parallel can't reproduce, so they get one shard.
+    bool cache_wide = policy_kind == PolicyType::BRRIP || policy_kind == PolicyType::DRRIP ||
+                      policy_kind == PolicyType::SHIP;
+    num_shards = 1;
+    while (!cache_wide && num_shards < threads && num_shards < num_sets) {
+        num_shards <<= 1;
+    }
+    num_threads = threads < num_shards ? threads : num_shards;
+
+    offset_bits = log2_size(block);
+    local_index_bits = log2_size(num_sets / num_shards);
+    shard_mask = num_shards - 1;
+
+    shards.reserve(num_shards);
+    for (size_t i = 0; i < num_shards; i++) {
+        shards.emplace_back(size / num_shards, block, assoc, addr_bits, mode, policy_kind, false);
+        shards.back().set_first_set(i << local_index_bits);
+    }
+}
+
+/**
+ * Drop the shard bits from the set index; tag and local set stay put
+ */
+uint64_t ShardedSimulator::local_address(uint64_t address) const {
+    uint64_t local_bits = offset_bits + local_index_bits;
+    uint64_t low = address & ((1ULL << local_bits) - 1);
+    uint64_t tag = address >> (local_bits + log2_size(num_shards));
+    return (tag << local_bits) | low;
+}
+
+// ============================================================================
+// Simulation
+// ============================================================================
+
+void ShardedSimulator::run(const std::vector<TraceEntry>& trace, AccessResult* results) {
+    run(trace.data(), trace.size(), results);
+}
+
+void ShardedSimulator::run(const TraceEntry* trace, size_t count, AccessResult* results) {
+    if (num_shards == 1) {
+        shards[0].access_batch(trace, count, results);
+        return;
+    }
+
+    // Phase 1: thread t buckets slice t of the trace by shard (and, for
+    // results, remembers where each bucketed access came from)
+    const size_t T = num_threads;
+    std::vector<std::vector<std::vector<TraceEntry>>> buckets(
+        T, std::vector<std::vector<TraceEntry>>(num_shards));
+    std::vector<std::vector<std::vector<size_t>>> positions(
+        results ? T : 0, std::vector<std::vector<size_t>>(num_shards));
+
+    parallel_for(T, [&](size_t t) {
+        size_t begin = count * t / T;
+        size_t end = count * (t + 1) / T;
+        std::vector<std::vector<TraceEntry>>& mine = buckets[t];
+        for (auto& b : mine) {
+            b.reserve((end - begin) / num_shards + 64);
+        }
+        for (size_t i = begin; i < end; i++) {
+            size_t shard = shard_of(trace[i].address);
+            mine[shard].push_back({local_address(trace[i].address), trace[i].type});
+            if (results) {
+                positions[t][shard].push_back(i);
+            }
+        }
+    });
+
+    // Phase 2: thread w owns shards w, w + T, ...; slices are replayed in
+    // order so every set sees its accesses in trace order
+    parallel_for(T, [&](size_t w) {
+        std::vector<AccessResult> local;
+        for (size_t shard = w; shard < num_shards; shard += T) {
+            SetAssociativeCache& cache = shards[shard];
+            const size_t set_base = shard << local_index_bits;
+            for (size_t t = 0; t < T; t++) {
+                const std::vector<TraceEntry>& bucket = buckets[t][shard];
+                if (!results) {
+                    cache.access_batch(bucket);
+                    continue;
+                }
+                // Tags are unchanged by local_address(); only the set moves
+                local.resize(bucket.size());
+                cache.access_batch(bucket, local.data());
+                for (size_t k = 0; k < bucket.size(); k++) {
+                    local[k].set_index += set_base;
+                    results[positions[t][shard][k]] = local[k];
+                }
+            }
+        }
+    });
+}
+
+CacheStats ShardedSimulator::get_stats() const {
+    CacheStats total;
+    for (const SetAssociativeCache& shard : shards) {
+        total += shard.get_stats();
+    }
+    return total;
+}
+
+void ShardedSimulator::reset() {
+    for (SetAssociativeCache& shard : shards) {
+        shard.reset();
+    }
+}
@@ -0,0 +1,154 @@
+#include "cache_hierarchy.h"
+#include "tlb.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <memory>
+
+// ============================================================================
+// Multi-level hierarchy simulation
+//
+// Streams one address trace through an L1 -> ... -> LLC hierarchy in a single
+// pass and prints per-level hit rates and write-back traffic.
+//
+// Trace format (same as memory_sim): one access per line, "R 0x1234" or
+// "W 0x1234", plus "I 0x1234" for an instruction fetch (a read). Other lines
+// are skipped.
+//
+// Levels are given as size_bytes:ways, closest to the core first.
+//
+// With --tlb the trace addresses are virtual: every access is translated by
+// an MMU (ITLB/DTLB, STLB, page walks) whose page-table reads go through the
+// same hierarchy. --pages picks the page size the OS maps with, and
+// --huge-fraction the share of regions that actually get huge pages (THP).
+// ============================================================================
+
+bool parse_policy(const std::string& s, InclusionPolicy& out) {
+    if (s == "inclusive") { out = InclusionPolicy::INCLUSIVE; return true; }
+    if (s == "exclusive") { out = InclusionPolicy::EXCLUSIVE; return true; }
+    if (s == "nine")      { out = InclusionPolicy::NINE;      return true; }
+    return false;
+}
+
+bool parse_page_size(const std::string& s, PageSize& out) {
+    if (s == "4k" || s == "4K") { out = PageSize::SIZE_4K; return true; }
+    if (s == "2m" || s == "2M") { out = PageSize::SIZE_2M; return true; }
+    if (s == "1g" || s == "1G") { out = PageSize::SIZE_1G; return true; }
+    return false;
+}
+
+/**
+ * Stream the trace into the hierarchy, through the MMU when there is one
+ */
+uint64_t run_trace(std::istream& in, CacheHierarchy& hierarchy, MMU* mmu) {
+    uint64_t count = 0;
+    char op;
+    uint64_t addr;
+    while (in >> op >> std::hex >> addr) {
+        AccessType type;
+        bool fetch = false;
+        if (op == 'R' || op == 'r') {
+            type = AccessType::READ;
+        } else if (op == 'W' || op == 'w') {
+            type = AccessType::WRITE;
+        } else if (op == 'I' || op == 'i') {
+            type = AccessType::READ;
+            fetch = true;
+        } else {
+            continue;
+        }
+        if (mmu) {
+            mmu->access(addr, type, fetch);
+        } else {
+            hierarchy.access(addr, type);
+        }
+        count++;
+    }
+    return count;
+}
+
+int main(int argc, char* argv[]) {
+    bool use_tlb = false;
+    MMUConfig mmu_config;
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--tlb") {
+            use_tlb = true;
+        } else if (arg == "--pages" && i + 1 < argc) {
+            if (!parse_page_size(argv[++i], mmu_config.page_size)) {
+                std::cerr << "Error: Page size must be 4k, 2m or 1g, got " << argv[i] << "\n";
+                return 1;
+            }
+            use_tlb = true;
+        } else if (arg == "--huge-fraction" && i + 1 < argc) {
+            mmu_config.huge_fraction = std::strtod(argv[++i], nullptr);
+            use_tlb = true;
+        } else {
+            args.push_back(arg);
+        }
+    }
+
+    if (args.size() < 3) {
+        std::cerr << "Usage: " << argv[0]
+                  << " [--tlb] [--pages 4k|2m|1g] [--huge-fraction F]"
+                  << " <trace_file|-> <inclusive|exclusive|nine> <size:ways> [size:ways ...]\n";
+        std::cerr << "Example: " << argv[0] << " trace.txt inclusive 32768:8 262144:8 2097152:16\n";
+        std::cerr << "         " << argv[0]
+                  << " --pages 2m --huge-fraction 0.8 trace.txt nine 32768:8 2097152:16\n";
+        return 1;
+    }
+
+    std::string trace_file = args[0];
+    InclusionPolicy policy;
+    if (!parse_policy(args[1], policy)) {
+        std::cerr << "Error: Unknown inclusion policy: " << args[1] << "\n";
+        return 1;
+    }
+
+    const size_t block = 64;
+    std::vector<CacheLevelConfig> configs;
+    for (size_t i = 2; i < args.size(); i++) {
+        std::string spec = args[i];
+        size_t colon = spec.find(':');
+        if (colon == std::string::npos) {
+            std::cerr << "Error: Level must be size:ways, got " << spec << "\n";
+            return 1;
+        }
+        size_t size = std::strtoull(spec.substr(0, colon).c_str(), nullptr, 10);
+        size_t ways = std::strtoull(spec.substr(colon + 1).c_str(), nullptr, 10);
+        configs.emplace_back("L" + std::to_string(i - 1), size, block, ways);
+    }
+    if (configs.size() > 1) {
+        configs.back().name = "LLC";
+    }
+
+    CacheHierarchy hierarchy(configs, policy, 64);
+    std::unique_ptr<MMU> mmu;
+    if (use_tlb) {
+        mmu.reset(new MMU(hierarchy, mmu_config));
+    }
+
+    uint64_t count;
+    if (trace_file == "-") {
+        count = run_trace(std::cin, hierarchy, mmu.get());
+    } else {
+        std::ifstream file(trace_file);
+        if (!file.is_open()) {
+            std::cerr << "Error: Could not open trace file: " << trace_file << "\n";
+            return 1;
+        }
+        count = run_trace(file, hierarchy, mmu.get());
+    }
+
+    std::cout << "Trace: " << std::dec << count << " accesses\n";
+    hierarchy.print_report(std::cout);
+    if (mmu) {
+        std::cout << "\n";
+        mmu->print_report(std::cout);
+    }
+
+    return 0;
+}
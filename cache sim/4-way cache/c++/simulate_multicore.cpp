@@ -0,0 +1,132 @@
+#include "coherent_system.h"
+#include "address_trace.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <cstdlib>
+
+// ============================================================================
+// Multi-core coherent cache simulation
+//
+// Replays per-core access streams through private L1s kept coherent with
+// MESI or MOESI over a snooping bus, in front of one shared LLC.
+//
+// Two trace layouts:
+//   <trace_file|->                 one interleaved trace, "<core> R 0x1234"
+//   --per-core <file0> <file1> ... one trace per core, "<cycle> R 0x1234"
+//                                  (or untimed "R 0x1234"), merged by cycle
+//
+// Caches are given as size_bytes:ways.
+// ============================================================================
+
+bool parse_level(const char* arg, size_t& size, size_t& ways) {
+    std::string spec = arg;
+    size_t colon = spec.find(':');
+    if (colon == std::string::npos) {
+        return false;
+    }
+    size = std::strtoull(spec.substr(0, colon).c_str(), nullptr, 10);
+    ways = std::strtoull(spec.substr(colon + 1).c_str(), nullptr, 10);
+    return size > 0 && ways > 0;
+}
+
+void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [options] <trace_file|->\n"
+              << "       " << prog << " [options] --per-core <file0> <file1> ...\n"
+              << "Options:\n"
+              << "  --protocol mesi|moesi   Coherence protocol (default mesi)\n"
+              << "  --l1 size:ways          Private L1 of every core (default 32768:8)\n"
+              << "  --llc size:ways         Shared LLC (default 2097152:16)\n"
+              << "  --cores N               Core count (default: highest core id + 1)\n"
+              << "Example: " << prog << " --protocol moesi --per-core t0.txt t1.txt t2.txt t3.txt\n";
+}
+
+int main(int argc, char* argv[]) {
+    CoherenceProtocol protocol = CoherenceProtocol::MESI;
+    size_t l1_size = 32768, l1_ways = 8;
+    size_t llc_size = 2097152, llc_ways = 16;
+    size_t cores = 0;
+    std::vector<std::string> files;
+    bool per_core = false;
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (std::strcmp(argv[i], "--protocol") == 0 && has_value) {
+            if (!parse_protocol(argv[++i], protocol)) {
+                std::cerr << "Error: Unknown protocol: " << argv[i] << "\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--l1") == 0 && has_value) {
+            if (!parse_level(argv[++i], l1_size, l1_ways)) {
+                std::cerr << "Error: L1 must be size:ways, got " << argv[i] << "\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--llc") == 0 && has_value) {
+            if (!parse_level(argv[++i], llc_size, llc_ways)) {
+                std::cerr << "Error: LLC must be size:ways, got " << argv[i] << "\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--cores") == 0 && has_value) {
+            cores = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--per-core") == 0) {
+            per_core = true;
+        } else if (argv[i][0] == '-' && argv[i][1] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+    if (files.empty() || (!per_core && files.size() != 1)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::vector<CoreAccess> trace;
+    if (per_core) {
+        std::vector<std::vector<TimedAccess>> streams;
+        for (const std::string& name : files) {
+            std::ifstream file(name);
+            if (!file.is_open()) {
+                std::cerr << "Error: Could not open trace file: " << name << "\n";
+                return 1;
+            }
+            streams.push_back(read_timed_trace(file));
+        }
+        trace = merge_by_timestamp(streams);
+        if (cores == 0) cores = files.size();
+    } else if (files[0] == "-") {
+        trace = read_multicore_trace(std::cin);
+    } else {
+        std::ifstream file(files[0]);
+        if (!file.is_open()) {
+            std::cerr << "Error: Could not open trace file: " << files[0] << "\n";
+            return 1;
+        }
+        trace = read_multicore_trace(file);
+    }
+
+    uint32_t max_core = 0;
+    for (const CoreAccess& a : trace) {
+        max_core = std::max(max_core, a.core);
+    }
+    if (cores == 0) {
+        cores = max_core + 1;
+    } else if (!trace.empty() && max_core >= cores) {
+        std::cerr << "Error: Trace uses core " << max_core << " but only " << cores
+                  << " cores are configured\n";
+        return 1;
+    }
+
+    const size_t block = 64;
+    CoherentSystem system(cores, CacheLevelConfig("L1", l1_size, block, l1_ways),
+                          CacheLevelConfig("LLC", llc_size, block, llc_ways), protocol, 64);
+    system.run(trace);
+
+    std::cout << "Trace: " << trace.size() << " accesses\n";
+    system.print_report(std::cout);
+    return 0;
+}
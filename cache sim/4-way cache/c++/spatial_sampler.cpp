@@ -0,0 +1,145 @@
+#include "spatial_sampler.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+double normal_critical_value(double confidence) {
+    assert(confidence > 0.0 && confidence < 1.0 && "Confidence must be in (0, 1)");
+    // Solve erf(z / sqrt(2)) = confidence by bisection
+    double lo = 0.0, hi = 10.0;
+    for (int i = 0; i < 100; i++) {
+        double mid = 0.5 * (lo + hi);
+        if (std::erf(mid / std::sqrt(2.0)) < confidence) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return 0.5 * (lo + hi);
+}
+
+// ============================================================================
+// SpatialSampler
+// ============================================================================
+
+SpatialSampler::SpatialSampler(double rate, size_t block_size, uint64_t seed)
+    : threshold(0), block_shift(0), seed(seed) {
+    assert(rate > 0.0 && rate <= 1.0 && "Sample rate must be in (0, 1]");
+    assert(block_size > 0 && (block_size & (block_size - 1)) == 0 && "Block size must be power of 2");
+    threshold = static_cast<uint64_t>(std::llround(rate * MODULUS));
+    if (threshold == 0) {
+        threshold = 1;
+    }
+    while ((1ULL << block_shift) < block_size) {
+        block_shift++;
+    }
+}
+
+// ============================================================================
+// SampledCache
+// ============================================================================
+
+/**
+ * Round rate so the miniature cache has a power-of-two number of sets
+ */
+static double miniature_rate(size_t size, size_t block, size_t assoc, double rate) {
+    size_t full_sets = size / block / assoc;
+    assert(full_sets > 0 && "Must have at least one set");
+    double target = std::log2(full_sets * rate);
+    long exponent = std::lround(target);
+    if (exponent < 0) {
+        exponent = 0;   // One set is as small as the miniature gets
+    }
+    size_t mini_sets = std::min(full_sets, static_cast<size_t>(1) << exponent);
+    return static_cast<double>(mini_sets) / full_sets;
+}
+
+SampledCache::SampledCache(size_t size, size_t block, size_t assoc, double rate, size_t addr_bits,
+                           StorageMode mode, PolicyType policy_kind, uint64_t seed)
+    : sampler(miniature_rate(size, block, assoc, rate), block, seed),
+      mini(static_cast<size_t>(size * miniature_rate(size, block, assoc, rate)), block, assoc,
+           addr_bits, mode, policy_kind, false),
+      seen(0), group_accesses(SpatialSampler::NUM_GROUPS, 0),
+      group_hits(SpatialSampler::NUM_GROUPS, 0) {}
+
+bool SampledCache::access(uint64_t address, AccessType type) {
+    seen++;
+    if (!sampler.sample(address)) {
+        return false;
+    }
+    AccessResult r = mini.access(address, type);
+    size_t g = sampler.group(address);
+    group_accesses[g]++;
+    if (r.hit) {
+        group_hits[g]++;
+    }
+    return true;
+}
+
+CacheStats SampledCache::get_stats() const {
+    CacheStats s = mini.get_stats();
+    double scale = 1.0 / sampler.get_rate();
+    auto up = [scale](uint64_t n) { return static_cast<uint64_t>(std::llround(n * scale)); };
+    s.hits = up(s.hits);
+    s.misses = up(s.misses);
+    s.reads = up(s.reads);
+    s.writes = up(s.writes);
+    s.evictions = up(s.evictions);
+    s.dirty_evictions = up(s.dirty_evictions);
+    return s;
+}
+
+HitRateEstimate SampledCache::hit_rate_estimate(double confidence) const {
+    HitRateEstimate est;
+    est.confidence = confidence;
+    est.samples = get_sampled();
+    est.hit_rate = mini.get_stats().hit_rate();
+
+    // Ratio estimator over groups: var(p) ~ K/(K-1) * sum (h_g - p n_g)^2 / N^2
+    const size_t K = SpatialSampler::NUM_GROUPS;
+    double n = static_cast<double>(est.samples);
+    double sum_sq = 0.0;
+    for (size_t g = 0; g < K; g++) {
+        double residual = group_hits[g] - est.hit_rate * group_accesses[g];
+        sum_sq += residual * residual;
+    }
+    double stderr_p = n > 0 ? std::sqrt(K / (K - 1.0) * sum_sq) / n : 1.0;
+    double half = normal_critical_value(confidence) * stderr_p;
+
+    est.lower = std::max(0.0, est.hit_rate - half);
+    est.upper = std::min(1.0, est.hit_rate + half);
+    return est;
+}
+
+// ============================================================================
+// SampledStackDistance
+// ============================================================================
+
+SampledStackDistance::SampledStackDistance(double rate, size_t block_size, uint64_t seed)
+    : sampler(rate, block_size, seed), engine(block_size), seen(0) {}
+
+int64_t SampledStackDistance::access(uint64_t address) {
+    seen++;
+    if (!sampler.sample(address)) {
+        return NOT_SAMPLED;
+    }
+    int64_t d = engine.access(address);
+    if (d == StackDistance::INFINITE_DISTANCE) {
+        return d;
+    }
+    return static_cast<int64_t>(std::llround(d / sampler.get_rate()));
+}
+
+double SampledStackDistance::hit_rate(size_t blocks) const {
+    // Scaled distance d / R < C  <=>  sampled distance d < C * R
+    size_t sampled_blocks = static_cast<size_t>(std::ceil(blocks * sampler.get_rate() - 1e-9));
+    return engine.hit_rate(sampled_blocks);
+}
+
+std::vector<double> SampledStackDistance::miss_ratio_curve(size_t max_blocks) const {
+    std::vector<double> curve(max_blocks + 1, 1.0);
+    for (size_t c = 1; c <= max_blocks; c++) {
+        curve[c] = 1.0 - hit_rate(c);
+    }
+    return curve;
+}
@@ -0,0 +1,136 @@
+#include "stack_distance.h"
+#include <algorithm>
+#include <cassert>
+
+namespace {
+constexpr size_t INITIAL_SLOTS = 1024;
+}
+
+// ============================================================================
+// Fenwick tree over timestamps
+// ============================================================================
+
+void StackDistance::Stack::add(uint64_t t, int32_t delta) {
+    for (uint64_t i = t + 1; i < tree.size(); i += i & (~i + 1)) {
+        tree[i] += delta;
+    }
+}
+
+uint64_t StackDistance::Stack::prefix(uint64_t t) const {
+    uint64_t sum = 0;
+    for (uint64_t i = t + 1; i > 0; i -= i & (~i + 1)) {
+        sum += tree[i];
+    }
+    return sum;
+}
+
+/**
+ * Renumber live timestamps 0..live-1 (order preserved) and rebuild the tree
+ * with room for as many new accesses again
+ */
+void StackDistance::Stack::compact() {
+    std::vector<uint64_t*> order;
+    order.reserve(last_access.size());
+    for (auto& entry : last_access) {
+        order.push_back(&entry.second);
+    }
+    std::sort(order.begin(), order.end(),
+              [](const uint64_t* a, const uint64_t* b) { return *a < *b; });
+    for (size_t i = 0; i < order.size(); i++) {
+        *order[i] = i;
+    }
+
+    size_t live = order.size();
+    tree.assign(std::max(INITIAL_SLOTS, 2 * live) + 1, 0);
+    // Linear-time build with every slot in [0, live) marked
+    for (size_t i = 1; i < tree.size(); i++) {
+        if (i <= live) {
+            tree[i] += 1;
+        }
+        size_t parent = i + (i & (~i + 1));
+        if (parent < tree.size()) {
+            tree[parent] += tree[i];
+        }
+    }
+    now = live;
+}
+
+// ============================================================================
+// StackDistance
+// ============================================================================
+
+StackDistance::StackDistance(size_t block, size_t num_sets)
+    : block_size(block), block_shift(0), stacks(num_sets), cold_misses(0), total(0) {
+    assert(block > 0 && (block & (block - 1)) == 0 && "Block size must be power of 2");
+    assert(num_sets > 0 && "Need at least one set");
+    while ((1ULL << block_shift) < block_size) {
+        block_shift++;
+    }
+}
+
+int64_t StackDistance::access(uint64_t address) {
+    total++;
+    uint64_t block = address >> block_shift;
+    Stack& s = stacks.size() == 1 ? stacks[0] : stacks[block % stacks.size()];
+    if (s.now + 1 >= s.tree.size()) {
+        s.compact();
+    }
+
+    int64_t distance = INFINITE_DISTANCE;
+    auto it = s.last_access.find(block);
+    if (it == s.last_access.end()) {
+        cold_misses++;
+        s.last_access.emplace(block, s.now);
+    } else {
+        // Every other block has exactly one mark; count those after prev
+        uint64_t prev = it->second;
+        uint64_t newer = s.last_access.size() - s.prefix(prev);
+        distance = static_cast<int64_t>(newer);
+        s.add(prev, -1);
+        it->second = s.now;
+
+        if (hist.size() <= newer) {
+            hist.resize(newer + 1, 0);
+        }
+        hist[newer]++;
+    }
+    s.add(s.now, 1);
+    s.now++;
+    return distance;
+}
+
+double StackDistance::hit_rate(size_t blocks) const {
+    if (total == 0) {
+        return 0.0;
+    }
+    uint64_t hits = 0;
+    for (size_t d = 0; d < blocks && d < hist.size(); d++) {
+        hits += hist[d];
+    }
+    return static_cast<double>(hits) / total;
+}
+
+std::vector<double> StackDistance::miss_ratio_curve(size_t max_blocks) const {
+    size_t n = max_blocks > 0 ? max_blocks : hist.size() + 1;
+    std::vector<double> curve(n + 1, 1.0);
+    if (total == 0) {
+        return curve;
+    }
+    uint64_t hits = 0;
+    for (size_t c = 1; c <= n; c++) {
+        if (c - 1 < hist.size()) {
+            hits += hist[c - 1];
+        }
+        curve[c] = 1.0 - static_cast<double>(hits) / total;
+    }
+    return curve;
+}
+
+void StackDistance::reset() {
+    size_t num_sets = stacks.size();
+    stacks.clear();
+    stacks.resize(num_sets);
+    hist.clear();
+    cold_misses = 0;
+    total = 0;
+}
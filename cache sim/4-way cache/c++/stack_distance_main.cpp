@@ -0,0 +1,89 @@
+#include "stack_distance.h"
+#include "spatial_sampler.h"
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <cstdlib>
+
+// ============================================================================
+// Miss-ratio curve from one pass over an address trace
+//
+// Prints the LRU miss ratio for every cache size (in blocks, or ways per
+// set when num_sets > 1) as CSV, the native counterpart of
+// predict_miss_rate_curve() in python/analysis/reuse_distance.py.
+//
+// Trace format (same as memory_sim): one access per line, "R 0x1234" or
+// "W 0x1234". Other lines are skipped.
+//
+// A sample_rate below 1 estimates the fully associative curve from a
+// SHARDS spatial sample of the blocks (see spatial_sampler.h).
+// ============================================================================
+
+template <typename Engine>
+static void run_trace(std::istream& in, Engine& engine) {
+    char op;
+    uint64_t addr;
+    while (in >> op >> std::hex >> addr) {
+        if (op == 'R' || op == 'r' || op == 'W' || op == 'w') {
+            engine.access(addr);
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <trace_file|-> [block_bytes] [num_sets] [max_blocks] [sample_rate]\n";
+        std::cerr << "Example: " << argv[0] << " trace.txt 64 1 4096\n";
+        std::cerr << "Sampled: " << argv[0] << " trace.txt 64 1 4096 0.01\n";
+        return 1;
+    }
+
+    std::string trace_file = argv[1];
+    size_t block = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 64;
+    size_t sets = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 1;
+    size_t max_blocks = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 0;
+
+    double rate = argc > 5 ? std::strtod(argv[5], nullptr) : 1.0;
+    if (rate <= 0.0 || rate > 1.0) {
+        std::cerr << "Error: sample_rate must be in (0, 1]\n";
+        return 1;
+    }
+    if (rate < 1.0 && (sets != 1 || max_blocks == 0)) {
+        std::cerr << "Error: sampling needs num_sets = 1 and an explicit max_blocks\n";
+        return 1;
+    }
+
+    std::ifstream file;
+    if (trace_file != "-") {
+        file.open(trace_file);
+        if (!file.is_open()) {
+            std::cerr << "Error: Could not open trace file: " << trace_file << "\n";
+            return 1;
+        }
+    }
+    std::istream& in = trace_file == "-" ? std::cin : file;
+
+    std::vector<double> curve;
+    if (rate < 1.0) {
+        SampledStackDistance engine(rate, block);
+        run_trace(in, engine);
+        std::cerr << std::dec << engine.get_seen() << " accesses, "
+                  << engine.get_engine().get_total_accesses() << " sampled at rate "
+                  << engine.get_rate() << "\n";
+        curve = engine.miss_ratio_curve(max_blocks);
+    } else {
+        StackDistance engine(block, sets);
+        run_trace(in, engine);
+        std::cerr << std::dec << engine.get_total_accesses() << " accesses, "
+                  << engine.get_cold_misses() << " cold misses\n";
+        curve = engine.miss_ratio_curve(max_blocks);
+    }
+
+    std::cout << (sets > 1 ? "ways" : "blocks") << ",miss_ratio\n";
+    for (size_t c = 1; c < curve.size(); c++) {
+        std::cout << std::dec << c << "," << std::fixed << std::setprecision(6) << curve[c] << "\n";
+    }
+    return 0;
+}
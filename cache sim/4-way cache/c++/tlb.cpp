@@ -0,0 +1,227 @@
+#include "tlb.h"
+#include <iomanip>
+#include <sstream>
+#include <cassert>
+#include <algorithm>
+
+namespace {
+constexpr unsigned TABLE_LEVELS = 4;        // PML4, PDPT, PD, PT
+constexpr unsigned TABLE_SHIFT = 12;        // Page-table nodes are 4K
+constexpr uint64_t PTE_BYTES = 8;
+constexpr uint64_t FIRST_FRAME = 1ULL << 20; // Leave physical page 0 unused
+
+/** Index bits of each level start here and are 9 wide */
+unsigned level_shift(unsigned level) { return 39 - 9 * level; }
+
+/** splitmix64 finalizer over the region number */
+uint64_t mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+}
+
+const char* page_size_name(PageSize size) {
+    switch (size) {
+        case PageSize::SIZE_4K: return "4K";
+        case PageSize::SIZE_2M: return "2M";
+        case PageSize::SIZE_1G: return "1G";
+    }
+    return "unknown";
+}
+
+// ============================================================================
+// TLB
+// ============================================================================
+
+TLB::TLB(const TLBLevelConfig& config)
+    : entries(config.entries, 1, config.assoc, 64, StorageMode::FLAT, config.policy,
+              false),
+      name(config.name), hit_latency(config.hit_latency) {}
+
+// ============================================================================
+// Constructor
+// ============================================================================
+
+MMU::MMU(CacheHierarchy& hierarchy, const MMUConfig& config)
+    : hierarchy(hierarchy), config(config), itlb(config.itlb), dtlb(config.dtlb),
+      stlb(config.stlb), next_frame(FIRST_FRAME) {
+    assert(!config.cache_latency.empty() && "Need a latency for the first cache level");
+    stats.walk_ref_hits.assign(hierarchy.get_num_levels() + 1, 0);
+}
+
+// ============================================================================
+// Page tables
+// ============================================================================
+
+PageSize MMU::page_of(uint64_t vaddr) const {
+    if (config.page_size == PageSize::SIZE_4K || config.huge_fraction <= 0.0) {
+        return PageSize::SIZE_4K;
+    }
+    if (config.huge_fraction >= 1.0) {
+        return config.page_size;
+    }
+    // Top 53 bits of the hash as a uniform double in [0, 1)
+    uint64_t region = vaddr >> page_shift(config.page_size);
+    double u = static_cast<double>(mix(region) >> 11) * 0x1.0p-53;
+    return u < config.huge_fraction ? config.page_size : PageSize::SIZE_4K;
+}
+
+uint64_t MMU::allocate(unsigned shift) {
+    const uint64_t align = (1ULL << shift) - 1;
+    uint64_t frame = (next_frame + align) & ~align;
+    next_frame = frame + (1ULL << shift);
+    return frame;
+}
+
+uint64_t MMU::frame_of(uint64_t key, PageSize size) {
+    auto it = frames.find(key);
+    if (it != frames.end()) {
+        return it->second;
+    }
+    stats.pages[static_cast<size_t>(size)]++;
+    uint64_t frame = allocate(page_shift(size));
+    frames.emplace(key, frame);
+    return frame;
+}
+
+/**
+ * Physical base of the table that level walks through for vaddr
+ * A level-l table covers the bits above level l's index, so the VA above
+ * those bits plus the level identifies it.
+ */
+uint64_t MMU::table_of(unsigned level, uint64_t vaddr) {
+    const unsigned covered = level_shift(level) + 9;
+    uint64_t id = (static_cast<uint64_t>(level) << 60) | (vaddr >> covered);
+    auto it = tables.find(id);
+    if (it != tables.end()) {
+        return it->second;
+    }
+    uint64_t table = allocate(TABLE_SHIFT);
+    tables.emplace(id, table);
+    return table;
+}
+
+uint32_t MMU::latency_of(size_t hit_level) const {
+    if (hit_level >= hierarchy.get_num_levels()) {
+        return config.memory_latency;
+    }
+    return config.cache_latency[std::min(hit_level, config.cache_latency.size() - 1)];
+}
+
+/**
+ * Read one entry per level down to the leaf for size
+ * @return Walk latency in cycles
+ */
+uint64_t MMU::walk(uint64_t vaddr, PageSize size) {
+    const unsigned leaf = TABLE_LEVELS - 1 - static_cast<unsigned>(size);
+    uint64_t cycles = 0;
+    for (unsigned level = 0; level <= leaf; level++) {
+        uint64_t index = (vaddr >> level_shift(level)) & 511;
+        uint64_t pte = table_of(level, vaddr) + index * PTE_BYTES;
+        size_t hit = hierarchy.access(pte, AccessType::READ).hit_level;
+        stats.walk_ref_hits[hit]++;
+        stats.walk_refs++;
+        cycles += latency_of(hit);
+    }
+    stats.walks++;
+    stats.walk_cycles += cycles;
+    stats.max_walk_cycles = std::max(stats.max_walk_cycles, cycles);
+    return cycles;
+}
+
+// ============================================================================
+// Core Access Logic
+// ============================================================================
+
+TranslationResult MMU::access(uint64_t vaddr, AccessType type, bool fetch) {
+    TranslationResult result;
+    const PageSize size = page_of(vaddr);
+    const uint64_t key = TLB::key(vaddr, size);
+    TLB& first = fetch ? itlb : dtlb;
+
+    if (first.lookup(key)) {
+        result.tlb_level = 0;
+        result.translation_cycles = first.get_hit_latency();
+    } else if (stlb.lookup(key)) {
+        result.tlb_level = 1;
+        result.translation_cycles = stlb.get_hit_latency();
+    } else {
+        result.tlb_level = 2;
+        result.translation_cycles = stlb.get_hit_latency() + walk(vaddr, size);
+    }
+    stats.translations++;
+    stats.translation_cycles += result.translation_cycles;
+
+    const uint64_t offset = vaddr & ((1ULL << page_shift(size)) - 1);
+    result.page = size;
+    result.paddr = frame_of(key, size) | offset;
+    result.cache = hierarchy.access(result.paddr, type);
+    return result;
+}
+
+// ============================================================================
+// Reporting
+// ============================================================================
+
+void MMU::print_report(std::ostream& out) const {
+    out << std::string(70, '=') << "\n";
+    out << "TLBs (" << page_size_name(config.page_size) << " pages";
+    if (config.page_size != PageSize::SIZE_4K && config.huge_fraction < 1.0) {
+        out << " for " << std::fixed << std::setprecision(0)
+            << (config.huge_fraction * 100) << "% of regions, 4K elsewhere";
+    }
+    out << ")\n";
+    out << std::string(70, '=') << "\n";
+    out << std::left << std::setw(8) << "TLB"
+        << std::setw(10) << "Entries"
+        << std::setw(6) << "Ways"
+        << std::setw(12) << "Lookups"
+        << std::setw(12) << "Hits"
+        << std::setw(11) << "Hit Rate"
+        << "Misses\n";
+    out << std::string(70, '-') << "\n";
+    for (const TLB* tlb : {&itlb, &dtlb, &stlb}) {
+        CacheStats s = tlb->get_stats();
+        std::ostringstream rate;
+        rate << std::fixed << std::setprecision(2) << (s.hit_rate() * 100) << "%";
+        out << std::left << std::setw(8) << tlb->get_name()
+            << std::setw(10) << tlb->get_entries()
+            << std::setw(6) << tlb->get_associativity()
+            << std::setw(12) << (s.hits + s.misses)
+            << std::setw(12) << s.hits
+            << std::setw(11) << rate.str()
+            << s.misses << "\n";
+    }
+    out << std::string(70, '-') << "\n";
+
+    out << "Pages mapped: " << stats.pages[0] << " x 4K, " << stats.pages[1] << " x 2M, "
+        << stats.pages[2] << " x 1G\n";
+    out << "Page walks: " << stats.walks << " (" << stats.walk_refs << " PTE reads)"
+        << std::fixed << std::setprecision(2)
+        << ", avg latency " << stats.avg_walk_cycles() << " cycles"
+        << ", max " << stats.max_walk_cycles << "\n";
+    out << "PTE reads served by:";
+    for (size_t i = 0; i < stats.walk_ref_hits.size(); i++) {
+        out << " " << (i < hierarchy.get_num_levels() ? hierarchy.get_level_name(i) : "memory")
+            << "=" << stats.walk_ref_hits[i];
+    }
+    out << "\n";
+    double per_access = stats.translations > 0
+        ? static_cast<double>(stats.translation_cycles) / stats.translations : 0.0;
+    out << "Translation cycles: " << stats.translation_cycles << " ("
+        << per_access << " per access)\n";
+}
+
+void MMU::reset() {
+    itlb.reset();
+    dtlb.reset();
+    stlb.reset();
+    frames.clear();
+    tables.clear();
+    next_frame = FIRST_FRAME;
+    stats = MMUStats();
+    stats.walk_ref_hits.assign(hierarchy.get_num_levels() + 1, 0);
+}
@@ -0,0 +1,391 @@
+#include "working_set.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+constexpr size_t MIN_PER_THREAD = 1 << 14;     // Less work than this stays serial
+
+/** splitmix64 finalizer */
+uint64_t mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+/**
+ * FlatMap - Open-addressing block -> V table with linear probing
+ * Deletion shifts the following cluster back, so there are no tombstones
+ * and a sliding window's table stays as small as the window.
+ */
+template <typename V>
+class FlatMap {
+public:
+    static constexpr uint64_t EMPTY = ~0ULL;   // Only a block with 1-byte blocks
+
+    explicit FlatMap(size_t expected = 16) : count(0) {
+        size_t capacity = 16;
+        while (capacity < expected * 2) {
+            capacity <<= 1;
+        }
+        keys.assign(capacity, EMPTY);
+        values.resize(capacity);
+        mask = capacity - 1;
+    }
+
+    V* find(uint64_t key) {
+        for (size_t i = home(key);; i = (i + 1) & mask) {
+            if (keys[i] == key) {
+                return &values[i];
+            }
+            if (keys[i] == EMPTY) {
+                return nullptr;
+            }
+        }
+    }
+
+    /** Insert a key known to be absent */
+    V& insert(uint64_t key, const V& value) {
+        if ((count + 1) * 4 > keys.size() * 3) {
+            grow();
+        }
+        size_t i = home(key);
+        while (keys[i] != EMPTY) {
+            i = (i + 1) & mask;
+        }
+        keys[i] = key;
+        values[i] = value;
+        count++;
+        return values[i];
+    }
+
+    /** Remove a key known to be present */
+    void erase(uint64_t key) {
+        size_t i = home(key);
+        while (keys[i] != key) {
+            i = (i + 1) & mask;
+        }
+        for (size_t j = (i + 1) & mask; keys[j] != EMPTY; j = (j + 1) & mask) {
+            // Move j into the hole unless its home lies cyclically in (i, j]
+            size_t k = home(keys[j]);
+            bool stays = i <= j ? (i < k && k <= j) : (i < k || k <= j);
+            if (!stays) {
+                keys[i] = keys[j];
+                values[i] = values[j];
+                i = j;
+            }
+        }
+        keys[i] = EMPTY;
+        count--;
+    }
+
+    size_t size() const { return count; }
+
+    template <typename F>
+    void for_each(F f) const {
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (keys[i] != EMPTY) {
+                f(keys[i], values[i]);
+            }
+        }
+    }
+
+private:
+    std::vector<uint64_t> keys;
+    std::vector<V> values;
+    size_t mask;
+    size_t count;
+
+    size_t home(uint64_t key) const { return static_cast<size_t>(mix(key)) & mask; }
+
+    void grow() {
+        FlatMap bigger(keys.size());
+        for_each([&](uint64_t key, const V& value) { bigger.insert(key, value); });
+        *this = std::move(bigger);
+    }
+};
+
+/**
+ * Run f(chunk, begin, end) over [0, n) split into `threads` contiguous
+ * chunks, on threads - 1 new threads plus the caller
+ */
+template <typename F>
+void parallel_chunks(size_t n, size_t threads, F f) {
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < threads; t++) {
+        pool.emplace_back(f, t, n * t / threads, n * (t + 1) / threads);
+    }
+    f(0, 0, n / threads);
+    for (std::thread& t : pool) {
+        t.join();
+    }
+}
+
+/**
+ * Times (first-access, reverse last-access and reuse) bucketed by the
+ * window lengths they exceed: bucket k holds the times x with
+ * windows[k - 1] < x <= windows[k]
+ */
+struct TimeBuckets {
+    std::vector<uint64_t> count;
+    std::vector<uint64_t> sum;
+
+    explicit TimeBuckets(size_t windows) : count(windows + 1, 0), sum(windows + 1, 0) {}
+
+    void add(const std::vector<size_t>& windows, uint64_t x) {
+        size_t k = std::lower_bound(windows.begin(), windows.end(), x) - windows.begin();
+        count[k]++;
+        sum[k] += x;
+    }
+
+    TimeBuckets& operator+=(const TimeBuckets& other) {
+        for (size_t k = 0; k < count.size(); k++) {
+            count[k] += other.count[k];
+            sum[k] += other.sum[k];
+        }
+        return *this;
+    }
+};
+
+struct FirstLast {
+    uint64_t first;
+    uint64_t last;
+};
+}
+
+// ============================================================================
+// HyperLogLog
+// ============================================================================
+
+HyperLogLog::HyperLogLog(unsigned precision) : precision(precision) {
+    if (precision < MIN_PRECISION || precision > MAX_PRECISION) {
+        throw std::invalid_argument("HyperLogLog precision must be 4..18");
+    }
+    registers.assign(size_t(1) << precision, 0);
+}
+
+void HyperLogLog::add(uint64_t key) {
+    uint64_t h = mix(key);
+    size_t index = static_cast<size_t>(h >> (64 - precision));
+    // Guard bit caps the rank at 64 - precision + 1
+    uint64_t rest = (h << precision) | (1ULL << (precision - 1));
+    uint8_t rank = static_cast<uint8_t>(__builtin_clzll(rest) + 1);
+    registers[index] = std::max(registers[index], rank);
+}
+
+void HyperLogLog::merge(const HyperLogLog& other) {
+    if (other.precision != precision) {
+        throw std::invalid_argument("Can't merge HyperLogLogs of different precision");
+    }
+    for (size_t i = 0; i < registers.size(); i++) {
+        registers[i] = std::max(registers[i], other.registers[i]);
+    }
+}
+
+double HyperLogLog::estimate() const {
+    const double m = static_cast<double>(registers.size());
+    double alpha;
+    switch (registers.size()) {
+        case 16: alpha = 0.673; break;
+        case 32: alpha = 0.697; break;
+        case 64: alpha = 0.709; break;
+        default: alpha = 0.7213 / (1.0 + 1.079 / m); break;
+    }
+    double sum = 0.0;
+    size_t zeros = 0;
+    for (uint8_t r : registers) {
+        sum += std::ldexp(1.0, -static_cast<int>(r));
+        zeros += (r == 0);
+    }
+    double e = alpha * m * m / sum;
+    if (e <= 2.5 * m && zeros > 0) {
+        e = m * std::log(m / static_cast<double>(zeros));    // Linear counting
+    }
+    return e;
+}
+
+void HyperLogLog::clear() {
+    std::fill(registers.begin(), registers.end(), 0);
+}
+
+// ============================================================================
+// WorkingSetAnalyzer
+// ============================================================================
+
+WorkingSetAnalyzer::WorkingSetAnalyzer(size_t block_size, size_t threads) : block_shift(0) {
+    if (block_size == 0 || (block_size & (block_size - 1)) != 0) {
+        throw std::invalid_argument("Block size must be a power of 2");
+    }
+    block_shift = static_cast<unsigned>(__builtin_ctzll(block_size));
+    num_threads = threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+}
+
+size_t WorkingSetAnalyzer::threads_for(size_t n) const {
+    return std::max<size_t>(1, std::min(num_threads, n / MIN_PER_THREAD));
+}
+
+std::vector<uint32_t> WorkingSetAnalyzer::sliding(const uint64_t* trace, size_t n,
+                                                  size_t window) const {
+    if (window == 0) {
+        throw std::invalid_argument("Working-set window must be positive");
+    }
+    if (n < window) {
+        return {static_cast<uint32_t>(unique_blocks(trace, n))};
+    }
+
+    const size_t positions = n - window + 1;
+    std::vector<uint32_t> sizes(positions);
+    parallel_chunks(positions, threads_for(positions), [&](size_t, size_t begin, size_t end) {
+        if (begin == end) {
+            return;
+        }
+        FlatMap<uint32_t> counts(std::min<size_t>(window, 1 << 16));
+        auto add = [&](uint64_t block) {
+            if (uint32_t* c = counts.find(block)) {
+                ++*c;
+            } else {
+                counts.insert(block, 1);
+            }
+        };
+        for (size_t i = begin; i < begin + window; i++) {
+            add(trace[i] >> block_shift);
+        }
+        sizes[begin] = static_cast<uint32_t>(counts.size());
+        for (size_t p = begin + 1; p < end; p++) {
+            uint64_t old = trace[p - 1] >> block_shift;
+            uint32_t* c = counts.find(old);
+            if (--*c == 0) {
+                counts.erase(old);
+            }
+            add(trace[p + window - 1] >> block_shift);
+            sizes[p] = static_cast<uint32_t>(counts.size());
+        }
+    });
+    return sizes;
+}
+
+FootprintCurve WorkingSetAnalyzer::footprint(const uint64_t* trace, size_t n,
+                                             const std::vector<size_t>& windows) const {
+    FootprintCurve curve;
+    curve.accesses = n;
+    for (size_t w : windows) {
+        if (w >= 1 && w <= n) {
+            curve.windows.push_back(w);
+        }
+    }
+    std::sort(curve.windows.begin(), curve.windows.end());
+    curve.windows.erase(std::unique(curve.windows.begin(), curve.windows.end()),
+                        curve.windows.end());
+    const std::vector<size_t>& ws = curve.windows;
+
+    // Pass: first/last access of each block per chunk, reuse times inside it
+    const size_t threads = threads_for(n);
+    std::vector<FlatMap<FirstLast>> chunks(threads);
+    std::vector<TimeBuckets> times(threads, TimeBuckets(ws.size()));
+    parallel_chunks(n, threads, [&](size_t t, size_t begin, size_t end) {
+        FlatMap<FirstLast>& blocks = chunks[t];
+        for (size_t i = begin; i < end; i++) {
+            uint64_t block = trace[i] >> block_shift;
+            if (FirstLast* fl = blocks.find(block)) {
+                times[t].add(ws, i - fl->last);
+                fl->last = i;
+            } else {
+                blocks.insert(block, FirstLast{i, i});
+            }
+        }
+    });
+
+    // Merge in trace order: reuses across chunk boundaries, first accesses
+    FlatMap<uint64_t> last(chunks[0].size());
+    TimeBuckets total(ws.size());
+    for (size_t t = 0; t < threads; t++) {
+        chunks[t].for_each([&](uint64_t block, const FirstLast& fl) {
+            if (uint64_t* prev = last.find(block)) {
+                total.add(ws, fl.first - *prev);
+                *prev = fl.last;
+            } else {
+                total.add(ws, fl.first + 1);
+                last.insert(block, fl.last);
+            }
+        });
+        total += times[t];
+        chunks[t] = FlatMap<FirstLast>();
+    }
+    last.for_each([&](uint64_t, uint64_t l) { total.add(ws, n - l); });
+    curve.unique_blocks = last.size();
+
+    // fp(w) from the times above w: suffix sums over the buckets
+    curve.footprint.assign(ws.size(), 0.0);
+    uint64_t above = 0, above_sum = 0;
+    for (size_t j = ws.size(); j-- > 0;) {
+        above += total.count[j + 1];
+        above_sum += total.sum[j + 1];
+        double excess = static_cast<double>(above_sum - ws[j] * above);
+        curve.footprint[j] = static_cast<double>(curve.unique_blocks) -
+                             excess / static_cast<double>(n - ws[j] + 1);
+    }
+    return curve;
+}
+
+uint64_t WorkingSetAnalyzer::unique_blocks(const uint64_t* trace, size_t n) const {
+    const size_t threads = threads_for(n);
+    std::vector<FlatMap<uint8_t>> chunks(threads);
+    parallel_chunks(n, threads, [&](size_t t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            uint64_t block = trace[i] >> block_shift;
+            if (!chunks[t].find(block)) {
+                chunks[t].insert(block, 0);
+            }
+        }
+    });
+    for (size_t t = 1; t < threads; t++) {
+        chunks[t].for_each([&](uint64_t block, uint8_t) {
+            if (!chunks[0].find(block)) {
+                chunks[0].insert(block, 0);
+            }
+        });
+    }
+    return chunks[0].size();
+}
+
+HyperLogLog WorkingSetAnalyzer::sketch(const uint64_t* trace, size_t n,
+                                       unsigned precision) const {
+    const size_t threads = threads_for(n);
+    std::vector<HyperLogLog> sketches(threads, HyperLogLog(precision));
+    parallel_chunks(n, threads, [&](size_t t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            sketches[t].add(trace[i] >> block_shift);
+        }
+    });
+    for (size_t t = 1; t < threads; t++) {
+        sketches[0].merge(sketches[t]);
+    }
+    return sketches[0];
+}
+
+std::vector<double> WorkingSetAnalyzer::estimate_windows(const uint64_t* trace, size_t n,
+                                                         size_t window,
+                                                         unsigned precision) const {
+    if (window == 0) {
+        throw std::invalid_argument("Working-set window must be positive");
+    }
+    HyperLogLog validate(precision);    // Throw before starting threads
+    const size_t count = (n + window - 1) / window;
+    std::vector<double> estimates(count);
+    parallel_chunks(count, std::min(threads_for(n), std::max<size_t>(count, 1)),
+                    [&](size_t, size_t begin, size_t end) {
+        HyperLogLog hll(precision);
+        for (size_t k = begin; k < end; k++) {
+            hll.clear();
+            size_t stop = std::min(n, (k + 1) * window);
+            for (size_t i = k * window; i < stop; i++) {
+                hll.add(trace[i] >> block_shift);
+            }
+            estimates[k] = hll.estimate();
+        }
+    });
+    return estimates;
+}
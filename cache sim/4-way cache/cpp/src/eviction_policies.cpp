@@ -1,84 +1,53 @@
 #include "eviction_policies.hpp"
 #include <cassert>
+#include <algorithm>
 
 // ============================================================================
-// LRU Implementation (Linked List)
+// LRU Implementation (Index-Linked List)
 // ============================================================================
 
-LRU::LRU(int num_ways) : EvictionPolicy(num_ways) {
-    // Create dummy nodes
-    head = new Node(-1);
-    tail = new Node(-1);
-    head->next = tail;
-    tail->prev = head;
-    
-    // Create a node for each way
-    way_nodes.resize(num_ways);
-    for (int i = 0; i < num_ways; i++) {
-        way_nodes[i] = nullptr;  // Not inserted yet
-    }
-}
-
-LRU::~LRU() {
-    // Delete all nodes
-    Node* current = head;
-    while (current != nullptr) {
-        Node* next = current->next;
-        delete current;
-        current = next;
-    }
+LRU::LRU(int num_ways)
+    : EvictionPolicy(num_ways), sentinel(static_cast<uint32_t>(num_ways)),
+      next(num_ways + 1), prev(num_ways + 1) {
+    assert(num_ways > 0);
+    reset();
 }
 
 void LRU::access(int way) {
-    if (way_nodes[way] == nullptr) {
-        // First access: create node and add to front
-        Node* new_node = new Node(way);
-        way_nodes[way] = new_node;
-        add_to_front(new_node);
-    } else {
+    if (next[way] != UNLISTED) {
         // Re-access: move to front
-        remove_node(way_nodes[way]);
-        add_to_front(way_nodes[way]);
+        remove_node(way);
     }
+    // First access just joins the list
+    add_to_front(way);
 }
 
 int LRU::get_victim() {
-    // Victim is the node just before dummy_tail (least recently used)
-    Node* victim_node = tail->prev;
-    return victim_node->way;
+    // Victim is the way just before the sentinel (least recently used).
+    // With nothing accessed yet the list is empty and there is no victim.
+    return prev[sentinel] != sentinel ? static_cast<int>(prev[sentinel]) : -1;
 }
 
 void LRU::reset() {
-    // Delete all real nodes
-    Node* current = head->next;
-    while (current != tail) {
-        Node* next = current->next;
-        delete current;
-        current = next;
-    }
-    
-    // Reset list to just dummy nodes
-    head->next = tail;
-    tail->prev = head;
-    
-    // Reset way_nodes
-    for (int i = 0; i < num_ways; i++) {
-        way_nodes[i] = nullptr;
-    }
+    // Empty list: sentinel points at itself. Nothing to free.
+    std::fill(next.begin(), next.end(), UNLISTED);
+    next[sentinel] = sentinel;
+    prev[sentinel] = sentinel;
 }
 
-void LRU::remove_node(Node* node) {
-    // Unlink node from list
-    node->prev->next = node->next;
-    node->next->prev = node->prev;
+void LRU::remove_node(int way) {
+    // Unlink way from list
+    next[prev[way]] = next[way];
+    prev[next[way]] = prev[way];
 }
 
-void LRU::add_to_front(Node* node) {
-    // Insert node right after dummy_head
-    node->next = head->next;
-    node->prev = head;
-    head->next->prev = node;
-    head->next = node;
+void LRU::add_to_front(int way) {
+    // Insert way right after the sentinel
+    uint32_t w = static_cast<uint32_t>(way);
+    next[w] = next[sentinel];
+    prev[w] = sentinel;
+    prev[next[sentinel]] = w;
+    next[sentinel] = w;
 }
 
 // ============================================================================
@@ -124,9 +93,8 @@ void FIFO::reset() {
 // Random Implementation
 // ============================================================================
 
-Random::Random(int num_ways) : EvictionPolicy(num_ways) {
-    rng.seed(std::random_device{}());
-}
+Random::Random(int num_ways, uint64_t seed)
+    : EvictionPolicy(num_ways), seed(seed ? seed : DEFAULT_SEED), state(this->seed) {}
 
 void Random::access(int way) {
     // Random replacement doesn't track accesses
@@ -134,78 +102,70 @@ void Random::access(int way) {
 }
 
 int Random::get_victim() {
-   std::uniform_int_distribution<int> dist(0, num_ways-1);
-   return dist(rng);  
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    uint64_t r = (state * 0x2545F4914F6CDD1DULL) >> 32;
+    return static_cast<int>((r * static_cast<uint64_t>(num_ways)) >> 32);
 }
 
 void Random::reset() {
-    // Random replacement doesn't track accesses
-    // Do nothing
+    state = seed;
 }
 
 // ============================================================================
 // Pseudo-LRU Implementation
 // ============================================================================
 
-PseudoLRU::PseudoLRU(int num_ways) : EvictionPolicy(num_ways) {
-    assert(num_ways == 4 || num_ways == 8 || num_ways == 16);
-    
-    num_bits = num_ways - 1;
-    bits.resize(num_bits, 0);
-    
-    // Calculate max_depth once
-    max_depth = 0;
-    int temp = num_ways;
-    while (temp > 1) {
-        temp /= 2;
-        max_depth++;
+PseudoLRU::PseudoLRU(int num_ways)
+    : EvictionPolicy(num_ways), tree(0), paths(&table_for(num_ways)), depth(0) {
+    while ((1 << depth) < num_ways) {
+        depth++;
     }
 }
 
-void PseudoLRU::access(int way) {
-    // Flip bits along path from leaf to root
-    int bit_idx = 0;
-    int pos = way;
-    
-    for (int level = 0; level < max_depth; level++) {
-        int subtree_size = 1 << (max_depth - level - 1);
-        bool is_right = (pos >= subtree_size);
-        
-        bits[bit_idx] = is_right ? 0 : 1;
-        
-        pos = is_right ? (pos - subtree_size) : pos;
-        bit_idx = 2 * bit_idx + (is_right ? 2 : 1);
-        
-        if (bit_idx >= num_bits) {
-            break;
+/**
+ * Built once per associativity on first use. Walking from the root to way
+ * w, every node passed gets 1 if w is in its left half (point away, to the
+ * right) and 0 if it is in the right half.
+ */
+const PseudoLRU::PathTable& PseudoLRU::table_for(int num_ways) {
+    assert(num_ways > 0 && num_ways <= MAX_WAYS && (num_ways & (num_ways - 1)) == 0);
+    static const std::array<PathTable, 7> tables = [] {
+        std::array<PathTable, 7> t{};
+        for (int log_ways = 0; log_ways < 7; log_ways++) {
+            for (int way = 0; way < (1 << log_ways); way++) {
+                uint64_t mask = 0;
+                uint64_t value = 0;
+                int node = 0;
+                for (int level = log_ways - 1; level >= 0; level--) {
+                    bool is_right = (way >> level) & 1;
+                    mask |= 1ULL << node;
+                    value |= static_cast<uint64_t>(!is_right) << node;
+                    node = 2 * node + (is_right ? 2 : 1);
+                }
+                t[log_ways].mask[way] = mask;
+                t[log_ways].value[way] = value;
+            }
         }
-    }
+        return t;
+    }();
+    return tables[__builtin_ctz(num_ways)];
+}
+
+void PseudoLRU::access(int way) {
+    tree = (tree & ~paths->mask[way]) | paths->value[way];
 }
 
 int PseudoLRU::get_victim() {
-    // Traverse tree using bits to find victim
-    int bit_idx = 0;
-    int victim = 0;
-    
-    for (int level = 0; level < max_depth; level++) {
-        int go_right = bits[bit_idx];
-        int subtree_size = 1 << (max_depth - level - 1);
-        
-        if (go_right) {
-            victim += subtree_size;
-        }
-        
-        bit_idx = 2 * bit_idx + (go_right ? 2 : 1);
-        if (bit_idx >= num_bits) {
-            break;
-        }
+    // Go right where the bit is 1; after depth steps node is the leaf
+    int node = 0;
+    for (int level = 0; level < depth; level++) {
+        node = 2 * node + 1 + static_cast<int>((tree >> node) & 1);
     }
-    
-    return victim;
+    return node - (num_ways - 1);
 }
 
 void PseudoLRU::reset() {
-    for (int i = 0; i < num_bits; i++) {
-        bits[i] = 0;
-    }
+    tree = 0;
 }
@@ -2,8 +2,8 @@
 #define EVICTION_POLICIES_HPP
 
 #include <vector>
+#include <array>
 #include <cstdint>
-#include <random>
 
 // ============================================================================
 // Abstract Base Class for Eviction Policies
@@ -37,37 +37,34 @@ protected:
 };
 
 // ============================================================================
-// Node for Linked List
-// ============================================================================
-
-struct Node {
-    int way;
-    Node* next;
-    Node* prev;
-    
-    Node(int w = -1) : way(w), next(nullptr), prev(nullptr) {}
-};
-
-// ============================================================================
-// LRU - Least Recently Used (Linked List Implementation)
+// LRU - Least Recently Used (Index-Linked List, Allocation-Free)
 // ============================================================================
 
 class LRU : public EvictionPolicy {
 public:
+    /**
+     * LRU order kept as a doubly linked list of way indices stored in
+     * index arrays sized once at construction (no heap nodes, any number
+     * of ways). Slot num_ways is the sentinel: next[sentinel] is the MRU
+     * way, prev[sentinel] is the LRU way. Ways join the list on their first
+     * access, as in the node-based list; next[way] is UNLISTED until then.
+     */
     explicit LRU(int num_ways);
-    ~LRU();
+    ~LRU() = default;
     
     void access(int way) override;
     int get_victim() override;
     void reset() override;
     
 private:
-    Node* head;              // Fake head node
-    Node* tail;              // Fake tail node
-    std::vector<Node*> way_nodes;  // Quick lookup: way → node
+    static constexpr uint32_t UNLISTED = UINT32_MAX;
+    
+    uint32_t sentinel;
+    std::vector<uint32_t> next;
+    std::vector<uint32_t> prev;
     
-    void remove_node(Node* node);  // Remove node from list
-    void add_to_front(Node* node); // Add node to front
+    void remove_node(int way);   // Unlink way from list
+    void add_to_front(int way);  // Link way right after the sentinel
 };
 
 // ============================================================================
@@ -94,15 +91,24 @@ private:
 
 class Random : public EvictionPolicy {
 public:
-    explicit Random(int num_ways);
+    static constexpr uint64_t DEFAULT_SEED = 0x9E3779B97F4A7C15ULL;
+    
+    /**
+     * Uniform victim from an xorshift64* generator owned by this policy.
+     * The same seed gives the same victims, so a policy per set seeded
+     * from its set index draws identically however the sets are sharded.
+     * The bounded draw is a multiply-shift: no modulo, no rejection loop.
+     */
+    explicit Random(int num_ways, uint64_t seed = DEFAULT_SEED);
     ~Random() = default;
     
     void access(int way) override;
     int get_victim() override;
-    void reset() override;
+    void reset() override;   // Back to the first draw of the seed
     
 private:
-    std::mt19937 rng;  // Mersenne Twister random number generator
+    uint64_t seed;
+    uint64_t state;
 };
 
 // ============================================================================
@@ -111,15 +117,22 @@ private:
 
 class PseudoLRU : public EvictionPolicy {
 public:
+    static constexpr int MAX_WAYS = 64;
+    
     /**
-     * Pseudo-LRU using a binary tree of bits.
-     * For 4-way cache, uses 3 bits to approximate LRU behavior.
+     * Pseudo-LRU using a binary tree of bits, for any power of two up to
+     * 64 ways. For 4-way cache, uses 3 bits to approximate LRU behavior.
      * 
      *     bit0
      *     /  \
      *   bit1  bit2
      *   / \    / \
      *  W0 W1  W2 W3
+     * 
+     * Node i's children are 2i+1 and 2i+2, and bit i of one uint64_t is node
+     * i (1 = the victim is to the right). access() rewrites a way's whole
+     * path with one precomputed mask and value; get_victim() follows the
+     * bits down, one step per level, without branches.
      */
     explicit PseudoLRU(int num_ways);
     ~PseudoLRU() = default;
@@ -129,9 +142,17 @@ public:
     void reset() override;
     
 private:
-    std::vector<int> bits;
-    int num_bits;
-    int max_depth;  // Calculate once, reuse
+    /** Per associativity: the tree bits on each way's path and what access() writes */
+    struct PathTable {
+        std::array<uint64_t, MAX_WAYS> mask;
+        std::array<uint64_t, MAX_WAYS> value;
+    };
+    
+    static const PathTable& table_for(int num_ways);
+    
+    uint64_t tree;
+    const PathTable* paths;   // Shared by every policy with this many ways
+    int depth;                // log2(num_ways)
 };
 
 #endif // EVICTION_POLICIES_HPP
@@ -0,0 +1,141 @@
+#ifndef ADDRESS_TRACE_H
+#define ADDRESS_TRACE_H
+
+#include <vector>
+#include <queue>
+#include <functional>
+#include <string>
+#include <sstream>
+#include <cstdint>
+#include <iostream>
+#include "set_associative_cache.h"
+
+/**
+ * Read a text address trace (same format as memory_sim)
+ * One access per line, "R 0x1234" or "W 0x1234". Other lines are skipped.
+ */
+inline std::vector<TraceEntry> read_address_trace(std::istream& in) {
+    std::vector<TraceEntry> trace;
+    char op;
+    uint64_t addr;
+    while (in >> op >> std::hex >> addr) {
+        if (op == 'R' || op == 'r') {
+            trace.push_back({addr, AccessType::READ});
+        } else if (op == 'W' || op == 'w') {
+            trace.push_back({addr, AccessType::WRITE});
+        }
+    }
+    return trace;
+}
+
+// ============================================================================
+// Multi-core traces
+// ============================================================================
+
+/**
+ * CoreAccess - One access of a multi-core trace
+ */
+struct CoreAccess {
+    uint32_t core;
+    uint64_t address;
+    AccessType type;
+};
+
+/**
+ * TimedAccess - One access of a per-core trace with its timestamp
+ */
+struct TimedAccess {
+    uint64_t time;
+    TraceEntry entry;
+};
+
+/**
+ * Parse "R" / "W" (either case)
+ * @return false for anything else
+ */
+inline bool parse_access_type(const std::string& op, AccessType& type) {
+    if (op == "R" || op == "r") { type = AccessType::READ;  return true; }
+    if (op == "W" || op == "w") { type = AccessType::WRITE; return true; }
+    return false;
+}
+
+/**
+ * Read an interleaved multi-core trace, already in global order
+ * One access per line, "<core> R 0x1234". Other lines are skipped.
+ */
+inline std::vector<CoreAccess> read_multicore_trace(std::istream& in) {
+    std::vector<CoreAccess> trace;
+    std::string line, op;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        uint32_t core;
+        uint64_t addr;
+        AccessType type;
+        if (fields >> std::dec >> core >> op >> std::hex >> addr && parse_access_type(op, type)) {
+            trace.push_back({core, addr, type});
+        }
+    }
+    return trace;
+}
+
+/**
+ * Read one core's trace
+ * One access per line, "<cycle> R 0x1234" (decimal timestamp, non-decreasing)
+ * or plain "R 0x1234", which is timestamped with its access number so
+ * untimed per-core traces interleave round-robin. Other lines are skipped.
+ */
+inline std::vector<TimedAccess> read_timed_trace(std::istream& in) {
+    std::vector<TimedAccess> trace;
+    std::string line, first, op;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        uint64_t time = trace.size();
+        uint64_t addr;
+        AccessType type;
+        if (!(fields >> first)) {
+            continue;
+        }
+        if (parse_access_type(first, type)) {
+            if (!(fields >> std::hex >> addr)) continue;
+        } else {
+            std::istringstream stamp(first);
+            if (!(stamp >> time) || !(fields >> op >> std::hex >> addr) ||
+                !parse_access_type(op, type)) {
+                continue;
+            }
+        }
+        trace.push_back({time, {addr, type}});
+    }
+    return trace;
+}
+
+/**
+ * Merge per-core traces into one global order by timestamp
+ * Equal timestamps go to the lower-numbered core first.
+ * @param per_core Trace of core i at index i, each sorted by time
+ */
+inline std::vector<CoreAccess> merge_by_timestamp(
+        const std::vector<std::vector<TimedAccess>>& per_core) {
+    // (time, core) of each core's next access, smallest on top
+    using Head = std::pair<uint64_t, uint32_t>;
+    std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+    std::vector<size_t> next(per_core.size(), 0);
+    size_t total = 0;
+    for (uint32_t c = 0; c < per_core.size(); c++) {
+        total += per_core[c].size();
+        if (!per_core[c].empty()) heads.push({per_core[c][0].time, c});
+    }
+
+    std::vector<CoreAccess> merged;
+    merged.reserve(total);
+    while (!heads.empty()) {
+        uint32_t c = heads.top().second;
+        heads.pop();
+        const TraceEntry& e = per_core[c][next[c]++].entry;
+        merged.push_back({c, e.address, e.type});
+        if (next[c] < per_core[c].size()) heads.push({per_core[c][next[c]].time, c});
+    }
+    return merged;
+}
+
+#endif // ADDRESS_TRACE_H
@@ -0,0 +1,141 @@
+#ifndef CACHE_HIERARCHY_H
+#define CACHE_HIERARCHY_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <iostream>
+#include "set_associative_cache.h"
+
+/**
+ * InclusionPolicy - Relationship between a level and the levels above it
+ *
+ * INCLUSIVE: every block in an upper level is also in the lower levels;
+ *            a lower-level eviction back-invalidates the upper copies
+ * EXCLUSIVE: a block lives in exactly one level; lower levels are victim
+ *            caches filled only by evictions from above
+ * NINE:      non-inclusive non-exclusive; fills go to every level, but
+ *            evictions don't back-invalidate
+ */
+enum class InclusionPolicy {
+    INCLUSIVE,
+    EXCLUSIVE,
+    NINE
+};
+
+const char* inclusion_name(InclusionPolicy policy);
+
+/**
+ * CacheLevelConfig - Geometry and policy of one hierarchy level
+ */
+struct CacheLevelConfig {
+    std::string name;
+    size_t size;                // Total size in bytes
+    size_t block;               // Block size in bytes (same at every level)
+    size_t assoc;               // Number of ways
+    PolicyType policy;          // Replacement policy
+    StorageMode storage;        // Metadata layout
+
+    CacheLevelConfig(const std::string& name, size_t size, size_t block, size_t assoc,
+                     PolicyType policy = PolicyType::LRU,
+                     StorageMode storage = StorageMode::FLAT)
+        : name(name), size(size), block(block), assoc(assoc),
+          policy(policy), storage(storage) {}
+};
+
+/**
+ * LevelStats - Per-level counters collected by the hierarchy
+ */
+struct LevelStats {
+    uint64_t accesses;              // Demand lookups reaching this level
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t writebacks_in;         // Dirty blocks written back from above
+    uint64_t writebacks_out;        // Dirty victims sent below (or to memory)
+    uint64_t evictions;             // Valid victims displaced at this level
+    uint64_t back_invalidations;    // Lines dropped because a lower level evicted them
+
+    LevelStats()
+        : accesses(0), hits(0), misses(0), writebacks_in(0), writebacks_out(0),
+          evictions(0), back_invalidations(0) {}
+
+    double hit_rate() const {
+        return accesses > 0 ? static_cast<double>(hits) / accesses : 0.0;
+    }
+};
+
+/**
+ * HierarchyResult - Outcome of one access through the hierarchy
+ */
+struct HierarchyResult {
+    size_t hit_level;           // Level that supplied the block (== num_levels: memory)
+    uint64_t memory_writes;     // Dirty blocks written to memory by this access
+
+    HierarchyResult() : hit_level(0), memory_writes(0) {}
+};
+
+/**
+ * CacheHierarchy - Chain of SetAssociativeCache levels (L1 -> L2 -> ... -> LLC)
+ *
+ * A demand access looks up the levels top-down until one holds the block
+ * (or it falls through to memory), then the block is filled bottom-up into
+ * the levels above the hit. Every victim is routed according to the
+ * inclusion policy:
+ *  - dirty victims are written back into the next level (memory after the LLC)
+ *  - EXCLUSIVE also moves clean victims down, and moves hits below L1 up
+ *  - INCLUSIVE back-invalidates victims of lower levels from all upper
+ *    levels; a dirty upper copy is merged into the write-back
+ *
+ * The whole hierarchy is simulated in a single pass over the trace.
+ */
+class CacheHierarchy {
+private:
+    std::vector<SetAssociativeCache> levels;
+    std::vector<LevelStats> level_stats;
+    std::vector<std::string> names;
+    InclusionPolicy inclusion;
+    uint64_t memory_reads;
+    uint64_t memory_writes;
+
+    void place(size_t level, uint64_t address, bool dirty, HierarchyResult& result);
+    void send_down(size_t level, uint64_t address, bool dirty, HierarchyResult& result);
+
+public:
+    /**
+     * Build the hierarchy
+     * @param configs Levels from closest to the core (L1) to the LLC
+     * @param policy Inclusion policy applied between adjacent levels
+     * @param addr_bits Address size in bits (default 32)
+     */
+    CacheHierarchy(const std::vector<CacheLevelConfig>& configs, InclusionPolicy policy,
+                   size_t addr_bits = 32);
+
+    /**
+     * Access the hierarchy (read or write from the core)
+     * @param address Memory address to access
+     * @param type Read or write access
+     * @return Level that hit and any memory write-backs caused
+     */
+    HierarchyResult access(uint64_t address, AccessType type);
+
+    /**
+     * Print a per-level report plus memory traffic
+     */
+    void print_report(std::ostream& out) const;
+
+    /**
+     * Reset every level and all counters
+     */
+    void reset();
+
+    size_t get_num_levels() const { return levels.size(); }
+    const SetAssociativeCache& get_level(size_t level) const { return levels[level]; }
+    const LevelStats& get_level_stats(size_t level) const { return level_stats[level]; }
+    const std::string& get_level_name(size_t level) const { return names[level]; }
+    InclusionPolicy get_inclusion() const { return inclusion; }
+    uint64_t get_memory_reads() const { return memory_reads; }
+    uint64_t get_memory_writes() const { return memory_writes; }
+};
+
+#endif // CACHE_HIERARCHY_H
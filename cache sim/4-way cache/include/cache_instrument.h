@@ -0,0 +1,181 @@
+#ifndef CACHE_INSTRUMENT_H
+#define CACHE_INSTRUMENT_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include "set_associative_cache.h"
+
+/**
+ * Opt-in instrumentation for SetAssociativeCache
+ *
+ * The cache only calls into a CacheInstrument when the build defines
+ * CACHESIM_INSTRUMENT (CMake: -DCACHESIM_INSTRUMENT=ON). Without it the
+ * hooks and the instrument pointer are compiled out, so a default build
+ * pays nothing. The class itself always builds and can also be fed by hand.
+ *
+ * Two outputs, both CSV:
+ *  - per-set heatmap: hits, misses, evictions and write-backs of every set
+ *    over the whole run (finds conflict hotspots)
+ *  - interval snapshots: totals for every window of N accesses or N cycles,
+ *    plus the set with the most misses in that window (phase behaviour)
+ *
+ * Closed windows go into a bounded ring that a background thread drains to
+ * disk, so file I/O stays off the simulation thread. When the ring is full
+ * the simulation waits; no snapshot is dropped.
+ */
+
+/**
+ * IntervalUnit - What an instrument interval counts
+ */
+enum class IntervalUnit {
+    ACCESSES,       // Every access advances the window
+    CYCLES          // Windows follow advance(now) from a timing model
+};
+
+/**
+ * InstrumentConfig - Where and how often to report
+ */
+struct InstrumentConfig {
+    uint64_t interval;          // Window length in accesses or cycles
+    IntervalUnit unit;
+    std::string interval_csv;   // Snapshot file ("" = no snapshots)
+    std::string heatmap_csv;    // Per-set file written by finish() ("" = none)
+    size_t ring_slots;          // Snapshots buffered ahead of the writer
+
+    InstrumentConfig()
+        : interval(100000), unit(IntervalUnit::ACCESSES), ring_slots(1024) {}
+};
+
+/**
+ * SetCounters - Lifetime counters of one set
+ */
+struct SetCounters {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t dirty_evictions;
+
+    SetCounters() : hits(0), misses(0), evictions(0), dirty_evictions(0) {}
+};
+
+/**
+ * IntervalSnapshot - Totals for one window
+ */
+struct IntervalSnapshot {
+    uint64_t index;             // Window number
+    uint64_t start;             // First access / cycle of the window
+    uint64_t end;               // One past the last
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t dirty_evictions;
+    uint64_t hottest_set;       // Set with the most misses in the window
+    uint64_t hottest_set_misses;
+
+    IntervalSnapshot()
+        : index(0), start(0), end(0), hits(0), misses(0), evictions(0),
+          dirty_evictions(0), hottest_set(0), hottest_set_misses(0) {}
+};
+
+/**
+ * CacheInstrument - Per-set counters and windowed snapshots for one cache
+ */
+class CacheInstrument {
+public:
+    /**
+     * @param num_sets Sets of the instrumented cache
+     * @param config Interval and output files
+     * @throws std::runtime_error if an output file can't be created
+     */
+    CacheInstrument(size_t num_sets, const InstrumentConfig& config);
+    ~CacheInstrument();
+
+    CacheInstrument(const CacheInstrument&) = delete;
+    CacheInstrument& operator=(const CacheInstrument&) = delete;
+
+    /**
+     * Count one demand access (called by the cache)
+     */
+    void record(size_t set, const AccessResult& r) {
+        SetCounters& c = sets[set];
+        if (r.hit) {
+            c.hits++;
+            window.hits++;
+        } else {
+            c.misses++;
+            window.misses++;
+        }
+        if (r.evicted) {
+            record_eviction(set, r.evicted_dirty);
+        }
+        if (unit == IntervalUnit::ACCESSES && ++position >= window.end) {
+            close_window(position);
+        }
+    }
+
+    /**
+     * Count an eviction caused by a non-demand fill (install())
+     */
+    void record_eviction(size_t set, bool dirty) {
+        sets[set].evictions++;
+        window.evictions++;
+        if (dirty) {
+            sets[set].dirty_evictions++;
+            window.dirty_evictions++;
+        }
+    }
+
+    /**
+     * Move simulated time forward (IntervalUnit::CYCLES)
+     * Closes every window that ends at or before now. Windows with no
+     * traffic are skipped rather than written out.
+     */
+    void advance(uint64_t now);
+
+    /**
+     * Close the current partial window, drain the writer and write the
+     * per-set heatmap. Called by the destructor if not called before.
+     */
+    void finish();
+
+    const SetCounters& get_set(size_t set) const { return sets[set]; }
+    size_t get_num_sets() const { return sets.size(); }
+    uint64_t get_snapshots() const { return snapshots; }
+
+private:
+    IntervalUnit unit;
+    uint64_t interval;
+    std::vector<SetCounters> sets;
+    std::vector<uint64_t> window_base_misses;   // Per-set misses at window start
+    IntervalSnapshot window;                    // Window being filled
+    uint64_t position;                          // Accesses so far (ACCESSES)
+    uint64_t snapshots;
+    bool finished;
+
+    std::string heatmap_path;
+    std::ofstream interval_out;
+
+    // Ring of closed windows: simulation pushes at tail, writer pops at head
+    std::vector<IntervalSnapshot> ring;
+    size_t head;
+    size_t tail;
+    size_t filled;
+    bool stopping;
+    std::mutex mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+    std::thread writer;
+
+    void close_window(uint64_t end);
+    void push(const IntervalSnapshot& snapshot);
+    void drain();
+    void write_heatmap() const;
+};
+
+#endif // CACHE_INSTRUMENT_H
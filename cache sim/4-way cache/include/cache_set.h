@@ -3,7 +3,7 @@
 
 #include <vector>
 #include <cstdint>
-#include "lru_tracker.h"
+#include "checkpoint.h"
 
 /**
  * CacheLine - Represents a single cache line
@@ -11,9 +11,10 @@
 struct CacheLine {
     bool valid;         // Is this line holding valid data?
     bool dirty;         // Has this line been written to? (for write-back)
+    bool shared;        // May other caches hold a copy? (coherence)
     uint64_t tag;       // Tag portion of the address
     
-    CacheLine() : valid(false), dirty(false), tag(0) {}
+    CacheLine() : valid(false), dirty(false), shared(false), tag(0) {}
 };
 
 /**
@@ -21,11 +22,11 @@ struct CacheLine {
  * 
  * A set contains multiple "ways" (cache lines). For a 4-way cache,
  * each set has 4 lines that can hold different blocks mapping to the same set.
+ * Replacement state lives outside the set, in the cache's policy.
  */
 class CacheSet {
 private:
     size_t num_ways;
-    LRUTracker lru;
 
 public:
     std::vector<CacheLine> lines;  // The cache lines (ways) in this set
@@ -35,7 +36,7 @@ public:
      * @param ways Number of ways (lines) in this set
      */
     explicit CacheSet(size_t ways) 
-        : num_ways(ways), lru(ways), lines(ways) {}
+        : num_ways(ways), lines(ways) {}
 
     /**
      * Search all ways for a matching tag
@@ -52,43 +53,55 @@ public:
     }
 
     /**
-     * Find a victim way for eviction
-     * Prefers invalid (empty) lines over LRU eviction
-     * @return Way index to evict/use
+     * Find an invalid (empty) way to fill
+     * @return Way index, or -1 if every way is valid
      */
-    int find_victim() {
-        // First, look for an invalid (empty) line
+    int find_invalid() const {
         for (size_t i = 0; i < num_ways; i++) {
             if (!lines[i].valid) {
                 return static_cast<int>(i);
             }
         }
-        // All lines valid, use LRU
-        return static_cast<int>(lru.get_victim());
+        return -1;
     }
 
     /**
-     * Update LRU state - mark way as most recently used
-     * @param way The way that was just accessed
+     * Empty the set, keeping its storage
      */
-    void update_lru(int way) {
-        if (way >= 0 && static_cast<size_t>(way) < num_ways) {
-            lru.access(static_cast<size_t>(way));
+    void clear() {
+        for (CacheLine& line : lines) {
+            line = CacheLine();
         }
     }
 
     /**
-     * Get number of ways in this set
+     * Write the lines (no section; the cache wraps all sets in one)
+     * Each line is its tag and a valid | dirty << 1 | shared << 2 byte.
      */
-    size_t get_num_ways() const {
-        return num_ways;
+    void save(CheckpointWriter& out) const {
+        out.put(static_cast<uint64_t>(lines.size()));
+        for (const CacheLine& line : lines) {
+            out.put(line.tag);
+            out.put(static_cast<uint8_t>(line.valid | line.dirty << 1 | line.shared << 2));
+        }
+    }
+
+    void restore(CheckpointReader& in) {
+        in.expect(static_cast<uint64_t>(lines.size()), "set ways");
+        for (CacheLine& line : lines) {
+            line.tag = in.get<uint64_t>();
+            uint8_t flags = in.get<uint8_t>();
+            line.valid = flags & 1;
+            line.dirty = flags & 2;
+            line.shared = flags & 4;
+        }
     }
 
     /**
-     * Get LRU order for debugging
+     * Get number of ways in this set
      */
-    std::vector<size_t> get_lru_order() const {
-        return lru.get_order();
+    size_t get_num_ways() const {
+        return num_ways;
     }
 };
 
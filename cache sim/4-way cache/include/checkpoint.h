@@ -0,0 +1,195 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+/**
+ * Warm-state checkpoints (.ckpt)
+ *
+ * A 16-byte header, then nested sections. Each section is an 8-character
+ * tag and a payload size, followed by the payload. Values are raw,
+ * native-endian bytes; arrays are a 64-bit element count followed by the
+ * elements. Only types without padding go out as raw bytes; structs with
+ * padding or bit-fields are written field by field by their owners:
+ *
+ * ┌──────────────┬────────────────────────────────────────────┐
+ * │ magic/version│ "SETASSOC" size │ geometry, stats, ...     │
+ * │  (16 bytes)  │                 │ "TAGSTORE" size │ arrays │
+ * └──────────────┴────────────────────────────────────────────┘
+ *
+ * Every model writes its own section (save()) and checks it on the way
+ * back in (restore()). A model restored with a different geometry throws.
+ * The reader mmaps the snapshot and copies each array out in one go, so
+ * many experiments can fork from one warmed file. No warmup is re-run,
+ * and the page cache shares the file between them.
+ */
+
+/** A value whose bytes are all value bits: no padding, so snapshots are deterministic */
+template <typename T>
+constexpr bool is_checkpoint_plain =
+    std::is_trivially_copyable<T>::value && std::has_unique_object_representations<T>::value;
+
+constexpr char CHECKPOINT_MAGIC[8] = {'C', 'A', 'C', 'H', 'E', 'C', 'K', 'P'};
+constexpr uint32_t CHECKPOINT_VERSION = 1;
+
+/**
+ * CheckpointWriter - Writes a snapshot file section by section
+ */
+class CheckpointWriter {
+public:
+    /**
+     * @throws std::runtime_error if the file can't be created
+     */
+    explicit CheckpointWriter(const std::string& path);
+    ~CheckpointWriter();
+
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+    /** Open a section (up to 8 characters of tag); sections nest */
+    void begin_section(const char* tag);
+
+    /** Close the innermost section, filling in its size */
+    void end_section();
+
+    void put_bytes(const void* data, size_t n);
+
+    template <typename T>
+    void put(const T& value) {
+        static_assert(is_checkpoint_plain<T>, "put() needs a plain value without padding");
+        put_bytes(&value, sizeof(T));
+    }
+
+    /** Element count, then the elements */
+    template <typename T>
+    void put_array(const T* data, size_t n) {
+        static_assert(is_checkpoint_plain<T>, "put_array() needs plain values without padding");
+        put(static_cast<uint64_t>(n));
+        put_bytes(data, n * sizeof(T));
+    }
+
+    template <typename T>
+    void put_vector(const std::vector<T>& v) { put_array(v.data(), v.size()); }
+
+    /**
+     * Flush and close the file
+     * @throws std::runtime_error on a write error or an open section
+     */
+    void close();
+
+private:
+    std::FILE* file;
+    std::string path;
+    std::vector<long> open_sections;    // File offsets of their size fields
+    bool failed;
+};
+
+/**
+ * CheckpointReader - Maps a snapshot and hands it to restore() calls
+ *
+ * Reads are bounds-checked: a truncated or mismatched snapshot throws
+ * std::runtime_error instead of reading past a section.
+ */
+class CheckpointReader {
+public:
+    /**
+     * @throws std::runtime_error if the file is missing or not a checkpoint
+     */
+    explicit CheckpointReader(const std::string& path);
+    ~CheckpointReader();
+
+    CheckpointReader(const CheckpointReader&) = delete;
+    CheckpointReader& operator=(const CheckpointReader&) = delete;
+
+    /** Tag of the next section ("" at the end of the enclosing one) */
+    std::string peek_section() const;
+
+    /**
+     * Enter the next section
+     * @throws std::runtime_error if its tag isn't the expected one
+     */
+    void enter_section(const char* tag);
+
+    /**
+     * Leave the innermost section
+     * @throws std::runtime_error if it wasn't read to the end
+     */
+    void leave_section();
+
+    /** Step over the next section without reading it */
+    void skip_section();
+
+    /** Leave the innermost section, dropping whatever is left of it */
+    void skip_rest();
+
+    /** Back to the first section, e.g. to restore another copy */
+    void rewind();
+
+    void get_bytes(void* data, size_t n);
+
+    template <typename T>
+    T get() {
+        static_assert(is_checkpoint_plain<T>, "get() needs a plain value without padding");
+        T value;
+        get_bytes(&value, sizeof(T));
+        return value;
+    }
+
+    /**
+     * Read a value and check it against the restoring model's own
+     * @throws std::invalid_argument naming the field on a mismatch
+     */
+    template <typename T>
+    void expect(const T& value, const char* what) {
+        if (get<T>() != value) {
+            throw std::invalid_argument(std::string("checkpoint: ") + what +
+                                        " doesn't match this model");
+        }
+    }
+
+    /**
+     * Read n elements written by put_array()
+     * @throws std::runtime_error if the stored count isn't n
+     */
+    template <typename T>
+    void get_array(T* data, size_t n) {
+        static_assert(is_checkpoint_plain<T>, "get_array() needs plain values without padding");
+        if (get<uint64_t>() != n) {
+            throw std::runtime_error("checkpoint: array size mismatch");
+        }
+        get_bytes(data, n * sizeof(T));
+    }
+
+    /** Read into an existing vector; its size must match the stored one */
+    template <typename T>
+    void get_vector(std::vector<T>& v) { get_array(v.data(), v.size()); }
+
+    /** Read a vector of whatever size was stored */
+    template <typename T>
+    void get_resized(std::vector<T>& v) {
+        static_assert(is_checkpoint_plain<T>, "get_resized() needs plain values without padding");
+        uint64_t n = get<uint64_t>();
+        if (n > (limit() - cursor) / (sizeof(T) ? sizeof(T) : 1)) {
+            throw std::runtime_error("checkpoint: truncated array");
+        }
+        v.resize(n);
+        get_bytes(v.data(), n * sizeof(T));
+    }
+
+private:
+    const char* base;
+    size_t size;
+    size_t cursor;
+    std::vector<size_t> section_ends;
+
+    size_t limit() const { return section_ends.empty() ? size : section_ends.back(); }
+};
+
+#endif // CHECKPOINT_H
@@ -0,0 +1,160 @@
+#ifndef COHERENT_SYSTEM_H
+#define COHERENT_SYSTEM_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <iostream>
+#include "set_associative_cache.h"
+#include "cache_hierarchy.h"
+#include "address_trace.h"
+
+/**
+ * CoherenceProtocol - Snooping protocol between the private L1s
+ *
+ * MESI:  a read snoop of a MODIFIED line writes it back to the LLC and both
+ *        copies become SHARED
+ * MOESI: the MODIFIED line becomes OWNED instead, keeps the dirty data and
+ *        supplies later readers, so nothing is written back until it leaves
+ */
+enum class CoherenceProtocol {
+    MESI,
+    MOESI
+};
+
+const char* protocol_name(CoherenceProtocol protocol);
+
+/**
+ * Parse "mesi" or "moesi"
+ * @return false if the name is unknown
+ */
+bool parse_protocol(const std::string& name, CoherenceProtocol& protocol);
+
+/**
+ * CoreStats - Coherence counters of one core
+ * Hits and misses are in the core's L1 (get_l1(core).get_stats()).
+ */
+struct CoreStats {
+    uint64_t coherence_misses;  // Misses to blocks another core invalidated
+    uint64_t upgrades;          // Write hits on SHARED / OWNED lines (BusUpgr)
+    uint64_t invalidations;     // Lines of this core invalidated by other cores
+    uint64_t writebacks;        // Dirty victims written back to the LLC
+
+    CoreStats() : coherence_misses(0), upgrades(0), invalidations(0), writebacks(0) {}
+};
+
+/**
+ * BusStats - Snooping bus and memory traffic
+ */
+struct BusStats {
+    uint64_t bus_reads;             // BusRd: read misses
+    uint64_t bus_read_exclusive;    // BusRdX: write misses
+    uint64_t bus_upgrades;          // BusUpgr: write hits on shared lines
+    uint64_t invalidations;         // Remote lines invalidated by BusRdX / BusUpgr
+    uint64_t cache_to_cache;        // Misses supplied by another L1
+    uint64_t flushes;               // MODIFIED lines written to the LLC by a read snoop
+    uint64_t memory_reads;          // LLC misses
+    uint64_t memory_writes;         // Dirty LLC victims
+
+    BusStats()
+        : bus_reads(0), bus_read_exclusive(0), bus_upgrades(0), invalidations(0),
+          cache_to_cache(0), flushes(0), memory_reads(0), memory_writes(0) {}
+};
+
+/**
+ * CoherentSystem - N private L1s kept coherent over a snooping bus,
+ * backed by one shared LLC
+ *
+ * Each L1 is a SetAssociativeCache whose lines carry their MESI/MOESI state
+ * in the tag store's valid/dirty/shared bits (see CoherenceState), so the
+ * protocol adds no side tables to the hot path. For an access from core c:
+ *  - read hit, or write hit on MODIFIED / EXCLUSIVE: local only
+ *    (EXCLUSIVE -> MODIFIED silently)
+ *  - write hit on SHARED / OWNED: BusUpgr invalidates every other copy
+ *  - read miss: BusRd. A peer holding the block MODIFIED, OWNED or EXCLUSIVE
+ *    supplies it (cache-to-cache transfer) and drops to SHARED (OWNED under
+ *    MOESI); otherwise the block comes from the LLC. The new line is SHARED
+ *    if any peer kept a copy, EXCLUSIVE if not.
+ *  - write miss: BusRdX invalidates every other copy, taking the data from
+ *    an owning peer if there is one; the new line is MODIFIED
+ * Dirty L1 victims (MODIFIED / OWNED) are written back into the LLC. The LLC
+ * is non-inclusive: it is filled by L1 misses and write-backs and never
+ * back-invalidates the L1s.
+ *
+ * A miss is a coherence miss when the core's copy was last removed by
+ * another core's invalidation rather than by its own replacement. The
+ * invalidated block is remembered in the L1 line it left, until the core
+ * refills that line, so the bookkeeping is one word per L1 line.
+ */
+class CoherentSystem {
+private:
+    CoherenceProtocol protocol;
+    std::vector<SetAssociativeCache> l1;
+    SetAssociativeCache llc;
+    std::vector<CoreStats> core_stats;
+    std::vector<std::vector<uint64_t>> lost;    // Per core, per L1 line: block a remote write took
+    static constexpr uint64_t NO_BLOCK = ~0ULL; // Block addresses are aligned, never all ones
+    BusStats bus;
+    uint64_t block_mask;
+
+    bool snoop_read(uint32_t core, uint64_t block, bool& shared);
+    bool invalidate_peers(uint32_t core, uint64_t block);
+    void read_llc(uint64_t block);
+    void write_back(uint64_t block);
+    size_t first_line(uint64_t block) const;
+
+public:
+    /**
+     * Build the system
+     * @param num_cores Number of cores, one private L1 each
+     * @param l1_config Geometry and policy of every L1
+     * @param llc_config Geometry and policy of the shared LLC (same block size)
+     * @param protocol_kind MESI (default) or MOESI
+     * @param addr_bits Address size in bits (default 32)
+     */
+    CoherentSystem(size_t num_cores, const CacheLevelConfig& l1_config,
+                   const CacheLevelConfig& llc_config,
+                   CoherenceProtocol protocol_kind = CoherenceProtocol::MESI,
+                   size_t addr_bits = 32);
+
+    /**
+     * Access from one core
+     * @param core Core id (< get_num_cores())
+     * @param address Memory address
+     * @param type Read or write
+     * @return true on an L1 hit (including upgrades)
+     */
+    bool access(uint32_t core, uint64_t address, AccessType type);
+
+    /**
+     * Replay a merged multi-core trace
+     */
+    void run(const std::vector<CoreAccess>& trace);
+
+    /**
+     * State of a block in one core's L1
+     */
+    CoherenceState state(uint32_t core, uint64_t address) const {
+        return l1[core].coherence_state(address);
+    }
+
+    /**
+     * Print per-core, LLC, bus and memory statistics
+     */
+    void print_report(std::ostream& out) const;
+
+    /**
+     * Empty every cache and clear all counters
+     */
+    void reset();
+
+    size_t get_num_cores() const { return l1.size(); }
+    CoherenceProtocol get_protocol() const { return protocol; }
+    const SetAssociativeCache& get_l1(uint32_t core) const { return l1[core]; }
+    const SetAssociativeCache& get_llc() const { return llc; }
+    const CoreStats& get_core_stats(uint32_t core) const { return core_stats[core]; }
+    const BusStats& get_bus_stats() const { return bus; }
+};
+
+#endif // COHERENT_SYSTEM_H
@@ -0,0 +1,268 @@
+#ifndef FIXED_CACHE_H
+#define FIXED_CACHE_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+#include <type_traits>
+#include "set_associative_cache.h"
+#include "replacement_policy.h"
+
+/**
+ * FixedCache - Set-associative cache with geometry fixed at compile time
+ *
+ * Same behaviour as SetAssociativeCache, but associativity, block size and
+ * replacement policy are template parameters. The offset shift, way mask
+ * and every per-way loop are constants, so the compiler fully unrolls the
+ * tag match and replacement update. Only the number of sets (and therefore
+ * the index mask / tag shift) is a runtime value.
+ *
+ *   FixedCache<8, 64> l1(32 * 1024);   // 32KB, 8-way, 64B blocks, LRU
+ *
+ * Use dispatch_fixed_cache() to pick the instantiation from runtime values.
+ */
+template <size_t Ways, size_t BlockBytes, template <size_t> class Policy = LRUPolicy>
+class FixedCache {
+    static_assert(Ways >= 1 && Ways <= 64, "FixedCache supports 1..64 ways");
+    static_assert((Ways & (Ways - 1)) == 0, "Associativity must be power of 2");
+    static_assert(BlockBytes > 0 && (BlockBytes & (BlockBytes - 1)) == 0,
+                  "Block size must be power of 2");
+
+    static constexpr size_t ctlog2(size_t n) { return n <= 1 ? 0 : 1 + ctlog2(n >> 1); }
+
+public:
+    static constexpr size_t WAYS = Ways;
+    static constexpr size_t BLOCK_SIZE = BlockBytes;
+    static constexpr size_t OFFSET_BITS = ctlog2(BlockBytes);
+    static constexpr uint64_t WAY_MASK = Ways == 64 ? ~0ULL : ((1ULL << Ways) - 1);
+
+    /**
+     * Construct a cache of the given total size
+     * @param size Total cache size in bytes
+     */
+    explicit FixedCache(size_t size)
+        : cache_size(size),
+          num_sets(size / BlockBytes / Ways),
+          index_mask(num_sets - 1),
+          tag_shift(OFFSET_BITS + ctlog2(num_sets)),
+          sets(num_sets),
+          policy(num_sets, Ways) {
+        assert(num_sets > 0 && "Must have at least one set");
+        assert((num_sets & (num_sets - 1)) == 0 && "Number of sets must be power of 2");
+        reset();
+    }
+
+    /**
+     * Access the cache (read or write)
+     * @param address Memory address to access
+     * @param type Read or write access
+     * @return AccessResult with hit/miss info and eviction details
+     */
+    AccessResult access(uint64_t address, AccessType type) {
+        AccessResult result;
+
+        if (type == AccessType::READ) {
+            stats.reads++;
+        } else {
+            stats.writes++;
+        }
+
+        const uint64_t set_index = get_set_index(address);
+        const uint64_t tag = get_tag(address);
+        result.set_index = set_index;
+        Set& set = sets[set_index];
+
+        // Compare every way; with Ways constant this is branch-free and unrolled
+        uint64_t match = 0;
+        for (size_t i = 0; i < Ways; i++) {
+            match |= static_cast<uint64_t>(set.tags[i] == tag) << i;
+        }
+        match &= set.valid;
+
+        if (match) {
+            const size_t way = __builtin_ctzll(match);
+            result.hit = true;
+            result.way = static_cast<int>(way);
+            stats.hits++;
+            policy.on_hit(set_index, way);
+            if (type == AccessType::WRITE) {
+                set.dirty |= 1ULL << way;
+            }
+            return result;
+        }
+
+        stats.misses++;
+        policy.on_miss(set_index, address >> OFFSET_BITS);
+        const uint64_t empty = ~set.valid & WAY_MASK;
+        const size_t way = empty ? __builtin_ctzll(empty) : policy.victim(set_index);
+        const uint64_t bit = 1ULL << way;
+        result.way = static_cast<int>(way);
+
+        if (set.valid & bit) {
+            result.evicted = true;
+            result.evicted_tag = set.tags[way];
+            stats.evictions++;
+            if (set.dirty & bit) {
+                result.evicted_dirty = true;
+                stats.dirty_evictions++;
+            }
+        }
+
+        set.tags[way] = tag;
+        set.valid |= bit;
+        set.dirty = (type == AccessType::WRITE) ? (set.dirty | bit) : (set.dirty & ~bit);
+        policy.on_fill(set_index, way);
+        return result;
+    }
+
+    uint64_t get_set_index(uint64_t address) const { return (address >> OFFSET_BITS) & index_mask; }
+    uint64_t get_tag(uint64_t address) const { return address >> tag_shift; }
+
+    CacheStats get_stats() const { return stats; }
+
+    /**
+     * Reset cache to initial state (keeps allocations)
+     */
+    void reset() {
+        for (Set& set : sets) {
+            set = Set();
+        }
+        policy.reset();
+        stats = CacheStats();
+    }
+
+    /**
+     * Write the full warm state: stats, every set and the replacement state
+     */
+    void save(CheckpointWriter& out) const {
+        out.begin_section("FIXED");
+        out.put(static_cast<uint64_t>(cache_size));
+        out.put(static_cast<uint64_t>(BlockBytes));
+        out.put(static_cast<uint64_t>(Ways));
+        out.put(stats);
+        out.put_vector(sets);
+        out.begin_section("POLICY");
+        policy.save(out);
+        out.end_section();
+        out.end_section();
+    }
+
+    /**
+     * Replace this cache's state with one save() wrote for the same geometry
+     * The snapshot is decoded into a copy, so a failed restore leaves this
+     * cache as it was.
+     * @throws std::invalid_argument on a geometry mismatch
+     * @throws std::runtime_error on a truncated or corrupt snapshot
+     */
+    void restore(CheckpointReader& in) {
+        FixedCache staged(*this);
+        in.enter_section("FIXED");
+        in.expect(static_cast<uint64_t>(cache_size), "cache size");
+        in.expect(static_cast<uint64_t>(BlockBytes), "block size");
+        in.expect(static_cast<uint64_t>(Ways), "associativity");
+        staged.stats = in.get<CacheStats>();
+        in.get_vector(staged.sets);
+        in.enter_section("POLICY");
+        staged.policy.restore(in);
+        in.leave_section();
+        in.leave_section();
+        *this = std::move(staged);
+    }
+
+    size_t get_cache_size() const { return cache_size; }
+    size_t get_block_size() const { return BlockBytes; }
+    size_t get_associativity() const { return Ways; }
+    size_t get_num_sets() const { return num_sets; }
+
+private:
+    struct Set {
+        uint64_t tags[Ways] = {};
+        uint64_t valid = 0;
+        uint64_t dirty = 0;
+    };
+
+    size_t cache_size;
+    size_t num_sets;
+    uint64_t index_mask;
+    size_t tag_shift;
+    std::vector<Set> sets;
+    Policy<Ways> policy;
+    CacheStats stats;
+};
+
+// ============================================================================
+// Runtime Dispatch
+// ============================================================================
+
+namespace fixed_cache_detail {
+
+template <size_t Ways, template <size_t> class Policy, typename Fn>
+bool dispatch_block(size_t block, Fn& fn) {
+    switch (block) {
+        case 32:  fn(static_cast<FixedCache<Ways, 32, Policy>*>(nullptr));  return true;
+        case 64:  fn(static_cast<FixedCache<Ways, 64, Policy>*>(nullptr));  return true;
+        case 128: fn(static_cast<FixedCache<Ways, 128, Policy>*>(nullptr)); return true;
+        default:  return false;
+    }
+}
+
+} // namespace fixed_cache_detail
+
+/**
+ * Pick the FixedCache instantiation matching a runtime geometry
+ *
+ * Instantiations exist for 1/2/4/8/16 ways x 32/64/128-byte blocks. fn gets
+ * a null pointer of the cache type, for callers that keep the cache beyond
+ * one call (memsim's SweepEngine holds one per configuration):
+ *
+ *   dispatch_fixed_type(size, block, ways, [&](auto* type) {
+ *       using Cache = std::remove_pointer_t<decltype(type)>;
+ *       caches.emplace_back(new Holder<Cache>(size));
+ *   });
+ *
+ * @return false if the geometry has no instantiation (use SetAssociativeCache)
+ */
+template <template <size_t> class Policy = LRUPolicy, typename Fn>
+bool dispatch_fixed_type(size_t size, size_t block, size_t assoc, Fn&& fn) {
+    using namespace fixed_cache_detail;
+    if (block == 0 || assoc == 0 || size % (block * assoc) != 0) {
+        return false;
+    }
+    size_t num_sets = size / (block * assoc);
+    if (num_sets == 0 || (num_sets & (num_sets - 1)) != 0) {
+        return false;
+    }
+    switch (assoc) {
+        case 1:  return dispatch_block<1, Policy>(block, fn);
+        case 2:  return dispatch_block<2, Policy>(block, fn);
+        case 4:  return dispatch_block<4, Policy>(block, fn);
+        case 8:  return dispatch_block<8, Policy>(block, fn);
+        case 16: return dispatch_block<16, Policy>(block, fn);
+        default: return false;
+    }
+}
+
+/**
+ * Build the FixedCache instantiation matching a runtime geometry and run fn on it
+ *
+ * Same instantiations as dispatch_fixed_type(). fn is a generic callable
+ * taking the cache by reference, so the whole simulation loop inside it is
+ * compiled once per geometry:
+ *
+ *   dispatch_fixed_cache(size, block, ways, [&](auto& cache) {
+ *       for (auto& r : trace) cache.access(r.addr, r.type);
+ *       stats = cache.get_stats();
+ *   });
+ *
+ * @return false if the geometry has no instantiation (use SetAssociativeCache)
+ */
+template <template <size_t> class Policy = LRUPolicy, typename Fn>
+bool dispatch_fixed_cache(size_t size, size_t block, size_t assoc, Fn&& fn) {
+    return dispatch_fixed_type<Policy>(size, block, assoc, [&](auto* type) {
+        std::remove_pointer_t<decltype(type)> cache(size);
+        fn(cache);
+    });
+}
+
+#endif // FIXED_CACHE_H
@@ -0,0 +1,276 @@
+#ifndef LOCKSTEP_H
+#define LOCKSTEP_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <fstream>
+#include <iostream>
+#include <cstdint>
+#include <cstddef>
+#include "set_associative_cache.h"
+#include "reference_cache.h"
+
+// ============================================================================
+// Trace sources
+// ============================================================================
+
+/**
+ * TraceSource - A trace read a chunk at a time, so runs needn't fit in memory
+ */
+class TraceSource {
+public:
+    virtual ~TraceSource() = default;
+
+    /**
+     * Fill up to max entries
+     * @return Entries written; 0 once the trace is exhausted
+     */
+    virtual size_t next(TraceEntry* out, size_t max) = 0;
+};
+
+/**
+ * SyntheticPattern - Address patterns SyntheticTrace can generate
+ *
+ * RANDOM:   uniform over the footprint
+ * STREAM:   sequential blocks, wrapping at the footprint
+ * HOT:      80% of accesses to a hot 1/16 of the footprint
+ * CONFLICT: 2 x assoc blocks that all map to one set (stride = size / assoc)
+ * MIXED:    each access picks one of the above, so hits, capacity misses
+ *           and conflict evictions interleave in every set
+ */
+enum class SyntheticPattern {
+    RANDOM,
+    STREAM,
+    HOT,
+    CONFLICT,
+    MIXED
+};
+
+const char* synthetic_pattern_name(SyntheticPattern pattern);
+
+/**
+ * Parse a pattern name ("random", "stream", "hot", "conflict", "mixed")
+ * @return false for anything else
+ */
+bool parse_synthetic_pattern(const std::string& name, SyntheticPattern& pattern);
+
+/**
+ * SyntheticTraceConfig - What SyntheticTrace generates
+ */
+struct SyntheticTraceConfig {
+    SyntheticPattern pattern;
+    uint64_t accesses;
+    uint64_t footprint;         // Bytes the addresses span
+    uint64_t stride;            // CONFLICT stride in bytes (cache size / assoc)
+    uint64_t assoc;             // CONFLICT: cycles through 2 x assoc blocks
+    double write_fraction;
+    uint64_t seed;
+
+    SyntheticTraceConfig()
+        : pattern(SyntheticPattern::MIXED), accesses(1000000), footprint(1 << 24),
+          stride(4096), assoc(8), write_fraction(0.3), seed(1) {}
+};
+
+/**
+ * SyntheticTrace - Generated accesses (xorshift, same seed = same trace)
+ */
+class SyntheticTrace : public TraceSource {
+public:
+    explicit SyntheticTrace(const SyntheticTraceConfig& config);
+
+    size_t next(TraceEntry* out, size_t max) override;
+
+private:
+    SyntheticTraceConfig config;
+    uint64_t state;
+    uint64_t produced;
+    uint64_t stream_next;
+    uint64_t conflict_next;
+    uint64_t write_threshold;   // write_fraction scaled to 2^32
+
+    uint64_t random_u64();
+    uint64_t address_for(SyntheticPattern pattern);
+};
+
+/**
+ * TraceFile - A trace file streamed from disk
+ *
+ * Three formats, picked from the contents / name:
+ *   .mtr   memory system simulator binary trace ("MEMTRACE" header,
+ *          16-byte records; memory system simulator/c++/trace_format.h)
+ *   .bin   raw little-endian uint64 addresses (numpy tofile()), all reads
+ *   other  text, "R 0x1234" / "W 0x1234" per line like read_address_trace(),
+ *          or a bare address (a read) like python/validation traces
+ */
+class TraceFile : public TraceSource {
+public:
+    enum class Format { MTR, RAW, TEXT };
+
+    /**
+     * @throws std::runtime_error if the file can't be opened or is malformed
+     */
+    explicit TraceFile(const std::string& path);
+
+    size_t next(TraceEntry* out, size_t max) override;
+
+    Format get_format() const { return format; }
+
+private:
+    std::ifstream in;
+    Format format;
+    uint64_t remaining;         // MTR: records left per the header
+    size_t record_bytes;        // MTR: record size per the header
+    std::vector<char> buffer;   // Raw bytes of one next() call
+};
+
+// ============================================================================
+// Engines under test
+// ============================================================================
+
+/**
+ * LockstepEngine - One cache implementation fed the same chunks as the reference
+ *
+ * Subclass to put a new fast path under the validator; run() must return
+ * exactly what SetAssociativeCache::access() would for each entry.
+ */
+class LockstepEngine {
+public:
+    virtual ~LockstepEngine() = default;
+
+    virtual const std::string& name() const = 0;
+
+    /**
+     * Simulate n accesses, continuing from the current state
+     * @param results n results, in order
+     */
+    virtual void run(const TraceEntry* entries, size_t n, AccessResult* results) = 0;
+
+    virtual CacheStats get_stats() const = 0;
+};
+
+/**
+ * Engines make_lockstep_engine() knows, LRU throughout:
+ *   per-set  SetAssociativeCache, PER_SET storage, access()
+ *   flat     SetAssociativeCache, FLAT storage (SIMD tag match), access()
+ *   sparse   SetAssociativeCache, SPARSE storage, access()
+ *   batch    SetAssociativeCache, FLAT storage, access_batch()
+ *   fixed    FixedCache instantiation for the geometry
+ *   sharded  ShardedSimulator with 4 shards, per-access results
+ */
+const std::vector<std::string>& lockstep_engine_names();
+
+/**
+ * Build a named engine for a geometry
+ * @return nullptr for an unknown name or a geometry the engine can't build
+ *         (fixed: 1..16 ways x 32/64/128-byte blocks, flat/sparse/batch:
+ *         at most 64 ways)
+ */
+std::unique_ptr<LockstepEngine> make_lockstep_engine(const std::string& name, size_t size,
+                                                     size_t block, size_t assoc);
+
+// ============================================================================
+// Validator
+// ============================================================================
+
+/**
+ * SetAccess - One earlier access to the diverging set, with its reference result
+ */
+struct SetAccess {
+    uint64_t index;
+    TraceEntry entry;
+    AccessResult result;
+};
+
+/**
+ * Divergence - The first access an engine got wrong, with context
+ */
+struct Divergence {
+    std::string engine;
+    uint64_t index;                     // Access number, from 0
+    TraceEntry entry;
+    const char* field;                  // First AccessResult field that differs
+    AccessResult expected;              // Reference result
+    AccessResult actual;
+    std::vector<SetAccess> history;     // Earlier accesses to the set, oldest first
+    std::vector<CacheLine> lines;       // Reference set contents after the access
+    std::vector<size_t> lru_order;      // Reference LRU order after it (LRU first)
+
+    Divergence() : index(0), entry{0, AccessType::READ}, field("") {}
+};
+
+/**
+ * LockstepReport - Outcome of a validation run
+ */
+struct LockstepReport {
+    uint64_t accesses;                  // Accesses compared
+    double seconds;
+    bool diverged;
+    Divergence divergence;              // Meaningful if diverged
+    CacheStats reference;               // Reference stats over the compared accesses
+    std::vector<std::string> engines;
+    std::vector<CacheStats> engine_stats;
+
+    LockstepReport() : accesses(0), seconds(0.0), diverged(false) {}
+
+    double accesses_per_second() const { return seconds > 0 ? accesses / seconds : 0.0; }
+
+    /** No divergence and every engine's stats equal the reference's */
+    bool passed() const;
+};
+
+/**
+ * LockstepValidator - Differential run of engines against ReferenceCache
+ *
+ * The trace is pulled from a TraceSource in chunks. While the reference
+ * replays chunk i on the calling thread and compares every engine's result
+ * for each access, the engines already simulate chunk i + 1, one thread
+ * each. Everything AccessResult reports is compared: hit, way, set index,
+ * eviction, victim tag and victim dirtiness. The run stops at the first
+ * access any engine gets wrong (the lowest index across engines) and
+ * records the earlier accesses to that set from the last two chunks and the
+ * reference's view of the set.
+ */
+class LockstepValidator {
+public:
+    static constexpr size_t DEFAULT_CHUNK = 1 << 16;
+    static constexpr size_t DEFAULT_HISTORY = 16;
+
+    /**
+     * @param size Total cache size in bytes
+     * @param block Block size in bytes
+     * @param assoc Associativity
+     * @param chunk Accesses per chunk
+     * @param history Earlier same-set accesses kept in a Divergence
+     */
+    LockstepValidator(size_t size, size_t block, size_t assoc, size_t chunk = DEFAULT_CHUNK,
+                      size_t history = DEFAULT_HISTORY);
+
+    void add_engine(std::unique_ptr<LockstepEngine> engine);
+    size_t get_num_engines() const { return engines.size(); }
+
+    /**
+     * Validate the engines over the source, continuing from the current state
+     * @param limit Stop after this many accesses (0 = the whole source)
+     * @param progress Print throughput every this many accesses (0 = never)
+     */
+    LockstepReport run(TraceSource& source, uint64_t limit = 0, uint64_t progress = 0,
+                       std::ostream& out = std::cout);
+
+private:
+    ReferenceCache reference;
+    std::vector<std::unique_ptr<LockstepEngine>> engines;
+    size_t chunk;
+    size_t history;
+    uint64_t compared;
+
+    void record_divergence(Divergence& d, const std::vector<TraceEntry>* chunks[2],
+                           const std::vector<AccessResult>* results[2], size_t offset);
+};
+
+/**
+ * Print a report: throughput and PASS, or the divergence with its context
+ */
+void print_lockstep_report(const LockstepReport& report, std::ostream& out = std::cout);
+
+#endif // LOCKSTEP_H
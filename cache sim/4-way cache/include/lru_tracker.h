@@ -4,6 +4,7 @@
 #include <vector>
 #include <cstdint>
 #include <algorithm>
+#include "checkpoint.h"
 
 /**
  * LRUTracker - Tracks Least Recently Used ordering for cache ways
@@ -87,6 +88,16 @@ public:
             last_access[i] = i;
         }
     }
+
+    void save(CheckpointWriter& out) const {
+        out.put(access_counter);
+        out.put_vector(last_access);
+    }
+
+    void restore(CheckpointReader& in) {
+        access_counter = in.get<uint64_t>();
+        in.get_vector(last_access);
+    }
 };
 
 #endif // LRU_TRACKER_H
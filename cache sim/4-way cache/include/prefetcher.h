@@ -0,0 +1,237 @@
+#ifndef PREFETCHER_H
+#define PREFETCHER_H
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+class CheckpointWriter;     // checkpoint.h
+class CheckpointReader;
+
+/**
+ * Hardware prefetcher models
+ *
+ * A Prefetcher watches the demand stream seen by one cache and proposes
+ * blocks to fetch ahead of use. It only predicts addresses: filling the
+ * cache, dropping blocks that are already resident and accounting for
+ * useful / late / polluting prefetches is done by PrefetchingCache
+ * (include/prefetching_cache.h), so every model is charged the same way.
+ *
+ * Prefetchers are called once per demand access through a virtual
+ * interface, like the EvictionPolicy classes in cpp/src.
+ */
+
+/**
+ * PrefetchEvent - One demand access as seen by a prefetcher
+ */
+struct PrefetchEvent {
+    uint64_t address;       // Demand byte address
+    bool hit;               // Did the demand access hit?
+    bool prefetch_hit;      // First demand use of a prefetched block
+};
+
+/**
+ * PrefetchStats - What became of the prefetches a cache issued
+ *
+ * Kept by PrefetchingCache. Every issued prefetch ends up in at most one
+ * of useful / late / polluting; prefetches still resident and unused are in
+ * none of them yet.
+ */
+struct PrefetchStats {
+    uint64_t issued;        // Prefetch fills installed
+    uint64_t redundant;     // Candidates dropped because already resident
+    uint64_t useful;        // Demand hit after the fill had arrived
+    uint64_t late;          // Demand hit while the fill was still in flight
+    uint64_t polluting;     // Evicted before any demand use
+
+    PrefetchStats() : issued(0), redundant(0), useful(0), late(0), polluting(0) {}
+
+    /** Fraction of issued prefetches that a demand access used */
+    double accuracy() const {
+        return issued > 0 ? static_cast<double>(useful + late) / issued : 0.0;
+    }
+};
+
+/**
+ * Prefetcher - Interface for address-predicting prefetchers
+ */
+class Prefetcher {
+public:
+    virtual ~Prefetcher() = default;
+
+    /**
+     * Observe a demand access and append block addresses to prefetch
+     * @param event The demand access
+     * @param candidates Output: block-aligned addresses to fetch
+     */
+    virtual void observe(const PrefetchEvent& event, std::vector<uint64_t>& candidates) = 0;
+
+    /** Forget all training state */
+    virtual void reset() = 0;
+
+    /** A copy with the same training state */
+    virtual std::unique_ptr<Prefetcher> clone() const = 0;
+
+    /** Write / read back the training state (stateless models have none) */
+    virtual void save(CheckpointWriter&) const {}
+    virtual void restore(CheckpointReader&) {}
+
+    virtual const char* name() const = 0;
+};
+
+// ============================================================================
+// Next-line
+// ============================================================================
+
+/**
+ * NextLinePrefetcher - Tagged next-N-line prefetching
+ *
+ * A demand miss, or the first use of a prefetched block, fetches the next
+ * `degree` blocks. Triggering on prefetch hits keeps a sequential stream
+ * ahead of the core instead of missing on every other block.
+ */
+class NextLinePrefetcher : public Prefetcher {
+public:
+    /**
+     * @param block_size Block size in bytes (power of 2)
+     * @param degree Blocks fetched per trigger (default 1)
+     */
+    explicit NextLinePrefetcher(size_t block_size, size_t degree = 1);
+
+    void observe(const PrefetchEvent& event, std::vector<uint64_t>& candidates) override;
+    void reset() override {}
+    std::unique_ptr<Prefetcher> clone() const override {
+        return std::make_unique<NextLinePrefetcher>(*this);
+    }
+    const char* name() const override { return "next-line"; }
+
+private:
+    size_t block_shift;
+    size_t degree;
+};
+
+// ============================================================================
+// Stride (reference prediction table without PCs)
+// ============================================================================
+
+/**
+ * StridePrefetcher - PC-less stride detection per memory region
+ *
+ * Without program counters, accesses are grouped by 4 KB region instead.
+ * Each table entry remembers its region's last block and stride plus a
+ * 2-bit confidence counter. Once the same non-zero stride is seen twice in
+ * a row, the next `degree` blocks along the stride are fetched.
+ */
+class StridePrefetcher : public Prefetcher {
+public:
+    static constexpr size_t REGION_BITS = 12;
+
+    /**
+     * @param block_size Block size in bytes (power of 2)
+     * @param degree Strides fetched ahead per trigger (default 2)
+     * @param table_size Number of regions tracked (power of 2, default 64)
+     */
+    StridePrefetcher(size_t block_size, size_t degree = 2, size_t table_size = 64);
+
+    void observe(const PrefetchEvent& event, std::vector<uint64_t>& candidates) override;
+    void reset() override;
+    std::unique_ptr<Prefetcher> clone() const override {
+        return std::make_unique<StridePrefetcher>(*this);
+    }
+    void save(CheckpointWriter& out) const override;
+    void restore(CheckpointReader& in) override;
+    const char* name() const override { return "stride"; }
+
+private:
+    struct Entry {
+        uint64_t region = ~0ULL;    // Region tag (~0 = empty)
+        uint64_t last_block = 0;
+        int64_t stride = 0;         // In blocks
+        uint8_t confidence = 0;     // 0..3, prefetch at >= 1
+    };
+
+    size_t block_shift;
+    size_t degree;
+    std::vector<Entry> table;
+};
+
+// ============================================================================
+// Stream
+// ============================================================================
+
+/**
+ * StreamPrefetcher - Sequential stream detection with a prefetch window
+ *
+ * Tracks up to num_streams streams. A miss next to another recent miss
+ * (either direction) starts a stream. After that, every miss or prefetch
+ * hit inside the window moves it forward, keeping `depth` blocks fetched
+ * ahead of the most recent access. Streams are replaced LRU.
+ */
+class StreamPrefetcher : public Prefetcher {
+public:
+    /**
+     * @param block_size Block size in bytes (power of 2)
+     * @param depth Blocks kept in flight ahead of the stream (default 4)
+     * @param num_streams Streams tracked at once (default 8)
+     */
+    StreamPrefetcher(size_t block_size, size_t depth = 4, size_t num_streams = 8);
+
+    void observe(const PrefetchEvent& event, std::vector<uint64_t>& candidates) override;
+    void reset() override;
+    std::unique_ptr<Prefetcher> clone() const override {
+        return std::make_unique<StreamPrefetcher>(*this);
+    }
+    void save(CheckpointWriter& out) const override;
+    void restore(CheckpointReader& in) override;
+    const char* name() const override { return "stream"; }
+
+private:
+    struct Stream {
+        bool valid = false;
+        bool trained = false;       // Direction known, prefetching
+        uint64_t last_block = 0;    // Most recent block of the stream
+        uint64_t head = 0;          // Furthest block already fetched
+        int64_t direction = 0;      // +1 / -1
+        uint64_t last_use = 0;      // For LRU replacement
+    };
+
+    size_t block_shift;
+    size_t depth;
+    std::vector<Stream> streams;
+    uint64_t clock;
+};
+
+// ============================================================================
+// Runtime Selection
+// ============================================================================
+
+/**
+ * PrefetcherType - Prefetcher selectable at runtime
+ */
+enum class PrefetcherType {
+    NONE,
+    NEXT_LINE,
+    STRIDE,
+    STREAM
+};
+
+const char* prefetcher_name(PrefetcherType type);
+
+/**
+ * Parse "none", "next-line", "stride" or "stream"
+ * @return false if the name is unknown
+ */
+bool parse_prefetcher(const std::string& name, PrefetcherType& type);
+
+/**
+ * Build a prefetcher
+ * @param type Which model (NONE returns nullptr)
+ * @param block_size Block size in bytes
+ * @param degree Degree / depth (0 = the model's default)
+ */
+std::unique_ptr<Prefetcher> make_prefetcher(PrefetcherType type, size_t block_size,
+                                            size_t degree = 0);
+
+#endif // PREFETCHER_H
@@ -0,0 +1,126 @@
+#ifndef PREFETCHING_CACHE_H
+#define PREFETCHING_CACHE_H
+
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+#include "set_associative_cache.h"
+#include "prefetcher.h"
+
+/**
+ * PrefetchFill - One prefetch installed by the last access()
+ * The caller charges it to the next level (e.g. a DRAM read).
+ */
+struct PrefetchFill {
+    uint64_t address;           // Block address fetched
+    bool evicted_dirty;         // Did the fill push out a dirty block?
+    uint64_t victim_address;    // Block address of that victim
+};
+
+/**
+ * PrefetchingCache - SetAssociativeCache with a prefetcher beside access()
+ *
+ * Each demand access goes to the cache first. The prefetcher then sees the
+ * access and its outcome. If its candidates aren't resident, they are
+ * installed as prefetch fills. Resident but still unused prefetched blocks
+ * are tracked by block address together with the cycle their data arrives.
+ * That tag is what lets the first demand hit count as useful or late, and
+ * an unused eviction count as polluting.
+ *
+ * Demand stats (get_stats()) count only demand accesses. Evictions caused by
+ * prefetch fills are included in the eviction counts.
+ *
+ * Without a timing model every prefetch arrives at its issue cycle, so
+ * `late` stays 0. With MemorySystem, set_ready() records when the DRAM read
+ * behind a fill completes.
+ */
+class PrefetchingCache {
+private:
+    SetAssociativeCache cache;
+    PrefetcherType prefetcher_type;
+    std::unique_ptr<Prefetcher> prefetcher;     // nullptr = no prefetching
+    uint64_t block_mask;
+    std::unordered_map<uint64_t, uint64_t> in_cache;   // Unused prefetched block -> ready cycle
+    std::vector<uint64_t> candidates;
+    std::vector<PrefetchFill> fills;
+    PrefetchStats pstats;
+
+    void note_eviction(const AccessResult& r);
+    void load(CheckpointReader& in);
+
+public:
+    /**
+     * @param size Cache size in bytes
+     * @param block Block size in bytes
+     * @param assoc Associativity
+     * @param prefetcher_kind Prefetcher model
+     * @param degree Prefetcher degree / depth (0 = model default)
+     * @param addr_bits Address size in bits (default 32)
+     * @param mode Metadata layout (default FLAT)
+     * @param policy_kind Replacement policy (default LRU)
+     */
+    PrefetchingCache(size_t size, size_t block, size_t assoc, PrefetcherType prefetcher_kind,
+                     size_t degree = 0, size_t addr_bits = 32,
+                     StorageMode mode = StorageMode::FLAT,
+                     PolicyType policy_kind = PolicyType::LRU);
+
+    /** Copies the cache and the prefetcher's training */
+    PrefetchingCache(const PrefetchingCache& other);
+    PrefetchingCache(PrefetchingCache&&) = default;
+    PrefetchingCache& operator=(PrefetchingCache&&) = default;
+
+    /**
+     * Demand access, then let the prefetcher issue fills
+     * @param address Memory address
+     * @param type Read or write
+     * @param now Current cycle (prefetches issued now are ready at now
+     *            unless set_ready() says otherwise)
+     * @param ready_cycle Set to the block's arrival cycle when the access hit
+     *                    a prefetch that was never used before (> now = late)
+     * @return The demand access result
+     */
+    AccessResult access(uint64_t address, AccessType type, uint64_t now = 0,
+                        uint64_t* ready_cycle = nullptr);
+
+    /**
+     * Prefetch fills installed by the most recent access()
+     */
+    const std::vector<PrefetchFill>& last_fills() const { return fills; }
+
+    /**
+     * Record when a prefetched block's data arrives
+     */
+    void set_ready(uint64_t address, uint64_t ready_cycle);
+
+    CacheStats get_stats() const { return cache.get_stats(); }
+    const PrefetchStats& get_prefetch_stats() const { return pstats; }
+    const SetAssociativeCache& get_cache() const { return cache; }
+    PrefetcherType get_prefetcher_type() const { return prefetcher_type; }
+#ifdef CACHESIM_INSTRUMENT
+    /** Instrument the underlying cache (demand accesses and prefetch fills) */
+    void set_instrument(CacheInstrument* inst) { cache.set_instrument(inst); }
+#endif
+
+    /**
+     * Empty the cache, forget prefetcher training and clear all stats
+     */
+    void reset();
+
+    /**
+     * Write the cache, prefetcher training, unused prefetches and stats
+     */
+    void save(CheckpointWriter& out) const;
+
+    /**
+     * Read back a saved state (see SetAssociativeCache::restore())
+     * A snapshot from another prefetcher model keeps the cache and stats and
+     * starts this prefetcher untrained. Like the cache, a failed restore
+     * leaves everything as it was.
+     * @throws std::invalid_argument on a cache geometry mismatch
+     */
+    void restore(CheckpointReader& in);
+};
+
+#endif // PREFETCHING_CACHE_H
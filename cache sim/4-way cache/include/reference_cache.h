@@ -0,0 +1,121 @@
+#ifndef REFERENCE_CACHE_H
+#define REFERENCE_CACHE_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+#include "cache_set.h"
+#include "lru_tracker.h"
+#include "set_associative_cache.h"
+
+/**
+ * ReferenceCache - The original LRU cache model, kept as the golden reference
+ *
+ * One CacheSet (lines) and counter-based LRUTracker per set, a linear tag
+ * search and the first invalid way on a fill: the access path
+ * SetAssociativeCache started from, before flat storage, templates, batching
+ * or sharding. LockstepValidator checks every faster engine against it
+ * access by access, so keep it simple and leave it unoptimized; a change
+ * here changes what "correct" means.
+ */
+class ReferenceCache {
+public:
+    /**
+     * @param size Total cache size in bytes
+     * @param block Block size in bytes (power of 2)
+     * @param assoc Associativity (power of 2, any number of sets that is one too)
+     */
+    ReferenceCache(size_t size, size_t block, size_t assoc)
+        : offset_bits(log2(block)), index_bits(0), associativity(assoc) {
+        assert(block > 0 && (block & (block - 1)) == 0 && "Block size must be power of 2");
+        assert(assoc > 0 && (assoc & (assoc - 1)) == 0 && "Associativity must be power of 2");
+        size_t num_sets = size / block / assoc;
+        assert(num_sets > 0 && (num_sets & (num_sets - 1)) == 0 &&
+               "Number of sets must be power of 2");
+        index_bits = log2(num_sets);
+        sets.reserve(num_sets);
+        lru.reserve(num_sets);
+        for (size_t i = 0; i < num_sets; i++) {
+            sets.emplace_back(assoc);
+            lru.emplace_back(assoc);
+        }
+    }
+
+    AccessResult access(uint64_t address, AccessType type) {
+        AccessResult result;
+        if (type == AccessType::READ) {
+            stats.reads++;
+        } else {
+            stats.writes++;
+        }
+
+        uint64_t set_index = get_set_index(address);
+        uint64_t tag = address >> (offset_bits + index_bits);
+        result.set_index = set_index;
+        CacheSet& set = sets[set_index];
+
+        int way = set.find_line(tag);
+        if (way >= 0) {
+            result.hit = true;
+            result.way = way;
+            stats.hits++;
+            lru[set_index].access(way);
+            if (type == AccessType::WRITE) {
+                set.lines[way].dirty = true;
+            }
+            return result;
+        }
+
+        stats.misses++;
+        way = set.find_invalid();
+        if (way < 0) {
+            way = static_cast<int>(lru[set_index].get_victim());
+        }
+        result.way = way;
+        CacheLine& victim = set.lines[way];
+        if (victim.valid) {
+            result.evicted = true;
+            result.evicted_tag = victim.tag;
+            stats.evictions++;
+            if (victim.dirty) {
+                result.evicted_dirty = true;
+                stats.dirty_evictions++;
+            }
+        }
+        victim.valid = true;
+        victim.tag = tag;
+        victim.dirty = (type == AccessType::WRITE);
+        lru[set_index].access(way);
+        return result;
+    }
+
+    uint64_t get_set_index(uint64_t address) const {
+        return (address >> offset_bits) & ((1ULL << index_bits) - 1);
+    }
+
+    const CacheSet& get_set(size_t set_index) const { return sets[set_index]; }
+    std::vector<size_t> get_lru_order(size_t set_index) const { return lru[set_index].get_order(); }
+    CacheStats get_stats() const { return stats; }
+    size_t get_num_sets() const { return sets.size(); }
+    size_t get_associativity() const { return associativity; }
+
+private:
+    size_t offset_bits;
+    size_t index_bits;
+    size_t associativity;
+    std::vector<CacheSet> sets;
+    std::vector<LRUTracker> lru;
+    CacheStats stats;
+
+    static size_t log2(size_t n) {
+        size_t result = 0;
+        while (n > 1) {
+            n >>= 1;
+            result++;
+        }
+        return result;
+    }
+};
+
+#endif // REFERENCE_CACHE_H
@@ -0,0 +1,1077 @@
+#ifndef REPLACEMENT_POLICY_H
+#define REPLACEMENT_POLICY_H
+
+#include <vector>
+#include <variant>
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+#include <algorithm>
+#include "checkpoint.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/**
+ * Replacement policies for the cache models
+ *
+ * Unlike the EvictionPolicy classes in cpp/src (one virtual object per set),
+ * these policies own the replacement state of *every* set in one packed
+ * array and are called through templates, never through a vtable.
+ *
+ * Each policy is a class template over the associativity:
+ *   Policy<Ways>          ways fixed at compile time (loops fully unrolled)
+ *   Policy<DYNAMIC_WAYS>  ways chosen at runtime
+ *
+ * Interface every policy provides:
+ *   Policy(size_t num_sets, size_t ways)
+ *   void   on_hit(size_t set, size_t way)    - demand hit on a resident way
+ *   void   on_miss(size_t set, uint64_t block) - demand or fill miss on block
+ *                                            (address >> offset bits), before
+ *                                            victim() / on_fill() for it
+ *   void   on_fill(size_t set, size_t way)   - new block installed in way
+ *   size_t victim(size_t set)                - way to evict (set is full)
+ *   void   prefetch(size_t set) const        - warm the set's state (batched access)
+ *   void   reset()                           - back to the initial state
+ *   void   reset_set(size_t set)             - one set back to its initial state
+ *   void   begin_epoch()                     - reset state not kept per set
+ *   void   save(CheckpointWriter&) const     - write the state of every set
+ *   void   restore(CheckpointReader&)        - read it back (same geometry)
+ *   void   attach(Policy& cache_wide, size_t first_set)
+ *                                            - use cache_wide's shared state
+ *                                            (see SharedState; a no-op for
+ *                                            policies with only per-set state)
+ *
+ * An epoch reset of the cache (see TagStore) is begin_epoch() right away
+ * plus reset_set() on each set when it is next filled, which together
+ * equal reset() without touching every set.
+ *
+ * The cache itself always prefers an invalid way; victim() is only asked
+ * when every way of the set is valid.
+ */
+
+constexpr size_t DYNAMIC_WAYS = 0;
+
+/**
+ * PolicyWays - Holds the associativity, either as a constant or a member
+ */
+template <size_t Ways>
+struct PolicyWays {
+    explicit PolicyWays(size_t) {}
+    static constexpr size_t ways() { return Ways; }
+    template <typename Policy>
+    void attach(Policy&, size_t) {}
+};
+
+template <>
+struct PolicyWays<DYNAMIC_WAYS> {
+    explicit PolicyWays(size_t w) : num_ways(w) {}
+    size_t ways() const { return num_ways; }
+    template <typename Policy>
+    void attach(Policy&, size_t) {}
+    size_t num_ways;
+};
+
+/**
+ * SharedState - Policy state that belongs to the whole cache, not to a set
+ *
+ * BRRIP's throttle, DRRIP's selector and SHiP's SHCT learn from every set;
+ * RANDOM's seed applies to every set. FLAT and PER_SET caches have one
+ * policy, which uses its own copy. A SPARSE page's policy holds only the
+ * state of its own sets. Before each use, attach() points it at the
+ * cache-wide policy's copy and gives it the global index of its first set,
+ * so SPARSE replaces exactly like FLAT. A cache that is a slice of a larger
+ * one attaches its policy to itself, just to number its sets globally.
+ */
+template <typename State>
+class SharedState {
+public:
+    explicit SharedState(State initial) : own(std::move(initial)) {}
+
+    void attach(SharedState& cache_wide, size_t first) {
+        attached = &cache_wide == this ? nullptr : &cache_wide.own;
+        first_set = first;
+    }
+
+protected:
+    State own;                      // Saved, restored and reset with the policy
+    State* attached = nullptr;      // Set by attach(), else own is used
+    size_t first_set = 0;           // Global index of set 0
+
+    State& shared() { return attached ? *attached : own; }
+    const State& shared() const { return attached ? *attached : own; }
+};
+
+// ============================================================================
+// LRU - rank byte per way
+// ============================================================================
+
+/**
+ * LRUPolicy - True LRU using a rank byte per way
+ *
+ * rank 0 is the MRU way and rank ways-1 is the LRU way. Ranks start
+ * staggered so way 0 is the first victim, like LRUTracker. In the runtime
+ * variant each set's ranks are padded to 16 bytes so a whole set (up to 16
+ * ways) is aged with one SSE2/NEON compare-and-add.
+ *
+ * A byte holds ranks for up to 256 ways. Wider runtime sets (a PER_SET
+ * cache can be fully associative) keep 32-bit ranks and take the scalar
+ * loops instead.
+ */
+template <size_t Ways>
+class LRUPolicy : public PolicyWays<Ways> {
+public:
+    static constexpr size_t MAX_BYTE_WAYS = 256;
+    static_assert(Ways <= MAX_BYTE_WAYS, "fixed-ways LRU keeps byte ranks");
+
+    LRUPolicy(size_t num_sets, size_t ways)
+        : PolicyWays<Ways>(ways), sets(num_sets),
+          wide(Ways == DYNAMIC_WAYS && ways > MAX_BYTE_WAYS),
+          stride(wide ? ways : Ways == DYNAMIC_WAYS ? (ways + 15) & ~size_t(15) : Ways),
+          ranks(wide ? 0 : num_sets * stride), wide_ranks(wide ? num_sets * stride : 0) {
+        reset();
+    }
+
+    void on_hit(size_t set, size_t way) { promote(set, way); }
+    void on_miss(size_t, uint64_t) {}
+    void on_fill(size_t set, size_t way) { promote(set, way); }
+
+    size_t victim(size_t set) const {
+        if (Ways == DYNAMIC_WAYS && wide) {
+            return lru_way(&wide_ranks[set * stride]);
+        }
+        const uint8_t* r = &ranks[set * stride];
+#if defined(__SSE2__)
+        if (Ways == DYNAMIC_WAYS) {
+            const uint8_t lru = static_cast<uint8_t>(this->ways() - 1);
+            const __m128i needle = _mm_set1_epi8(static_cast<char>(lru));
+            for (size_t i = 0; i < stride; i += 16) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r + i));
+                int hits = _mm_movemask_epi8(_mm_cmpeq_epi8(v, needle));
+                if (hits) {
+                    return i + __builtin_ctz(hits);
+                }
+            }
+            return 0;
+        }
+#endif
+        return lru_way(r);
+    }
+
+    void prefetch(size_t set) const {
+        if (wide) {
+            __builtin_prefetch(&wide_ranks[set * stride], 1);
+        } else {
+            __builtin_prefetch(&ranks[set * stride], 1);
+        }
+    }
+
+    void reset() {
+        for (size_t s = 0; s < sets; s++) {
+            reset_set(s);
+        }
+    }
+
+    void reset_set(size_t set) {
+        if (wide) {
+            uint32_t* r = &wide_ranks[set * stride];
+            for (size_t i = 0; i < stride; i++) {
+                r[i] = static_cast<uint32_t>(this->ways() - 1 - i);
+            }
+            return;
+        }
+        uint8_t* r = &ranks[set * stride];
+        for (size_t i = 0; i < stride; i++) {
+            // Padding lanes get 0xFF so they never count as "younger"
+            r[i] = i < this->ways() ? static_cast<uint8_t>(this->ways() - 1 - i) : 0xFF;
+        }
+    }
+
+    void begin_epoch() {}
+
+    void save(CheckpointWriter& out) const {
+        out.put_vector(ranks);
+        out.put_vector(wide_ranks);
+    }
+    void restore(CheckpointReader& in) {
+        in.get_vector(ranks);
+        in.get_vector(wide_ranks);
+    }
+
+    /**
+     * Get LRU order for debugging
+     * @return Way indices ordered from LRU to MRU
+     */
+    std::vector<size_t> get_order(size_t set) const {
+        std::vector<size_t> order(this->ways());
+        for (size_t i = 0; i < this->ways(); i++) {
+            size_t rank = wide ? wide_ranks[set * stride + i] : ranks[set * stride + i];
+            order[this->ways() - 1 - rank] = i;
+        }
+        return order;
+    }
+
+private:
+    size_t sets;
+    bool wide;                          // More than MAX_BYTE_WAYS ways
+    size_t stride;                      // Ranks per set
+    std::vector<uint8_t> ranks;         // Byte ranks (not wide)
+    std::vector<uint32_t> wide_ranks;   // 32-bit ranks (wide)
+
+    template <typename Rank>
+    size_t lru_way(const Rank* r) const {
+        const Rank lru = static_cast<Rank>(this->ways() - 1);
+        size_t way = 0;
+        for (size_t i = 0; i < this->ways(); i++) {
+            way = r[i] == lru ? i : way;
+        }
+        return way;
+    }
+
+    template <typename Rank>
+    void age(Rank* r, size_t way) {
+        const Rank old_rank = r[way];
+        for (size_t i = 0; i < this->ways(); i++) {
+            r[i] += (r[i] < old_rank);
+        }
+        r[way] = 0;
+    }
+
+    /** Make way MRU; every way more recent than it ages by one */
+    void promote(size_t set, size_t way) {
+        if (Ways == DYNAMIC_WAYS && wide) {
+            age(&wide_ranks[set * stride], way);
+            return;
+        }
+        uint8_t* r = &ranks[set * stride];
+        const uint8_t old_rank = r[way];
+        if (old_rank == 0) {
+            return;
+        }
+        if (Ways == DYNAMIC_WAYS) {
+#if defined(__SSE2__)
+            // Unsigned r[i] < old_rank via sign-flipped signed compare
+            const __m128i bias = _mm_set1_epi8(static_cast<char>(0x80));
+            const __m128i limit = _mm_set1_epi8(static_cast<char>(old_rank ^ 0x80));
+            const __m128i one = _mm_set1_epi8(1);
+            for (size_t i = 0; i < stride; i += 16) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r + i));
+                __m128i younger = _mm_cmplt_epi8(_mm_xor_si128(v, bias), limit);
+                v = _mm_add_epi8(v, _mm_and_si128(younger, one));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(r + i), v);
+            }
+            r[way] = 0;
+            return;
+#elif defined(__ARM_NEON)
+            const uint8x16_t limit = vdupq_n_u8(old_rank);
+            const uint8x16_t one = vdupq_n_u8(1);
+            for (size_t i = 0; i < stride; i += 16) {
+                uint8x16_t v = vld1q_u8(r + i);
+                v = vaddq_u8(v, vandq_u8(vcltq_u8(v, limit), one));
+                vst1q_u8(r + i, v);
+            }
+            r[way] = 0;
+            return;
+#endif
+        }
+        age(r, way);
+    }
+};
+
+// ============================================================================
+// FIFO - LRU ranks updated only on fill
+// ============================================================================
+
+/**
+ * FIFOPolicy - Evict the way that was filled longest ago
+ *
+ * Same rank array as LRU, but hits don't promote: only (re)filling a way
+ * moves it to the front of the queue.
+ */
+template <size_t Ways>
+class FIFOPolicy : public LRUPolicy<Ways> {
+public:
+    using LRUPolicy<Ways>::LRUPolicy;
+
+    void on_hit(size_t, size_t) {}
+};
+
+// ============================================================================
+// Random
+// ============================================================================
+
+/**
+ * RandomPolicy - Uniform random victim, reproducible set by set
+ *
+ * The n-th victim of a set is a splitmix64 hash of the seed, the set's
+ * global index and n, counted per set. A set's victims therefore depend
+ * only on its own misses, not on which other sets share the cache object:
+ * a SPARSE page or a ShardedSimulator shard picks the same victims as the
+ * whole cache. The seed is the cache-wide state (see SharedState). The
+ * bounded draw is a multiply-shift (no modulo, no rejection loop).
+ */
+template <size_t Ways>
+class RandomPolicy : public PolicyWays<Ways>, public SharedState<uint64_t> {
+public:
+    static constexpr uint64_t DEFAULT_SEED = 0x9E3779B97F4A7C15ULL;
+
+    RandomPolicy(size_t num_sets, size_t ways, uint64_t seed = DEFAULT_SEED)
+        : PolicyWays<Ways>(ways), SharedState<uint64_t>(seed ? seed : DEFAULT_SEED),
+          draws(num_sets, 0) {}
+
+    using SharedState<uint64_t>::attach;
+
+    void on_hit(size_t, size_t) {}
+    void on_miss(size_t, uint64_t) {}
+    void on_fill(size_t, size_t) {}
+
+    size_t victim(size_t set) {
+        uint64_t x = shared() ^ ((static_cast<uint64_t>(first_set + set) << 32) | draws[set]++);
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        uint64_t r = (x ^ (x >> 31)) >> 32;
+        return static_cast<size_t>((r * this->ways()) >> 32);
+    }
+
+    void prefetch(size_t set) const { __builtin_prefetch(&draws[set], 1); }
+
+    void reset() { std::fill(draws.begin(), draws.end(), 0); }
+    void reset_set(size_t set) { draws[set] = 0; }
+    void begin_epoch() {}
+
+    /** Only the draw counts; the seed comes from the constructor */
+    void save(CheckpointWriter& out) const { out.put_vector(draws); }
+    void restore(CheckpointReader& in) { in.get_vector(draws); }
+
+private:
+    std::vector<uint32_t> draws;    // Per set: victims drawn since reset
+};
+
+// ============================================================================
+// Pseudo-LRU - binary tree packed into one word per set
+// ============================================================================
+
+/**
+ * PseudoLRUPolicy - Tree pseudo-LRU, ways-1 bits per set in a uint64_t
+ *
+ * Same tree as PseudoLRU in cpp/src: node 0 is the root, node n has
+ * children 2n+1 / 2n+2. A bit of 1 means "victim is in the right subtree";
+ * an access points every node on its path away from the accessed way.
+ */
+template <size_t Ways>
+class PseudoLRUPolicy : public PolicyWays<Ways> {
+public:
+    PseudoLRUPolicy(size_t num_sets, size_t ways)
+        : PolicyWays<Ways>(ways), depth(0), trees(num_sets, 0) {
+        assert(ways > 0 && ways <= 64 && (ways & (ways - 1)) == 0 &&
+               "Pseudo-LRU needs a power-of-2 way count up to 64");
+        while ((size_t(1) << depth) < ways) {
+            depth++;
+        }
+    }
+
+    void on_hit(size_t set, size_t way) { point_away(set, way); }
+    void on_miss(size_t, uint64_t) {}
+    void on_fill(size_t set, size_t way) { point_away(set, way); }
+
+    size_t victim(size_t set) const {
+        const uint64_t tree = trees[set];
+        size_t node = 0;
+        size_t way = 0;
+        for (size_t level = 0; level < depth; level++) {
+            size_t go_right = (tree >> node) & 1;
+            way = (way << 1) | go_right;
+            node = 2 * node + 1 + go_right;
+        }
+        return way;
+    }
+
+    void prefetch(size_t set) const { __builtin_prefetch(&trees[set], 1); }
+
+    void reset() {
+        for (auto& t : trees) {
+            t = 0;
+        }
+    }
+
+    void reset_set(size_t set) { trees[set] = 0; }
+    void begin_epoch() {}
+
+    void save(CheckpointWriter& out) const { out.put_vector(trees); }
+    void restore(CheckpointReader& in) { in.get_vector(trees); }
+
+private:
+    size_t depth;                  // log2(ways)
+    std::vector<uint64_t> trees;   // One tree per set
+
+    void point_away(size_t set, size_t way) {
+        uint64_t tree = trees[set];
+        size_t node = 0;
+        for (size_t level = 0; level < depth; level++) {
+            size_t is_right = (way >> (depth - 1 - level)) & 1;
+            tree = is_right ? (tree & ~(1ULL << node)) : (tree | (1ULL << node));
+            node = 2 * node + 1 + is_right;
+        }
+        trees[set] = tree;
+    }
+};
+
+// ============================================================================
+// RRIP family - 2-bit re-reference prediction values in two bit-planes
+// ============================================================================
+
+/**
+ * RRPVPlanes - Packed 2-bit RRPVs of every set (up to 64 ways)
+ *
+ * Bit 1 and bit 0 of each way's RRPV live in two words per set, hi[set] and
+ * lo[set], bit w = way w. A whole set is then searched and aged with a few
+ * word operations instead of a loop over ways:
+ *
+ *   ways at RRPV 3 ("distant"):   hi & lo
+ *   age all by 1 (max was 2):     hi' = hi | lo,  lo' = ~lo
+ *   age all by 2 (max was 1):     hi' = all
+ *   age all by 3 (max was 0):     hi' = lo' = all
+ *
+ * Every way starts distant, so the first victims are the lowest ways.
+ */
+class RRPVPlanes {
+public:
+    static constexpr uint8_t NEAR = 0;
+    static constexpr uint8_t LONG = 2;
+    static constexpr uint8_t DISTANT = 3;
+
+    RRPVPlanes(size_t num_sets, size_t ways)
+        : way_mask(ways >= 64 ? ~0ULL : ((1ULL << ways) - 1)),
+          hi(num_sets, way_mask), lo(num_sets, way_mask) {}
+
+    void set(size_t set, size_t way, uint8_t rrpv) {
+        uint64_t bit = 1ULL << way;
+        hi[set] = (rrpv & 2) ? (hi[set] | bit) : (hi[set] & ~bit);
+        lo[set] = (rrpv & 1) ? (lo[set] | bit) : (lo[set] & ~bit);
+    }
+
+    uint8_t get(size_t set, size_t way) const {
+        return static_cast<uint8_t>((((hi[set] >> way) & 1) << 1) | ((lo[set] >> way) & 1));
+    }
+
+    /** Lowest distant way, after ageing the set just enough to have one */
+    size_t victim(size_t set) {
+        uint64_t h = hi[set];
+        uint64_t l = lo[set];
+        uint64_t distant = h & l;
+        if (!distant) {
+            if (h) {
+                h |= l;
+                l = ~l & way_mask;
+            } else if (l) {
+                h = way_mask;
+            } else {
+                h = l = way_mask;
+            }
+            hi[set] = h;
+            lo[set] = l;
+            distant = h & l;
+        }
+        return __builtin_ctzll(distant);
+    }
+
+    void prefetch(size_t set) const {
+        __builtin_prefetch(&hi[set], 1);
+        __builtin_prefetch(&lo[set], 1);
+    }
+
+    void reset_set(size_t set) { hi[set] = lo[set] = way_mask; }
+
+    void reset() {
+        std::fill(hi.begin(), hi.end(), way_mask);
+        std::fill(lo.begin(), lo.end(), way_mask);
+    }
+
+    void save(CheckpointWriter& out) const {
+        out.put_vector(hi);
+        out.put_vector(lo);
+    }
+
+    void restore(CheckpointReader& in) {
+        in.get_vector(hi);
+        in.get_vector(lo);
+    }
+
+private:
+    uint64_t way_mask;
+    std::vector<uint64_t> hi;
+    std::vector<uint64_t> lo;
+};
+
+/**
+ * SRRIPPolicy - Static RRIP (hit priority)
+ *
+ * Fills are predicted a long re-reference (RRPV 2), hits near (0). The
+ * victim is a distant way, so a scan of single-use blocks only displaces
+ * other blocks that were never reused.
+ */
+template <size_t Ways>
+class SRRIPPolicy : public PolicyWays<Ways> {
+public:
+    SRRIPPolicy(size_t num_sets, size_t ways) : PolicyWays<Ways>(ways), rrpv(num_sets, ways) {
+        assert(ways > 0 && ways <= 64 && "RRIP supports 1..64 ways");
+    }
+
+    void on_hit(size_t set, size_t way) { rrpv.set(set, way, RRPVPlanes::NEAR); }
+    void on_miss(size_t, uint64_t) {}
+    void on_fill(size_t set, size_t way) { rrpv.set(set, way, RRPVPlanes::LONG); }
+    size_t victim(size_t set) { return rrpv.victim(set); }
+    void prefetch(size_t set) const { rrpv.prefetch(set); }
+
+    void reset() { rrpv.reset(); }
+    void reset_set(size_t set) { rrpv.reset_set(set); }
+    void begin_epoch() {}
+
+    void save(CheckpointWriter& out) const { rrpv.save(out); }
+    void restore(CheckpointReader& in) { rrpv.restore(in); }
+
+    uint8_t get_rrpv(size_t set, size_t way) const { return rrpv.get(set, way); }
+
+private:
+    RRPVPlanes rrpv;
+};
+
+/**
+ * BimodalThrottle - BRRIP's insertion choice: long once every 32 fills
+ *
+ * A counter rather than a random draw, so runs are reproducible.
+ */
+struct BimodalThrottle {
+    static constexpr uint32_t PERIOD = 32;
+    uint32_t fills = 0;
+
+    uint8_t next() { return ++fills % PERIOD == 0 ? RRPVPlanes::LONG : RRPVPlanes::DISTANT; }
+};
+
+/**
+ * BRRIPPolicy - Bimodal RRIP
+ *
+ * Like SRRIP, but most fills are predicted distant. Only one in 32 is
+ * inserted long, so a working set larger than the cache keeps part of
+ * itself resident instead of thrashing.
+ */
+template <size_t Ways>
+class BRRIPPolicy : public PolicyWays<Ways>, public SharedState<BimodalThrottle> {
+public:
+    BRRIPPolicy(size_t num_sets, size_t ways)
+        : PolicyWays<Ways>(ways), SharedState<BimodalThrottle>(BimodalThrottle()),
+          rrpv(num_sets, ways) {
+        assert(ways > 0 && ways <= 64 && "RRIP supports 1..64 ways");
+    }
+
+    using SharedState<BimodalThrottle>::attach;
+
+    void on_hit(size_t set, size_t way) { rrpv.set(set, way, RRPVPlanes::NEAR); }
+    void on_miss(size_t, uint64_t) {}
+    void on_fill(size_t set, size_t way) { rrpv.set(set, way, shared().next()); }
+    size_t victim(size_t set) { return rrpv.victim(set); }
+    void prefetch(size_t set) const { rrpv.prefetch(set); }
+
+    void reset() {
+        rrpv.reset();
+        begin_epoch();
+    }
+    void reset_set(size_t set) { rrpv.reset_set(set); }
+    void begin_epoch() { own = BimodalThrottle(); }
+
+    void save(CheckpointWriter& out) const {
+        rrpv.save(out);
+        out.put(own.fills);
+    }
+    void restore(CheckpointReader& in) {
+        rrpv.restore(in);
+        own.fills = in.get<uint32_t>();
+    }
+
+private:
+    RRPVPlanes rrpv;
+};
+
+/** DRRIP's cache-wide state: the leader spacing, PSEL and the BRRIP throttle */
+struct DuelState {
+    size_t stride;              // Sets per dueling group (power of 2)
+    uint32_t psel;              // > PSEL_MAX / 2: SRRIP leaders are missing more
+    BimodalThrottle throttle;
+};
+
+/**
+ * DRRIPPolicy - Dynamic RRIP: SRRIP and BRRIP chosen by set dueling
+ *
+ * One set in every `stride` always inserts like SRRIP, another like BRRIP
+ * (up to 32 of each; stride is num_sets / 32, at least 4). Their misses move
+ * a 10-bit saturating selector, PSEL, in opposite directions, and every
+ * other set follows whichever leader group is missing less.
+ */
+template <size_t Ways>
+class DRRIPPolicy : public PolicyWays<Ways>, public SharedState<DuelState> {
+public:
+    static constexpr uint32_t PSEL_MAX = 1023;
+    static constexpr size_t LEADERS = 32;
+
+    DRRIPPolicy(size_t num_sets, size_t ways) : DRRIPPolicy(num_sets, ways, num_sets) {}
+
+    /** @param shared_sets Sets of the whole cache, which the leaders are spread over */
+    DRRIPPolicy(size_t num_sets, size_t ways, size_t shared_sets)
+        : PolicyWays<Ways>(ways),
+          SharedState<DuelState>(DuelState{std::max<size_t>(4, shared_sets / LEADERS),
+                                           PSEL_MAX / 2 + 1, BimodalThrottle()}),
+          rrpv(num_sets, ways) {
+        assert(ways > 0 && ways <= 64 && "RRIP supports 1..64 ways");
+    }
+
+    using SharedState<DuelState>::attach;
+
+    void on_hit(size_t set, size_t way) { rrpv.set(set, way, RRPVPlanes::NEAR); }
+
+    void on_miss(size_t set, uint64_t) {
+        DuelState& d = shared();
+        size_t duel = (first_set + set) & (d.stride - 1);
+        if (duel == 0 && d.psel < PSEL_MAX) {
+            d.psel++;               // SRRIP leader missed
+        } else if (duel == d.stride / 2 && d.psel > 0) {
+            d.psel--;               // BRRIP leader missed
+        }
+    }
+
+    void on_fill(size_t set, size_t way) {
+        DuelState& d = shared();
+        size_t duel = (first_set + set) & (d.stride - 1);
+        bool bimodal = duel == 0 ? false : duel == d.stride / 2 ? true : uses_brrip();
+        rrpv.set(set, way, bimodal ? d.throttle.next() : RRPVPlanes::LONG);
+    }
+
+    size_t victim(size_t set) { return rrpv.victim(set); }
+    void prefetch(size_t set) const { rrpv.prefetch(set); }
+
+    void reset() {
+        rrpv.reset();
+        begin_epoch();
+    }
+    void reset_set(size_t set) { rrpv.reset_set(set); }
+    void begin_epoch() {
+        own.psel = PSEL_MAX / 2 + 1;
+        own.throttle = BimodalThrottle();
+    }
+
+    void save(CheckpointWriter& out) const {
+        rrpv.save(out);
+        out.put(own.psel);
+        out.put(own.throttle.fills);
+    }
+    void restore(CheckpointReader& in) {
+        rrpv.restore(in);
+        own.psel = in.get<uint32_t>();
+        own.throttle.fills = in.get<uint32_t>();
+    }
+
+    /** Whether follower sets currently insert like BRRIP */
+    bool uses_brrip() const { return shared().psel > PSEL_MAX / 2; }
+
+private:
+    RRPVPlanes rrpv;
+};
+
+/** SHiP's cache-wide state: the SHCT and the signature of the pending fill */
+struct SignatureTable {
+    std::vector<uint8_t> shct;          // Saturating reuse counters
+    uint16_t pending;                   // Signature of the miss being filled
+};
+
+/**
+ * SHiPPolicy - Signature-based hit prediction on top of SRRIP
+ *
+ * Without program counters the signature is the memory region: a 14-bit
+ * hash of the block address >> 8 (256 blocks, 16 KB at 64 B). Each line
+ * remembers the signature it was filled under and whether it has been hit
+ * since. The signature history counter table (SHCT) holds 3-bit counters.
+ * A hit increments the line's counter. Evicting a line that was never
+ * reused decrements it. Fills whose counter is 0 are predicted distant,
+ * the rest long.
+ *
+ * The SHCT has one entry per line of the cache, up to 16K entries.
+ */
+template <size_t Ways>
+class SHiPPolicy : public PolicyWays<Ways>, public SharedState<SignatureTable> {
+public:
+    static constexpr uint8_t COUNTER_MAX = 7;
+    static constexpr size_t MAX_SHCT = 1 << 14;
+    static constexpr size_t REGION_SHIFT = 8;
+
+    SHiPPolicy(size_t num_sets, size_t ways) : SHiPPolicy(num_sets, ways, num_sets) {}
+
+    /** @param shared_sets Sets of the whole cache, which size the SHCT (0: none, attached) */
+    SHiPPolicy(size_t num_sets, size_t ways, size_t shared_sets)
+        : PolicyWays<Ways>(ways),
+          SharedState<SignatureTable>(SignatureTable{
+              std::vector<uint8_t>(shared_sets ? shct_entries(shared_sets * ways) : 0, 1), 0}),
+          rrpv(num_sets, ways), signatures(num_sets * ways, 0), reused(num_sets, 0) {
+        assert(ways > 0 && ways <= 64 && "RRIP supports 1..64 ways");
+    }
+
+    using SharedState<SignatureTable>::attach;
+
+    void on_hit(size_t set, size_t way) {
+        rrpv.set(set, way, RRPVPlanes::NEAR);
+        reused[set] |= 1ULL << way;
+        uint8_t& counter = shared().shct[signatures[set * this->ways() + way]];
+        counter += counter < COUNTER_MAX;
+    }
+
+    void on_miss(size_t, uint64_t block) {
+        SignatureTable& t = shared();
+        uint64_t h = (block >> REGION_SHIFT) * 0x9E3779B97F4A7C15ULL;
+        t.pending = static_cast<uint16_t>((h >> 50) & (t.shct.size() - 1));
+    }
+
+    void on_fill(size_t set, size_t way) {
+        SignatureTable& t = shared();
+        signatures[set * this->ways() + way] = t.pending;
+        reused[set] &= ~(1ULL << way);
+        rrpv.set(set, way, t.shct[t.pending] == 0 ? RRPVPlanes::DISTANT : RRPVPlanes::LONG);
+    }
+
+    size_t victim(size_t set) {
+        size_t way = rrpv.victim(set);
+        if (!((reused[set] >> way) & 1)) {
+            uint8_t& counter = shared().shct[signatures[set * this->ways() + way]];
+            counter -= counter > 0;
+        }
+        return way;
+    }
+
+    void prefetch(size_t set) const {
+        rrpv.prefetch(set);
+        __builtin_prefetch(&signatures[set * this->ways()], 1);
+    }
+
+    void reset() {
+        rrpv.reset();
+        std::fill(reused.begin(), reused.end(), 0);
+        begin_epoch();
+    }
+    void reset_set(size_t set) {
+        rrpv.reset_set(set);
+        reused[set] = 0;
+    }
+    void begin_epoch() { std::fill(own.shct.begin(), own.shct.end(), 1); }
+
+    void save(CheckpointWriter& out) const {
+        rrpv.save(out);
+        out.put_vector(signatures);
+        out.put_vector(reused);
+        out.put_vector(own.shct);
+    }
+    void restore(CheckpointReader& in) {
+        rrpv.restore(in);
+        in.get_vector(signatures);
+        in.get_vector(reused);
+        in.get_vector(own.shct);
+    }
+
+private:
+    RRPVPlanes rrpv;
+    std::vector<uint16_t> signatures;   // Per line: signature at fill
+    std::vector<uint64_t> reused;       // Per set: bit w = way w hit since fill
+
+    static size_t shct_entries(size_t lines) {
+        size_t n = 64;
+        while (n < lines && n < MAX_SHCT) {
+            n <<= 1;
+        }
+        return n;
+    }
+};
+
+// ============================================================================
+// ARC - adaptive replacement, one instance per set
+// ============================================================================
+
+/**
+ * ARCPolicy - Adaptive Replacement Cache applied to each set (c = ways)
+ *
+ * Resident ways are split into T1 (seen once) and T2 (hit at least once,
+ * or refilled from a ghost). Ghost lists B1 and B2 remember the blocks
+ * recently evicted from each. A miss that finds its block in B1 grows
+ * the T1 target p, and a B2 ghost hit shrinks it. The victim is the LRU
+ * way of T1 while T1 is above p, otherwise the LRU way of T2.
+ *
+ * Per set the state is a T2 mask, recency ranks, the target p and up to
+ * `ways` ghost blocks per list, oldest first. ARC needs block identity for
+ * its ghosts, which it gets from on_miss(). So it keeps its own copy of each
+ * resident way's block.
+ */
+template <size_t Ways>
+class ARCPolicy : public PolicyWays<Ways> {
+public:
+    ARCPolicy(size_t num_sets, size_t ways)
+        : PolicyWays<Ways>(ways), sets(num_sets),
+          ranks(num_sets * ways), resident(num_sets), t2(num_sets), target(num_sets),
+          blocks(num_sets * ways, 0), ghosts(num_sets * 2 * ways, 0), ghost_count(num_sets * 2),
+          pending_block(0), pending_ghost(NONE) {
+        assert(ways > 0 && ways <= 64 && "ARC supports 1..64 ways");
+        reset();
+    }
+
+    void on_hit(size_t set, size_t way) {
+        t2[set] |= 1ULL << way;
+        promote(set, way);
+    }
+
+    void on_miss(size_t set, uint64_t block) {
+        const size_t c = this->ways();
+        size_t b1 = ghost_count[2 * set];
+        size_t b2 = ghost_count[2 * set + 1];
+        pending_block = block;
+        pending_ghost = NONE;
+        if (remove_ghost(set, B1, block)) {
+            target[set] = static_cast<uint8_t>(std::min(c, target[set] + std::max<size_t>(1, b2 / b1)));
+            pending_ghost = B1;
+        } else if (remove_ghost(set, B2, block)) {
+            size_t delta = std::max<size_t>(1, b1 / b2);
+            target[set] = static_cast<uint8_t>(target[set] > delta ? target[set] - delta : 0);
+            pending_ghost = B2;
+        } else {
+            // New block: keep |T1| + |B1| <= c and the directory at 2c
+            size_t t1 = __builtin_popcountll(resident[set] & ~t2[set]);
+            size_t total = __builtin_popcountll(resident[set]) + b1 + b2;
+            if (t1 + b1 >= c && b1 > 0) {
+                drop_oldest(set, B1);
+            } else if (total >= 2 * c && b2 > 0) {
+                drop_oldest(set, B2);
+            }
+        }
+    }
+
+    void on_fill(size_t set, size_t way) {
+        uint64_t bit = 1ULL << way;
+        resident[set] |= bit;
+        t2[set] = pending_ghost != NONE ? (t2[set] | bit) : (t2[set] & ~bit);
+        blocks[set * this->ways() + way] = pending_block;
+        pending_ghost = NONE;
+        promote(set, way);
+    }
+
+    size_t victim(size_t set) {
+        // The set is full; ways filled before this policy saw them count as T1
+        resident[set] = this->ways() >= 64 ? ~0ULL : ((1ULL << this->ways()) - 1);
+        uint64_t t1_ways = resident[set] & ~t2[set];
+        uint64_t t2_ways = resident[set] & t2[set];
+        size_t t1 = __builtin_popcountll(t1_ways);
+        bool from_t1 = t1 > 0 && (t1 > target[set] || (pending_ghost == B2 && t1 == target[set]) ||
+                                  t2_ways == 0);
+        size_t way = lru_of(set, from_t1 ? t1_ways : t2_ways);
+        push_ghost(set, from_t1 ? B1 : B2, blocks[set * this->ways() + way]);
+        resident[set] &= ~(1ULL << way);
+        return way;
+    }
+
+    void prefetch(size_t set) const {
+        __builtin_prefetch(&ranks[set * this->ways()], 1);
+        __builtin_prefetch(&resident[set], 1);
+        __builtin_prefetch(&t2[set], 1);
+    }
+
+    void reset() {
+        for (size_t s = 0; s < sets; s++) {
+            reset_set(s);
+        }
+    }
+
+    void reset_set(size_t set) {
+        uint8_t* r = &ranks[set * this->ways()];
+        for (size_t i = 0; i < this->ways(); i++) {
+            r[i] = static_cast<uint8_t>(this->ways() - 1 - i);
+        }
+        resident[set] = 0;
+        t2[set] = 0;
+        target[set] = 0;
+        ghost_count[2 * set] = 0;
+        ghost_count[2 * set + 1] = 0;
+    }
+
+    void begin_epoch() {}
+
+    void save(CheckpointWriter& out) const {
+        out.put_vector(ranks);
+        out.put_vector(resident);
+        out.put_vector(t2);
+        out.put_vector(target);
+        out.put_vector(blocks);
+        out.put_vector(ghosts);
+        out.put_vector(ghost_count);
+    }
+
+    void restore(CheckpointReader& in) {
+        in.get_vector(ranks);
+        in.get_vector(resident);
+        in.get_vector(t2);
+        in.get_vector(target);
+        in.get_vector(blocks);
+        in.get_vector(ghosts);
+        in.get_vector(ghost_count);
+    }
+
+    /** Current T1 target size of a set */
+    size_t get_target(size_t set) const { return target[set]; }
+
+private:
+    enum Ghost : uint8_t { B1 = 0, B2 = 1, NONE = 2 };
+
+    size_t sets;
+    std::vector<uint8_t> ranks;         // Per way, 0 = MRU
+    std::vector<uint64_t> resident;     // Per set: ways this policy has filled
+    std::vector<uint64_t> t2;           // Per set: resident ways in T2
+    std::vector<uint8_t> target;        // Per set: p, the T1 target size
+    std::vector<uint64_t> blocks;       // Per way: block held
+    std::vector<uint64_t> ghosts;       // Per set: B1 then B2, `ways` slots each
+    std::vector<uint8_t> ghost_count;   // Per set: |B1|, |B2|
+    uint64_t pending_block;             // Block of the miss being filled
+    Ghost pending_ghost;                // Ghost list it was found in
+
+    void promote(size_t set, size_t way) {
+        uint8_t* r = &ranks[set * this->ways()];
+        const uint8_t old_rank = r[way];
+        for (size_t i = 0; i < this->ways(); i++) {
+            r[i] += (r[i] < old_rank);
+        }
+        r[way] = 0;
+    }
+
+    size_t lru_of(size_t set, uint64_t mask) const {
+        const uint8_t* r = &ranks[set * this->ways()];
+        size_t way = __builtin_ctzll(mask);
+        for (uint64_t m = mask & (mask - 1); m; m &= m - 1) {
+            size_t w = __builtin_ctzll(m);
+            way = r[w] > r[way] ? w : way;
+        }
+        return way;
+    }
+
+    uint64_t* ghost_list(size_t set, Ghost list) {
+        return &ghosts[(2 * set + list) * this->ways()];
+    }
+
+    bool remove_ghost(size_t set, Ghost list, uint64_t block) {
+        uint64_t* g = ghost_list(set, list);
+        uint8_t& n = ghost_count[2 * set + list];
+        for (size_t i = 0; i < n; i++) {
+            if (g[i] == block) {
+                std::copy(g + i + 1, g + n, g + i);
+                n--;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void drop_oldest(size_t set, Ghost list) {
+        uint64_t* g = ghost_list(set, list);
+        uint8_t& n = ghost_count[2 * set + list];
+        std::copy(g + 1, g + n, g);
+        n--;
+    }
+
+    void push_ghost(size_t set, Ghost list, uint64_t block) {
+        if (ghost_count[2 * set + list] == this->ways()) {
+            drop_oldest(set, list);
+        }
+        ghost_list(set, list)[ghost_count[2 * set + list]++] = block;
+    }
+};
+
+// ============================================================================
+// Runtime Selection
+// ============================================================================
+
+/**
+ * PolicyType - Replacement policy selectable at runtime
+ */
+enum class PolicyType {
+    LRU,
+    FIFO,
+    RANDOM,
+    PLRU,
+    SRRIP,
+    BRRIP,
+    DRRIP,
+    SHIP,
+    ARC
+};
+
+inline const char* policy_name(PolicyType type) {
+    switch (type) {
+        case PolicyType::LRU:    return "LRU";
+        case PolicyType::FIFO:   return "FIFO";
+        case PolicyType::RANDOM: return "Random";
+        case PolicyType::PLRU:   return "Pseudo-LRU";
+        case PolicyType::SRRIP:  return "SRRIP";
+        case PolicyType::BRRIP:  return "BRRIP";
+        case PolicyType::DRRIP:  return "DRRIP";
+        case PolicyType::SHIP:   return "SHiP";
+        case PolicyType::ARC:    return "ARC";
+    }
+    return "?";
+}
+
+/**
+ * ReplacementPolicy - Any runtime-ways policy, dispatched with std::visit
+ *
+ * Callers visit once per access with a generic lambda, so the policy calls
+ * inside are direct (inlinable) calls rather than virtual ones.
+ */
+using ReplacementPolicy = std::variant<
+    LRUPolicy<DYNAMIC_WAYS>,
+    FIFOPolicy<DYNAMIC_WAYS>,
+    RandomPolicy<DYNAMIC_WAYS>,
+    PseudoLRUPolicy<DYNAMIC_WAYS>,
+    SRRIPPolicy<DYNAMIC_WAYS>,
+    BRRIPPolicy<DYNAMIC_WAYS>,
+    DRRIPPolicy<DYNAMIC_WAYS>,
+    SHiPPolicy<DYNAMIC_WAYS>,
+    ARCPolicy<DYNAMIC_WAYS>>;
+
+/**
+ * @param num_sets Sets whose per-set state the policy holds
+ * @param shared_sets Sets of the whole cache, sizing the cache-wide state
+ *                    (0 for a SPARSE page, which attaches to the cache's)
+ */
+inline ReplacementPolicy make_policy(PolicyType type, size_t num_sets, size_t ways,
+                                     size_t shared_sets) {
+    switch (type) {
+        case PolicyType::FIFO:
+            return ReplacementPolicy(std::in_place_type<FIFOPolicy<DYNAMIC_WAYS>>, num_sets, ways);
+        case PolicyType::RANDOM:
+            return ReplacementPolicy(std::in_place_type<RandomPolicy<DYNAMIC_WAYS>>, num_sets, ways);
+        case PolicyType::PLRU:
+            return ReplacementPolicy(std::in_place_type<PseudoLRUPolicy<DYNAMIC_WAYS>>, num_sets, ways);
+        case PolicyType::SRRIP:
+            return ReplacementPolicy(std::in_place_type<SRRIPPolicy<DYNAMIC_WAYS>>, num_sets, ways);
+        case PolicyType::BRRIP:
+            return ReplacementPolicy(std::in_place_type<BRRIPPolicy<DYNAMIC_WAYS>>, num_sets, ways);
+        case PolicyType::DRRIP:
+            return ReplacementPolicy(std::in_place_type<DRRIPPolicy<DYNAMIC_WAYS>>, num_sets, ways,
+                                     shared_sets);
+        case PolicyType::SHIP:
+            return ReplacementPolicy(std::in_place_type<SHiPPolicy<DYNAMIC_WAYS>>, num_sets, ways,
+                                     shared_sets);
+        case PolicyType::ARC:
+            return ReplacementPolicy(std::in_place_type<ARCPolicy<DYNAMIC_WAYS>>, num_sets, ways);
+        case PolicyType::LRU:
+        default:
+            return ReplacementPolicy(std::in_place_type<LRUPolicy<DYNAMIC_WAYS>>, num_sets, ways);
+    }
+}
+
+inline ReplacementPolicy make_policy(PolicyType type, size_t num_sets, size_t ways) {
+    return make_policy(type, num_sets, ways, num_sets);
+}
+
+#endif // REPLACEMENT_POLICY_H
@@ -2,9 +2,16 @@
 #define SET_ASSOCIATIVE_CACHE_H
 
 #include <vector>
+#include <deque>
 #include <cstdint>
 #include <cstddef>
 #include "cache_set.h"
+#include "tag_store.h"
+#include "replacement_policy.h"
+
+#ifdef CACHESIM_INSTRUMENT
+class CacheInstrument;      // cache_instrument.h
+#endif
 
 /**
  * AccessType - Type of memory access
@@ -14,6 +21,37 @@ enum class AccessType {
     WRITE
 };
 
+/**
+ * TraceEntry - One access of an address trace
+ */
+struct TraceEntry {
+    uint64_t address;
+    AccessType type;
+};
+
+/**
+ * StorageMode - How per-line metadata is laid out in memory
+ *
+ * PER_SET: one CacheSet object per set (its lines), easy to inspect
+ * FLAT:    one contiguous TagStore for the whole cache, SIMD tag match
+ * SPARSE:  FLAT metadata in pages of 64 sets, allocated on first fill, for
+ *          huge caches (DRAM caches, big LLCs) that a trace only partly touches
+ */
+enum class StorageMode {
+    PER_SET,
+    FLAT,
+    SPARSE
+};
+
+inline const char* storage_name(StorageMode mode) {
+    switch (mode) {
+        case StorageMode::PER_SET: return "per-set";
+        case StorageMode::FLAT:    return "flat";
+        case StorageMode::SPARSE:  return "sparse";
+    }
+    return "?";
+}
+
 /**
  * AccessResult - Result of a cache access operation
  */
@@ -30,6 +68,31 @@ struct AccessResult {
           evicted_tag(0), set_index(0), way(-1) {}
 };
 
+/**
+ * CoherenceState - MESI/MOESI state of one line
+ *
+ * Packed into the metadata the cache already keeps, no extra per-line state:
+ *
+ *   state      valid  dirty  shared
+ *   INVALID      0      -      -
+ *   SHARED       1      0      1
+ *   EXCLUSIVE    1      0      0
+ *   OWNED        1      1      1      (MOESI only)
+ *   MODIFIED     1      1      0
+ *
+ * Fills clear the shared bit, so a cache that is never snooped only ever
+ * holds EXCLUSIVE (clean) and MODIFIED (dirty) lines.
+ */
+enum class CoherenceState {
+    INVALID,
+    SHARED,
+    EXCLUSIVE,
+    OWNED,
+    MODIFIED
+};
+
+const char* coherence_state_name(CoherenceState state);
+
 /**
  * CacheStats - Statistics for cache performance
  */
@@ -49,6 +112,16 @@ struct CacheStats {
         uint64_t total = hits + misses;
         return total > 0 ? static_cast<double>(hits) / total : 0.0;
     }
+    
+    CacheStats& operator+=(const CacheStats& other) {
+        hits += other.hits;
+        misses += other.misses;
+        reads += other.reads;
+        writes += other.writes;
+        evictions += other.evictions;
+        dirty_evictions += other.dirty_evictions;
+        return *this;
+    }
 };
 
 /**
@@ -71,16 +144,68 @@ private:
     size_t offset_bits;         // Number of bits for block offset
     size_t index_bits;          // Number of bits for set index
     size_t tag_bits;            // Number of bits for tag
+    uint64_t index_mask;        // (1 << index_bits) - 1, precomputed
+    size_t tag_shift;           // offset_bits + index_bits, precomputed
+    
+    StorageMode storage;        // Metadata layout
+    std::vector<CacheSet> sets; // The cache sets (PER_SET mode)
+    TagStore store;             // Flat metadata (FLAT mode)
+    PolicyType policy_type;     // Which replacement policy is active
+    ReplacementPolicy policy;   // Replacement state for every set
+    size_t first_set;           // Global index of set 0 (see set_first_set())
+    
+    /**
+     * SparsePage - page_sets consecutive sets of a SPARSE cache
+     * Same layout and policy code as FLAT, just cache-sized per page. The
+     * page policy's cache-wide state is the cache's own (see page_policy()).
+     */
+    struct SparsePage {
+        TagStore store;
+        ReplacementPolicy policy;
+        size_t directory_index;         // Its page_table entry
+    };
+    static constexpr size_t SPARSE_PAGE_SETS = 64;
+    size_t page_sets;                   // Sets per page (fewer for tiny caches)
+    size_t page_shift;                  // log2(page_sets)
+    std::vector<uint32_t> page_table;   // Set >> page_shift -> page + 1, 0 = untouched
+    std::deque<SparsePage> pages;       // Page arena; a deque never moves them
+    size_t pages_used;                  // pages[0..pages_used) are mapped
     
-    std::vector<CacheSet> sets; // The cache sets
     CacheStats stats;           // Performance statistics
+#ifdef CACHESIM_INSTRUMENT
+    CacheInstrument* instrument = nullptr;  // Per-set/interval counters (not owned)
+#endif
 
     // Helper functions
     uint64_t get_offset(uint64_t address) const;
     uint64_t get_set_index(uint64_t address) const;
     uint64_t get_tag(uint64_t address) const;
-    uint64_t reconstruct_address(uint64_t tag, uint64_t set_index) const;
     static size_t log2(size_t n);
+    template <typename Policy>
+    AccessResult access_with(Policy& repl, uint64_t address, AccessType type);
+    template <typename Policy>
+    int access_flat(Policy& repl, TagStore& ts, size_t row, uint64_t tag, AccessType type,
+                    AccessResult& result);
+    AccessResult access_sparse(uint64_t address, AccessType type);
+    template <typename Policy>
+    void access_batch_with(Policy& repl, const TraceEntry* entries, size_t n,
+                           AccessResult* results);
+    template <typename Policy>
+    void prefetch_set(const Policy& repl, uint64_t set_index) const;
+    template <typename Policy>
+    AccessResult install_with(Policy& repl, TagStore& ts, size_t row, uint64_t address,
+                              bool dirty);
+    const SparsePage* find_page(uint64_t set_index) const;
+    SparsePage& touch_page(uint64_t set_index);
+    ReplacementPolicy& page_policy(SparsePage& page);
+    const TagStore* find_store(uint64_t set_index, size_t& row) const;
+    TagStore* find_store(uint64_t set_index, size_t& row);
+    int find_way(uint64_t set_index, uint64_t tag) const;
+    bool set_has_valid(size_t set_idx) const;
+    static void save_policy(CheckpointWriter& out, const ReplacementPolicy& repl);
+    void restore_policy(CheckpointReader& in, ReplacementPolicy& repl, PolicyType saved,
+                        size_t policy_sets, size_t shared_sets);
+    void load(CheckpointReader& in);
 
 public:
     /**
@@ -89,8 +214,19 @@ public:
      * @param block Block size in bytes (must be power of 2)
      * @param assoc Associativity (1 = direct-mapped, N = N-way)
      * @param addr_bits Address size in bits (default 32)
+     * @param mode Metadata layout (default PER_SET; FLAT and SPARSE need assoc <= 64)
+     * @param policy_kind Replacement policy (default LRU)
+     * @param verbose Print the configuration on construction (default true)
+     */
+    SetAssociativeCache(size_t size, size_t block, size_t assoc, size_t addr_bits = 32,
+                        StorageMode mode = StorageMode::PER_SET,
+                        PolicyType policy_kind = PolicyType::LRU,
+                        bool verbose = true);
+    
+    /**
+     * Print cache geometry and address bit fields
      */
-    SetAssociativeCache(size_t size, size_t block, size_t assoc, size_t addr_bits = 32);
+    void print_config() const;
     
     /**
      * Access the cache (read or write)
@@ -100,6 +236,74 @@ public:
      */
     AccessResult access(uint64_t address, AccessType type);
     
+    /**
+     * Access a contiguous run of requests, same result as calling access()
+     * on each in order. Set indices are decoded a chunk at a time and each
+     * target set is prefetched a few requests ahead, so the misses the
+     * simulator takes on its own metadata overlap instead of serializing.
+     * @param entries Requests to replay
+     * @param n Number of requests
+     * @param results Optional output buffer of n results (nullptr = stats only)
+     */
+    void access_batch(const TraceEntry* entries, size_t n, AccessResult* results = nullptr);
+    void access_batch(const std::vector<TraceEntry>& entries,
+                      AccessResult* results = nullptr) {
+        access_batch(entries.data(), entries.size(), results);
+    }
+    
+    // ========================================================================
+    // Multi-level support (used by CacheHierarchy)
+    // These don't count as demand accesses: reads/writes/hits/misses are
+    // left alone, evictions caused by install() are still counted.
+    // ========================================================================
+    
+    /**
+     * Check whether the block holding address is resident (no state change)
+     * @param address Memory address
+     * @return true if a valid line holds the block
+     */
+    bool probe(uint64_t address) const;
+    
+    /**
+     * Drop the block holding address, if resident
+     * @param address Memory address
+     * @param was_dirty Set to the line's dirty bit when it was resident
+     * @param way Set to the way the block was in when it was resident
+     * @return true if a line was invalidated
+     */
+    bool invalidate(uint64_t address, bool* was_dirty = nullptr, int* way = nullptr);
+    
+    /**
+     * Place a block arriving from another level (fill or write-back)
+     * A resident block is touched and its dirty bit OR-ed with dirty;
+     * otherwise a line is allocated exactly like a demand miss.
+     * @param address Memory address
+     * @param dirty Whether the incoming data is dirty
+     * @return AccessResult (hit = was resident) with eviction details
+     */
+    AccessResult install(uint64_t address, bool dirty);
+    
+    /**
+     * Coherence state of the block holding address (no state change)
+     * @return INVALID if the block isn't resident
+     */
+    CoherenceState coherence_state(uint64_t address) const;
+    
+    /**
+     * Change the coherence state of a resident block (snoop transitions)
+     * Replacement state and stats are left alone; INVALID drops the line.
+     * @param address Memory address
+     * @param state New state
+     * @return false if the block isn't resident
+     */
+    bool set_coherence_state(uint64_t address, CoherenceState state);
+    
+    /**
+     * Reconstruct an address from tag and set index (offset = 0)
+     * e.g. the victim block of a miss: reconstruct_address(r.evicted_tag, r.set_index)
+     */
+    uint64_t reconstruct_address(uint64_t tag, uint64_t set_index) const;
+    
     /**
      * Print contents of a specific set (for debugging)
      * @param set_idx Set index to display
@@ -108,9 +312,20 @@ public:
     
     /**
      * Print all non-empty cache contents
+     * Fine for a toy cache; for real runs build with CACHESIM_INSTRUMENT and
+     * attach a CacheInstrument instead (per-set heatmap and interval CSVs).
      */
     void print_all_contents() const;
     
+#ifdef CACHESIM_INSTRUMENT
+    /**
+     * Feed every demand access and fill eviction to an instrument
+     * @param inst Sized for get_num_sets() sets, or nullptr to detach
+     */
+    void set_instrument(CacheInstrument* inst) { instrument = inst; }
+    CacheInstrument* get_instrument() const { return instrument; }
+#endif
+    
     /**
      * Get cache statistics
      */
@@ -118,9 +333,36 @@ public:
     
     /**
      * Reset cache to initial state
+     * O(1) for FLAT and SPARSE (epoch bump, sets cleared on their next
+     * fill); PER_SET clears every set in place. Nothing is freed.
      */
     void reset();
     
+    /**
+     * Write the full warm state: stats, every line and the replacement state
+     * (an attached instrument is not part of it)
+     */
+    void save(CheckpointWriter& out) const;
+    
+    /**
+     * Replace this cache's state with a saved one
+     * Size, block, associativity, address bits and storage mode must match.
+     * A snapshot taken under another replacement policy restores the lines
+     * and stats and starts this cache's policy cold, for policy what-ifs
+     * from one warmed state. The snapshot is decoded into a copy, so a
+     * failed restore leaves this cache as it was.
+     * @throws std::invalid_argument on a geometry mismatch
+     * @throws std::runtime_error on a truncated or corrupt snapshot
+     */
+    void restore(CheckpointReader& in);
+    
+    /**
+     * Number the sets from first, as one slice of a larger cache
+     * RANDOM then draws the victims the whole cache would for the same sets
+     * (ShardedSimulator gives each shard its first global set).
+     */
+    void set_first_set(size_t first);
+    
     // Getters for cache parameters
     size_t get_cache_size() const { return cache_size; }
     size_t get_block_size() const { return block_size; }
@@ -130,6 +372,15 @@ public:
     size_t get_offset_bits() const { return offset_bits; }
     size_t get_index_bits() const { return index_bits; }
     size_t get_tag_bits() const { return tag_bits; }
+    StorageMode get_storage_mode() const { return storage; }
+    
+    /**
+     * Sets whose metadata is allocated (num_sets except in SPARSE mode)
+     */
+    size_t get_allocated_sets() const {
+        return storage == StorageMode::SPARSE ? pages_used * page_sets : num_sets;
+    }
+    PolicyType get_policy_type() const { return policy_type; }
 };
 
 #endif // SET_ASSOCIATIVE_CACHE_H
@@ -0,0 +1,181 @@
+#ifndef SPATIAL_SAMPLER_H
+#define SPATIAL_SAMPLER_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "set_associative_cache.h"
+#include "stack_distance.h"
+
+/**
+ * SpatialSampler - SHARDS-style hash-based spatial sampling
+ *
+ * A block is kept iff hash(block) mod P < T, so every access to a sampled
+ * block is kept and every access to any other block is dropped. The sample
+ * rate is R = T / P. Reuse behaviour of the kept blocks is preserved, which
+ * is what makes scaled-down simulation accurate (Waldspurger et al.,
+ * "Efficient MRC Construction with SHARDS", FAST '15).
+ *
+ * Sampled blocks are also split into NUM_GROUPS independent groups by
+ * further hash bits; estimators use the spread between groups for their
+ * confidence intervals.
+ */
+class SpatialSampler {
+public:
+    static constexpr uint64_t MODULUS_BITS = 24;
+    static constexpr uint64_t MODULUS = 1ULL << MODULUS_BITS;
+    static constexpr size_t NUM_GROUPS = 32;
+
+    /**
+     * @param rate Fraction of blocks to keep, in (0, 1]
+     * @param block_size Block size in bytes (sampling is per block)
+     * @param seed Hash seed (different seeds give independent samples)
+     */
+    explicit SpatialSampler(double rate, size_t block_size = 64, uint64_t seed = 0);
+
+    /**
+     * Whether accesses to this address are part of the sample
+     */
+    bool sample(uint64_t address) const {
+        return (hash(address) & (MODULUS - 1)) < threshold;
+    }
+
+    /**
+     * Group (0 .. NUM_GROUPS-1) of a sampled address
+     */
+    size_t group(uint64_t address) const {
+        return static_cast<size_t>((hash(address) >> MODULUS_BITS) % NUM_GROUPS);
+    }
+
+    /** Exact sample rate T / P */
+    double get_rate() const { return static_cast<double>(threshold) / MODULUS; }
+
+private:
+    uint64_t threshold;
+    size_t block_shift;
+    uint64_t seed;
+
+    /** splitmix64 finalizer over the block address */
+    uint64_t hash(uint64_t address) const {
+        uint64_t z = (address >> block_shift) ^ seed;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+};
+
+/**
+ * HitRateEstimate - Sampled hit rate with a confidence interval
+ */
+struct HitRateEstimate {
+    double hit_rate;        // Point estimate
+    double lower;           // Confidence interval bounds
+    double upper;
+    double confidence;      // e.g. 0.95
+    uint64_t samples;       // Sampled accesses behind the estimate
+};
+
+/**
+ * SampledCache - Miniature simulation of a SetAssociativeCache
+ *
+ * Sampled accesses drive a cache with the same block size and
+ * associativity but R times the sets, which behaves like the full cache
+ * under the full trace. The rate is rounded to a power-of-two fraction so
+ * the miniature geometry is exact (1% becomes 1/128).
+ *
+ * get_stats() scales counts back up to full-trace estimates;
+ * hit_rate_estimate() adds a confidence interval.
+ */
+class SampledCache {
+private:
+    SpatialSampler sampler;
+    SetAssociativeCache mini;
+    uint64_t seen;                          // All accesses offered
+    std::vector<uint64_t> group_accesses;
+    std::vector<uint64_t> group_hits;
+
+public:
+    /**
+     * @param size Full cache size in bytes
+     * @param block Block size in bytes
+     * @param assoc Associativity
+     * @param rate Requested sample rate in (0, 1]
+     * @param addr_bits Address size in bits (default 32)
+     * @param mode Metadata layout (default FLAT)
+     * @param policy_kind Replacement policy (default LRU)
+     * @param seed Sampling hash seed
+     */
+    SampledCache(size_t size, size_t block, size_t assoc, double rate, size_t addr_bits = 32,
+                 StorageMode mode = StorageMode::FLAT, PolicyType policy_kind = PolicyType::LRU,
+                 uint64_t seed = 0);
+
+    /**
+     * Offer one access; only sampled blocks reach the miniature cache
+     * @return true if the access was sampled
+     */
+    bool access(uint64_t address, AccessType type);
+
+    /**
+     * Full-trace estimates: sampled counts divided by the rate
+     */
+    CacheStats get_stats() const;
+
+    /**
+     * Hit rate with a confidence interval from the spread between
+     * NUM_GROUPS independent sample groups
+     * @param confidence Two-sided confidence level (default 0.95)
+     */
+    HitRateEstimate hit_rate_estimate(double confidence = 0.95) const;
+
+    double get_rate() const { return sampler.get_rate(); }
+    uint64_t get_seen() const { return seen; }
+    uint64_t get_sampled() const { return mini.get_stats().hits + mini.get_stats().misses; }
+    const SetAssociativeCache& get_miniature() const { return mini; }
+};
+
+/**
+ * SampledStackDistance - StackDistance over a spatial sample
+ *
+ * Distances measured among sampled blocks are scaled by 1/R, so
+ * hit_rate(C) for the full trace is the sampled hit rate at C * R blocks.
+ */
+class SampledStackDistance {
+private:
+    SpatialSampler sampler;
+    StackDistance engine;
+    uint64_t seen;
+
+public:
+    /**
+     * @param rate Sample rate in (0, 1]
+     * @param block_size Block size in bytes
+     * @param seed Sampling hash seed
+     */
+    explicit SampledStackDistance(double rate, size_t block_size = 64, uint64_t seed = 0);
+
+    /**
+     * Offer one access
+     * @return Scaled reuse distance, INFINITE_DISTANCE for a first access,
+     *         or NOT_SAMPLED if the block is outside the sample
+     */
+    int64_t access(uint64_t address);
+
+    static constexpr int64_t NOT_SAMPLED = -2;
+
+    /** Estimated LRU hit rate of a cache holding `blocks` blocks */
+    double hit_rate(size_t blocks) const;
+
+    /** curve[c] = estimated miss ratio with c blocks, c = 0 .. max_blocks */
+    std::vector<double> miss_ratio_curve(size_t max_blocks) const;
+
+    double get_rate() const { return sampler.get_rate(); }
+    uint64_t get_seen() const { return seen; }
+    const StackDistance& get_engine() const { return engine; }
+};
+
+/**
+ * Two-sided standard normal quantile for a confidence level (0.95 -> 1.96)
+ */
+double normal_critical_value(double confidence);
+
+#endif // SPATIAL_SAMPLER_H
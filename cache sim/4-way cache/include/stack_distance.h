@@ -0,0 +1,93 @@
+#ifndef STACK_DISTANCE_H
+#define STACK_DISTANCE_H
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * StackDistance - Single-pass Mattson stack-distance (reuse distance) engine
+ *
+ * The reuse distance of an access is the number of distinct blocks touched
+ * since the previous access to the same block (-1 for a first access). An
+ * LRU cache of C blocks hits exactly the accesses with distance < C, so one
+ * pass over a trace yields the miss ratio of every cache size at once.
+ *
+ * Each block keeps only its last-access timestamp. A Fenwick tree marks the
+ * timestamps that are still some block's most recent access, so
+ *   distance = number of marks between the previous access and now
+ * costs O(log n). When the timestamp space fills up, live timestamps are
+ * renumbered in order (amortized O(1) per access).
+ *
+ * With num_sets > 1 every set gets its own stack (set = block % num_sets),
+ * giving the hit ratio of a set-associative LRU cache per number of ways.
+ */
+class StackDistance {
+public:
+    static constexpr int64_t INFINITE_DISTANCE = -1;
+
+    /**
+     * @param block_size Block size in bytes (addresses in a block share a stack entry)
+     * @param num_sets 1 = fully associative, N = per-set stacks
+     */
+    explicit StackDistance(size_t block_size = 64, size_t num_sets = 1);
+
+    /**
+     * Record one access
+     * @param address Byte address
+     * @return Reuse distance in blocks, or INFINITE_DISTANCE for a first access
+     */
+    int64_t access(uint64_t address);
+
+    /**
+     * Histogram of finite distances: histogram()[d] = accesses with distance d
+     */
+    const std::vector<uint64_t>& histogram() const { return hist; }
+
+    uint64_t get_cold_misses() const { return cold_misses; }
+    uint64_t get_total_accesses() const { return total; }
+
+    /**
+     * LRU hit ratio of a cache holding `blocks` blocks per stack
+     * (total blocks when fully associative, ways when per-set)
+     */
+    double hit_rate(size_t blocks) const;
+
+    /**
+     * Miss ratio for every size from 0 to max_blocks (0 = largest distance + 1)
+     * @return curve[c] = miss ratio with c blocks per stack
+     */
+    std::vector<double> miss_ratio_curve(size_t max_blocks = 0) const;
+
+    /**
+     * Forget all history
+     */
+    void reset();
+
+    size_t get_block_size() const { return block_size; }
+    size_t get_num_sets() const { return stacks.size(); }
+
+private:
+    /**
+     * One LRU stack: last access time per block plus a Fenwick tree over time
+     */
+    struct Stack {
+        std::unordered_map<uint64_t, uint64_t> last_access;
+        std::vector<uint32_t> tree;     // 1-based Fenwick tree, tree.size() - 1 slots
+        uint64_t now = 0;               // Next timestamp
+
+        void add(uint64_t t, int32_t delta);
+        uint64_t prefix(uint64_t t) const;  // Marks in [0, t]
+        void compact();
+    };
+
+    size_t block_size;
+    size_t block_shift;
+    std::vector<Stack> stacks;
+    std::vector<uint64_t> hist;
+    uint64_t cold_misses;
+    uint64_t total;
+};
+
+#endif // STACK_DISTANCE_H
@@ -0,0 +1,235 @@
+#ifndef TAG_STORE_H
+#define TAG_STORE_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+#include <algorithm>
+#include "checkpoint.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/**
+ * TagStore - Flat structure-of-arrays metadata for every set in a cache
+ *
+ * Instead of one heap-allocated CacheSet per set, all metadata lives in a
+ * handful of contiguous arrays indexed by set:
+ *
+ *   tags   [set * tag_stride + way]   uint64_t tag per way (padded to 4 ways)
+ *   valid  [set]                      bitmask, bit w = way w holds a block
+ *   dirty  [set]                      bitmask, bit w = way w needs write-back
+ *   shared [set]                      bitmask, bit w = other caches may hold way w
+ *   stamp  [set]                      epoch the set was last filled in
+ *
+ * Together the three masks encode a line's MESI/MOESI state in 3 bits (see
+ * CoherenceState); caches that are never snooped leave `shared` clear.
+ *
+ * Tag matching compares all ways of a set with vector compares (AVX2 or
+ * NEON) and falls back to a scalar loop elsewhere. Replacement state lives
+ * in the cache's ReplacementPolicy, which is packed per set the same way.
+ *
+ * reset() is O(1): it bumps the epoch, and a set whose stamp is older
+ * reads as empty. The first fill in the new epoch calls renew(), which
+ * clears the set's masks then (the cache resets its policy state with it).
+ *
+ * Supports up to 64 ways (the width of the valid/dirty bitmasks).
+ */
+class TagStore {
+public:
+    static constexpr size_t MAX_WAYS = 64;
+
+    TagStore() : num_sets(0), num_ways(0), tag_stride(0), way_mask(0), epoch(0) {}
+
+    /**
+     * Allocate metadata for the given geometry
+     * @param sets Number of sets
+     * @param ways Number of ways per set (1..64)
+     */
+    TagStore(size_t sets, size_t ways)
+        : num_sets(sets), num_ways(ways),
+          tag_stride((ways + 3) & ~size_t(3)),
+          way_mask(ways == 64 ? ~0ULL : ((1ULL << ways) - 1)),
+          epoch(0),
+          tags(sets * tag_stride, 0),
+          valid(sets, 0),
+          dirty(sets, 0),
+          shared(sets, 0),
+          stamp(sets, 0) {
+        assert(ways > 0 && ways <= MAX_WAYS && "TagStore supports 1..64 ways");
+    }
+
+    /**
+     * Search all ways of a set for a matching valid tag
+     * @param set Set index
+     * @param tag The tag to search for
+     * @return Way index if found, -1 if not found
+     */
+    int find_line(size_t set, uint64_t tag) const {
+        uint64_t match = match_mask(set, tag) & live(set);
+        return match ? __builtin_ctzll(match) : -1;
+    }
+
+    /**
+     * Find an invalid (empty) way to fill
+     * @param set Set index
+     * @return Way index, or -1 if every way is valid
+     */
+    int find_invalid(size_t set) const {
+        uint64_t empty = ~live(set) & way_mask;
+        return empty ? __builtin_ctzll(empty) : -1;
+    }
+
+    /**
+     * Bring a set from an older epoch into the current one, empty
+     * Call before filling a set; lookups alone never need it.
+     * @return true if the set was stale (its policy state needs a reset too)
+     */
+    bool renew(size_t set) {
+        if (stamp[set] == epoch) {
+            return false;
+        }
+        stamp[set] = epoch;
+        valid[set] = 0;
+        dirty[set] = 0;
+        shared[set] = 0;
+        return true;
+    }
+
+    /** Install a block: mark way valid (not shared) with the given tag and dirty state */
+    void fill(size_t set, size_t way, uint64_t tag, bool is_dirty) {
+        tags[set * tag_stride + way] = tag;
+        uint64_t bit = 1ULL << way;
+        valid[set] |= bit;
+        dirty[set] = is_dirty ? (dirty[set] | bit) : (dirty[set] & ~bit);
+        shared[set] &= ~bit;
+    }
+
+    /** Invalidate a single way */
+    void invalidate(size_t set, size_t way) {
+        uint64_t bit = 1ULL << way;
+        valid[set] &= ~bit;
+        dirty[set] &= ~bit;
+        shared[set] &= ~bit;
+    }
+
+    void set_dirty(size_t set, size_t way) { dirty[set] |= 1ULL << way; }
+
+    /** Overwrite a valid way's dirty and shared bits (coherence transitions) */
+    void set_state(size_t set, size_t way, bool is_dirty, bool is_shared) {
+        uint64_t bit = 1ULL << way;
+        dirty[set] = is_dirty ? (dirty[set] | bit) : (dirty[set] & ~bit);
+        shared[set] = is_shared ? (shared[set] | bit) : (shared[set] & ~bit);
+    }
+
+    bool is_valid(size_t set, size_t way) const { return (live(set) >> way) & 1; }
+    bool is_dirty(size_t set, size_t way) const { return (dirty[set] >> way) & 1; }
+    bool is_shared(size_t set, size_t way) const { return (shared[set] >> way) & 1; }
+    uint64_t get_tag(size_t set, size_t way) const { return tags[set * tag_stride + way]; }
+    bool set_has_valid(size_t set) const { return live(set) != 0; }
+
+    /** Start pulling a set's tags and valid/dirty masks into the CPU cache */
+    void prefetch(size_t set) const {
+        __builtin_prefetch(&tags[set * tag_stride], 1);
+        __builtin_prefetch(&valid[set], 1);
+        __builtin_prefetch(&dirty[set], 1);
+        __builtin_prefetch(&shared[set], 1);
+        __builtin_prefetch(&stamp[set], 1);
+    }
+
+    /**
+     * Reset all sets to empty by starting a new epoch
+     * Only when the 32-bit epoch wraps are the stamps rewritten.
+     */
+    void reset() {
+        if (++epoch == 0) {
+            std::fill(stamp.begin(), stamp.end(), 0);
+            epoch = 1;
+        }
+    }
+
+    size_t get_num_ways() const { return num_ways; }
+
+    /** Write the epoch and every array, stale sets included */
+    void save(CheckpointWriter& out) const {
+        out.begin_section("TAGSTORE");
+        out.put(static_cast<uint64_t>(num_sets));
+        out.put(static_cast<uint64_t>(num_ways));
+        out.put(epoch);
+        out.put_vector(tags);
+        out.put_vector(valid);
+        out.put_vector(dirty);
+        out.put_vector(shared);
+        out.put_vector(stamp);
+        out.end_section();
+    }
+
+    /**
+     * Read back a store saved with the same geometry
+     * @throws std::invalid_argument if the sets or ways differ
+     */
+    void restore(CheckpointReader& in) {
+        in.enter_section("TAGSTORE");
+        in.expect(static_cast<uint64_t>(num_sets), "tag store sets");
+        in.expect(static_cast<uint64_t>(num_ways), "tag store ways");
+        epoch = in.get<uint32_t>();
+        in.get_vector(tags);
+        in.get_vector(valid);
+        in.get_vector(dirty);
+        in.get_vector(shared);
+        in.get_vector(stamp);
+        in.leave_section();
+    }
+
+private:
+    size_t num_sets;
+    size_t num_ways;
+    size_t tag_stride;      // Ways per set in tags[], rounded up to 4
+    uint64_t way_mask;      // Low num_ways bits set
+    uint32_t epoch;         // Current epoch; older stamps mean "empty"
+
+    std::vector<uint64_t> tags;
+    std::vector<uint64_t> valid;
+    std::vector<uint64_t> dirty;
+    std::vector<uint64_t> shared;
+    std::vector<uint32_t> stamp;
+
+    /** Valid mask of a set, or 0 if it belongs to an older epoch */
+    uint64_t live(size_t set) const { return stamp[set] == epoch ? valid[set] : 0; }
+
+    /**
+     * Compare a tag against every way of a set
+     * @return Bitmask with bit w set when tags[w] == tag (validity ignored)
+     */
+    uint64_t match_mask(size_t set, uint64_t tag) const {
+        const uint64_t* t = &tags[set * tag_stride];
+        uint64_t mask = 0;
+#if defined(__AVX2__)
+        const __m256i needle = _mm256_set1_epi64x(static_cast<long long>(tag));
+        for (size_t i = 0; i < tag_stride; i += 4) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(t + i));
+            __m256i eq = _mm256_cmpeq_epi64(v, needle);
+            mask |= static_cast<uint64_t>(_mm256_movemask_pd(_mm256_castsi256_pd(eq))) << i;
+        }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        const uint64x2_t needle = vdupq_n_u64(tag);
+        for (size_t i = 0; i < tag_stride; i += 2) {
+            uint64x2_t eq = vceqq_u64(vld1q_u64(t + i), needle);
+            mask |= (vgetq_lane_u64(eq, 0) & 1ULL) << i;
+            mask |= (vgetq_lane_u64(eq, 1) & 1ULL) << (i + 1);
+        }
+#else
+        for (size_t i = 0; i < num_ways; i++) {
+            mask |= static_cast<uint64_t>(t[i] == tag) << i;
+        }
+#endif
+        return mask & way_mask;
+    }
+};
+
+#endif // TAG_STORE_H
@@ -0,0 +1,220 @@
+#ifndef TLB_H
+#define TLB_H
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+#include <iostream>
+#include "set_associative_cache.h"
+#include "cache_hierarchy.h"
+
+/**
+ * PageSize - x86-64 page sizes
+ */
+enum class PageSize {
+    SIZE_4K,
+    SIZE_2M,
+    SIZE_1G
+};
+
+const char* page_size_name(PageSize size);
+
+/** log2 of the page size in bytes */
+inline unsigned page_shift(PageSize size) {
+    switch (size) {
+        case PageSize::SIZE_4K: return 12;
+        case PageSize::SIZE_2M: return 21;
+        case PageSize::SIZE_1G: return 30;
+    }
+    return 12;
+}
+
+/**
+ * TLBLevelConfig - Geometry and hit latency of one TLB
+ */
+struct TLBLevelConfig {
+    std::string name;
+    size_t entries;             // Translations held (power of 2)
+    size_t assoc;               // Number of ways
+    PolicyType policy;          // Replacement policy
+    uint32_t hit_latency;       // Cycles to translate on a hit here
+
+    TLBLevelConfig(const std::string& name, size_t entries, size_t assoc,
+                   uint32_t hit_latency, PolicyType policy = PolicyType::LRU)
+        : name(name), entries(entries), assoc(assoc), policy(policy),
+          hit_latency(hit_latency) {}
+};
+
+/**
+ * MMUConfig - TLB levels, page sizes and walk timing
+ *
+ * The OS maps each page_size-aligned region with one page_size page, except
+ * that with huge_fraction < 1 only that share of the regions (picked by a
+ * hash of the region number, so the choice is repeatable) gets a huge page;
+ * the rest are mapped with 4K pages. SIZE_4K ignores huge_fraction.
+ *
+ * cache_latency[i] is charged for a page-walk reference that hits
+ * hierarchy level i (the last entry covers deeper levels), memory_latency
+ * for one that goes to memory.
+ */
+struct MMUConfig {
+    TLBLevelConfig itlb = TLBLevelConfig("ITLB", 64, 8, 1);
+    TLBLevelConfig dtlb = TLBLevelConfig("DTLB", 64, 4, 1);
+    TLBLevelConfig stlb = TLBLevelConfig("STLB", 1024, 8, 8);
+    PageSize page_size = PageSize::SIZE_4K;
+    double huge_fraction = 1.0;
+    std::vector<uint32_t> cache_latency = {4, 12, 40};
+    uint32_t memory_latency = 200;
+};
+
+/**
+ * TLB - One translation buffer on the FLAT set-associative engine
+ *
+ * Entries are keyed by virtual page number, with the page size in the top
+ * two bits so a 4K and a 2M translation never alias. The set index is the
+ * low VPN bits for every page size, so the sizes share the sets (like a
+ * unified STLB). A lookup that misses installs the translation, which is
+ * what a fill after the walk does.
+ */
+class TLB {
+private:
+    SetAssociativeCache entries;
+    std::string name;
+    uint32_t hit_latency;
+
+public:
+    explicit TLB(const TLBLevelConfig& config);
+
+    static uint64_t key(uint64_t vaddr, PageSize size) {
+        return (vaddr >> page_shift(size)) | (static_cast<uint64_t>(size) << 62);
+    }
+
+    /**
+     * Look up a translation, filling it on a miss
+     * @return True on a hit
+     */
+    bool lookup(uint64_t key) { return entries.access(key, AccessType::READ).hit; }
+
+    bool probe(uint64_t key) const { return entries.probe(key); }
+    void reset() { entries.reset(); }
+
+    CacheStats get_stats() const { return entries.get_stats(); }
+    const std::string& get_name() const { return name; }
+    uint32_t get_hit_latency() const { return hit_latency; }
+    size_t get_entries() const { return entries.get_cache_size(); }
+    size_t get_associativity() const { return entries.get_associativity(); }
+};
+
+/**
+ * TranslationResult - Outcome of one access through the MMU
+ */
+struct TranslationResult {
+    uint64_t paddr;             // Physical address sent to the caches
+    PageSize page;              // Size of the page that maps it
+    size_t tlb_level;           // 0: ITLB/DTLB, 1: STLB, 2: page walk
+    uint64_t translation_cycles;// TLB hit latency, or the walk's latency
+    HierarchyResult cache;      // The data access itself
+
+    TranslationResult()
+        : paddr(0), page(PageSize::SIZE_4K), tlb_level(0), translation_cycles(0) {}
+};
+
+/**
+ * MMUStats - Translation and page-walk counters
+ */
+struct MMUStats {
+    uint64_t translations;
+    uint64_t walks;
+    uint64_t walk_refs;                 // Page-table entries read by walks
+    uint64_t walk_cycles;               // Sum of walk latencies
+    uint64_t max_walk_cycles;
+    uint64_t translation_cycles;        // All cycles spent translating
+    std::vector<uint64_t> walk_ref_hits;// Walk references served per level (last: memory)
+    uint64_t pages[3];                  // Pages mapped, by PageSize
+
+    MMUStats()
+        : translations(0), walks(0), walk_refs(0), walk_cycles(0), max_walk_cycles(0),
+          translation_cycles(0), pages{0, 0, 0} {}
+
+    double avg_walk_cycles() const {
+        return walks > 0 ? static_cast<double>(walk_cycles) / walks : 0.0;
+    }
+};
+
+/**
+ * MMU - Multi-level TLB and page walker in front of a CacheHierarchy
+ *
+ * Trace addresses are virtual. Instruction fetches look up the ITLB and data
+ * accesses the DTLB; both miss into the unified STLB, and an STLB miss walks
+ * an x86-64 style four-level radix page table:
+ *
+ *   PML4 [47:39] -> PDPT [38:30] -> PD [29:21] -> PT [20:12]
+ *                   1G leaf         2M leaf       4K leaf
+ *
+ * Each step reads one 8-byte entry, and that read goes through the cache
+ * hierarchy like any other access, so walks compete with the data for the
+ * caches and hit there when the tables are warm. A walk's latency is the
+ * sum of the latencies of the levels its references hit. Misses fill the
+ * STLB and the first-level TLB (non-inclusive).
+ *
+ * Pages and page-table nodes are given physical frames on first touch from
+ * a bump allocator, each aligned to its size. The hierarchy isn't owned and
+ * is shared with whoever else drives it.
+ */
+class MMU {
+private:
+    CacheHierarchy& hierarchy;
+    MMUConfig config;
+    TLB itlb;
+    TLB dtlb;
+    TLB stlb;
+    uint64_t next_frame;                                // Bump allocator
+    std::unordered_map<uint64_t, uint64_t> frames;      // TLB::key -> page frame
+    std::unordered_map<uint64_t, uint64_t> tables;      // Level and VA prefix -> table
+    MMUStats stats;
+
+    uint64_t allocate(unsigned shift);
+    uint64_t frame_of(uint64_t key, PageSize size);
+    uint64_t table_of(unsigned level, uint64_t vaddr);
+    uint32_t latency_of(size_t hit_level) const;
+    uint64_t walk(uint64_t vaddr, PageSize size);
+
+public:
+    /**
+     * @param hierarchy Caches that data and page-walk references go through
+     * @param config TLB geometry, paging and walk timing
+     */
+    MMU(CacheHierarchy& hierarchy, const MMUConfig& config = MMUConfig());
+
+    /**
+     * Translate a virtual address and access the hierarchy with it
+     * @param vaddr Virtual address
+     * @param type Read or write
+     * @param fetch Instruction fetch (ITLB) rather than data (DTLB)
+     */
+    TranslationResult access(uint64_t vaddr, AccessType type, bool fetch = false);
+
+    /** Size of the page that maps vaddr (mapped or not yet) */
+    PageSize page_of(uint64_t vaddr) const;
+
+    /**
+     * Print per-TLB hit rates, walk latency and where walk references hit
+     */
+    void print_report(std::ostream& out) const;
+
+    /**
+     * Empty the TLBs, unmap everything and clear all counters
+     * The hierarchy is the caller's to reset.
+     */
+    void reset();
+
+    const TLB& get_itlb() const { return itlb; }
+    const TLB& get_dtlb() const { return dtlb; }
+    const TLB& get_stlb() const { return stlb; }
+    const MMUStats& get_stats() const { return stats; }
+    const MMUConfig& get_config() const { return config; }
+};
+
+#endif // TLB_H
@@ -0,0 +1,138 @@
+#ifndef WORKING_SET_H
+#define WORKING_SET_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * HyperLogLog - Fixed-size distinct-count sketch
+ *
+ * 2^precision one-byte registers. Each key is hashed; the top precision
+ * bits pick a register, which keeps the longest run of leading zeros seen
+ * in the remaining bits. The standard error is about 1.04 / sqrt(2^precision)
+ * (0.8% at the default 14, in 16 KB) however many keys are added. Small
+ * counts use linear counting over the empty registers.
+ *
+ * Sketches of the same precision merge by taking the register-wise maximum,
+ * which is what lets trace chunks be counted in parallel.
+ */
+class HyperLogLog {
+public:
+    static constexpr unsigned MIN_PRECISION = 4;
+    static constexpr unsigned MAX_PRECISION = 18;
+
+    /**
+     * @param precision log2 of the register count (MIN_PRECISION..MAX_PRECISION)
+     * @throws std::invalid_argument outside that range
+     */
+    explicit HyperLogLog(unsigned precision = 14);
+
+    void add(uint64_t key);
+
+    /**
+     * Fold another sketch into this one
+     * @throws std::invalid_argument if the precisions differ
+     */
+    void merge(const HyperLogLog& other);
+
+    double estimate() const;
+    void clear();
+
+    unsigned get_precision() const { return precision; }
+
+private:
+    unsigned precision;
+    std::vector<uint8_t> registers;
+};
+
+/**
+ * FootprintCurve - Average working set of every window of each length
+ */
+struct FootprintCurve {
+    uint64_t accesses;
+    uint64_t unique_blocks;             // Distinct blocks in the whole trace
+    std::vector<size_t> windows;        // Window lengths, ascending
+    std::vector<double> footprint;      // footprint[i]: mean distinct blocks per window
+
+    FootprintCurve() : accesses(0), unique_blocks(0) {}
+};
+
+/**
+ * WorkingSetAnalyzer - Working-set size and footprint of a trace, in parallel
+ *
+ * All analyses split the trace into one chunk per thread and merge:
+ *
+ *   sliding(): distinct blocks in each window of `window` consecutive
+ *     accesses. Each thread slides over its share of the window positions,
+ *     keeping a count per block in a flat open-addressing table; a step
+ *     adds the new block and drops the oldest (O(1)). A thread starts
+ *     window - 1 accesses early to fill its first window, and the outputs
+ *     are concatenated.
+ *
+ *   footprint(): the all-window footprint fp(w), the mean number of
+ *     distinct blocks over all n - w + 1 windows of length w, for every
+ *     requested w at once (Xiang et al.):
+ *
+ *       fp(w) = m - ( sum over first-access times f > w of (f - w)
+ *                   + sum over reverse last-access times l > w of (l - w)
+ *                   + sum over reuse times t > w of (t - w) ) / (n - w + 1)
+ *
+ *     Each thread records the first and last access of every block in its
+ *     chunk, plus the reuse times inside it. The merge walks the chunks in
+ *     order and adds the reuse times across chunk boundaries.
+ *
+ *   estimate_windows(): HyperLogLog count of each tumbling window, for
+ *     windows too large for an exact table. sketch() merges per-chunk
+ *     sketches of the whole trace.
+ *
+ * Results don't depend on the thread count.
+ */
+class WorkingSetAnalyzer {
+public:
+    /**
+     * @param block_size Block size in bytes (power of 2)
+     * @param threads Worker threads (0 = hardware concurrency)
+     */
+    explicit WorkingSetAnalyzer(size_t block_size = 64, size_t threads = 0);
+
+    /**
+     * Distinct blocks in every window of consecutive accesses
+     * @return n - window + 1 sizes, result[i] for accesses [i, i + window);
+     *         one size (of the whole trace) when n < window
+     * @throws std::invalid_argument if window is 0
+     */
+    std::vector<uint32_t> sliding(const uint64_t* trace, size_t n, size_t window) const;
+
+    /**
+     * Footprint at each window length (lengths outside 1..n are dropped)
+     */
+    FootprintCurve footprint(const uint64_t* trace, size_t n,
+                             const std::vector<size_t>& windows) const;
+
+    /** Exact number of distinct blocks */
+    uint64_t unique_blocks(const uint64_t* trace, size_t n) const;
+
+    /** Distinct blocks as a HyperLogLog sketch (merged across threads) */
+    HyperLogLog sketch(const uint64_t* trace, size_t n, unsigned precision = 14) const;
+
+    /**
+     * Estimated distinct blocks of each window [k * window, (k + 1) * window)
+     * (the last window may be shorter)
+     * @throws std::invalid_argument if window is 0
+     */
+    std::vector<double> estimate_windows(const uint64_t* trace, size_t n, size_t window,
+                                         unsigned precision = 14) const;
+
+    size_t get_block_size() const { return size_t(1) << block_shift; }
+    size_t get_num_threads() const { return num_threads; }
+
+private:
+    unsigned block_shift;
+    size_t num_threads;
+
+    /** Threads worth starting for n items of work */
+    size_t threads_for(size_t n) const;
+};
+
+#endif // WORKING_SET_H
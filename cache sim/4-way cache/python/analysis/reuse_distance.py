@@ -13,6 +13,12 @@ import matplotlib.pyplot as plt
 from collections import OrderedDict
 from typing import List, Dict, Tuple, Optional
 
+try:
+    # Native engines, built by CMake in cache sim/4-way cache
+    import cachesim
+except ImportError:
+    cachesim = None
+
 
 def load_trace(filename: str) -> List[int]:
     """
@@ -113,6 +119,21 @@ def compute_reuse_distance_fast(trace: List[int], block_size: int = 64) -> List[
     return distances
 
 
+def compute_reuse_distance_native(trace: List[int], block_size: int = 64) -> List[int]:
+    """
+    Same result as compute_reuse_distance(), in O(n log n).
+    
+    Uses the native cachesim module, a Fenwick tree over
+    last-access times, when it is importable, otherwise falls back to
+    compute_reuse_distance_fast(). Put the CMake build directory on
+    PYTHONPATH to enable it. cachesim reads a NumPy uint64 array in place.
+    """
+    if cachesim is not None:
+        addresses = np.ascontiguousarray(trace, dtype=np.uint64)
+        return cachesim.reuse_distances(addresses, block_size=block_size).tolist()
+    return compute_reuse_distance_fast(trace, block_size)
+
+
 def compute_reuse_histogram(distances: List[int], 
                             max_distance: int = 1000) -> Dict[int, int]:
     """
@@ -234,10 +255,19 @@ def predict_miss_rate_curve(distances: List[int],
         List of (cache_size, miss_rate) tuples
     """
     curve = []
+    if not distances:
+        return [(size, 1.0) for size in range(1, max_cache_blocks + 1)]
+    
+    # One pass: count distances, then accumulate hits for growing sizes
+    counts = [0] * max_cache_blocks
+    for d in distances:
+        if 0 <= d < max_cache_blocks:
+            counts[d] += 1
     
+    hits = 0
     for cache_size in range(1, max_cache_blocks + 1):
-        hit_rate = predict_hit_rate(distances, cache_size)
-        miss_rate = 1.0 - hit_rate
+        hits += counts[cache_size - 1]
+        miss_rate = 1.0 - hits / len(distances)
         curve.append((cache_size, miss_rate))
     
     return curve
@@ -252,7 +282,7 @@ def analyze_reuse_distance(trace: List[int], block_size: int = 64):
         block_size: Cache block size
     """
     print("Computing reuse distances...")
-    distances = compute_reuse_distance_fast(trace, block_size)
+    distances = compute_reuse_distance_native(trace, block_size)
     
     # Statistics
     finite = [d for d in distances if d >= 0]
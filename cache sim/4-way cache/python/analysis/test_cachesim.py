@@ -0,0 +1,196 @@
+#!/usr/bin/env python3
+"""
+Check the native cachesim module against brute-force Python models.
+
+Run by ctest with PYTHONPATH pointing at the built module; needs no
+third-party packages (array.array stands in for NumPy arrays, which go
+through the same buffer protocol).
+"""
+
+import random
+import sys
+from array import array
+
+import cachesim
+
+
+def brute_force_cache(trace, writes, size, block, assoc, fifo=False):
+    """Reference: per-set list of [tag, dirty], most recent last"""
+    num_sets = size // block // assoc
+    sets = [[] for _ in range(num_sets)]
+    hits, dirty_evictions = 0, 0
+    for addr, write in zip(trace, writes):
+        blk = addr // block
+        ways = sets[blk % num_sets]
+        line = next((l for l in ways if l[0] == blk), None)
+        if line:
+            hits += 1
+            if not fifo:
+                ways.remove(line)
+                ways.append(line)
+        else:
+            if len(ways) == assoc:
+                dirty_evictions += ways.pop(0)[1]
+            line = [blk, False]
+            ways.append(line)
+        line[1] |= bool(write)
+    return hits, dirty_evictions
+
+
+def brute_force_flags(trace, size, block, assoc):
+    """Per-access LRU hit flags"""
+    num_sets = size // block // assoc
+    sets = [[] for _ in range(num_sets)]
+    flags = []
+    for addr in trace:
+        blk = addr // block
+        ways = sets[blk % num_sets]
+        if blk in ways:
+            flags.append(1)
+            ways.remove(blk)
+        else:
+            flags.append(0)
+            if len(ways) == assoc:
+                ways.pop(0)
+        ways.append(blk)
+    return flags
+
+
+def brute_force_distances(trace, block_size=64, num_sets=1):
+    stacks = [[] for _ in range(num_sets)]
+    distances = []
+    for addr in trace:
+        blk = addr // block_size
+        stack = stacks[blk % num_sets]
+        if blk in stack:
+            distances.append(len(stack) - 1 - stack.index(blk))
+            stack.remove(blk)
+        else:
+            distances.append(-1)
+        stack.append(blk)
+    return distances
+
+
+def brute_force_working_set(trace, window, block_size=64):
+    blocks = [addr // block_size for addr in trace]
+    return [len(set(blocks[i:i + window])) for i in range(len(blocks) - window + 1)]
+
+
+def expect_error(kind, fn, *args, **kwargs):
+    try:
+        fn(*args, **kwargs)
+    except kind:
+        return
+    raise AssertionError(f"{fn.__name__}{args} should raise {kind.__name__}")
+
+
+def main():
+    rng = random.Random(7)
+    n = 20000
+    trace = [rng.randrange(1 << 15) & ~7 for _ in range(n)]
+    writes = bytes(1 if rng.random() < 0.3 else 0 for _ in range(n))
+    addrs = array('Q', trace)
+
+    # simulate() matches the reference for LRU and FIFO, every input layout agrees
+    for size, block, assoc in [(4096, 64, 4), (8192, 32, 8), (2048, 64, 1)]:
+        for policy, fifo in [("lru", False), ("fifo", True)]:
+            hits, dirty = brute_force_cache(trace, writes, size, block, assoc, fifo)
+            s = cachesim.simulate(addrs, size, block=block, assoc=assoc, policy=policy,
+                                  writes=writes)
+            assert (s.hits, s.dirty_evictions) == (hits, dirty), (size, assoc, policy)
+            assert s.accesses == n and s.misses == n - hits
+            assert abs(s.hit_rate - hits / n) < 1e-12
+
+    base = cachesim.simulate(addrs, 4096)
+    for layout in (trace, array('I', trace), array('q', trace), memoryview(addrs), iter(trace)):
+        assert cachesim.simulate(layout, 4096) == base
+    for storage in ("per-set", "sparse"):
+        assert cachesim.simulate(addrs, 4096, storage=storage) == base
+    for policy in cachesim.POLICIES:
+        s = cachesim.simulate(addrs, 4096, policy=policy, writes=writes)
+        assert s.accesses == n and s.writes == writes.count(1)
+
+    # Per-access hit flags land in the caller's buffer
+    hit_flags = bytearray(n)
+    s = cachesim.simulate(addrs, 4096, assoc=4, hits=hit_flags)
+    assert list(hit_flags) == brute_force_flags(trace, 4096, 64, 4)
+    assert sum(hit_flags) == s.hits
+
+    # hierarchy(): NINE L1 equals a lone cache, lower levels see L1's misses
+    h = cachesim.hierarchy(addrs, [(2048, 2), (8192, 4, "plru")], writes=writes)
+    l1, llc = h.levels
+    assert (l1.name, llc.name) == ("L1", "LLC") and llc.ways == 4
+    assert l1.hits == cachesim.simulate(addrs, 2048, assoc=2).hits
+    assert llc.accesses == l1.misses and h.memory_reads == llc.misses
+    incl = cachesim.hierarchy(addrs, [(2048, 2), (8192, 4)], inclusion="inclusive")
+    assert incl.levels[1].accesses == incl.levels[0].misses
+
+    # sweep(): one point per buildable configuration, each equal to simulate()
+    points = cachesim.sweep(addrs, sizes=[1024, 4096, 3000], assocs=[1, 4, 128],
+                            writes=writes, threads=3)
+    assert [(p.size, p.assoc) for p in points] == [(1024, 1), (1024, 4), (4096, 1), (4096, 4)]
+    for p in points:
+        s = cachesim.simulate(addrs, p.size, assoc=p.assoc, writes=writes)
+        assert (p.hits, p.misses, p.writebacks, p.policy) == (s.hits, s.misses,
+                                                            s.dirty_evictions, "lru")
+
+    # Stack distance comes back as typed memoryviews
+    small = trace[:3000]
+    d = cachesim.reuse_distances(array('Q', small))
+    assert d.format == 'q' and d.tolist() == brute_force_distances(small)
+    curve = cachesim.miss_ratio_curve(small, max_blocks=64)
+    assert curve.format == 'd' and len(curve) == 65 and curve[0] == 1.0
+    expect = brute_force_distances(small)
+    for c in (1, 8, 64):
+        hits = sum(1 for x in expect if 0 <= x < c)
+        assert abs(curve[c] - (1 - hits / len(small))) < 1e-12
+    for block_size, num_sets in [(32, 1), (64, 8)]:
+        expect = brute_force_distances(small, block_size, num_sets)
+        d = cachesim.reuse_distances(small, block_size=block_size, num_sets=num_sets)
+        assert d.tolist() == expect
+        curve = cachesim.miss_ratio_curve(small, block_size=block_size,
+                                          max_blocks=64, num_sets=num_sets)
+        for c in (1, 16, 64):
+            hits = sum(1 for x in expect if 0 <= x < c)
+            assert abs(curve[c] - (1 - hits / len(small))) < 1e-12
+    assert cachesim.reuse_distances(iter([0, 64, 0])).tolist() == [-1, -1, 1]
+
+    # Working sets: sliding sizes, footprint means, exact and estimated counts
+    ws = cachesim.working_set(array('I', small), 100)
+    assert ws.format == 'I' and ws.tolist() == brute_force_working_set(small, 100)
+    assert cachesim.working_set(addrs, 500, threads=4).tolist() == \
+        cachesim.working_set(addrs, 500, threads=1).tolist()
+    fp = cachesim.footprint(small, [0, 100, 10, 1 << 40])
+    assert fp.windows == [10, 100] and fp.accesses == len(small)
+    assert fp.unique_blocks == len({a // 64 for a in small})
+    for w, value in zip(fp.windows, fp.footprint):
+        sizes = brute_force_working_set(small, w)
+        assert abs(value - sum(sizes) / len(sizes)) < 1e-9
+    unique = cachesim.unique_blocks(addrs)
+    assert unique == len({a // 64 for a in trace})
+    assert abs(cachesim.unique_blocks(addrs, precision=14) - unique) < 0.05 * unique
+    est = cachesim.working_set_estimate(addrs, 8000)
+    assert est.format == 'd' and len(est) == 3
+    assert abs(est[2] - len({a // 64 for a in trace[16000:]})) < 0.05 * 4000
+
+    # Bad arguments raise instead of aborting in the engine
+    expect_error(TypeError, cachesim.simulate, array('d', [1.0]), 4096)
+    expect_error(TypeError, cachesim.simulate, addrs, 4096, writes=array('Q', trace))
+    expect_error(ValueError, cachesim.simulate, addrs, 4096, writes=writes[:10])
+    expect_error(ValueError, cachesim.simulate, addrs, 3000)
+    expect_error(ValueError, cachesim.simulate, addrs, 4096, assoc=3)
+    expect_error(ValueError, cachesim.simulate, addrs, 4096, policy="mru")
+    expect_error(ValueError, cachesim.simulate, addrs, 4096, hits=bytearray(5))
+    expect_error(ValueError, cachesim.hierarchy, addrs, [])
+    expect_error(ValueError, cachesim.hierarchy, addrs, [(2048, 2)], inclusion="strict")
+    expect_error(ValueError, cachesim.reuse_distances, addrs, block_size=48)
+    expect_error(ValueError, cachesim.working_set, addrs, 0)
+    expect_error(ValueError, cachesim.footprint, addrs, [10], block_size=48)
+    expect_error(ValueError, cachesim.unique_blocks, addrs, precision=30)
+
+    print("cachesim: all checks passed")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
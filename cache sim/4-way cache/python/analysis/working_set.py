@@ -11,6 +11,12 @@ import matplotlib.pyplot as plt
 from collections import deque
 from typing import List, Tuple, Optional
 
+try:
+    # Native engines, built by CMake in cache sim/4-way cache
+    import cachesim
+except ImportError:
+    cachesim = None
+
 
 def load_trace(filename: str) -> List[int]:
     """
@@ -42,8 +48,15 @@ def calculate_working_set(trace: List[int], window_size: int,
         block_size: Cache block size (addresses in same block count as one)
     
     Returns:
-        List of working set sizes (one per position in trace)
+        List of working set sizes (one per position in trace); a NumPy
+        array when the native cachesim module is available
     """
+    if cachesim is not None and window_size > 0:
+        # Incremental window over a flat hash table, split across threads
+        addresses = np.ascontiguousarray(trace, dtype=np.uint64)
+        return np.asarray(cachesim.working_set(addresses, window_size,
+                                               block_size=block_size))
+
     if len(trace) < window_size:
         return [len(set(addr // block_size for addr in trace))]
     
@@ -141,6 +154,13 @@ def simulate_cache_hit_rate(trace: List[int], cache_blocks: int,
     Returns:
         Hit rate (0.0 to 1.0)
     """
+    if cachesim is not None and trace and cache_blocks > 0:
+        # One stack-distance pass gives the fully-associative LRU curve
+        addresses = np.ascontiguousarray(trace, dtype=np.uint64)
+        curve = cachesim.miss_ratio_curve(addresses, block_size=block_size,
+                                          max_blocks=cache_blocks)
+        return 1.0 - curve[cache_blocks]
+
     block_trace = [addr // block_size for addr in trace]
     
     cache = []  # List acting as LRU stack (front = MRU, back = LRU)
@@ -167,7 +187,7 @@ def estimate_cache_size_needed(trace: List[int], target_hit_rate: float,
                                 max_blocks: int = 4096) -> Tuple[int, int]:
     """
     Find minimum cache size (in blocks and bytes) to achieve target hit rate.
-    Uses binary search for efficiency.
+    Reads one miss-ratio curve with cachesim, otherwise binary searches.
     
     Args:
         trace: List of memory addresses
@@ -178,6 +198,15 @@ def estimate_cache_size_needed(trace: List[int], target_hit_rate: float,
     Returns:
         Tuple of (blocks_needed, bytes_needed)
     """
+    if cachesim is not None and len(trace) > 0 and max_blocks > 0:
+        # Every size at once: curve[c] is the miss ratio with c blocks
+        addresses = np.ascontiguousarray(trace, dtype=np.uint64)
+        curve = np.asarray(cachesim.miss_ratio_curve(addresses, block_size=block_size,
+                                                     max_blocks=max_blocks))
+        meets = np.nonzero(1.0 - curve[1:] >= target_hit_rate)[0]
+        best = int(meets[0]) + 1 if len(meets) else max_blocks
+        return best, best * block_size
+
     # Binary search for minimum cache size
     low, high = 1, max_blocks
     best = max_blocks
@@ -203,8 +232,11 @@ def analyze_working_set(trace: List[int], block_size: int = 64):
         trace: List of memory addresses
         block_size: Cache block size
     """
-    block_trace = [addr // block_size for addr in trace]
-    unique_blocks = len(set(block_trace))
+    if cachesim is not None:
+        unique_blocks = cachesim.unique_blocks(
+            np.ascontiguousarray(trace, dtype=np.uint64), block_size=block_size)
+    else:
+        unique_blocks = len(set(addr // block_size for addr in trace))
     
     print("=" * 50)
     print("WORKING SET ANALYSIS")
@@ -2,7 +2,28 @@
 #include <cassert>
 #include <vector>
 #include <string>
+#include <sstream>
+#include <algorithm>
 #include "../include/set_associative_cache.h"
+#include "../include/fixed_cache.h"
+#include "../include/cache_hierarchy.h"
+#include "../include/sharded_simulator.h"
+#include "../include/stack_distance.h"
+#include "../include/spatial_sampler.h"
+#include "../include/prefetching_cache.h"
+#include "../include/coherent_system.h"
+#include "../include/cache_instrument.h"
+#include "../include/checkpoint.h"
+#include "../include/tlb.h"
+#include "../include/working_set.h"
+#include "../include/lockstep.h"
+#include <fstream>
+#include <filesystem>
+#include <map>
+#include <cstring>
+#include <cmath>
+#include <random>
+#include <stdexcept>
 
 // ============================================================================
 // Test Utilities
@@ -267,6 +288,1438 @@ TEST(test_sequential_access) {
     assert(stats.hit_rate() > 0.9 && "Sequential access should have high hit rate");
 }
 
+/**
+ * Test 8: Flat storage follows the same LRU replacement as per-set storage
+ */
+TEST(test_flat_lru_ordering) {
+    // Same scenario as test_lru_ordering, but on the flat tag store
+    SetAssociativeCache cache(1024, 64, 4, 32, StorageMode::FLAT);
+    
+    cache.access(0x000, AccessType::READ);
+    cache.access(0x100, AccessType::READ);
+    cache.access(0x200, AccessType::READ);
+    cache.access(0x300, AccessType::WRITE);
+    cache.access(0x000, AccessType::READ);   // a0 becomes MRU
+    
+    auto r = cache.access(0x400, AccessType::READ);  // Evicts a1
+    assert(!r.hit && r.evicted && "Should evict when set is full");
+    assert(r.evicted_tag == (0x100 >> 8) && "LRU way (a1) should be evicted");
+    
+    assert(cache.access(0x000, AccessType::READ).hit && "a0 should hit");
+    assert(cache.access(0x200, AccessType::READ).hit && "a2 should hit");
+    
+    // a3 was written and is now LRU: re-fetching a1 must write it back
+    auto wb = cache.access(0x100, AccessType::READ);
+    assert(!wb.hit && "a1 should be evicted");
+    assert(wb.evicted_dirty && wb.evicted_tag == (0x300 >> 8) && "Dirty a3 should be written back");
+    
+    cache.print_set_contents(0);
+}
+
+/**
+ * Test 9: Flat and per-set storage agree access-by-access
+ */
+TEST(test_flat_matches_per_set) {
+    const size_t ways_list[] = {1, 2, 4, 8, 16, 32, 64};
+    
+    for (size_t ways : ways_list) {
+        SetAssociativeCache ref(64 * 64 * ways, 64, ways);
+        SetAssociativeCache flat(64 * 64 * ways, 64, ways, 32, StorageMode::FLAT);
+        
+        // Simple LCG so the trace is reproducible
+        uint64_t x = 12345;
+        for (int i = 0; i < 20000; i++) {
+            x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+            uint64_t addr = (x >> 33) % (64 * 64 * ways * 3);
+            AccessType type = ((x >> 20) & 3) == 0 ? AccessType::WRITE : AccessType::READ;
+            
+            auto a = ref.access(addr, type);
+            auto b = flat.access(addr, type);
+            assert(a.hit == b.hit && a.way == b.way && "Hit/way must match");
+            assert(a.evicted == b.evicted && a.evicted_dirty == b.evicted_dirty);
+            assert(a.evicted_tag == b.evicted_tag && "Victim must match");
+        }
+        
+        auto sa = ref.get_stats();
+        auto sb = flat.get_stats();
+        assert(sa.hits == sb.hits && sa.misses == sb.misses);
+        assert(sa.dirty_evictions == sb.dirty_evictions);
+    }
+}
+
+/**
+ * Test 10: Compile-time specialized caches match the runtime cache
+ */
+TEST(test_fixed_cache_dispatch) {
+    const size_t ways_list[] = {1, 2, 4, 8, 16};
+    const size_t block_list[] = {32, 64, 128};
+    
+    for (size_t ways : ways_list) {
+        for (size_t block : block_list) {
+            size_t size = 32 * block * ways;  // 32 sets
+            SetAssociativeCache ref(size, block, ways);
+            
+            // Replay the same trace through the runtime cache and the dispatched one
+            std::vector<std::pair<uint64_t, AccessType>> trace;
+            uint64_t x = ways * 131 + block;
+            for (int i = 0; i < 5000; i++) {
+                x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+                uint64_t addr = (x >> 33) % (size * 4);
+                trace.push_back({addr, (x >> 17) & 1 ? AccessType::WRITE : AccessType::READ});
+            }
+            
+            std::vector<AccessResult> expected;
+            for (const auto& t : trace) {
+                expected.push_back(ref.access(t.first, t.second));
+            }
+            
+            bool dispatched = dispatch_fixed_cache(size, block, ways, [&](auto& cache) {
+                assert(cache.get_associativity() == ways && cache.get_block_size() == block);
+                for (size_t i = 0; i < trace.size(); i++) {
+                    AccessResult r = cache.access(trace[i].first, trace[i].second);
+                    assert(r.hit == expected[i].hit && r.way == expected[i].way);
+                    assert(r.evicted_tag == expected[i].evicted_tag);
+                    assert(r.evicted_dirty == expected[i].evicted_dirty);
+                }
+                assert(cache.get_stats().hits == ref.get_stats().hits);
+            });
+            assert(dispatched && "Common geometry should have an instantiation");
+        }
+    }
+    
+    // Geometries outside the instantiated set are reported, not guessed
+    bool ok = dispatch_fixed_cache(32 * 64 * 32, 64, 32, [](auto&) {});
+    assert(!ok && "32-way has no instantiation");
+}
+
+/**
+ * Test 11: FIFO ignores hits, LRU does not
+ */
+TEST(test_fifo_policy) {
+    // 256 bytes, 64-byte blocks, 4-way = 1 set
+    SetAssociativeCache lru(256, 64, 4, 32, StorageMode::PER_SET, PolicyType::LRU);
+    SetAssociativeCache fifo(256, 64, 4, 32, StorageMode::PER_SET, PolicyType::FIFO);
+    
+    for (auto* cache : {&lru, &fifo}) {
+        cache->access(0x000, AccessType::READ);
+        cache->access(0x100, AccessType::READ);
+        cache->access(0x200, AccessType::READ);
+        cache->access(0x300, AccessType::READ);
+        cache->access(0x000, AccessType::READ);  // Hit on the oldest block
+    }
+    
+    // LRU evicts 0x100 (least recent); FIFO evicts 0x000 (first filled)
+    auto r_lru = lru.access(0x400, AccessType::READ);
+    auto r_fifo = fifo.access(0x400, AccessType::READ);
+    assert(r_lru.evicted_tag == (0x100 >> 6) && "LRU should evict 0x100");
+    assert(r_fifo.evicted_tag == (0x000 >> 6) && "FIFO should evict 0x000");
+}
+
+/**
+ * Test 12: Tree pseudo-LRU picks the way the tree points at
+ */
+TEST(test_plru_policy) {
+    SetAssociativeCache cache(256, 64, 4, 32, StorageMode::FLAT, PolicyType::PLRU);
+    
+    // Fill ways 0..3 in order, then touch way 0 again
+    cache.access(0x000, AccessType::READ);
+    cache.access(0x100, AccessType::READ);
+    cache.access(0x200, AccessType::READ);
+    cache.access(0x300, AccessType::READ);
+    cache.access(0x000, AccessType::READ);
+    
+    // Root points right (away from way 0); right node points at way 2
+    auto r = cache.access(0x400, AccessType::READ);
+    assert(r.way == 2 && "PLRU victim should be way 2");
+}
+
+/**
+ * Test 13: Every policy behaves the same in both storage modes and in FixedCache
+ */
+TEST(test_policies_all_storage_modes) {
+    const PolicyType kinds[] = {PolicyType::LRU, PolicyType::FIFO, PolicyType::RANDOM,
+                                PolicyType::PLRU, PolicyType::SRRIP, PolicyType::BRRIP,
+                                PolicyType::DRRIP, PolicyType::SHIP, PolicyType::ARC};
+    
+    for (PolicyType kind : kinds) {
+        SetAssociativeCache per_set(16384, 64, 8, 32, StorageMode::PER_SET, kind);
+        SetAssociativeCache flat(16384, 64, 8, 32, StorageMode::FLAT, kind);
+        
+        uint64_t x = 99;
+        for (int i = 0; i < 20000; i++) {
+            x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+            uint64_t addr = (x >> 33) % (16384 * 3);
+            auto a = per_set.access(addr, AccessType::READ);
+            auto b = flat.access(addr, AccessType::READ);
+            assert(a.hit == b.hit && a.way == b.way && a.evicted_tag == b.evicted_tag);
+        }
+        assert(per_set.get_stats().hits == flat.get_stats().hits);
+    }
+    
+    // Compile-time FIFO agrees with the runtime one
+    SetAssociativeCache runtime_fifo(4096, 64, 4, 32, StorageMode::FLAT, PolicyType::FIFO);
+    FixedCache<4, 64, FIFOPolicy> fixed_fifo(4096);
+    for (uint64_t i = 0; i < 5000; i++) {
+        uint64_t addr = (i * 2654435761ULL) % 16384;
+        assert(runtime_fifo.access(addr, AccessType::READ).hit ==
+               fixed_fifo.access(addr, AccessType::READ).hit);
+    }
+}
+
+/**
+ * Test 14: RRIP, SHiP and ARC keep what LRU loses to scans and thrashing
+ */
+TEST(test_rrip_arc_policies) {
+    auto hits = [](size_t size, size_t ways, PolicyType kind, uint64_t n, auto gen) {
+        SetAssociativeCache cache(size, 64, ways, 32, StorageMode::FLAT, kind, false);
+        for (uint64_t i = 0; i < n; i++) {
+            cache.access(gen(i), AccessType::READ);
+        }
+        return cache.get_stats().hits;
+    };
+    
+    // One 4-way set: two hot blocks hit twice, then a burst of three new blocks
+    auto scan = [](uint64_t i) -> uint64_t {
+        uint64_t k = i % 7;
+        return k < 4 ? (k % 2) * 256 : (1000 + (i / 7) * 3 + k) * 256;
+    };
+    assert(hits(256, 4, PolicyType::LRU, 7000, scan) == 2000);
+    assert(hits(256, 4, PolicyType::SRRIP, 7000, scan) == 4000 - 2);
+    assert(hits(256, 4, PolicyType::ARC, 7000, scan) == 4000 - 2);
+    
+    // 32 sets cycling over 1.5x the cache: LRU and SRRIP thrash, BRRIP doesn't,
+    // DRRIP's followers learn to insert like BRRIP
+    auto cyclic = [](uint64_t i) -> uint64_t { return (i % 384) * 64; };
+    uint64_t brrip = hits(16384, 8, PolicyType::BRRIP, 200000, cyclic);
+    uint64_t drrip = hits(16384, 8, PolicyType::DRRIP, 200000, cyclic);
+    assert(hits(16384, 8, PolicyType::LRU, 200000, cyclic) == 0);
+    assert(hits(16384, 8, PolicyType::SRRIP, 200000, cyclic) == 0);
+    assert(brrip > 100000 && drrip > 50000 && drrip < brrip);
+    
+    // A hot region next to a stream from another region: SHiP learns the
+    // stream's signature never hits and inserts it distant
+    auto stream = [](uint64_t i) -> uint64_t {
+        return i % 4 == 0 ? ((i / 4) % 192) * 64 : (1ULL << 24) + i * 64;
+    };
+    uint64_t srrip = hits(16384, 8, PolicyType::SRRIP, 400000, stream);
+    assert(hits(16384, 8, PolicyType::SHIP, 400000, stream) > 3 * srrip);
+    
+    // Policy state directly: RRPV planes, PSEL and ARC's target
+    SRRIPPolicy<4> rrip(1, 4);
+    rrip.on_fill(0, 1);
+    assert(rrip.get_rrpv(0, 1) == RRPVPlanes::LONG && rrip.get_rrpv(0, 0) == RRPVPlanes::DISTANT);
+    rrip.on_hit(0, 1);
+    assert(rrip.get_rrpv(0, 1) == RRPVPlanes::NEAR);
+    
+    DRRIPPolicy<DYNAMIC_WAYS> duel(64, 4);
+    for (int i = 0; i < 600; i++) {
+        duel.on_miss(0, i);     // Set 0 leads for SRRIP
+    }
+    assert(duel.uses_brrip());
+    for (int i = 0; i < 1200; i++) {
+        duel.on_miss(2, i);     // Set stride / 2 leads for BRRIP
+    }
+    assert(!duel.uses_brrip());
+    
+    // c = 2: A, B fill T1; C evicts A to B1; A's ghost hit grows p, B goes
+    // to B1; D trims B1 and evicts A (T2) to B2; A's ghost hit shrinks p
+    ARCPolicy<DYNAMIC_WAYS> arc(1, 2);
+    auto miss = [&arc](uint64_t block, bool full, size_t free_way) {
+        arc.on_miss(0, block);
+        size_t way = full ? arc.victim(0) : free_way;
+        arc.on_fill(0, way);
+        return way;
+    };
+    miss(0xA, false, 0);
+    miss(0xB, false, 1);
+    assert(miss(0xC, true, 0) == 0);
+    assert(arc.get_target(0) == 0);
+    assert(miss(0xA, true, 0) == 1);
+    assert(arc.get_target(0) == 1);
+    assert(miss(0xD, true, 0) == 1);
+    miss(0xA, true, 0);
+    assert(arc.get_target(0) == 0);
+}
+
+/**
+ * Two one-set, 2-way levels: small enough to trace every fill by hand
+ */
+static std::vector<CacheLevelConfig> tiny_two_level() {
+    return {CacheLevelConfig("L1", 128, 64, 2), CacheLevelConfig("L2", 128, 64, 2)};
+}
+
+TEST(test_hierarchy_inclusive_back_invalidation) {
+    const uint64_t A = 0x000, B = 0x040, C = 0x080;
+    CacheHierarchy h(tiny_two_level(), InclusionPolicy::INCLUSIVE);
+
+    h.access(A, AccessType::WRITE);     // Dirty in L1
+    h.access(B, AccessType::READ);
+    assert(h.access(A, AccessType::READ).hit_level == 0);   // L2 never sees this
+    
+    // C evicts A from L2 (its LRU), which must pull A out of L1 too
+    HierarchyResult r = h.access(C, AccessType::READ);
+    assert(r.hit_level == 2);
+    assert(!h.get_level(0).probe(A) && !h.get_level(1).probe(A));
+    assert(h.get_level(0).probe(B) && h.get_level(0).probe(C));
+    assert(h.get_level_stats(0).back_invalidations == 1);
+    
+    // The dirty L1 copy is written to memory with the L2 victim
+    assert(r.memory_writes == 1 && h.get_memory_writes() == 1);
+    assert(h.get_memory_reads() == 3);
+}
+
+TEST(test_hierarchy_exclusive_victim_fill) {
+    const uint64_t blocks[] = {0x000, 0x040, 0x080, 0x0C0};
+    CacheHierarchy excl(tiny_two_level(), InclusionPolicy::EXCLUSIVE);
+    CacheHierarchy incl(tiny_two_level(), InclusionPolicy::INCLUSIVE);
+    
+    // Four blocks cycle through 2 + 2 lines: exclusive holds them all
+    for (int pass = 0; pass < 2; pass++) {
+        for (uint64_t b : blocks) {
+            size_t level = excl.access(b, AccessType::READ).hit_level;
+            assert(level == (pass == 0 ? 2u : 1u));
+            incl.access(b, AccessType::READ);
+        }
+    }
+    assert(excl.get_memory_reads() == 4);
+    assert(excl.get_level_stats(1).hits == 4);
+    assert(incl.get_memory_reads() == 8);
+    
+    for (uint64_t b : blocks) {
+        assert(excl.get_level(0).probe(b) != excl.get_level(1).probe(b));
+    }
+}
+
+TEST(test_hierarchy_writeback_propagation) {
+    const uint64_t A = 0x000, B = 0x040, C = 0x080, D = 0x0C0, E = 0x100;
+    CacheHierarchy h(tiny_two_level(), InclusionPolicy::NINE);
+    
+    h.access(A, AccessType::WRITE);
+    h.access(B, AccessType::READ);
+    h.access(C, AccessType::READ);      // L1 evicts dirty A into L2
+    assert(h.get_level_stats(0).writebacks_out == 1);
+    assert(h.get_level_stats(1).writebacks_in == 1);
+    assert(h.get_level(1).probe(A) && !h.get_level(0).probe(A));
+    assert(h.get_memory_writes() == 0);
+    
+    h.access(D, AccessType::READ);
+    h.access(E, AccessType::READ);      // L2 evicts dirty A to memory
+    assert(h.get_level_stats(1).writebacks_out == 1);
+    assert(h.get_memory_writes() == 1);
+    
+    h.reset();
+    assert(h.get_memory_reads() == 0 && !h.get_level(1).probe(C));
+}
+
+TEST(test_hierarchy_invariants) {
+    const InclusionPolicy kinds[] = {InclusionPolicy::INCLUSIVE, InclusionPolicy::EXCLUSIVE,
+                                     InclusionPolicy::NINE};
+    std::vector<CacheLevelConfig> levels = {
+        CacheLevelConfig("L1", 1024, 64, 2),
+        CacheLevelConfig("L2", 4096, 64, 4, PolicyType::PLRU),
+        CacheLevelConfig("LLC", 16384, 64, 8, PolicyType::LRU, StorageMode::PER_SET)};
+    const uint64_t span = 64 * 1024;
+    
+    for (InclusionPolicy kind : kinds) {
+        CacheHierarchy h(levels, kind);
+        uint64_t x = 7;
+        uint64_t writes = 0;
+        for (int i = 0; i < 50000; i++) {
+            x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+            AccessType type = ((x >> 20) & 3) == 0 ? AccessType::WRITE : AccessType::READ;
+            writes += (type == AccessType::WRITE);
+            h.access((x >> 33) % span, type);
+        }
+        
+        // Demand lookups only reach a level after missing every level above
+        for (size_t i = 1; i < h.get_num_levels(); i++) {
+            assert(h.get_level_stats(i).accesses == h.get_level_stats(i - 1).misses);
+        }
+        assert(h.get_memory_reads() == h.get_level_stats(2).misses);
+        assert(h.get_memory_writes() <= writes);
+        
+        for (uint64_t addr = 0; addr < span; addr += 64) {
+            bool in1 = h.get_level(0).probe(addr);
+            bool in2 = h.get_level(1).probe(addr);
+            bool in3 = h.get_level(2).probe(addr);
+            if (kind == InclusionPolicy::INCLUSIVE) {
+                assert((!in1 || in2) && (!in2 || in3));
+            } else if (kind == InclusionPolicy::EXCLUSIVE) {
+                assert(in1 + in2 + in3 <= 1);
+            }
+        }
+    }
+}
+
+TEST(test_sharded_matches_serial) {
+    std::vector<TraceEntry> trace;
+    uint64_t x = 12345;
+    for (int i = 0; i < 60000; i++) {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        AccessType type = ((x >> 17) & 3) == 0 ? AccessType::WRITE : AccessType::READ;
+        trace.push_back({(x >> 30) % (1 << 20), type});   // ~2x the cache
+    }
+    
+    const PolicyType kinds[] = {PolicyType::LRU, PolicyType::FIFO, PolicyType::RANDOM,
+                                PolicyType::PLRU, PolicyType::SRRIP, PolicyType::ARC};
+    const size_t thread_counts[] = {1, 2, 3, 4, 8};
+    
+    for (PolicyType kind : kinds) {
+        for (StorageMode mode : {StorageMode::FLAT, StorageMode::PER_SET}) {
+            SetAssociativeCache serial(512 * 1024, 64, 8, 32, mode, kind, false);
+            for (const auto& t : trace) {
+                serial.access(t.address, t.type);
+            }
+            CacheStats expect = serial.get_stats();
+            
+            for (size_t threads : thread_counts) {
+                ShardedSimulator sharded(512 * 1024, 64, 8, threads, 32, mode, kind);
+                assert(sharded.get_num_threads() == threads);
+                sharded.run(trace);
+                CacheStats got = sharded.get_stats();
+                assert(got.hits == expect.hits && got.misses == expect.misses);
+                assert(got.reads == expect.reads && got.writes == expect.writes);
+                assert(got.evictions == expect.evictions);
+                assert(got.dirty_evictions == expect.dirty_evictions);
+            }
+        }
+    }
+    
+    // Cache-wide learning runs as one shard, so it matches as well
+    for (PolicyType kind : {PolicyType::BRRIP, PolicyType::DRRIP, PolicyType::SHIP}) {
+        SetAssociativeCache serial(512 * 1024, 64, 8, 32, StorageMode::FLAT, kind, false);
+        for (const auto& t : trace) {
+            serial.access(t.address, t.type);
+        }
+        ShardedSimulator sharded(512 * 1024, 64, 8, 4, 32, StorageMode::FLAT, kind);
+        assert(sharded.get_num_shards() == 1 && sharded.get_num_threads() == 1);
+        sharded.run(trace);
+        assert(sharded.get_stats().hits == serial.get_stats().hits);
+        assert(sharded.get_stats().evictions == serial.get_stats().evictions);
+    }
+    
+    // Batches continue from the current state, like one long run
+    SetAssociativeCache serial(65536, 64, 4, 32, StorageMode::FLAT, PolicyType::LRU, false);
+    ShardedSimulator sharded(65536, 64, 4, 4);
+    for (const auto& t : trace) {
+        serial.access(t.address, t.type);
+    }
+    sharded.run(trace.data(), trace.size() / 3);
+    sharded.run(trace.data() + trace.size() / 3, trace.size() - trace.size() / 3);
+    assert(sharded.get_stats().hits == serial.get_stats().hits);
+    
+    // Never more shards than sets
+    ShardedSimulator tiny(256, 64, 2, 8);
+    assert(tiny.get_num_shards() == 2 && tiny.get_num_threads() == 2);
+    sharded.reset();
+    assert(sharded.get_stats().hits == 0);
+}
+
+TEST(test_stack_distance_matches_lru) {
+    std::vector<uint64_t> trace;
+    uint64_t x = 2024;
+    for (int i = 0; i < 40000; i++) {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        // Skewed: mostly a hot 8 KB region, sometimes a 256 KB one
+        uint64_t span = ((x >> 60) < 12) ? 8192 : 262144;
+        trace.push_back((x >> 30) % span);
+    }
+    
+    // Fully associative: one pass predicts every LRU size exactly
+    StackDistance fa(64);
+    for (uint64_t a : trace) fa.access(a);
+    assert(fa.get_total_accesses() == trace.size());
+    std::vector<double> curve = fa.miss_ratio_curve(64);
+    assert(curve.size() == 65 && curve[0] == 1.0);
+    for (size_t blocks : {1, 4, 16, 64}) {
+        SetAssociativeCache cache(blocks * 64, 64, blocks, 32, StorageMode::FLAT,
+                                  PolicyType::LRU, false);
+        for (uint64_t a : trace) cache.access(a, AccessType::READ);
+        assert(static_cast<uint64_t>(fa.hit_rate(blocks) * trace.size() + 0.5) ==
+               cache.get_stats().hits);
+        assert(curve[blocks] == 1.0 - fa.hit_rate(blocks));
+    }
+    
+    // Per-set stacks predict set-associative LRU for every associativity
+    StackDistance per_set(64, 16);
+    for (uint64_t a : trace) per_set.access(a);
+    for (size_t ways : {1, 2, 8}) {
+        SetAssociativeCache cache(16 * ways * 64, 64, ways, 32, StorageMode::PER_SET,
+                                  PolicyType::LRU, false);
+        for (uint64_t a : trace) cache.access(a, AccessType::READ);
+        assert(static_cast<uint64_t>(per_set.hit_rate(ways) * trace.size() + 0.5) ==
+               cache.get_stats().hits);
+    }
+    
+    // Distances themselves (and survival across timestamp compaction)
+    StackDistance sd(64);
+    assert(sd.access(0x000) == StackDistance::INFINITE_DISTANCE);
+    assert(sd.access(0x040) == StackDistance::INFINITE_DISTANCE);
+    assert(sd.access(0x010) == 1);     // Same block as 0x000, one block in between
+    assert(sd.access(0x010) == 0);
+    for (int i = 0; i < 5000; i++) {
+        sd.access(0x040);
+    }
+    assert(sd.access(0x000) == 1);
+    assert(sd.get_cold_misses() == 2);
+    sd.reset();
+    assert(sd.access(0x000) == StackDistance::INFINITE_DISTANCE);
+}
+
+TEST(test_spatial_sampling) {
+    std::vector<uint64_t> trace;
+    uint64_t x = 77;
+    for (int i = 0; i < 400000; i++) {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        // Hot 128 KB region most of the time, cold 4 MB region otherwise
+        uint64_t span = ((x >> 60) < 11) ? 131072 : 4194304;
+        trace.push_back((x >> 24) % span);
+    }
+    
+    // Sampler keeps whole blocks at close to the requested rate
+    SpatialSampler sampler(1.0 / 16, 64);
+    assert(sampler.get_rate() == 1.0 / 16);
+    assert(sampler.sample(0x1000) == sampler.sample(0x103F));
+    size_t kept = 0;
+    for (uint64_t block = 0; block < 65536; block++) {
+        kept += sampler.sample(block * 64);
+    }
+    assert(kept > 65536 / 16 * 0.9 && kept < 65536 / 16 * 1.1);
+    
+    // Miniature cache tracks the full one
+    SetAssociativeCache full(256 * 1024, 64, 8, 32, StorageMode::FLAT, PolicyType::LRU, false);
+    SampledCache sampled(256 * 1024, 64, 8, 1.0 / 16);
+    assert(sampled.get_miniature().get_num_sets() == full.get_num_sets() / 16);
+    for (uint64_t a : trace) {
+        full.access(a, AccessType::READ);
+        sampled.access(a, AccessType::READ);
+    }
+    assert(sampled.get_seen() == trace.size());
+    double exact = full.get_stats().hit_rate();
+    HitRateEstimate est = sampled.hit_rate_estimate(0.99);
+    assert(est.lower <= est.hit_rate && est.hit_rate <= est.upper);
+    assert(est.lower <= exact && exact <= est.upper);
+    assert(est.upper - est.lower < 0.1);
+    CacheStats scaled = sampled.get_stats();
+    assert(scaled.hits + scaled.misses > trace.size() * 0.8 &&
+           scaled.hits + scaled.misses < trace.size() * 1.2);
+    
+    // Rounded to a power-of-two number of miniature sets
+    SampledCache rounded(256 * 1024, 64, 8, 0.01);
+    assert(rounded.get_rate() == 1.0 / 128);
+    
+    // Sampled reuse distances approximate the exact curve
+    StackDistance exact_sd(64);
+    SampledStackDistance sampled_sd(1.0 / 16, 64);
+    for (uint64_t a : trace) {
+        exact_sd.access(a);
+        sampled_sd.access(a);
+    }
+    for (size_t blocks : {512, 2048, 8192}) {
+        double diff = sampled_sd.hit_rate(blocks) - exact_sd.hit_rate(blocks);
+        assert(diff > -0.03 && diff < 0.03);
+    }
+    assert(normal_critical_value(0.95) > 1.95 && normal_critical_value(0.95) < 1.97);
+}
+
+TEST(test_access_batch_matches_access) {
+    std::vector<TraceEntry> trace;
+    uint64_t x = 99;
+    for (int i = 0; i < 20000; i++) {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        AccessType type = (x >> 62) == 0 ? AccessType::WRITE : AccessType::READ;
+        trace.push_back({(x >> 30) % 65536, type});
+    }
+    
+    for (StorageMode mode : {StorageMode::PER_SET, StorageMode::FLAT}) {
+        for (PolicyType p : {PolicyType::LRU, PolicyType::RANDOM, PolicyType::PLRU}) {
+            SetAssociativeCache one(4096, 64, 4, 32, mode, p, false);
+            SetAssociativeCache batched(4096, 64, 4, 32, mode, p, false);
+            std::vector<AccessResult> results(trace.size());
+            // Odd split so a batch ends mid-chunk
+            batched.access_batch(trace.data(), 1001, results.data());
+            batched.access_batch(trace.data() + 1001, trace.size() - 1001, results.data() + 1001);
+            for (size_t i = 0; i < trace.size(); i++) {
+                AccessResult r = one.access(trace[i].address, trace[i].type);
+                assert(r.hit == results[i].hit && r.way == results[i].way);
+                assert(r.evicted_dirty == results[i].evicted_dirty);
+            }
+            CacheStats a = one.get_stats(), b = batched.get_stats();
+            assert(a.hits == b.hits && a.writes == b.writes &&
+                   a.dirty_evictions == b.dirty_evictions);
+        }
+    }
+    
+    // Stats-only form
+    SetAssociativeCache stats_only(4096, 64, 4, 32, StorageMode::FLAT, PolicyType::LRU, false);
+    stats_only.access_batch(trace);
+    assert(stats_only.get_stats().reads + stats_only.get_stats().writes == trace.size());
+}
+
+TEST(test_prefetchers) {
+    // Sequential sweep over 256 KB: far bigger than the 8 KB cache
+    std::vector<uint64_t> sequential;
+    for (uint64_t a = 0; a < 256 * 1024; a += 8) {
+        sequential.push_back(a);
+    }
+    auto misses = [](PrefetcherType type, const std::vector<uint64_t>& trace) {
+        PrefetchingCache cache(8192, 64, 4, type);
+        for (uint64_t a : trace) cache.access(a, AccessType::READ);
+        return cache.get_stats().misses;
+    };
+    uint64_t baseline = misses(PrefetcherType::NONE, sequential);
+    assert(baseline == 4096);
+    assert(misses(PrefetcherType::NEXT_LINE, sequential) == 1);
+    assert(misses(PrefetcherType::STREAM, sequential) < 10);
+    
+    // Stride of 3 blocks inside each page: only the stride table catches it
+    std::vector<uint64_t> strided;
+    for (uint64_t page = 0; page < 256; page++) {
+        for (uint64_t b = 0; b < 64; b += 3) {
+            strided.push_back(page * 4096 + b * 64);
+        }
+    }
+    uint64_t strided_base = misses(PrefetcherType::NONE, strided);
+    assert(misses(PrefetcherType::STRIDE, strided) < strided_base / 4);
+    assert(misses(PrefetcherType::NEXT_LINE, strided) > strided_base * 9 / 10);
+    
+    // Accounting: every prefetch of a sequential sweep gets used
+    PrefetchingCache nl(8192, 64, 4, PrefetcherType::NEXT_LINE);
+    for (uint64_t a : sequential) nl.access(a, AccessType::READ);
+    PrefetchStats ps = nl.get_prefetch_stats();
+    assert(ps.issued == 4096 && ps.useful == 4095 && ps.late == 0 && ps.polluting == 0);
+    
+    // Random blocks: next-line prefetches are mostly evicted unused
+    PrefetchingCache rnd(8192, 64, 4, PrefetcherType::NEXT_LINE);
+    uint64_t x = 5;
+    for (int i = 0; i < 20000; i++) {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        rnd.access(((x >> 33) % 16384) * 64, AccessType::READ);
+    }
+    ps = rnd.get_prefetch_stats();
+    assert(ps.polluting > ps.issued * 9 / 10 && ps.accuracy() < 0.1);
+    
+    // Late: demand arrives before the fill's ready cycle
+    PrefetchingCache timed(8192, 64, 4, PrefetcherType::NEXT_LINE);
+    timed.access(0x0, AccessType::READ, 0);
+    assert(timed.last_fills().size() == 1 && timed.last_fills()[0].address == 0x40);
+    timed.set_ready(0x40, 100);
+    uint64_t ready = 0;
+    assert(timed.access(0x40, AccessType::READ, 10, &ready).hit && ready == 100);
+    assert(timed.get_prefetch_stats().late == 1);
+    timed.reset();
+    assert(timed.get_prefetch_stats().issued == 0 && timed.get_stats().hits == 0);
+}
+
+TEST(test_coherence_protocol) {
+    CacheLevelConfig l1("L1", 4096, 64, 4), llc("LLC", 65536, 64, 8);
+    const uint64_t A = 0x1000;
+    
+    // MESI: E on a private read, S once shared, upgrade invalidates the peer
+    CoherentSystem mesi(2, l1, llc, CoherenceProtocol::MESI);
+    assert(!mesi.access(0, A, AccessType::READ));
+    assert(mesi.state(0, A) == CoherenceState::EXCLUSIVE);
+    assert(!mesi.access(1, A + 8, AccessType::READ));
+    assert(mesi.state(0, A) == CoherenceState::SHARED && mesi.state(1, A) == CoherenceState::SHARED);
+    assert(mesi.get_bus_stats().cache_to_cache == 1);
+    assert(mesi.access(0, A, AccessType::WRITE));
+    assert(mesi.state(0, A) == CoherenceState::MODIFIED && mesi.state(1, A) == CoherenceState::INVALID);
+    assert(mesi.get_core_stats(0).upgrades == 1 && mesi.get_core_stats(1).invalidations == 1);
+    
+    // Reading a MODIFIED line flushes it to the LLC; the miss is a coherence miss
+    assert(!mesi.access(1, A, AccessType::READ));
+    assert(mesi.get_core_stats(1).coherence_misses == 1);
+    assert(mesi.get_bus_stats().flushes == 1);
+    assert(mesi.state(0, A) == CoherenceState::SHARED && mesi.state(1, A) == CoherenceState::SHARED);
+    assert(mesi.get_llc().coherence_state(A) == CoherenceState::MODIFIED);
+    
+    // Write miss: BusRdX takes the line, the E -> M write is silent
+    assert(!mesi.access(1, 0x2000, AccessType::WRITE));
+    assert(mesi.state(1, 0x2000) == CoherenceState::MODIFIED);
+    assert(!mesi.access(0, 0x3000, AccessType::READ));
+    assert(mesi.access(0, 0x3000, AccessType::WRITE));
+    assert(mesi.get_core_stats(0).upgrades == 1);
+    BusStats bus = mesi.get_bus_stats();
+    assert(bus.bus_reads == 4 && bus.bus_read_exclusive == 1 && bus.bus_upgrades == 1);
+    assert(bus.memory_reads == 3);
+    
+    // MOESI: the writer becomes OWNED, keeps the dirty data and supplies readers
+    CoherentSystem moesi(3, l1, llc, CoherenceProtocol::MOESI);
+    moesi.access(0, A, AccessType::WRITE);
+    moesi.access(1, A, AccessType::READ);
+    moesi.access(2, A, AccessType::READ);
+    assert(moesi.state(0, A) == CoherenceState::OWNED && moesi.state(2, A) == CoherenceState::SHARED);
+    assert(moesi.get_bus_stats().flushes == 0 && moesi.get_bus_stats().cache_to_cache == 2);
+    assert(moesi.get_llc().coherence_state(A) == CoherenceState::EXCLUSIVE);    // Never written back
+    assert(moesi.access(0, A, AccessType::WRITE));
+    assert(moesi.state(0, A) == CoherenceState::MODIFIED && moesi.get_bus_stats().invalidations == 2);
+
+    // Refilling the line the block was invalidated from forgets it: a later
+    // miss to it is the core's own replacement, not a coherence miss
+    CoherentSystem direct(2, CacheLevelConfig("L1", 4096, 64, 1), llc, CoherenceProtocol::MESI);
+    direct.access(0, A, AccessType::READ);
+    direct.access(1, A, AccessType::WRITE);
+    direct.access(0, A + 4096, AccessType::READ);
+    assert(!direct.access(0, A, AccessType::READ));
+    assert(direct.get_core_stats(0).invalidations == 1 && direct.get_core_stats(0).coherence_misses == 0);
+
+    // The state lives in the tag store: same encoding in both layouts
+    for (StorageMode mode : {StorageMode::FLAT, StorageMode::PER_SET}) {
+        SetAssociativeCache cache(4096, 64, 4, 32, mode, PolicyType::LRU, false);
+        cache.access(A, AccessType::READ);
+        assert(cache.coherence_state(A) == CoherenceState::EXCLUSIVE);
+        assert(cache.set_coherence_state(A, CoherenceState::OWNED));
+        assert(cache.coherence_state(A) == CoherenceState::OWNED);
+        bool dirty = false;
+        assert(cache.invalidate(A, &dirty) && dirty);
+        cache.install(A, false);
+        assert(cache.coherence_state(A) == CoherenceState::EXCLUSIVE);
+        assert(!cache.set_coherence_state(0x9000, CoherenceState::SHARED));
+    }
+}
+
+TEST(test_coherence_invariants) {
+    // Random shared-heavy trace: at most one owner per block, never M/E beside a copy
+    CacheLevelConfig l1("L1", 2048, 64, 2), llc("LLC", 16384, 64, 4);
+    for (CoherenceProtocol protocol : {CoherenceProtocol::MESI, CoherenceProtocol::MOESI}) {
+        CoherentSystem system(4, l1, llc, protocol);
+        uint64_t x = 17;
+        for (int i = 0; i < 20000; i++) {
+            x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+            uint32_t core = static_cast<uint32_t>(x >> 62);
+            uint64_t addr = ((x >> 33) % 128) * 64;
+            AccessType type = ((x >> 20) & 3) == 0 ? AccessType::WRITE : AccessType::READ;
+            system.access(core, addr, type);
+            
+            if (i % 97 != 0) continue;
+            for (uint64_t block = 0; block < 128 * 64; block += 64) {
+                int owners = 0, copies = 0, exclusive = 0;
+                for (uint32_t c = 0; c < 4; c++) {
+                    CoherenceState s = system.state(c, block);
+                    copies += s != CoherenceState::INVALID;
+                    owners += s == CoherenceState::MODIFIED || s == CoherenceState::OWNED;
+                    exclusive += s == CoherenceState::MODIFIED || s == CoherenceState::EXCLUSIVE;
+                    assert(protocol == CoherenceProtocol::MOESI || s != CoherenceState::OWNED);
+                }
+                assert(owners <= 1);
+                assert(exclusive == 0 || copies == 1);
+            }
+        }
+        uint64_t coherence = 0, invalidations = 0;
+        for (uint32_t c = 0; c < 4; c++) {
+            coherence += system.get_core_stats(c).coherence_misses;
+            invalidations += system.get_core_stats(c).invalidations;
+        }
+        assert(coherence > 0 && coherence <= invalidations);
+        assert(invalidations == system.get_bus_stats().invalidations);
+    }
+    
+    // Per-core traces merge by timestamp, ties to the lower core
+    std::istringstream t0("5 R 0x40\n1 W 0x80\n"), t1("R 0x100\nW 0x140\n");
+    std::vector<std::vector<TimedAccess>> streams = {read_timed_trace(t0), read_timed_trace(t1)};
+    std::vector<CoreAccess> merged = merge_by_timestamp(streams);
+    assert(merged.size() == 4);
+    assert(merged[0].core == 1 && merged[0].address == 0x100);
+    assert(merged[1].core == 1 && merged[1].type == AccessType::WRITE);
+    assert(merged[2].core == 0 && merged[2].address == 0x40);
+    std::istringstream shared("0 R 0x40\n3 W 0x40\nbad line\n");
+    std::vector<CoreAccess> interleaved = read_multicore_trace(shared);
+    assert(interleaved.size() == 2 && interleaved[1].core == 3);
+}
+
+TEST(test_sparse_matches_flat) {
+    // 256 MB, 16-way: 262144 sets, of which the trace touches a handful of pages.
+    // Every policy replaces alike, including the cache-wide state of BRRIP,
+    // DRRIP (its leader sets are on different pages) and SHiP.
+    const size_t size = 256ULL << 20;
+    const PolicyType kinds[] = {PolicyType::LRU, PolicyType::FIFO, PolicyType::RANDOM,
+                                PolicyType::PLRU, PolicyType::SRRIP, PolicyType::BRRIP,
+                                PolicyType::DRRIP, PolicyType::SHIP, PolicyType::ARC};
+    for (PolicyType kind : kinds) {
+        SetAssociativeCache flat(size, 64, 16, 48, StorageMode::FLAT, kind, false);
+        SetAssociativeCache sparse(size, 64, 16, 48, StorageMode::SPARSE, kind, false);
+        assert(sparse.get_allocated_sets() == 0);
+        
+        uint64_t x = 7;
+        for (int i = 0; i < 60000; i++) {
+            if (i == 30000) {
+                // A second epoch: the cache-wide state restarts in both
+                flat.reset();
+                sparse.reset();
+            }
+            x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+            // 8 hot 64-set regions, each hit with addresses 16 MB apart
+            uint64_t set = ((x >> 40) % 8) * 4096 + ((x >> 20) % 64);
+            uint64_t addr = ((x >> 50) % 64) * size + set * 64;
+            AccessType type = ((x >> 12) & 3) == 0 ? AccessType::WRITE : AccessType::READ;
+            AccessResult a = flat.access(addr, type);
+            AccessResult b = sparse.access(addr, type);
+            assert(a.hit == b.hit && a.way == b.way && a.evicted_tag == b.evicted_tag);
+            assert(a.evicted_dirty == b.evicted_dirty);
+            if (i % 101 == 0) {
+                AccessResult fa = flat.install(addr + 64 * size, true);
+                AccessResult fb = sparse.install(addr + 64 * size, true);
+                assert(fa.way == fb.way && fa.evicted_dirty == fb.evicted_dirty);
+            }
+        }
+        assert(flat.get_stats().hits == sparse.get_stats().hits);
+        assert(sparse.get_allocated_sets() == 8 * 64);
+        
+        // Lookups of untouched sets allocate nothing
+        assert(!sparse.probe(0x12345 * 64 * 64));
+        assert(!sparse.invalidate(0x12345 * 64 * 64));
+        assert(sparse.coherence_state(0x12345 * 64 * 64) == CoherenceState::INVALID);
+        assert(sparse.get_allocated_sets() == 8 * 64);
+        
+        sparse.reset();
+        assert(sparse.get_allocated_sets() == 0 && !sparse.probe(0));
+    }
+    
+    // Batched accesses and coherence state go through the pages too
+    SetAssociativeCache flat(1 << 20, 64, 4, 32, StorageMode::FLAT, PolicyType::LRU, false);
+    SetAssociativeCache sparse(1 << 20, 64, 4, 32, StorageMode::SPARSE, PolicyType::LRU, false);
+    std::vector<TraceEntry> trace;
+    for (uint64_t i = 0; i < 4096; i++) {
+        trace.push_back({(i * 2654435761ULL) % (4 << 20), i % 3 ? AccessType::READ : AccessType::WRITE});
+    }
+    std::vector<AccessResult> ra(trace.size()), rb(trace.size());
+    flat.access_batch(trace.data(), trace.size(), ra.data());
+    sparse.access_batch(trace.data(), trace.size(), rb.data());
+    for (size_t i = 0; i < trace.size(); i++) {
+        assert(ra[i].hit == rb[i].hit && ra[i].way == rb[i].way);
+    }
+    assert(sparse.set_coherence_state(trace.back().address, CoherenceState::OWNED));
+    assert(sparse.coherence_state(trace.back().address) == CoherenceState::OWNED);
+}
+
+TEST(test_epoch_reset) {
+    // After reset() every mode and policy replays a trace exactly like a new cache
+    const StorageMode modes[] = {StorageMode::PER_SET, StorageMode::FLAT, StorageMode::SPARSE};
+    const PolicyType kinds[] = {PolicyType::LRU, PolicyType::FIFO,
+                                PolicyType::RANDOM, PolicyType::PLRU};
+    for (StorageMode mode : modes) {
+        for (PolicyType kind : kinds) {
+            SetAssociativeCache reused(65536, 64, 8, 32, mode, kind, false);
+            uint64_t x = 5;
+            for (int round = 0; round < 3; round++) {
+                SetAssociativeCache fresh(65536, 64, 8, 32, mode, kind, false);
+                reused.reset();
+                assert(reused.get_stats().hits + reused.get_stats().misses == 0);
+                for (int i = 0; i < 6000; i++) {
+                    x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+                    // Each round touches a different part of the cache
+                    uint64_t addr = (x >> 33) % (65536 * 2) + (round % 2) * 32768;
+                    AccessType type = ((x >> 20) & 3) == 0 ? AccessType::WRITE : AccessType::READ;
+                    AccessResult a = fresh.access(addr, type);
+                    AccessResult b = reused.access(addr, type);
+                    assert(a.hit == b.hit && a.way == b.way && a.evicted_tag == b.evicted_tag);
+                    assert(a.evicted == b.evicted && a.evicted_dirty == b.evicted_dirty);
+                    if (i % 50 == 0) {
+                        assert(fresh.install(addr ^ 0x40000, true).way ==
+                               reused.install(addr ^ 0x40000, true).way);
+                    }
+                }
+                assert(fresh.get_stats().hits == reused.get_stats().hits);
+                for (uint64_t probe = 0; probe < 65536 * 2; probe += 4096) {
+                    assert(fresh.probe(probe) == reused.probe(probe));
+                }
+            }
+            // Stale sets read as empty until refilled
+            reused.reset();
+            assert(!reused.probe(0) && !reused.invalidate(64));
+            assert(reused.coherence_state(128) == CoherenceState::INVALID);
+        }
+    }
+}
+
+TEST(test_cache_instrument) {
+    namespace fs = std::filesystem;
+    fs::path dir = fs::temp_directory_path();
+    std::string intervals = (dir / "cachesim_test_intervals.csv").string();
+    std::string heatmap = (dir / "cachesim_test_sets.csv").string();
+    
+    // Fed by hand: 4 sets, windows of 10 accesses, a 2-slot ring forces the
+    // simulation thread to wait on the writer
+    InstrumentConfig config;
+    config.interval = 10;
+    config.ring_slots = 2;
+    config.interval_csv = intervals;
+    config.heatmap_csv = heatmap;
+    {
+        CacheInstrument inst(4, config);
+        AccessResult hit, miss;
+        hit.hit = true;
+        miss.evicted = true;
+        miss.evicted_dirty = true;
+        for (int i = 0; i < 95; i++) {
+            inst.record(i % 4 == 3 ? 3 : 0, i % 4 == 3 ? miss : hit);
+        }
+        inst.record_eviction(1, false);
+        assert(inst.get_snapshots() == 9);
+        inst.finish();
+        assert(inst.get_snapshots() == 10);
+        assert(inst.get_set(0).hits == 72 && inst.get_set(0).misses == 0);
+        assert(inst.get_set(3).misses == 23 && inst.get_set(3).dirty_evictions == 23);
+        assert(inst.get_set(1).evictions == 1 && inst.get_set(1).dirty_evictions == 0);
+    }
+    std::ifstream in(intervals);
+    std::string line;
+    std::vector<std::string> lines;
+    while (std::getline(in, line)) lines.push_back(line);
+    assert(lines.size() == 11);
+    assert(lines[1].rfind("0,0,10,8,2,", 0) == 0);
+    assert(lines[10].rfind("9,90,95,", 0) == 0);
+    assert(lines[1].substr(lines[1].size() - 4) == ",3,2");
+    std::ifstream sets_in(heatmap);
+    lines.clear();
+    while (std::getline(sets_in, line)) lines.push_back(line);
+    assert(lines.size() == 5 && lines[4].rfind("3,0,23,", 0) == 0);
+    
+    // Cycle windows skip idle stretches
+    InstrumentConfig cycles;
+    cycles.interval = 100;
+    cycles.unit = IntervalUnit::CYCLES;
+    CacheInstrument timed(1, cycles);
+    AccessResult hit;
+    hit.hit = true;
+    timed.advance(5);
+    timed.record(0, hit);
+    timed.advance(150);
+    assert(timed.get_snapshots() == 1);
+    timed.record(0, hit);
+    timed.advance(1000000);
+    timed.record(0, hit);
+    assert(timed.get_snapshots() == 2);
+    timed.finish();
+    assert(timed.get_snapshots() == 3);
+    
+#ifdef CACHESIM_INSTRUMENT
+    // Attached: counts agree with the cache's own totals, both storage modes
+    for (StorageMode mode : {StorageMode::PER_SET, StorageMode::FLAT}) {
+        SetAssociativeCache cache(4096, 64, 4, 32, mode, PolicyType::LRU, false);
+        InstrumentConfig none;
+        none.interval = 256;
+        CacheInstrument attached(cache.get_num_sets(), none);
+        cache.set_instrument(&attached);
+        for (uint64_t i = 0; i < 4000; i++) {
+            cache.access((i * 2654435761ULL) % 16384, i % 5 ? AccessType::READ : AccessType::WRITE);
+        }
+        cache.install(0x100000, true);
+        CacheStats stats = cache.get_stats();
+        uint64_t hits = 0, misses = 0, evictions = 0;
+        for (size_t s = 0; s < attached.get_num_sets(); s++) {
+            hits += attached.get_set(s).hits;
+            misses += attached.get_set(s).misses;
+            evictions += attached.get_set(s).evictions;
+        }
+        assert(hits == stats.hits && misses == stats.misses && evictions == stats.evictions);
+        assert(attached.get_snapshots() == 4000 / 256);
+    }
+#endif
+    fs::remove(intervals);
+    fs::remove(heatmap);
+}
+
+TEST(test_checkpoint_restore) {
+    // A restored cache continues exactly like the one that was saved
+    namespace fs = std::filesystem;
+    std::string path = (fs::temp_directory_path() / "cachesim_test.ckpt").string();
+    const StorageMode modes[] = {StorageMode::PER_SET, StorageMode::FLAT, StorageMode::SPARSE};
+    const PolicyType kinds[] = {PolicyType::LRU, PolicyType::FIFO, PolicyType::RANDOM,
+                                PolicyType::PLRU, PolicyType::SRRIP, PolicyType::BRRIP,
+                                PolicyType::DRRIP, PolicyType::SHIP, PolicyType::ARC};
+    auto next = [](uint64_t& x) {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        return (x >> 33) % (1 << 18);
+    };
+    for (StorageMode mode : modes) {
+        for (PolicyType kind : kinds) {
+            SetAssociativeCache warm(65536, 64, 8, 32, mode, kind, false);
+            uint64_t x = 11;
+            for (int i = 0; i < 20000; i++) {
+                warm.access(next(x), i % 3 ? AccessType::READ : AccessType::WRITE);
+            }
+            {
+                CheckpointWriter out(path);
+                warm.save(out);
+                out.close();
+            }
+            SetAssociativeCache cold(65536, 64, 8, 32, mode, kind, false);
+            cold.access(0x1234, AccessType::WRITE);     // Restore replaces this
+            CheckpointReader in(path);
+            cold.restore(in);
+            assert(cold.get_stats().hits == warm.get_stats().hits);
+            assert(cold.get_allocated_sets() == warm.get_allocated_sets());
+            for (int i = 0; i < 20000; i++) {
+                uint64_t addr = next(x);
+                AccessType type = i % 5 ? AccessType::READ : AccessType::WRITE;
+                AccessResult a = warm.access(addr, type);
+                AccessResult b = cold.access(addr, type);
+                assert(a.hit == b.hit && a.way == b.way && a.evicted_tag == b.evicted_tag);
+                assert(a.evicted_dirty == b.evicted_dirty);
+            }
+            // The same snapshot restores again, e.g. after a reset()
+            cold.reset();
+            in.rewind();
+            cold.restore(in);
+            assert(cold.get_stats().misses + cold.get_stats().hits == 20000);
+        }
+    }
+    
+    // Prefetcher training and unused prefetches come back too
+    PrefetchingCache pf(32768, 64, 8, PrefetcherType::STRIDE);
+    for (uint64_t i = 0; i < 3000; i++) {
+        pf.access(i * 192, AccessType::READ, i);
+    }
+    {
+        CheckpointWriter out(path);
+        pf.save(out);
+        out.close();
+    }
+    PrefetchingCache pf2(32768, 64, 8, PrefetcherType::STRIDE);
+    {
+        CheckpointReader in(path);
+        pf2.restore(in);
+    }
+    for (uint64_t i = 3000; i < 4000; i++) {
+        AccessResult a = pf.access(i * 192, AccessType::READ, i);
+        AccessResult b = pf2.access(i * 192, AccessType::READ, i);
+        assert(a.hit == b.hit && pf.last_fills().size() == pf2.last_fills().size());
+    }
+    assert(pf.get_prefetch_stats().useful == pf2.get_prefetch_stats().useful);
+    assert(pf.get_prefetch_stats().issued == pf2.get_prefetch_stats().issued);
+
+    // FixedCache checkpoints the same way (memory_sweep keeps its configs in one)
+    FixedCache<8, 64> fixed(65536);
+    uint64_t fx = 5;
+    for (int i = 0; i < 20000; i++) {
+        fixed.access(next(fx), i % 3 ? AccessType::READ : AccessType::WRITE);
+    }
+    {
+        CheckpointWriter out(path);
+        fixed.save(out);
+        out.close();
+    }
+    FixedCache<8, 64> fixed2(65536);
+    {
+        CheckpointReader in(path);
+        fixed2.restore(in);
+        FixedCache<8, 64> other_size(32768);
+        bool threw = false;
+        try {
+            in.rewind();
+            other_size.restore(in);
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        assert(threw && other_size.get_stats().misses == 0);
+    }
+    for (int i = 0; i < 20000; i++) {
+        uint64_t addr = next(fx);
+        AccessResult a = fixed.access(addr, AccessType::READ);
+        AccessResult b = fixed2.access(addr, AccessType::READ);
+        assert(a.hit == b.hit && a.way == b.way && a.evicted_dirty == b.evicted_dirty);
+    }
+
+    // Another policy keeps the lines and starts its own state cold
+    SetAssociativeCache lru(16384, 64, 4, 32, StorageMode::FLAT, PolicyType::LRU, false);
+    for (uint64_t a = 0; a < 16384; a += 64) {
+        lru.access(a, AccessType::READ);
+    }
+    {
+        CheckpointWriter out(path);
+        lru.save(out);
+        out.close();
+    }
+    SetAssociativeCache plru(16384, 64, 4, 32, StorageMode::FLAT, PolicyType::PLRU, false);
+    CheckpointReader in(path);
+    plru.restore(in);
+    for (uint64_t a = 0; a < 16384; a += 64) {
+        assert(plru.probe(a));
+    }
+    
+    // Different geometry or not a checkpoint at all: refused
+    SetAssociativeCache bigger(32768, 64, 4, 32, StorageMode::FLAT, PolicyType::LRU, false);
+    in.rewind();
+    bool rejected = false;
+    try {
+        bigger.restore(in);
+    } catch (const std::invalid_argument&) {
+        rejected = true;
+    }
+    assert(rejected);
+
+    // A snapshot that breaks off after the stats throws and changes nothing
+    {
+        CheckpointWriter out(path);
+        out.begin_section("SETASSOC");
+        for (size_t v : {lru.get_cache_size(), lru.get_block_size(), lru.get_associativity(),
+                         lru.get_tag_bits()}) {
+            out.put(static_cast<uint64_t>(v));
+        }
+        out.put(static_cast<uint32_t>(StorageMode::FLAT));
+        out.put(static_cast<uint32_t>(PolicyType::LRU));
+        for (int i = 0; i < 6; i++) {
+            out.put(static_cast<uint64_t>(0));
+        }
+        out.end_section();
+        out.close();
+    }
+    CacheStats before = lru.get_stats();
+    rejected = false;
+    try {
+        CheckpointReader cut(path);
+        lru.restore(cut);
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    assert(rejected && lru.get_stats().hits == before.hits && lru.get_stats().misses == before.misses);
+    for (uint64_t a = 0; a < 16384; a += 64) {
+        assert(lru.probe(a));
+    }
+    {
+        std::ofstream junk(path);
+        junk << "not a checkpoint at all";
+    }
+    rejected = false;
+    try {
+        CheckpointReader bad(path);
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    assert(rejected);
+    fs::remove(path);
+}
+
+TEST(test_tlb_page_walks) {
+    std::vector<CacheLevelConfig> levels = {CacheLevelConfig("L1", 32768, 64, 8),
+                                            CacheLevelConfig("L2", 1 << 20, 64, 16)};
+    const uint64_t base = 0x7f0000000000ULL;    // 1G aligned
+    const size_t pages = 256;                   // Beyond the DTLB, within the STLB
+
+    // 4K pages: every new page walks all four levels, the second pass hits the STLB
+    {
+        CacheHierarchy h(levels, InclusionPolicy::NINE, 64);
+        MMU mmu(h);
+        std::vector<uint64_t> frames;
+        for (int pass = 0; pass < 2; pass++) {
+            for (size_t p = 0; p < pages; p++) {
+                uint64_t va = base + p * 4096 + 0x123;
+                TranslationResult r = mmu.access(va, AccessType::READ);
+                assert(r.page == PageSize::SIZE_4K && (r.paddr & 0xFFF) == 0x123);
+                assert(r.tlb_level == (pass == 0 ? 2u : 1u));
+                if (pass == 0) {
+                    frames.push_back(r.paddr >> 12);
+                } else {
+                    assert(frames[p] == (r.paddr >> 12));
+                }
+            }
+        }
+        std::sort(frames.begin(), frames.end());
+        assert(std::unique(frames.begin(), frames.end()) == frames.end());
+
+        const MMUStats& s = mmu.get_stats();
+        assert(s.translations == 2 * pages && s.walks == pages && s.walk_refs == 4 * pages);
+        assert(s.pages[0] == pages && s.pages[1] == 0);
+        assert(mmu.get_dtlb().get_stats().misses == 2 * pages);
+        assert(mmu.get_stlb().get_stats().hits == pages);
+        assert(mmu.get_itlb().get_stats().hits + mmu.get_itlb().get_stats().misses == 0);
+
+        // Walk references go through the caches with the data
+        assert(h.get_level_stats(0).accesses == 2 * pages + s.walk_refs);
+        uint64_t served = 0;
+        for (uint64_t n : s.walk_ref_hits) {
+            served += n;
+        }
+        assert(served == s.walk_refs);
+    }
+
+    // Huge pages: the same footprint is one translation, with a shorter walk
+    const PageSize huge[] = {PageSize::SIZE_2M, PageSize::SIZE_1G};
+    for (PageSize size : huge) {
+        CacheHierarchy h(levels, InclusionPolicy::NINE, 64);
+        MMUConfig config;
+        config.page_size = size;
+        MMU mmu(h, config);
+        for (int pass = 0; pass < 2; pass++) {
+            for (size_t p = 0; p < pages; p++) {
+                uint64_t va = base + p * 4096 + 0x123;
+                TranslationResult r = mmu.access(va, AccessType::WRITE);
+                uint64_t mask = (1ULL << page_shift(size)) - 1;
+                assert(r.page == size && (r.paddr & mask) == (va & mask));
+            }
+        }
+        const MMUStats& s = mmu.get_stats();
+        assert(s.walks == 1 && s.pages[static_cast<size_t>(size)] == 1);
+        assert(s.walk_refs == (size == PageSize::SIZE_2M ? 3u : 2u));
+        assert(mmu.get_dtlb().get_stats().hits == 2 * pages - 1);
+    }
+
+    // Walk latency: a cold walk reads memory at every level, a neighbour's
+    // walk finds the same table lines in L1
+    {
+        CacheHierarchy h(levels, InclusionPolicy::NINE, 64);
+        MMUConfig config;
+        MMU mmu(h, config);
+        TranslationResult cold = mmu.access(base, AccessType::READ);
+        assert(cold.translation_cycles == config.stlb.hit_latency + 4 * config.memory_latency);
+        TranslationResult warm = mmu.access(base + 4096, AccessType::READ);
+        assert(warm.translation_cycles == config.stlb.hit_latency + 4 * config.cache_latency[0]);
+        assert(mmu.get_stats().max_walk_cycles == 4 * config.memory_latency);
+        assert(mmu.get_stats().walk_ref_hits[0] == 4 && mmu.get_stats().walk_ref_hits[2] == 4);
+
+        // Fetches use the ITLB; data to the same page then finds it in the STLB
+        TranslationResult fetch = mmu.access(base + 8192, AccessType::READ, true);
+        assert(fetch.tlb_level == 2 && mmu.get_itlb().get_stats().misses == 1);
+        TranslationResult data = mmu.access(base + 8192, AccessType::READ);
+        assert(data.tlb_level == 1 && data.paddr == fetch.paddr);
+        assert(data.translation_cycles == config.stlb.hit_latency);
+
+        mmu.reset();
+        assert(mmu.get_stats().walks == 0 && !mmu.get_stlb().probe(TLB::key(base, PageSize::SIZE_4K)));
+    }
+
+    // Partial THP coverage: regions split between 2M and 4K pages
+    {
+        CacheHierarchy h(levels, InclusionPolicy::NINE, 64);
+        MMUConfig config;
+        config.page_size = PageSize::SIZE_2M;
+        config.huge_fraction = 0.5;
+        MMU mmu(h, config);
+        const size_t regions = 128;
+        for (size_t i = 0; i < regions; i++) {
+            uint64_t va = base + (i << 21) + 0x5000;
+            assert(mmu.access(va, AccessType::READ).page == mmu.page_of(va));
+        }
+        const MMUStats& s = mmu.get_stats();
+        assert(s.pages[0] + s.pages[1] == regions);
+        assert(s.pages[1] > regions / 4 && s.pages[0] > regions / 4);
+        assert(s.walk_refs == 3 * s.pages[1] + 4 * s.pages[0]);
+    }
+}
+
+TEST(test_working_set_analysis) {
+    // Hot blocks mixed with a scan, long enough to split across threads
+    std::mt19937_64 rng(29);
+    std::vector<uint64_t> trace;
+    for (size_t i = 0; i < 100000; i++) {
+        trace.push_back(rng() % 4 == 0 ? i * 64 : (rng() % 512) * 64 + (rng() % 64));
+    }
+    const size_t n = trace.size();
+
+    // Reference: distinct blocks per sliding window with an ordered count map
+    auto brute_sliding = [&](size_t window) {
+        std::vector<uint32_t> sizes;
+        std::map<uint64_t, size_t> counts;
+        for (size_t i = 0; i < n; i++) {
+            counts[trace[i] / 64]++;
+            if (i >= window) {
+                uint64_t old = trace[i - window] / 64;
+                if (--counts[old] == 0) {
+                    counts.erase(old);
+                }
+            }
+            if (i + 1 >= window) {
+                sizes.push_back(static_cast<uint32_t>(counts.size()));
+            }
+        }
+        return sizes;
+    };
+
+    WorkingSetAnalyzer serial(64, 1);
+    WorkingSetAnalyzer parallel(64, 4);
+    for (size_t window : {1, 37, 1000}) {
+        std::vector<uint32_t> expect = brute_sliding(window);
+        assert(serial.sliding(trace.data(), n, window) == expect);
+        assert(parallel.sliding(trace.data(), n, window) == expect);
+    }
+    assert(serial.sliding(trace.data(), 10, 100).size() == 1);
+
+    // Footprint: exact mean of the sliding sizes, same for any thread count
+    std::vector<size_t> windows = {1000, 1, 37, 0, 5000, n, n + 1};
+    FootprintCurve curve = parallel.footprint(trace.data(), n, windows);
+    FootprintCurve curve1 = serial.footprint(trace.data(), n, windows);
+    const std::vector<size_t> kept = {1, 37, 1000, 5000, n};
+    assert(curve.windows == kept && curve1.windows == kept && curve.accesses == n);
+    assert(curve.footprint == curve1.footprint);
+    uint64_t unique = serial.unique_blocks(trace.data(), n);
+    assert(curve.unique_blocks == unique && parallel.unique_blocks(trace.data(), n) == unique);
+    for (size_t j = 0; j < kept.size(); j++) {
+        std::vector<uint32_t> sizes = brute_sliding(kept[j]);
+        double mean = 0.0;
+        for (uint32_t s : sizes) {
+            mean += s;
+        }
+        mean /= static_cast<double>(sizes.size());
+        assert(std::abs(curve.footprint[j] - mean) < 1e-6 * mean);
+    }
+    assert(curve.footprint.front() == 1.0 && curve.footprint.back() == unique);
+
+    // HyperLogLog: within a few standard errors, merge equals one sketch
+    double estimate = parallel.sketch(trace.data(), n).estimate();
+    assert(std::abs(estimate - unique) < 0.05 * unique);
+    HyperLogLog a(12), b(12), both(12);
+    for (uint64_t k = 0; k < 200000; k++) {
+        (k % 2 ? a : b).add(k);
+        both.add(k);
+    }
+    a.merge(b);
+    assert(a.estimate() == both.estimate());
+    assert(std::abs(both.estimate() - 200000) < 0.06 * 200000);
+    HyperLogLog small;
+    for (uint64_t k = 0; k < 100; k++) {
+        small.add(k);
+        small.add(k);
+    }
+    assert(std::abs(small.estimate() - 100) < 3);
+
+    // Tumbling windows: one estimate per window, the tail window included
+    std::vector<double> tumbling = parallel.estimate_windows(trace.data(), n, 30000);
+    assert(tumbling.size() == 4);
+    for (size_t k = 0; k < tumbling.size(); k++) {
+        size_t begin = k * 30000;
+        size_t len = std::min<size_t>(30000, n - begin);
+        uint64_t exact = serial.unique_blocks(trace.data() + begin, len);
+        assert(std::abs(tumbling[k] - exact) < 0.05 * exact);
+    }
+    assert(serial.estimate_windows(trace.data(), n, 30000) == tumbling);
+
+    bool threw = false;
+    try {
+        HyperLogLog bad(2);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+    threw = false;
+    try {
+        a.merge(small);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+}
+
+TEST(test_lockstep_validation) {
+    const size_t size = 16384, block = 64, ways = 4;
+    SyntheticTraceConfig config;
+    config.accesses = 300000;
+    config.footprint = 8 * size;
+    config.stride = size / ways;
+    config.assoc = ways;
+
+    // Every engine matches the reference access by access, across chunk edges
+    {
+        LockstepValidator validator(size, block, ways, 4096);
+        for (const std::string& name : lockstep_engine_names()) {
+            validator.add_engine(make_lockstep_engine(name, size, block, ways));
+        }
+        SyntheticTrace trace(config);
+        LockstepReport report = validator.run(trace);
+        assert(!report.diverged && report.passed());
+        assert(report.accesses == config.accesses && report.engines.size() == 6);
+        assert(report.reference.hits > 0 && report.reference.dirty_evictions > 0);
+    }
+    // PER_SET has no way limit: past 256 ways LRU keeps 32-bit ranks
+    {
+        const size_t wide_size = 32768, wide_ways = 512;
+        SyntheticTraceConfig wide = config;
+        wide.accesses = 20000;
+        wide.footprint = 4 * wide_size;
+        wide.stride = wide_size / wide_ways;
+        wide.assoc = wide_ways;
+        LockstepValidator validator(wide_size, block, wide_ways, 4096);
+        validator.add_engine(make_lockstep_engine("per-set", wide_size, block, wide_ways));
+        SyntheticTrace trace(wide);
+        LockstepReport report = validator.run(trace);
+        assert(!report.diverged && report.reference.evictions > 0);
+    }
+    assert(!make_lockstep_engine("fixed", 64 * 32 * 64, 64, 32));    // No instantiation
+    assert(!make_lockstep_engine("flat", 64 * 128 * 64, 64, 128));
+    assert(make_lockstep_engine("per-set", 64 * 128 * 64, 64, 128));
+    assert(!make_lockstep_engine("simd", size, block, ways));
+
+    // A wrong result is caught at its access, with the set's recent history
+    struct Broken : LockstepEngine {
+        std::unique_ptr<LockstepEngine> inner;
+        uint64_t bad;
+        uint64_t seen = 0;
+        Broken(uint64_t bad) : inner(make_lockstep_engine("flat", 16384, 64, 4)), bad(bad) {}
+        const std::string& name() const override {
+            static const std::string label = "broken";
+            return label;
+        }
+        void run(const TraceEntry* entries, size_t n, AccessResult* results) override {
+            inner->run(entries, n, results);
+            if (bad >= seen && bad < seen + n) {
+                results[bad - seen].way ^= 1;
+            }
+            seen += n;
+        }
+        CacheStats get_stats() const override { return inner->get_stats(); }
+    };
+    {
+        const uint64_t bad = 123457;
+        LockstepValidator validator(size, block, ways, 4096, 8);
+        validator.add_engine(make_lockstep_engine("batch", size, block, ways));
+        validator.add_engine(std::make_unique<Broken>(bad));
+        SyntheticTrace trace(config);
+        LockstepReport report = validator.run(trace);
+        const Divergence& d = report.divergence;
+        assert(report.diverged && !report.passed() && report.accesses == bad + 1);
+        assert(d.engine == "broken" && d.index == bad && std::string(d.field) == "way");
+        assert(d.actual.way == (d.expected.way ^ 1) && d.lines.size() == ways);
+        assert(d.history.size() == 8 && d.lru_order.back() == static_cast<size_t>(d.expected.way));
+        for (size_t i = 0; i < d.history.size(); i++) {
+            assert(d.history[i].result.set_index == d.expected.set_index);
+            assert(d.history[i].index < bad && (i == 0 || d.history[i - 1].index < d.history[i].index));
+        }
+        std::ostringstream out;
+        print_lockstep_report(report, out);
+        assert(out.str().find("DIVERGENCE in broken at access 123457") != std::string::npos);
+    }
+
+    // Trace files stream the same accesses: raw uint64, .mtr records, text
+    std::filesystem::path dir = std::filesystem::temp_directory_path();
+    std::vector<TraceEntry> expect(1000);
+    SyntheticTrace(config).next(expect.data(), expect.size());
+    {
+        std::ofstream raw(dir / "lockstep_test.bin", std::ios::binary);
+        std::ofstream mtr(dir / "lockstep_test.mtr", std::ios::binary);
+        std::ofstream text(dir / "lockstep_test.txt");
+        char header[32] = "MEMTRACE";
+        uint32_t version = 1, record_size = 16;
+        uint64_t count = expect.size();
+        std::memcpy(header + 8, &version, 4);
+        std::memcpy(header + 12, &record_size, 4);
+        std::memcpy(header + 16, &count, 8);
+        mtr.write(header, sizeof(header));
+        for (const TraceEntry& e : expect) {
+            raw.write(reinterpret_cast<const char*>(&e.address), 8);
+            char record[16] = {};
+            std::memcpy(record, &e.address, 8);
+            record[14] = e.type == AccessType::WRITE ? 1 : 0;
+            mtr.write(record, sizeof(record));
+            text << (e.type == AccessType::WRITE ? "W" : "R") << " 0x" << std::hex << e.address
+                 << "\n";
+        }
+    }
+    const char* names[] = {"lockstep_test.bin", "lockstep_test.mtr", "lockstep_test.txt"};
+    for (const char* name : names) {
+        TraceFile file((dir / name).string());
+        std::vector<TraceEntry> got(expect.size() + 1);
+        size_t n = file.next(got.data(), 300);
+        n += file.next(got.data() + n, got.size() - n);
+        assert(n == expect.size() && file.next(got.data(), 1) == 0);
+        for (size_t i = 0; i < n; i++) {
+            bool raw = file.get_format() == TraceFile::Format::RAW;
+            assert(got[i].address == expect[i].address);
+            assert(raw ? got[i].type == AccessType::READ : got[i].type == expect[i].type);
+        }
+        std::filesystem::remove(dir / name);
+    }
+}
+
 // ============================================================================
 // Main
 // ============================================================================
@@ -12,35 +12,40 @@ namespace memsim {
  * - Valid bit: Is this line currently holding valid data?
  * - Dirty bit: Has the data been modified (needs write-back)?
  * - Tag: Which memory block does this line represent?
- * - Data: The actual cached bytes
- * - Last access cycle: For LRU replacement policy
+ *
+ * By default a line is metadata only: the simulators never look at the
+ * cached bytes, so a line is just its tag and two flag bits (16 bytes, no
+ * heap allocation). Build with MEMSIM_LINE_DATA for functional simulation,
+ * which adds a per-line data buffer of block_size bytes.
  */
 struct CacheLine {
-  // State flags
-  bool valid; // Is this cache line valid?
-  bool dirty; // Has this line been written to (needs write-back)?
-
   // Address information
   uint64_t tag; // Tag bits from the address (identifies which block)
 
+  // State flags (packed)
+  bool valid : 1; // Is this cache line valid?
+  bool dirty : 1; // Has this line been written to (needs write-back)?
+
+#ifdef MEMSIM_LINE_DATA
   // Data storage
   std::vector<uint8_t> data; // The actual cached data bytes
-
-  // Replacement policy tracking
-  uint64_t last_access_cycle; // Last time this line was accessed (for LRU)
+#endif
 
   /**
    * Default constructor - initializes to empty/invalid state
    */
-  CacheLine() : valid(false), dirty(false), tag(0), last_access_cycle(0) {}
+  CacheLine() : tag(0), valid(false), dirty(false) {}
 
   /**
-   * Constructor with block size - allocates data array
+   * Constructor with block size - allocates data array when lines carry data
    * @param block_size Number of bytes in this cache line
    */
+#ifdef MEMSIM_LINE_DATA
   explicit CacheLine(uint32_t block_size)
-      : valid(false), dirty(false), tag(0), data(block_size, 0),
-        last_access_cycle(0) {}
+      : tag(0), valid(false), dirty(false), data(block_size, 0) {}
+#else
+  explicit CacheLine(uint32_t /*block_size*/) : CacheLine() {}
+#endif
 
   /**
    * Reset this cache line to empty state
@@ -50,7 +55,6 @@ struct CacheLine {
     valid = false;
     dirty = false;
     tag = 0;
-    last_access_cycle = 0;
     // Don't clear data array - just mark as invalid
   }
 
@@ -60,6 +64,19 @@ struct CacheLine {
    * @return true if valid and tag matches
    */
   bool matches(uint64_t query_tag) const { return valid && (tag == query_tag); }
+
+  /**
+   * Whether this build carries per-line data bytes
+   */
+#ifdef MEMSIM_LINE_DATA
+  static constexpr bool HAS_DATA = true;
+#else
+  static constexpr bool HAS_DATA = false;
+#endif
 };
 
+#ifndef MEMSIM_LINE_DATA
+static_assert(sizeof(CacheLine) == 16, "Metadata-only CacheLine should be tag + flags");
+#endif
+
 } // namespace memsim
@@ -1,4 +1,6 @@
 #include "direct_mapped_cache.h"
+#include "../../4-way cache/include/checkpoint.h"
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <iomanip>
@@ -6,10 +8,55 @@
 
 namespace memsim {
 
+namespace {
+constexpr size_t BATCH_CHUNK = 64;      // Requests decoded per chunk
+constexpr size_t PREFETCH_DISTANCE = 8; // Requests between prefetch and use
+
+AccessType request_type(const MemoryRequest &r) { return r.type; }
+AccessType request_type(const TraceRecord &r) { return r.type(); }
+
+// The flag bit-fields have no fixed layout, so lines go out as an array of
+// tags and an array of valid | dirty << 1 bytes, then any line data
+void save_lines(CheckpointWriter &out, const std::vector<CacheLine> &lines) {
+  std::vector<uint64_t> tags(lines.size());
+  std::vector<uint8_t> flags(lines.size());
+  for (size_t i = 0; i < lines.size(); i++) {
+    tags[i] = lines[i].tag;
+    flags[i] = static_cast<uint8_t>(lines[i].valid | (lines[i].dirty << 1));
+  }
+  out.put_vector(tags);
+  out.put_vector(flags);
+#ifdef MEMSIM_LINE_DATA
+  for (const CacheLine &line : lines) {
+    out.put_vector(line.data);
+  }
+#endif
+}
+
+void restore_lines(CheckpointReader &in, std::vector<CacheLine> &lines) {
+  std::vector<uint64_t> tags(lines.size());
+  std::vector<uint8_t> flags(lines.size());
+  in.get_vector(tags);
+  in.get_vector(flags);
+  for (size_t i = 0; i < lines.size(); i++) {
+    lines[i].tag = tags[i];
+    lines[i].valid = flags[i] & 1;
+    lines[i].dirty = (flags[i] >> 1) & 1;
+  }
+#ifdef MEMSIM_LINE_DATA
+  for (CacheLine &line : lines) {
+    in.get_vector(line.data);
+  }
+#endif
+}
+} // namespace
+
 DirectMappedCache::DirectMappedCache(const CacheConfig &config,
-                                     Cycle cache_latency, Cycle memory_latency)
+                                     Cycle cache_latency, Cycle memory_latency,
+                                     bool sparse)
     : config_(config), cache_latency_(cache_latency),
-      memory_latency_(memory_latency), current_cycle_(0) {
+      memory_latency_(memory_latency), sparse_(sparse), page_lines_(0),
+      current_cycle_(0) {
 
   // Calculate number of cache lines
   // num_lines = (size_kb * 1024) / block_size
@@ -19,10 +66,12 @@ DirectMappedCache::DirectMappedCache(const CacheConfig &config,
   offset_bits_ = log2(config_.block_size);
   index_bits_ = log2(num_lines_);
 
-  // Initialize cache lines
-  lines_.reserve(num_lines_);
-  for (uint32_t i = 0; i < num_lines_; ++i) {
-    lines_.emplace_back(config_.block_size);
+  // Initialize cache lines (one allocation unless lines carry data)
+  if (sparse_) {
+    page_lines_ = std::min(SPARSE_PAGE_LINES, num_lines_);
+    page_table_.assign(num_lines_ / page_lines_, 0);
+  } else {
+    lines_.assign(num_lines_, CacheLine(config_.block_size));
   }
 
   // Verify configuration
@@ -51,6 +100,18 @@ uint64_t DirectMappedCache::extract_offset(Address addr) const {
   return addr & (config_.block_size - 1);
 }
 
+CacheLine &DirectMappedCache::line_at(uint64_t index) {
+  if (!sparse_) {
+    return lines_[index];
+  }
+  uint32_t &slot = page_table_[index / page_lines_];
+  if (slot == 0) {
+    pages_.emplace_back(page_lines_, CacheLine(config_.block_size));
+    slot = static_cast<uint32_t>(pages_.size());
+  }
+  return pages_[slot - 1][index % page_lines_];
+}
+
 AccessResult DirectMappedCache::access(Address addr, AccessType type) {
   // Step 1: Decode the address
   uint64_t index = extract_index(addr);
@@ -58,16 +119,13 @@ AccessResult DirectMappedCache::access(Address addr, AccessType type) {
   uint64_t offset = extract_offset(addr);
 
   // Step 2: Look up the cache line
-  CacheLine &line = lines_[index];
+  CacheLine &line = line_at(index);
 
   // Step 3: Check for hit or miss
   bool is_hit = line.matches(tag);
 
   if (is_hit) {
     // CACHE HIT!
-    // Update last access time (for LRU tracking)
-    line.last_access_cycle = current_cycle_;
-
     // If it's a write, mark the line as dirty
     if (type == AccessType::WRITE) {
       line.dirty = true;
@@ -86,14 +144,18 @@ AccessResult DirectMappedCache::access(Address addr, AccessType type) {
     // Need to evict current line (if valid) and load new data
 
     // Step 4: Evict old line if necessary
+    // Remember where a dirty victim lives so callers can write it back
+    bool wrote_back = false;
+    Address victim_addr = 0;
     if (line.valid) {
-      evict(index);
+      victim_addr = (line.tag << (index_bits_ + offset_bits_)) |
+                    (index << offset_bits_);
+      wrote_back = evict(index);
     }
 
     // Step 5: Load new data from memory (simulated)
     line.valid = true;
     line.tag = tag;
-    line.last_access_cycle = current_cycle_;
 
     // If it's a write, mark as dirty
     // Otherwise, it's clean (just loaded from memory)
@@ -105,17 +167,60 @@ AccessResult DirectMappedCache::access(Address addr, AccessType type) {
     // Advance simulation time
     current_cycle_ += memory_latency_;
 
-    return AccessResult(false, memory_latency_);
+    AccessResult result(false, memory_latency_);
+    result.writeback = wrote_back;
+    result.writeback_addr = victim_addr;
+    return result;
+  }
+}
+
+void DirectMappedCache::access_batch(const MemoryRequest *requests, size_t n,
+                                     AccessResult *results) {
+  access_batch_impl(requests, n, results);
+}
+
+void DirectMappedCache::access_batch(TraceSpan records,
+                                     AccessResult *results) {
+  access_batch_impl(records.data, records.size, results);
+}
+
+template <typename Record>
+void DirectMappedCache::access_batch_impl(const Record *records, size_t n,
+                                          AccessResult *results) {
+  uint64_t index[BATCH_CHUNK];
+  for (size_t base = 0; base < n; base += BATCH_CHUNK) {
+    const Record *chunk = records + base;
+    size_t count = std::min(BATCH_CHUNK, n - base);
+
+    // Decode every line index of the chunk up front
+    for (size_t i = 0; i < count; ++i) {
+      index[i] = extract_index(chunk[i].addr);
+    }
+    // (sparse pages aren't contiguous, so only dense lines are prefetched)
+    for (size_t i = 0; i < count && i < PREFETCH_DISTANCE && !sparse_; ++i) {
+      __builtin_prefetch(&lines_[index[i]], 1);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+      if (i + PREFETCH_DISTANCE < count && !sparse_) {
+        __builtin_prefetch(&lines_[index[i + PREFETCH_DISTANCE]], 1);
+      }
+      AccessResult r = access(chunk[i].addr, request_type(chunk[i]));
+      if (results) {
+        results[base + i] = r;
+      }
+    }
   }
 }
 
-void DirectMappedCache::evict(uint64_t index) {
-  CacheLine &line = lines_[index];
+bool DirectMappedCache::evict(uint64_t index) {
+  CacheLine &line = line_at(index);
 
   // Only evict if line is valid
   if (!line.valid) {
-    return;
+    return false;
   }
+  bool was_dirty = line.dirty;
 
   // If line is dirty, we need to write it back to memory
   if (line.dirty) {
@@ -130,13 +235,18 @@ void DirectMappedCache::evict(uint64_t index) {
 
   // Invalidate the line
   line.reset();
+  return was_dirty;
 }
 
 void DirectMappedCache::print_config(std::ostream &out) const {
   out << "Direct-Mapped Cache Configuration:\n";
   out << "  Size: " << config_.size_kb << " KB\n";
   out << "  Block size: " << config_.block_size << " bytes\n";
-  out << "  Number of lines: " << num_lines_ << "\n";
+  out << "  Number of lines: " << num_lines_;
+  if (sparse_) {
+    out << " (sparse, " << allocated_lines() << " allocated)";
+  }
+  out << "\n";
   out << "  Index bits: " << index_bits_ << "\n";
   out << "  Offset bits: " << offset_bits_ << "\n";
   out << "  Cache hit latency: " << cache_latency_ << " cycles\n";
@@ -153,4 +263,58 @@ uint32_t DirectMappedCache::log2(uint32_t n) {
   return result;
 }
 
+void DirectMappedCache::save(CheckpointWriter &out) const {
+  out.begin_section("DIRECT");
+  out.put(config_.size_kb);
+  out.put(config_.block_size);
+  out.put(static_cast<uint8_t>(sparse_));
+  out.put(static_cast<uint8_t>(CacheLine::HAS_DATA));
+  out.put(stats_);
+  out.put(current_cycle_);
+  if (!sparse_) {
+    save_lines(out, lines_);
+  } else {
+    out.put(static_cast<uint64_t>(pages_.size()));
+    for (size_t d = 0; d < page_table_.size(); d++) {
+      if (page_table_[d]) {
+        out.put(static_cast<uint64_t>(d));
+        save_lines(out, pages_[page_table_[d] - 1]);
+      }
+    }
+  }
+  out.end_section();
+}
+
+void DirectMappedCache::restore(CheckpointReader &in) {
+  DirectMappedCache staged(*this);
+  staged.load(in);
+  *this = std::move(staged);
+}
+
+void DirectMappedCache::load(CheckpointReader &in) {
+  in.enter_section("DIRECT");
+  in.expect(config_.size_kb, "cache size");
+  in.expect(config_.block_size, "block size");
+  in.expect(static_cast<uint8_t>(sparse_), "sparse storage");
+  in.expect(static_cast<uint8_t>(CacheLine::HAS_DATA), "line data (MEMSIM_LINE_DATA)");
+  stats_ = in.get<Statistics>();
+  current_cycle_ = in.get<Cycle>();
+  if (!sparse_) {
+    restore_lines(in, lines_);
+  } else {
+    pages_.clear();
+    std::fill(page_table_.begin(), page_table_.end(), 0);
+    uint64_t mapped = in.get<uint64_t>();
+    for (uint64_t i = 0; i < mapped; i++) {
+      uint64_t d = in.get<uint64_t>();
+      if (d >= page_table_.size() || page_table_[d]) {
+        throw std::runtime_error("checkpoint: bad sparse page index");
+      }
+      line_at(d * page_lines_); // Maps the page
+      restore_lines(in, pages_.back());
+    }
+  }
+  in.leave_section();
+}
+
 } // namespace memsim
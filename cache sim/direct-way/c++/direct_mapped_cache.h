@@ -1,22 +1,30 @@
 #pragma once
 
-#include "../../memory system simulator/c++/config.h"
-#include "../../memory system simulator/c++/statistics.h"
-#include "../../memory system simulator/c++/types.h"
+#include "../../../memory system simulator/c++/config.h"
+#include "../../../memory system simulator/c++/statistics.h"
+#include "../../../memory system simulator/c++/trace_format.h"
+#include "../../../memory system simulator/c++/types.h"
 #include "cache_line.h"
 #include <cstdint>
+#include <deque>
 #include <vector>
 
+class CheckpointWriter; // cache sim/4-way cache/include/checkpoint.h
+class CheckpointReader;
+
 namespace memsim {
 
 /**
  * AccessResult - Result of a cache access operation
  */
 struct AccessResult {
-  bool hit;      // Was it a cache hit?
-  Cycle latency; // Latency in cycles for this access
+  bool hit;               // Was it a cache hit?
+  Cycle latency;          // Latency in cycles for this access
+  bool writeback;         // Did the miss evict a dirty line?
+  Address writeback_addr; // Block address of the evicted dirty line
 
-  AccessResult(bool hit, Cycle latency) : hit(hit), latency(latency) {}
+  AccessResult(bool hit = false, Cycle latency = 0)
+      : hit(hit), latency(latency), writeback(false), writeback_addr(0) {}
 };
 
 /**
@@ -35,9 +43,11 @@ public:
    * @param config Cache configuration (size, block size, etc.)
    * @param cache_latency Latency in cycles for cache hit
    * @param memory_latency Latency in cycles for memory access (miss)
+   * @param sparse Allocate lines a page at a time on first touch instead of
+   *               all up front (huge caches that a trace only partly uses)
    */
   DirectMappedCache(const CacheConfig &config, Cycle cache_latency = 1,
-                    Cycle memory_latency = 100);
+                    Cycle memory_latency = 100, bool sparse = false);
 
   /**
    * Access the cache (read or write)
@@ -47,6 +57,22 @@ public:
    */
   AccessResult access(Address addr, AccessType type);
 
+  /**
+   * Access a contiguous run of requests, same result as calling access() on
+   * each in order. Line indices are decoded a chunk at a time and each
+   * target line is prefetched a few requests ahead so lookups overlap.
+   * @param requests Requests to replay (arrival cycles are ignored)
+   * @param n Number of requests
+   * @param results Optional output buffer of n results (nullptr = stats only)
+   */
+  void access_batch(const MemoryRequest *requests, size_t n,
+                    AccessResult *results = nullptr);
+
+  /**
+   * Same, straight from a mapped binary trace (TraceReader::next_batch())
+   */
+  void access_batch(TraceSpan records, AccessResult *results = nullptr);
+
   /**
    * Get cache statistics
    * @return Reference to statistics object
@@ -58,6 +84,26 @@ public:
    */
   void print_config(std::ostream &out) const;
 
+  /**
+   * Lines currently allocated (all of them unless sparse)
+   */
+  uint64_t allocated_lines() const {
+    return sparse_ ? pages_.size() * page_lines_ : lines_.size();
+  }
+
+  /**
+   * Write every line (only allocated pages if sparse), stats and the cycle
+   */
+  void save(::CheckpointWriter &out) const;
+
+  /**
+   * Replace this cache's state with a saved one
+   * Decoded into a copy first, so a failed restore changes nothing.
+   * @throws std::invalid_argument if the size, block size or storage differs
+   * @throws std::runtime_error on a truncated or corrupt snapshot
+   */
+  void restore(::CheckpointReader &in);
+
 private:
   // Configuration
   CacheConfig config_;
@@ -67,6 +113,13 @@ private:
   // Cache storage
   std::vector<CacheLine> lines_;
 
+  // Sparse storage: page_table_[index / page_lines_] is page + 1, 0 = untouched
+  static constexpr uint32_t SPARSE_PAGE_LINES = 4096;
+  bool sparse_;
+  uint32_t page_lines_;
+  std::vector<uint32_t> page_table_;
+  std::deque<std::vector<CacheLine>> pages_;
+
   // Derived parameters (computed from config)
   uint32_t num_lines_;   // Number of cache lines
   uint32_t offset_bits_; // Number of bits for offset
@@ -78,6 +131,10 @@ private:
   // Current simulation cycle
   Cycle current_cycle_;
 
+  template <typename Record>
+  void access_batch_impl(const Record *records, size_t n,
+                         AccessResult *results);
+
   /**
    * Extract tag bits from address
    * Tag identifies which memory block this address belongs to
@@ -105,8 +162,19 @@ private:
   /**
    * Evict a cache line (write back if dirty)
    * @param index Cache line index to evict
+   * @return true if the line was dirty and had to be written back
+   */
+  bool evict(uint64_t index);
+
+  /**
+   * Line slot for an index, allocating its page first if sparse
+   */
+  CacheLine &line_at(uint64_t index);
+
+  /**
+   * Decode a saved state over this one (restore() runs it on a copy)
    */
-  void evict(uint64_t index);
+  void load(::CheckpointReader &in);
 
   /**
    * Compute log2 of a number (assumes power of 2)
@@ -1,5 +1,7 @@
 #include "../include/direct_mapped_cache.h"
+#include "../../4-way cache/include/checkpoint.h"
 #include <cassert>
+#include <cstdio>
 #include <iomanip>
 #include <iostream>
 #include <random>
@@ -163,6 +165,8 @@ void test_writeback() {
   std::cout << "  Result: " << (result3.hit ? "HIT" : "MISS")
             << " (expected MISS, evicts 0x0)\n";
   assert(!result3.hit && "Conflicting address should miss");
+  assert(result3.writeback && result3.writeback_addr == addr_a &&
+         "Dirty 0x0 should be reported for write-back");
 
   // Step 4: Access original address again (should miss, was evicted)
   std::cout << "\nStep 4: Access address 0x0 again (was evicted)\n";
@@ -170,6 +174,7 @@ void test_writeback() {
   std::cout << "  Result: " << (result4.hit ? "HIT" : "MISS")
             << " (expected MISS, was evicted)\n";
   assert(!result4.hit && "Evicted address should miss");
+  assert(!result4.writeback && "Clean 0x400 needs no write-back");
 
   // Print statistics
   std::cout << "\nFinal Statistics:\n";
@@ -227,6 +232,154 @@ void test_conflict_misses() {
   std::cout << "\n✓ Conflict miss test passed!\n";
 }
 
+/**
+ * Test 5: Large Metadata-Only Cache
+ *
+ * Tests that a 32 MB model builds without per-line buffers and still tracks
+ * dirty lines.
+ */
+void test_large_cache() {
+  std::cout << "\n=== Test 5: Large Metadata-Only Cache ===\n";
+
+  // 32 MB, 64-byte blocks = 512K lines
+  CacheConfig config(32 * 1024, 64, 1);
+  DirectMappedCache cache(config);
+
+  if (!CacheLine::HAS_DATA) {
+    assert(sizeof(CacheLine) == 16);
+  }
+
+  Address addr1 = 0x1000;
+  Address addr2 = addr1 + 32ULL * 1024 * 1024; // Same index, next tag
+  assert(!cache.access(addr1, AccessType::WRITE).hit);
+  assert(cache.access(addr1, AccessType::READ).hit);
+  AccessResult r = cache.access(addr2, AccessType::READ);
+  assert(!r.hit && r.writeback && r.writeback_addr == addr1);
+
+  std::cout << "Line size: " << sizeof(CacheLine) << " bytes ("
+            << (CacheLine::HAS_DATA ? "with" : "no") << " data buffer)\n";
+  std::cout << "\n✓ Large cache test passed!\n";
+}
+
+/**
+ * Test 6: Batched Access
+ *
+ * Tests that access_batch() gives the same results as one access() per
+ * request, from both MemoryRequests and binary trace records.
+ */
+void test_access_batch() {
+  std::cout << "\n=== Test 6: Batched Access ===\n";
+
+  CacheConfig config(4, 64, 1);
+  DirectMappedCache one(config), batched(config), from_trace(config);
+
+  std::mt19937_64 gen(7);
+  std::vector<MemoryRequest> requests;
+  std::vector<TraceRecord> records;
+  for (int i = 0; i < 5000; ++i) {
+    Address addr = gen() % 32768;
+    AccessType type = gen() % 4 == 0 ? AccessType::WRITE : AccessType::READ;
+    requests.emplace_back(addr, 0, type, 8);
+    records.push_back(TraceRecord::make(addr, type, 8));
+  }
+
+  std::vector<AccessResult> results(requests.size());
+  batched.access_batch(requests.data(), requests.size(), results.data());
+  from_trace.access_batch(TraceSpan{records.data(), records.size()});
+  for (size_t i = 0; i < requests.size(); ++i) {
+    AccessResult r = one.access(requests[i].addr, requests[i].type);
+    assert(r.hit == results[i].hit && r.writeback == results[i].writeback);
+    assert(r.writeback_addr == results[i].writeback_addr);
+  }
+  assert(batched.get_stats().total_hits() == one.get_stats().total_hits());
+  assert(from_trace.get_stats().total_hits() == one.get_stats().total_hits());
+
+  std::cout << "Hits: " << one.get_stats().total_hits() << " / "
+            << requests.size() << "\n";
+  std::cout << "\n✓ Batched access test passed!\n";
+}
+
+/**
+ * Test 7: Sparse Storage
+ *
+ * Tests that a sparse cache gives the same results as a dense one while
+ * allocating only the pages the trace touches.
+ */
+void test_sparse_storage() {
+  std::cout << "\n=== Test 7: Sparse Storage ===\n";
+
+  CacheConfig config(256 * 1024, 64, 1); // 256 MB, 4M lines
+  DirectMappedCache dense(config), sparse(config, 1, 100, true);
+  assert(sparse.allocated_lines() == 0);
+
+  std::mt19937_64 gen(11);
+  for (int i = 0; i < 20000; ++i) {
+    // Two 256 KB regions, several tags per line
+    Address addr = (gen() % 8) * (256ULL << 20) + (gen() % 2) * (64ULL << 20) +
+                   gen() % (256 * 1024);
+    AccessType type = gen() % 4 == 0 ? AccessType::WRITE : AccessType::READ;
+    AccessResult a = dense.access(addr, type);
+    AccessResult b = sparse.access(addr, type);
+    assert(a.hit == b.hit && a.writeback == b.writeback);
+    assert(a.writeback_addr == b.writeback_addr);
+  }
+  assert(dense.get_stats().total_hits() == sparse.get_stats().total_hits());
+  assert(sparse.allocated_lines() == 2 * 4096);
+
+  std::cout << "Allocated " << sparse.allocated_lines() << " of 4194304 lines\n";
+  std::cout << "\n✓ Sparse storage test passed!\n";
+}
+
+/**
+ * Test 8: Checkpoint and Restore
+ * A cache restored from a snapshot continues exactly like the original
+ */
+void test_checkpoint() {
+  std::cout << "\n=== Test 8: Checkpoint and Restore ===\n";
+
+  const char *path = "test_direct_mapped.ckpt";
+  for (bool sparse : {false, true}) {
+    CacheConfig config(sparse ? 64 * 1024 : 64, 64, 1);
+    DirectMappedCache warm(config, 1, 100, sparse);
+    std::mt19937_64 gen(3);
+    for (int i = 0; i < 20000; ++i) {
+      warm.access(gen() % (1 << 22), gen() % 3 ? AccessType::READ
+                                               : AccessType::WRITE);
+    }
+    {
+      CheckpointWriter out(path);
+      warm.save(out);
+      out.close();
+    }
+    DirectMappedCache restored(config, 1, 100, sparse);
+    CheckpointReader in(path);
+    restored.restore(in);
+    assert(restored.allocated_lines() == warm.allocated_lines());
+    assert(restored.get_stats().total_hits() == warm.get_stats().total_hits());
+    for (int i = 0; i < 20000; ++i) {
+      Address addr = gen() % (1 << 22);
+      AccessResult a = warm.access(addr, AccessType::READ);
+      AccessResult b = restored.access(addr, AccessType::READ);
+      assert(a.hit == b.hit && a.writeback == b.writeback);
+      assert(a.writeback_addr == b.writeback_addr);
+    }
+
+    // Dense and sparse snapshots don't mix
+    DirectMappedCache other(config, 1, 100, !sparse);
+    in.rewind();
+    bool rejected = false;
+    try {
+      other.restore(in);
+    } catch (const std::invalid_argument &) {
+      rejected = true;
+    }
+    assert(rejected);
+  }
+  std::remove(path);
+
+  std::cout << "\n✓ Checkpoint test passed!\n";
+}
+
 int main() {
   std::cout << "======================================\n";
   std::cout << "Direct-Mapped Cache Simulator Tests\n";
@@ -237,6 +390,10 @@ int main() {
     test_random_access();
     test_writeback();
     test_conflict_misses();
+    test_large_cache();
+    test_access_batch();
+    test_sparse_storage();
+    test_checkpoint();
 
     std::cout << "\n======================================\n";
     std::cout << "✓ All tests passed!\n";
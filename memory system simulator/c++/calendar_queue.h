@@ -0,0 +1,131 @@
+#pragma once
+
+#include "types.h"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace memsim {
+
+/**
+ * CalendarQueue - Timing-wheel event queue for the event-driven models
+ *
+ * Events within `slots` cycles of the current time go straight into the
+ * wheel, one bucket per cycle (O(1) schedule and pop). Events further out
+ * wait in an overflow min-heap and move into the wheel as time reaches
+ * them, so a burst of far-future events costs O(log n) once rather than
+ * on every pop.
+ *
+ *   wheel:    [now][now+1] ... [now+slots-1]     bucket = cycle & (slots-1)
+ *   overflow: heap of events at >= now + slots
+ *
+ * Events at the same cycle pop in the order they were scheduled. When the
+ * wheel is empty, time jumps straight to the next overflow event instead of
+ * stepping through idle cycles.
+ */
+template <typename Event> class CalendarQueue {
+public:
+  /**
+   * @param slots Wheel size in cycles (power of 2)
+   */
+  explicit CalendarQueue(size_t slots = 4096)
+      : wheel_(slots), mask_(slots - 1), now_(0), cursor_(0), near_(0),
+        seq_(0) {
+    assert(slots > 0 && (slots & (slots - 1)) == 0 &&
+           "Wheel size must be power of 2");
+  }
+
+  /**
+   * Schedule an event
+   * @param when Cycle to deliver it (>= now())
+   */
+  void schedule(Cycle when, const Event &event) {
+    assert(when >= now_ && "Cannot schedule into the past");
+    if (when - now_ < wheel_.size()) {
+      wheel_[when & mask_].push_back(event);
+      near_++;
+    } else {
+      far_.push_back(Far{when, seq_++, event});
+      std::push_heap(far_.begin(), far_.end(), later);
+    }
+  }
+
+  /**
+   * Remove the earliest event
+   * @param when Set to the event's cycle (also the new now())
+   * @param event Set to the event
+   * @return false if the queue is empty
+   */
+  bool pop(Cycle &when, Event &event) {
+    return pop_before(std::numeric_limits<Cycle>::max(), when, event);
+  }
+
+  /**
+   * Remove the earliest event if it is due before limit
+   * Time never moves to limit or past it, so events at >= limit (or at any
+   * cycle from now() on) can still be scheduled afterwards.
+   * @return false if the queue is empty or its earliest event is at >= limit
+   */
+  bool pop_before(Cycle limit, Cycle &when, Event &event) {
+    if (empty() || now_ >= limit) {
+      return false;
+    }
+    for (;;) {
+      std::vector<Event> &bucket = wheel_[now_ & mask_];
+      if (cursor_ < bucket.size()) {
+        event = bucket[cursor_++];
+        near_--;
+        when = now_;
+        return true;
+      }
+      Cycle next = near_ == 0 ? far_.front().when : now_ + 1;
+      if (next >= limit) {
+        return false;
+      }
+      bucket.clear();
+      cursor_ = 0;
+      now_ = next;
+      migrate();
+    }
+  }
+
+  bool empty() const { return near_ == 0 && far_.empty(); }
+  size_t size() const { return near_ + far_.size(); }
+
+  /** Cycle of the last event popped */
+  Cycle now() const { return now_; }
+
+private:
+  struct Far {
+    Cycle when;
+    uint64_t seq; // Keeps same-cycle events in schedule order
+    Event event;
+  };
+
+  static bool later(const Far &a, const Far &b) {
+    return a.when != b.when ? a.when > b.when : a.seq > b.seq;
+  }
+
+  /** Move overflow events that are now inside the wheel's window */
+  void migrate() {
+    while (!far_.empty() && far_.front().when - now_ < wheel_.size()) {
+      std::pop_heap(far_.begin(), far_.end(), later);
+      wheel_[far_.back().when & mask_].push_back(far_.back().event);
+      far_.pop_back();
+      near_++;
+    }
+  }
+
+  std::vector<std::vector<Event>> wheel_;
+  size_t mask_;
+  Cycle now_;
+  size_t cursor_; // Next event in the current bucket
+  size_t near_;   // Events in the wheel
+  std::vector<Far> far_;
+  uint64_t seq_;
+};
+
+} // namespace memsim
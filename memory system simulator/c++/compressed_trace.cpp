@@ -0,0 +1,364 @@
+#include "compressed_trace.h"
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef MEMSIM_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef MEMSIM_HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef MEMSIM_HAVE_LZ4
+#include <lz4frame.h>
+#endif
+
+namespace memsim {
+
+// ============================================================================
+// Format Detection
+// ============================================================================
+
+TraceCompression detect_trace_compression(const std::string &path) {
+  std::FILE *f = std::fopen(path.c_str(), "rb");
+  if (!f) {
+    throw std::runtime_error("Could not open trace file: " + path);
+  }
+  unsigned char magic[4] = {0, 0, 0, 0};
+  size_t n = std::fread(magic, 1, sizeof(magic), f);
+  std::fclose(f);
+
+  if (n >= 2 && magic[0] == 0x1F && magic[1] == 0x8B) {
+    return TraceCompression::GZIP;
+  }
+  if (n == 4 && magic[0] == 0x28 && magic[1] == 0xB5 && magic[2] == 0x2F &&
+      magic[3] == 0xFD) {
+    return TraceCompression::ZSTD;
+  }
+  if (n == 4 && magic[0] == 0x04 && magic[1] == 0x22 && magic[2] == 0x4D &&
+      magic[3] == 0x18) {
+    return TraceCompression::LZ4;
+  }
+  return TraceCompression::NONE;
+}
+
+bool compression_supported(TraceCompression format) {
+  switch (format) {
+  case TraceCompression::NONE:
+    return true;
+  case TraceCompression::GZIP:
+#ifdef MEMSIM_HAVE_ZLIB
+    return true;
+#else
+    return false;
+#endif
+  case TraceCompression::ZSTD:
+#ifdef MEMSIM_HAVE_ZSTD
+    return true;
+#else
+    return false;
+#endif
+  case TraceCompression::LZ4:
+#ifdef MEMSIM_HAVE_LZ4
+    return true;
+#else
+    return false;
+#endif
+  }
+  return false;
+}
+
+// ============================================================================
+// Decoders
+// ============================================================================
+
+/**
+ * Decoder - Pull-style decompressed byte stream
+ * read() fills as much of the buffer as it can; returns 0 at end of stream.
+ */
+class CompressedTraceSource::Decoder {
+public:
+  virtual ~Decoder() = default;
+  virtual size_t read(void *buf, size_t len) = 0;
+
+  /** Read exactly len bytes unless the stream ends first */
+  size_t read_full(void *buf, size_t len) {
+    size_t total = 0;
+    char *out = static_cast<char *>(buf);
+    while (total < len) {
+      size_t n = read(out + total, len - total);
+      if (n == 0) {
+        break;
+      }
+      total += n;
+    }
+    return total;
+  }
+};
+
+namespace {
+
+constexpr size_t INPUT_CHUNK = 1 << 20; // Compressed bytes per fread
+
+class PlainDecoder : public CompressedTraceSource::Decoder {
+public:
+  explicit PlainDecoder(std::FILE *f) : file_(f) {}
+  ~PlainDecoder() override { std::fclose(file_); }
+  size_t read(void *buf, size_t len) override {
+    return std::fread(buf, 1, len, file_);
+  }
+
+private:
+  std::FILE *file_;
+};
+
+#ifdef MEMSIM_HAVE_ZLIB
+class GzipDecoder : public CompressedTraceSource::Decoder {
+public:
+  explicit GzipDecoder(const std::string &path)
+      : file_(gzopen(path.c_str(), "rb")) {
+    if (!file_) {
+      throw std::runtime_error("Could not open gzip trace: " + path);
+    }
+    gzbuffer(file_, INPUT_CHUNK);
+  }
+  ~GzipDecoder() override { gzclose(file_); }
+  size_t read(void *buf, size_t len) override {
+    int n = gzread(file_, buf, static_cast<unsigned>(len));
+    if (n < 0) {
+      throw std::runtime_error("gzip decompression error");
+    }
+    return static_cast<size_t>(n);
+  }
+
+private:
+  gzFile file_;
+};
+#endif
+
+#ifdef MEMSIM_HAVE_ZSTD
+class ZstdDecoder : public CompressedTraceSource::Decoder {
+public:
+  explicit ZstdDecoder(std::FILE *f)
+      : file_(f), stream_(ZSTD_createDStream()), in_buf_(INPUT_CHUNK) {
+    ZSTD_initDStream(stream_);
+    input_ = {in_buf_.data(), 0, 0};
+  }
+  ~ZstdDecoder() override {
+    ZSTD_freeDStream(stream_);
+    std::fclose(file_);
+  }
+  size_t read(void *buf, size_t len) override {
+    ZSTD_outBuffer output = {buf, len, 0};
+    while (output.pos == 0) {
+      if (input_.pos == input_.size) {
+        input_.size = std::fread(in_buf_.data(), 1, in_buf_.size(), file_);
+        input_.pos = 0;
+        if (input_.size == 0) {
+          break; // End of file
+        }
+      }
+      size_t ret = ZSTD_decompressStream(stream_, &output, &input_);
+      if (ZSTD_isError(ret)) {
+        throw std::runtime_error(std::string("zstd decompression error: ") +
+                                 ZSTD_getErrorName(ret));
+      }
+    }
+    return output.pos;
+  }
+
+private:
+  std::FILE *file_;
+  ZSTD_DStream *stream_;
+  std::vector<char> in_buf_;
+  ZSTD_inBuffer input_;
+};
+#endif
+
+#ifdef MEMSIM_HAVE_LZ4
+class Lz4Decoder : public CompressedTraceSource::Decoder {
+public:
+  explicit Lz4Decoder(std::FILE *f)
+      : file_(f), in_buf_(INPUT_CHUNK), in_pos_(0), in_size_(0) {
+    if (LZ4F_isError(LZ4F_createDecompressionContext(&ctx_, LZ4F_VERSION))) {
+      std::fclose(file_);
+      throw std::runtime_error("Could not create lz4 decompression context");
+    }
+  }
+  ~Lz4Decoder() override {
+    LZ4F_freeDecompressionContext(ctx_);
+    std::fclose(file_);
+  }
+  size_t read(void *buf, size_t len) override {
+    size_t produced = 0;
+    while (produced == 0) {
+      if (in_pos_ == in_size_) {
+        in_size_ = std::fread(in_buf_.data(), 1, in_buf_.size(), file_);
+        in_pos_ = 0;
+        if (in_size_ == 0) {
+          break;
+        }
+      }
+      size_t out_size = len;
+      size_t src_size = in_size_ - in_pos_;
+      size_t ret = LZ4F_decompress(ctx_, buf, &out_size,
+                                   in_buf_.data() + in_pos_, &src_size,
+                                   nullptr);
+      if (LZ4F_isError(ret)) {
+        throw std::runtime_error(std::string("lz4 decompression error: ") +
+                                 LZ4F_getErrorName(ret));
+      }
+      in_pos_ += src_size;
+      produced = out_size;
+    }
+    return produced;
+  }
+
+private:
+  std::FILE *file_;
+  LZ4F_dctx *ctx_;
+  std::vector<char> in_buf_;
+  size_t in_pos_;
+  size_t in_size_;
+};
+#endif
+
+std::unique_ptr<CompressedTraceSource::Decoder>
+make_decoder(const std::string &path, TraceCompression format) {
+  if (!compression_supported(format)) {
+    throw std::runtime_error(
+        "Trace compression not supported by this build: " + path);
+  }
+  if (format == TraceCompression::GZIP) {
+#ifdef MEMSIM_HAVE_ZLIB
+    return std::unique_ptr<CompressedTraceSource::Decoder>(
+        new GzipDecoder(path));
+#endif
+  }
+
+  std::FILE *f = std::fopen(path.c_str(), "rb");
+  if (!f) {
+    throw std::runtime_error("Could not open trace file: " + path);
+  }
+  switch (format) {
+#ifdef MEMSIM_HAVE_ZSTD
+  case TraceCompression::ZSTD:
+    return std::unique_ptr<CompressedTraceSource::Decoder>(new ZstdDecoder(f));
+#endif
+#ifdef MEMSIM_HAVE_LZ4
+  case TraceCompression::LZ4:
+    return std::unique_ptr<CompressedTraceSource::Decoder>(new Lz4Decoder(f));
+#endif
+  default:
+    return std::unique_ptr<CompressedTraceSource::Decoder>(new PlainDecoder(f));
+  }
+}
+
+} // namespace
+
+// ============================================================================
+// CompressedTraceSource
+// ============================================================================
+
+CompressedTraceSource::CompressedTraceSource(const std::string &path,
+                                             size_t batch_records,
+                                             size_t ring_slots)
+    : format_(detect_trace_compression(path)),
+      decoder_(make_decoder(path, format_)),
+      slots_(ring_slots < 2 ? 2 : ring_slots) {
+  // The header is decoded synchronously so callers can inspect it up front
+  if (decoder_->read_full(&header_, sizeof(header_)) != sizeof(header_) ||
+      !header_.valid_magic()) {
+    throw std::runtime_error("Not a binary trace (bad magic): " + path);
+  }
+  if (header_.version != TRACE_VERSION ||
+      header_.record_size != sizeof(TraceRecord)) {
+    throw std::runtime_error("Unsupported trace version: " + path);
+  }
+
+  for (Slot &slot : slots_) {
+    slot.records.resize(batch_records == 0 ? 1 : batch_records);
+  }
+  worker_ = std::thread(&CompressedTraceSource::produce, this);
+}
+
+CompressedTraceSource::~CompressedTraceSource() {
+  stop_ = true;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    not_full_.notify_all();
+  }
+  if (worker_.joinable()) {
+    worker_.join();
+  }
+}
+
+void CompressedTraceSource::produce() {
+  try {
+    uint64_t remaining = header_.record_count;
+    while (remaining > 0 && !stop_) {
+      // Wait for a free slot
+      Slot *slot;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock,
+                       [&] { return stop_ || filled_ < slots_.size(); });
+        if (stop_) {
+          return;
+        }
+        slot = &slots_[tail_];
+      }
+
+      // Decompress directly into the slot, outside the lock
+      size_t want = slot->records.size();
+      if (want > remaining) {
+        want = static_cast<size_t>(remaining);
+      }
+      size_t bytes = decoder_->read_full(slot->records.data(),
+                                         want * sizeof(TraceRecord));
+      if (bytes != want * sizeof(TraceRecord)) {
+        throw std::runtime_error("Compressed trace truncated");
+      }
+      slot->count = want;
+      remaining -= want;
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      tail_ = (tail_ + 1) % slots_.size();
+      filled_++;
+      not_empty_.notify_one();
+    }
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    error_ = std::current_exception();
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  finished_ = true;
+  not_empty_.notify_one();
+}
+
+TraceSpan CompressedTraceSource::next_batch() {
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  // Hand the previous batch back to the producer
+  if (holding_) {
+    head_ = (head_ + 1) % slots_.size();
+    filled_--;
+    holding_ = false;
+    not_full_.notify_one();
+  }
+
+  not_empty_.wait(lock, [&] { return filled_ > 0 || finished_; });
+  if (filled_ == 0) {
+    if (error_) {
+      std::rethrow_exception(error_);
+    }
+    return TraceSpan{};
+  }
+
+  holding_ = true;
+  const Slot &slot = slots_[head_];
+  return TraceSpan{slot.records.data(), slot.count};
+}
+
+} // namespace memsim
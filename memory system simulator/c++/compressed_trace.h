@@ -0,0 +1,108 @@
+#pragma once
+
+#include "trace_format.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace memsim {
+
+/**
+ * TraceCompression - Container format of a trace file on disk
+ */
+enum class TraceCompression { NONE, GZIP, ZSTD, LZ4 };
+
+/**
+ * Detect the compression of a file from its leading magic bytes
+ * @throws std::runtime_error if the file can't be opened
+ */
+TraceCompression detect_trace_compression(const std::string &path);
+
+/**
+ * Whether this build can decompress the given format
+ * (gzip needs zlib, .zst needs libzstd, .lz4 needs liblz4 at build time)
+ */
+bool compression_supported(TraceCompression format);
+
+/**
+ * CompressedTraceSource - Streams a compressed binary trace
+ *
+ * A background thread reads and decompresses the file (a .mtr trace
+ * compressed with gzip, zstd or lz4; uncompressed also works) straight into
+ * a bounded ring of record batches. The simulation thread takes batches with
+ * next_batch(), so disk I/O, decompression and simulation overlap and memory
+ * use stays at ring_slots * batch_records records.
+ *
+ *   CompressedTraceSource src("trace.mtr.zst");
+ *   for (TraceSpan b = src.next_batch(); !b.empty(); b = src.next_batch())
+ *     for (const TraceRecord &r : b) simulate(r);
+ */
+class CompressedTraceSource {
+public:
+  /**
+   * Open a trace and start the decompression thread
+   * @param path Trace file (.mtr, .mtr.gz, .mtr.zst, .mtr.lz4)
+   * @param batch_records Records per batch
+   * @param ring_slots Number of batches buffered ahead of the consumer
+   * @throws std::runtime_error on unsupported or malformed input
+   */
+  explicit CompressedTraceSource(const std::string &path,
+                                 size_t batch_records = 64 * 1024,
+                                 size_t ring_slots = 8);
+  ~CompressedTraceSource();
+
+  CompressedTraceSource(const CompressedTraceSource &) = delete;
+  CompressedTraceSource &operator=(const CompressedTraceSource &) = delete;
+
+  /**
+   * Trace header (read before the constructor returns)
+   */
+  const TraceHeader &header() const { return header_; }
+
+  /**
+   * Next batch of decompressed records
+   * The span stays valid until the following call. Errors from the
+   * decompression thread are rethrown here.
+   * @return Records, or an empty span at end of trace
+   */
+  TraceSpan next_batch();
+
+  TraceCompression compression() const { return format_; }
+
+  /** Opaque per-format decoder (defined in compressed_trace.cpp) */
+  class Decoder;
+
+private:
+  struct Slot {
+    std::vector<TraceRecord> records;
+    size_t count = 0;
+  };
+
+  TraceCompression format_;
+  TraceHeader header_;
+  std::unique_ptr<Decoder> decoder_;
+
+  // Ring of batches: producer fills [tail], consumer reads [head]
+  std::vector<Slot> slots_;
+  size_t head_ = 0;
+  size_t tail_ = 0;
+  size_t filled_ = 0;
+  bool holding_ = false; // Consumer still owns slots_[head_]
+  bool finished_ = false;
+  std::exception_ptr error_;
+  std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+  std::atomic<bool> stop_{false};
+  std::thread worker_;
+
+  void produce();
+};
+
+} // namespace memsim
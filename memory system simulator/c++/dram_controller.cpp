@@ -0,0 +1,293 @@
+#include "dram_controller.h"
+#include <algorithm>
+#include <cassert>
+#include <iomanip>
+#include <string>
+
+namespace memsim {
+
+namespace {
+uint32_t log2_u32(uint32_t n) {
+  uint32_t result = 0;
+  while (n > 1) {
+    n >>= 1;
+    result++;
+  }
+  return result;
+}
+
+bool power_of_2(uint32_t n) { return n > 0 && (n & (n - 1)) == 0; }
+} // namespace
+
+// ============================================================================
+// AddressMapper
+// ============================================================================
+
+AddressMapper::AddressMapper(uint32_t banks, uint32_t row_bytes,
+                             uint32_t block_bytes, MappingScheme scheme,
+                             bool xor_banks)
+    : scheme_(scheme), xor_banks_(xor_banks), bank_mask_(banks - 1),
+      bank_bits_(log2_u32(banks)), block_bits_(log2_u32(block_bytes)),
+      column_bits_(log2_u32(row_bytes / block_bytes)) {
+  assert(power_of_2(banks) && "Bank count must be power of 2");
+  assert(power_of_2(row_bytes) && power_of_2(block_bytes) &&
+         block_bytes <= row_bytes && "Row and block sizes must be powers of 2");
+}
+
+DRAMAddress AddressMapper::decode(Address addr) const {
+  uint64_t block = addr >> block_bits_;
+  DRAMAddress d;
+  if (scheme_ == MappingScheme::ROW_BANK_COLUMN) {
+    d.column = static_cast<uint32_t>(block & ((1ULL << column_bits_) - 1));
+    d.bank = static_cast<uint32_t>((block >> column_bits_) & bank_mask_);
+  } else {
+    d.bank = static_cast<uint32_t>(block & bank_mask_);
+    d.column = static_cast<uint32_t>((block >> bank_bits_) &
+                                     ((1ULL << column_bits_) - 1));
+  }
+  d.row = block >> (column_bits_ + bank_bits_);
+  if (xor_banks_) {
+    d.bank ^= static_cast<uint32_t>(d.row & bank_mask_);
+  }
+  return d;
+}
+
+// ============================================================================
+// DRAMController
+// ============================================================================
+
+DRAMController::DRAMController(const DRAMConfig &timing,
+                               const DRAMControllerConfig &config)
+    : timing_(timing), config_(config),
+      mapper_(timing.banks, config.row_bytes, config.block_bytes,
+              config.mapping, config.xor_banks),
+      banks_(timing.banks), pending_(0), buffered_writes_(0),
+      draining_(false), bus_free_(0),
+      next_refresh_(config.tREFI ? config.tREFI : NEVER), reads_(0),
+      writes_(0), row_hits_(0), row_misses_(0), row_conflicts_(0),
+      refreshes_(0), write_drains_(0), total_queue_delay_(0), delay_hist_(),
+      first_arrival_(NEVER), last_completion_(0) {
+  assert(config_.queue_depth > 0 && "A bank queue must hold a request");
+  assert(config_.write_low < config_.write_high &&
+         "Write drain needs write_low < write_high");
+}
+
+void DRAMController::enqueue(Address addr, bool is_write, uint32_t tag,
+                             Cycle now) {
+  DRAMAddress d = mapper_.decode(addr);
+  Request req{d.row, now, tag, is_write};
+  uint32_t slot;
+  if (!free_slots_.empty()) {
+    slot = free_slots_.back();
+    free_slots_.pop_back();
+    requests_[slot] = req;
+  } else {
+    slot = static_cast<uint32_t>(requests_.size());
+    requests_.push_back(req);
+  }
+
+  Bank &bank = banks_[d.bank];
+  bank.waiting.push_back(slot);
+  admit(bank);
+  pending_++;
+  if (is_write) {
+    buffered_writes_++;
+  }
+  first_arrival_ = std::min(first_arrival_, now);
+}
+
+void DRAMController::admit(Bank &bank) {
+  while (!bank.waiting.empty() &&
+         bank.reads.size() + bank.writes.size() < config_.queue_depth) {
+    uint32_t slot = bank.waiting.front();
+    bank.waiting.pop_front();
+    (requests_[slot].is_write ? bank.writes : bank.reads).push_back(slot);
+  }
+}
+
+Cycle DRAMController::service(Cycle now,
+                              std::vector<DRAMCompletion> &completed) {
+  refresh_until(now);
+
+  if (!draining_ && buffered_writes_ >= config_.write_high) {
+    draining_ = true;
+    write_drains_++;
+  }
+
+  Cycle wake = NEVER;
+  for (Bank &bank : banks_) {
+    if (bank.reads.empty() && bank.writes.empty()) {
+      continue;
+    }
+    if (bank.ready > now) {
+      wake = std::min(wake, bank.ready);
+      continue;
+    }
+    // Reads first, unless draining writes or there is no read to send
+    bool send_write =
+        !bank.writes.empty() && (draining_ || bank.reads.empty());
+    std::vector<uint32_t> &queue = send_write ? bank.writes : bank.reads;
+    size_t pos = pick(bank, queue);
+    uint32_t slot = queue[pos];
+    queue.erase(queue.begin() + static_cast<std::ptrdiff_t>(pos));
+    completed.push_back(issue(bank, slot, now));
+    admit(bank);
+
+    if (draining_ && buffered_writes_ <= config_.write_low) {
+      draining_ = false;
+    }
+    if (!bank.reads.empty() || !bank.writes.empty()) {
+      wake = std::min(wake, bank.ready);
+    }
+  }
+  return wake;
+}
+
+size_t DRAMController::pick(const Bank &bank,
+                            const std::vector<uint32_t> &queue) const {
+  if (bank.row_open) {
+    for (size_t i = 0; i < queue.size(); ++i) {
+      if (requests_[queue[i]].row == bank.open_row) {
+        return i; // Oldest row hit
+      }
+    }
+  }
+  return 0; // Oldest
+}
+
+DRAMCompletion DRAMController::issue(Bank &bank, uint32_t slot, Cycle now) {
+  const Request req = requests_[slot];
+  free_slots_.push_back(slot);
+  pending_--;
+
+  Cycle t = now;
+  if (bank.row_open && bank.open_row == req.row) {
+    row_hits_++;
+  } else if (!bank.row_open) {
+    row_misses_++;
+    bank.activate_cycle = t;
+    t += timing_.tRCD;
+  } else {
+    row_conflicts_++;
+    t = std::max(t, bank.activate_cycle + timing_.tRAS);
+    t += timing_.tRP;
+    bank.activate_cycle = t;
+    t += timing_.tRCD;
+  }
+  bank.row_open = true;
+  bank.open_row = req.row;
+
+  // Column command at t; its data waits for the shared bus
+  Cycle data = std::max(t + timing_.tCAS, bus_free_);
+  bus_free_ = data + config_.burst_cycles;
+  bank.ready = t + config_.burst_cycles;
+
+  if (req.is_write) {
+    writes_++;
+    buffered_writes_--;
+  } else {
+    reads_++;
+  }
+  Cycle delay = now - req.arrival;
+  total_queue_delay_ += delay;
+  size_t bucket = 0;
+  for (Cycle d = delay; d > 0 && bucket < DELAY_BUCKETS - 1; d >>= 1) {
+    bucket++;
+  }
+  delay_hist_[bucket]++;
+
+  Cycle done = data + config_.burst_cycles;
+  last_completion_ = std::max(last_completion_, done);
+  return DRAMCompletion{req.tag, done};
+}
+
+void DRAMController::refresh_until(Cycle now) {
+  while (next_refresh_ <= now) {
+    for (Bank &bank : banks_) {
+      // Precharge first (after tRAS), then refresh for tRFC
+      Cycle start = std::max(next_refresh_, bank.ready);
+      if (bank.row_open) {
+        start = std::max(start, bank.activate_cycle + timing_.tRAS) +
+                timing_.tRP;
+        bank.row_open = false;
+      }
+      bank.ready = start + config_.tRFC;
+    }
+    refreshes_++;
+    next_refresh_ += config_.tREFI;
+  }
+}
+
+Cycle DRAMController::run(const std::vector<MemoryRequest> &requests) {
+  std::vector<DRAMCompletion> completed;
+  size_t next = 0;
+  Cycle wake = NEVER;
+  while (next < requests.size() || wake != NEVER) {
+    Cycle now = wake;
+    if (next < requests.size()) {
+      now = std::min(now, requests[next].arrival_cycle);
+    }
+    while (next < requests.size() && requests[next].arrival_cycle <= now) {
+      const MemoryRequest &r = requests[next++];
+      enqueue(r.addr, r.type == AccessType::WRITE, NO_TAG, now);
+    }
+    completed.clear();
+    wake = service(now, completed);
+  }
+  return last_completion_;
+}
+
+double DRAMController::row_hit_rate() const {
+  uint64_t total = row_hits_ + row_misses_ + row_conflicts_;
+  return total ? static_cast<double>(row_hits_) / total : 0.0;
+}
+
+double DRAMController::bandwidth() const {
+  if (first_arrival_ == NEVER || last_completion_ <= first_arrival_) {
+    return 0.0;
+  }
+  return static_cast<double>(reads_ + writes_) * config_.block_bytes /
+         static_cast<double>(last_completion_ - first_arrival_);
+}
+
+double DRAMController::avg_queue_delay() const {
+  uint64_t total = reads_ + writes_;
+  return total ? static_cast<double>(total_queue_delay_) / total : 0.0;
+}
+
+void DRAMController::print_stats(std::ostream &out) const {
+  out << "=== DRAM Controller (FR-FCFS) ===" << std::endl;
+  out << "Mapping:        "
+      << (config_.mapping == MappingScheme::ROW_BANK_COLUMN
+              ? "row:bank:column"
+              : "row:column:bank")
+      << (config_.xor_banks ? ", XOR banks" : "") << std::endl;
+  out << "Reads:          " << reads_ << std::endl;
+  out << "Writes:         " << writes_ << std::endl;
+  out << "Row Hits:       " << row_hits_ << std::endl;
+  out << "Row Misses:     " << row_misses_ << std::endl;
+  out << "Row Conflicts:  " << row_conflicts_ << std::endl;
+  out << "Row Hit Rate:   " << std::fixed << std::setprecision(2)
+      << (100.0 * row_hit_rate()) << "%" << std::endl;
+  out << "Refreshes:      " << refreshes_ << std::endl;
+  out << "Write Drains:   " << write_drains_ << std::endl;
+  out << "Bandwidth:      " << bandwidth() << " B/cycle" << std::endl;
+  out << "Avg Queue Wait: " << avg_queue_delay() << " cycles" << std::endl;
+
+  out << "Queue wait (cycles)  Requests" << std::endl;
+  for (size_t i = 0; i < DELAY_BUCKETS; ++i) {
+    if (delay_hist_[i] == 0) {
+      continue;
+    }
+    std::string range =
+        i == 0 ? "0"
+        : i == DELAY_BUCKETS - 1
+            ? ">= " + std::to_string(1ULL << (i - 1))
+            : std::to_string(1ULL << (i - 1)) + "-" +
+                  std::to_string((1ULL << i) - 1);
+    out << "  " << std::left << std::setw(19) << range << delay_hist_[i]
+        << std::right << std::endl;
+  }
+}
+
+} // namespace memsim
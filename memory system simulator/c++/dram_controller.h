@@ -0,0 +1,237 @@
+#pragma once
+
+#include "config.h"
+#include "types.h"
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <vector>
+
+namespace memsim {
+
+/**
+ * MappingScheme - How a byte address is split into row, bank and column
+ */
+enum class MappingScheme {
+  ROW_BANK_COLUMN, // row | bank | column: a whole row per bank (DRAMModel)
+  ROW_COLUMN_BANK  // row | column | bank | block: consecutive blocks rotate
+                   // over the banks
+};
+
+/**
+ * DRAMAddress - One decoded address
+ */
+struct DRAMAddress {
+  uint32_t bank;
+  uint64_t row;
+  uint32_t column; // Block within the row
+};
+
+/**
+ * AddressMapper - Splits byte addresses for a given bank count and row size
+ *
+ * ROW_BANK_COLUMN keeps a row's blocks in one bank, so sequential streams
+ * hit the open row but use one bank at a time. ROW_COLUMN_BANK puts
+ * consecutive blocks in consecutive banks, so a stream uses every bank
+ * at once, with each row spread over all of them.
+ *
+ * With xor_banks the bank index is XORed with the low bits of the row
+ * (permutation-based interleaving). Rows that would all land in the same
+ * bank then spread over the banks instead of conflicting in one. Within a
+ * row the mapping is unchanged, so row hits are the same.
+ */
+class AddressMapper {
+public:
+  /**
+   * @param banks Bank count (power of 2)
+   * @param row_bytes Row size per bank (power of 2)
+   * @param block_bytes Transfer size of one request (power of 2)
+   */
+  AddressMapper(uint32_t banks, uint32_t row_bytes, uint32_t block_bytes,
+                MappingScheme scheme, bool xor_banks);
+
+  DRAMAddress decode(Address addr) const;
+
+private:
+  MappingScheme scheme_;
+  bool xor_banks_;
+  uint32_t bank_mask_;
+  uint32_t bank_bits_;
+  uint32_t block_bits_;
+  uint32_t column_bits_; // log2(blocks per row)
+};
+
+/**
+ * DRAMControllerConfig - Queues, scheduling and refresh of a DRAMController
+ *
+ * Timings are in the same cycles as DRAMConfig's.
+ */
+struct DRAMControllerConfig {
+  uint32_t row_bytes = 8192;
+  uint32_t block_bytes = 64;
+  Cycle burst_cycles = 4; // Data bus time per request (also tCCD)
+  MappingScheme mapping = MappingScheme::ROW_BANK_COLUMN;
+  bool xor_banks = false;
+  uint32_t queue_depth = 16;       // Requests the scheduler sees per bank
+  uint32_t write_high = 32;        // Start draining writes at this many
+  uint32_t write_low = 8;          // Stop draining at this many
+  Cycle tREFI = 6240;              // Refresh interval (0 = no refresh)
+  Cycle tRFC = 280;                // All-bank refresh time
+};
+
+/**
+ * DRAMCompletion - A request whose data transfer has been scheduled
+ */
+struct DRAMCompletion {
+  uint32_t tag; // As passed to enqueue()
+  Cycle done;   // Last cycle of its data burst
+};
+
+/**
+ * DRAMController - Per-bank request queues with FR-FCFS scheduling
+ *
+ * Unlike DRAMModel, which serves each access as it arrives, requests wait
+ * in their bank's queue. When a bank is free, the scheduler picks the
+ * oldest request to its open row (first-ready), or else the oldest
+ * request (first-come, first-served). A bank queue holds queue_depth
+ * requests; later ones wait behind it in arrival order and aren't
+ * visible to the scheduler yet.
+ *
+ *   per bank:  [waiting FIFO] -> [queue: reads | writes] -> bank -> data bus
+ *
+ * Reads go first. Writes are buffered and sent when their bank has no
+ * read, or all together once write_high are buffered, until write_low
+ * are left (write drain). Every tREFI cycles all banks close their rows
+ * and refresh for tRFC. Bursts share one data bus, so requests to
+ * different banks overlap their activates but not their transfers.
+ * A bank takes its next column command burst_cycles after the last one.
+ *
+ * The controller doesn't own a clock. The owner's event loop calls
+ * enqueue() as requests arrive and service(now) at every cycle service()
+ * asked for (NonBlockingCache runs it on its CalendarQueue). run() drives
+ * it stand-alone from a request list.
+ */
+class DRAMController {
+public:
+  static constexpr Cycle NEVER = ~static_cast<Cycle>(0);
+  static constexpr uint32_t NO_TAG = ~static_cast<uint32_t>(0);
+  static constexpr size_t DELAY_BUCKETS = 24; // Powers of 2 up to 2^22+
+
+  /**
+   * @param timing Banks and tRCD / tCAS / tRP / tRAS
+   * @param config Mapping, queues and refresh
+   */
+  DRAMController(const DRAMConfig &timing,
+                 const DRAMControllerConfig &config = DRAMControllerConfig());
+
+  /**
+   * Queue a request that arrives at now
+   * @param tag Returned in its DRAMCompletion (NO_TAG for posted writes)
+   */
+  void enqueue(Address addr, bool is_write, uint32_t tag, Cycle now);
+
+  /**
+   * Issue every request that can start at now
+   * @param completed Gets a DRAMCompletion for each issued request
+   * @return Next cycle service() has work to do, or NEVER
+   */
+  Cycle service(Cycle now, std::vector<DRAMCompletion> &completed);
+
+  /**
+   * Serve requests stand-alone, each arriving at its arrival_cycle
+   * (requests in arrival order)
+   * @return Cycle the last transfer completed
+   */
+  Cycle run(const std::vector<MemoryRequest> &requests);
+
+  const AddressMapper &mapper() const { return mapper_; }
+  size_t pending() const { return pending_; }
+
+  uint64_t reads() const { return reads_; }
+  uint64_t writes() const { return writes_; }
+  uint64_t row_hits() const { return row_hits_; }
+  uint64_t row_misses() const { return row_misses_; }
+  uint64_t row_conflicts() const { return row_conflicts_; }
+  uint64_t refreshes() const { return refreshes_; }
+  uint64_t write_drains() const { return write_drains_; }
+  double row_hit_rate() const;
+
+  /** Bytes moved per cycle between the first arrival and the last transfer */
+  double bandwidth() const;
+
+  /** Mean cycles from arrival until a request's command is issued */
+  double avg_queue_delay() const;
+
+  /**
+   * Requests by queueing delay: bucket 0 is 0 cycles, bucket i is
+   * [2^(i-1), 2^i), the last bucket everything above
+   */
+  const std::array<uint64_t, DELAY_BUCKETS> &delay_histogram() const {
+    return delay_hist_;
+  }
+
+  Cycle first_arrival() const { return first_arrival_; }
+  Cycle last_completion() const { return last_completion_; }
+
+  void print_stats(std::ostream &out) const;
+
+private:
+  struct Request {
+    uint64_t row;
+    Cycle arrival;
+    uint32_t tag;
+    bool is_write;
+  };
+
+  struct Bank {
+    bool row_open = false;
+    uint64_t open_row = 0;
+    Cycle ready = 0;          // Next command may issue from this cycle on
+    Cycle activate_cycle = 0; // For tRAS
+    std::vector<uint32_t> reads;  // Scheduler window, oldest first
+    std::vector<uint32_t> writes;
+    std::deque<uint32_t> waiting; // Beyond queue_depth, oldest first
+  };
+
+  DRAMConfig timing_;
+  DRAMControllerConfig config_;
+  AddressMapper mapper_;
+  std::vector<Bank> banks_;
+  std::vector<Request> requests_;
+  std::vector<uint32_t> free_slots_;
+  size_t pending_;
+  uint32_t buffered_writes_; // Writes in bank queues or waiting
+  bool draining_;
+  Cycle bus_free_;
+  Cycle next_refresh_;
+
+  uint64_t reads_;
+  uint64_t writes_;
+  uint64_t row_hits_;
+  uint64_t row_misses_;
+  uint64_t row_conflicts_;
+  uint64_t refreshes_;
+  uint64_t write_drains_;
+  Cycle total_queue_delay_;
+  std::array<uint64_t, DELAY_BUCKETS> delay_hist_;
+  Cycle first_arrival_;
+  Cycle last_completion_;
+
+  /** Refresh every bank for each tREFI boundary at or before now */
+  void refresh_until(Cycle now);
+
+  /**
+   * FR-FCFS pick from one queue
+   * @return Position in the queue
+   */
+  size_t pick(const Bank &bank, const std::vector<uint32_t> &queue) const;
+
+  /** Send one request to a free bank; @return its completion */
+  DRAMCompletion issue(Bank &bank, uint32_t slot, Cycle now);
+
+  /** Move waiting requests into the bank queue while it has room */
+  void admit(Bank &bank);
+};
+
+} // namespace memsim
@@ -0,0 +1,202 @@
+#include "dram_model.h"
+#include "../../cache sim/4-way cache/include/checkpoint.h"
+#include <algorithm>
+#include <cassert>
+#include <iomanip>
+
+namespace memsim {
+
+namespace {
+uint32_t log2_u32(uint32_t n) {
+  uint32_t result = 0;
+  while (n > 1) {
+    n >>= 1;
+    result++;
+  }
+  return result;
+}
+} // namespace
+
+DRAMModel::DRAMModel(const DRAMConfig &config, uint32_t row_bytes,
+                     Cycle burst_cycles)
+    : config_(config), row_bytes_(row_bytes), burst_cycles_(burst_cycles),
+      column_bits_(log2_u32(row_bytes)), bank_bits_(log2_u32(config.banks)),
+      banks_(config.banks), stats_(config.banks), last_cycle_(0) {
+  assert(config_.banks > 0 && (config_.banks & (config_.banks - 1)) == 0 &&
+         "Bank count must be power of 2");
+  assert(row_bytes_ > 0 && (row_bytes_ & (row_bytes_ - 1)) == 0 &&
+         "Row size must be power of 2");
+}
+
+uint32_t DRAMModel::bank_of(Address addr) const {
+  return static_cast<uint32_t>((addr >> column_bits_) & (config_.banks - 1));
+}
+
+uint64_t DRAMModel::row_of(Address addr) const {
+  return addr >> (column_bits_ + bank_bits_);
+}
+
+RowBufferOutcome DRAMModel::peek(Address addr) const {
+  const Bank &bank = banks_[bank_of(addr)];
+  if (!bank.row_open) {
+    return RowBufferOutcome::MISS;
+  }
+  return bank.open_row == row_of(addr) ? RowBufferOutcome::HIT
+                                       : RowBufferOutcome::CONFLICT;
+}
+
+Cycle DRAMModel::access(Address addr, bool is_write, Cycle now) {
+  const uint32_t b = bank_of(addr);
+  const uint64_t row = row_of(addr);
+  Bank &bank = banks_[b];
+  BankStats &st = stats_[b];
+
+  // Wait for the bank to finish whatever it is doing
+  Cycle start = std::max(now, bank.ready_cycle);
+  Cycle t = start;
+
+  switch (peek(addr)) {
+  case RowBufferOutcome::HIT:
+    st.row_hits++;
+    break;
+  case RowBufferOutcome::MISS:
+    st.row_misses++;
+    bank.activate_cycle = t;
+    t += config_.tRCD;
+    break;
+  case RowBufferOutcome::CONFLICT:
+    st.row_conflicts++;
+    // Precharge may not start until the open row has been up for tRAS
+    t = std::max(t, bank.activate_cycle + config_.tRAS);
+    t += config_.tRP;
+    bank.activate_cycle = t;
+    t += config_.tRCD;
+    break;
+  }
+  t += config_.tCAS + burst_cycles_;
+
+  bank.row_open = true;
+  bank.open_row = row;
+  bank.ready_cycle = t;
+
+  if (is_write) {
+    st.writes++;
+  } else {
+    st.reads++;
+  }
+  st.busy_cycles += t - start;
+  last_cycle_ = std::max(last_cycle_, t);
+
+  return t - now;
+}
+
+uint64_t DRAMModel::row_hits() const {
+  uint64_t n = 0;
+  for (const BankStats &s : stats_) {
+    n += s.row_hits;
+  }
+  return n;
+}
+
+uint64_t DRAMModel::row_misses() const {
+  uint64_t n = 0;
+  for (const BankStats &s : stats_) {
+    n += s.row_misses;
+  }
+  return n;
+}
+
+uint64_t DRAMModel::row_conflicts() const {
+  uint64_t n = 0;
+  for (const BankStats &s : stats_) {
+    n += s.row_conflicts;
+  }
+  return n;
+}
+
+uint64_t DRAMModel::total_accesses() const {
+  return row_hits() + row_misses() + row_conflicts();
+}
+
+double DRAMModel::utilization(uint32_t bank) const {
+  if (last_cycle_ == 0) {
+    return 0.0;
+  }
+  return static_cast<double>(stats_[bank].busy_cycles) / last_cycle_;
+}
+
+void DRAMModel::print_stats(std::ostream &out) const {
+  out << "=== DRAM Statistics ===" << std::endl;
+  out << "Accesses:       " << total_accesses() << std::endl;
+  out << "Row Hits:       " << row_hits() << std::endl;
+  out << "Row Misses:     " << row_misses() << std::endl;
+  out << "Row Conflicts:  " << row_conflicts() << std::endl;
+
+  uint64_t total = total_accesses();
+  if (total > 0) {
+    out << "Row Hit Rate:   " << std::fixed << std::setprecision(2)
+        << (100.0 * row_hits() / total) << "%" << std::endl;
+  }
+
+  out << "Bank  Reads     Writes    Hits      Conflicts Util" << std::endl;
+  for (uint32_t b = 0; b < stats_.size(); ++b) {
+    const BankStats &s = stats_[b];
+    out << std::left << std::setw(6) << b << std::setw(10) << s.reads
+        << std::setw(10) << s.writes << std::setw(10) << s.row_hits
+        << std::setw(10) << s.row_conflicts << std::fixed
+        << std::setprecision(1) << (100.0 * utilization(b)) << "%"
+        << std::right << std::endl;
+  }
+}
+
+void DRAMModel::save(CheckpointWriter &out) const {
+  out.begin_section("DRAM");
+  out.put(config_.banks);
+  out.put(row_bytes_);
+  for (const Bank &b : banks_) {
+    out.put(static_cast<uint8_t>(b.row_open));
+    out.put(b.open_row);
+    out.put(b.ready_cycle);
+    out.put(b.activate_cycle);
+  }
+  for (const BankStats &s : stats_) {
+    out.put(s.row_hits);
+    out.put(s.row_misses);
+    out.put(s.row_conflicts);
+    out.put(s.reads);
+    out.put(s.writes);
+    out.put(s.busy_cycles);
+  }
+  out.put(last_cycle_);
+  out.end_section();
+}
+
+void DRAMModel::restore(CheckpointReader &in) {
+  in.enter_section("DRAM");
+  in.expect(config_.banks, "DRAM bank count");
+  in.expect(row_bytes_, "DRAM row size");
+  std::vector<Bank> banks(banks_.size());
+  for (Bank &b : banks) {
+    b.row_open = in.get<uint8_t>() != 0;
+    b.open_row = in.get<uint64_t>();
+    b.ready_cycle = in.get<Cycle>();
+    b.activate_cycle = in.get<Cycle>();
+  }
+  std::vector<BankStats> stats(stats_.size());
+  for (BankStats &s : stats) {
+    s.row_hits = in.get<uint64_t>();
+    s.row_misses = in.get<uint64_t>();
+    s.row_conflicts = in.get<uint64_t>();
+    s.reads = in.get<uint64_t>();
+    s.writes = in.get<uint64_t>();
+    s.busy_cycles = in.get<Cycle>();
+  }
+  Cycle last_cycle = in.get<Cycle>();
+  in.leave_section();
+
+  banks_.swap(banks);
+  stats_.swap(stats);
+  last_cycle_ = last_cycle;
+}
+
+} // namespace memsim
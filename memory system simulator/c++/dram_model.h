@@ -0,0 +1,124 @@
+#pragma once
+
+#include "config.h"
+#include "types.h"
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+class CheckpointWriter; // cache sim/4-way cache/include/checkpoint.h
+class CheckpointReader;
+
+namespace memsim {
+
+/**
+ * RowBufferOutcome - What a DRAM access found in its bank's row buffer
+ */
+enum class RowBufferOutcome {
+  HIT,     // Requested row already open: tCAS
+  MISS,    // Bank idle (no row open): tRCD + tCAS
+  CONFLICT // Another row open: tRP + tRCD + tCAS (and tRAS respected)
+};
+
+/**
+ * DRAMModel - Banked DRAM with open-page row buffers
+ *
+ * Address mapping (row interleaved):
+ * ┌──────────────────┬─────────────┬──────────────────┐
+ * │       ROW        │    BANK     │     COLUMN       │
+ * │   (remaining)    │ log2(banks) │ log2(row_bytes)  │
+ * └──────────────────┴─────────────┴──────────────────┘
+ *
+ * Each bank serves one request at a time. A request waits until its bank is
+ * free, then pays precharge/activate/CAS according to the row buffer state.
+ * A row must stay open for at least tRAS after its activate before it can be
+ * precharged.
+ */
+class DRAMModel {
+public:
+  /**
+   * Per-bank counters
+   */
+  struct BankStats {
+    uint64_t row_hits = 0;
+    uint64_t row_misses = 0;
+    uint64_t row_conflicts = 0;
+    uint64_t reads = 0;
+    uint64_t writes = 0;
+    Cycle busy_cycles = 0; // Cycles spent serving requests
+  };
+
+  /**
+   * Constructor
+   * @param config Banks and timings (tRCD, tCAS, tRP, tRAS)
+   * @param row_bytes Row (page) size per bank in bytes (power of 2)
+   * @param burst_cycles Data transfer time added to every access
+   */
+  explicit DRAMModel(const DRAMConfig &config, uint32_t row_bytes = 8192,
+                     Cycle burst_cycles = 4);
+
+  /**
+   * Perform one DRAM access
+   * @param addr Byte address
+   * @param is_write Write (true) or read (false)
+   * @param now Cycle the request reaches the DRAM
+   * @return Latency from now until the data transfer completes
+   */
+  Cycle access(Address addr, bool is_write, Cycle now);
+
+  /**
+   * Row-buffer outcome an access to addr would see right now
+   */
+  RowBufferOutcome peek(Address addr) const;
+
+  uint32_t bank_of(Address addr) const;
+  uint64_t row_of(Address addr) const;
+
+  const std::vector<BankStats> &bank_stats() const { return stats_; }
+  uint64_t row_hits() const;
+  uint64_t row_misses() const;
+  uint64_t row_conflicts() const;
+  uint64_t total_accesses() const;
+
+  /**
+   * Fraction of elapsed time each bank was busy
+   * @param bank Bank index
+   */
+  double utilization(uint32_t bank) const;
+
+  /** Last cycle any bank was busy */
+  Cycle last_cycle() const { return last_cycle_; }
+
+  void print_stats(std::ostream &out) const;
+
+  /**
+   * Write the row buffers, bank timing state and counters
+   */
+  void save(::CheckpointWriter &out) const;
+
+  /**
+   * Read back a saved state; timings may differ (what-if), layout may not
+   * The model is left as it was if the restore throws.
+   * @throws std::invalid_argument if the bank count or row size differs
+   */
+  void restore(::CheckpointReader &in);
+
+private:
+  struct Bank {
+    bool row_open = false;
+    uint64_t open_row = 0;
+    Cycle ready_cycle = 0;    // Bank free from this cycle on
+    Cycle activate_cycle = 0; // When the open row was activated (for tRAS)
+  };
+
+  DRAMConfig config_;
+  uint32_t row_bytes_;
+  Cycle burst_cycles_;
+  uint32_t column_bits_;
+  uint32_t bank_bits_;
+  std::vector<Bank> banks_;
+  std::vector<BankStats> stats_;
+  Cycle last_cycle_;
+};
+
+} // namespace memsim
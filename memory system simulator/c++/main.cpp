@@ -1,8 +1,26 @@
+#include "checkpoint.h"
+#include "compressed_trace.h"
 #include "config.h"
-#include "statistics.h"
+#include "dram_controller.h"
+#include "memory_system.h"
+#include "nonblocking_cache.h"
+#include "trace_generator.h"
+#include "trace_reader.h"
 #include "types.h"
+#ifdef CACHESIM_INSTRUMENT
+#include "cache_instrument.h"
+#endif
 #include <iostream>
 #include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+// Requests issued to the non-blocking L1 between run_until() catch-ups
+constexpr size_t NONBLOCKING_BATCH = 4096;
+} // namespace
 
 int main(int argc, char *argv[]) {
   std::cout << "Memory Simulator Starting..." << std::endl;
@@ -17,63 +35,308 @@ int main(int argc, char *argv[]) {
   uint32_t dram_tRP = 14;
   uint32_t dram_tRAS = 38;
 
-  if (argc >= 9) {
+  // Optional flags, then positional configuration
+  //   --trace <file.mtr>   read a binary trace instead of text on stdin
+  //   --direct-mapped      use the direct-mapped L1 instead of N-way
+  //   --prefetch <kind>    L1 prefetcher: none, next-line, stride, stream
+  //   --mshrs <n>          non-blocking L1 with n MSHRs (event-driven)
+  //   --controller         queue its DRAM requests in an FR-FCFS controller
+  //   --mapping <scheme>   controller address mapping: page (row:bank:column,
+  //                        default) or line (row:column:bank)
+  //   --xor-banks          XOR the controller's bank index with the row
+  //   --generate <pattern> synthesize the trace in-process (no file)
+  //   --count <n>          records to generate (default 1000000)
+  //   --seed <n>           generator seed (default 1)
+  //   --restore-checkpoint <file>  start from a saved warm state
+  //   --save-checkpoint <file>     save the final state for later runs
+  // Instrumented builds (-DCACHESIM_INSTRUMENT=ON) also take
+  //   --instrument <prefix> write <prefix>_intervals.csv and <prefix>_sets.csv
+  //   --interval <n>       window length (default 100000)
+  //   --interval-cycles    windows in cycles instead of accesses
+  std::string binary_trace;
+  std::string pattern;
+  uint64_t generate_count = 1000000;
+  uint64_t seed = 1;
+  uint32_t mshrs = 0;
+  bool use_controller = false;
+  memsim::DRAMControllerConfig controller_config;
+  std::string restore_path;
+  std::string save_path;
+  memsim::L1Type l1_type = memsim::L1Type::SET_ASSOCIATIVE;
+  PrefetcherType prefetcher = PrefetcherType::NONE;
+#ifdef CACHESIM_INSTRUMENT
+  std::string instrument_prefix;
+  InstrumentConfig instrument_config;
+#endif
+  std::vector<char *> args;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+      binary_trace = argv[++i];
+    } else if (std::strcmp(argv[i], "--generate") == 0 && i + 1 < argc) {
+      pattern = argv[++i];
+    } else if (std::strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+      generate_count = std::strtoull(argv[++i], nullptr, 10);
+    } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      seed = std::strtoull(argv[++i], nullptr, 10);
+    } else if (std::strcmp(argv[i], "--restore-checkpoint") == 0 &&
+               i + 1 < argc) {
+      restore_path = argv[++i];
+    } else if (std::strcmp(argv[i], "--save-checkpoint") == 0 &&
+               i + 1 < argc) {
+      save_path = argv[++i];
+    } else if (std::strcmp(argv[i], "--direct-mapped") == 0) {
+      l1_type = memsim::L1Type::DIRECT_MAPPED;
+    } else if (std::strcmp(argv[i], "--mshrs") == 0 && i + 1 < argc) {
+      mshrs = static_cast<uint32_t>(std::atoi(argv[++i]));
+      if (mshrs == 0) {
+        std::cerr << "--mshrs needs at least one MSHR" << std::endl;
+        return 1;
+      }
+    } else if (std::strcmp(argv[i], "--controller") == 0) {
+      use_controller = true;
+    } else if (std::strcmp(argv[i], "--mapping") == 0 && i + 1 < argc) {
+      std::string scheme = argv[++i];
+      if (scheme == "page") {
+        controller_config.mapping = memsim::MappingScheme::ROW_BANK_COLUMN;
+      } else if (scheme == "line") {
+        controller_config.mapping = memsim::MappingScheme::ROW_COLUMN_BANK;
+      } else {
+        std::cerr << "Unknown mapping: " << scheme << std::endl;
+        return 1;
+      }
+      use_controller = true;
+    } else if (std::strcmp(argv[i], "--xor-banks") == 0) {
+      controller_config.xor_banks = true;
+      use_controller = true;
+    } else if (std::strcmp(argv[i], "--prefetch") == 0 && i + 1 < argc) {
+      if (!parse_prefetcher(argv[++i], prefetcher)) {
+        std::cerr << "Unknown prefetcher: " << argv[i] << std::endl;
+        return 1;
+      }
+#ifdef CACHESIM_INSTRUMENT
+    } else if (std::strcmp(argv[i], "--instrument") == 0 && i + 1 < argc) {
+      instrument_prefix = argv[++i];
+    } else if (std::strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+      instrument_config.interval = std::strtoull(argv[++i], nullptr, 10);
+    } else if (std::strcmp(argv[i], "--interval-cycles") == 0) {
+      instrument_config.unit = IntervalUnit::CYCLES;
+#endif
+    } else {
+      args.push_back(argv[i]);
+    }
+  }
+
+  if (args.size() >= 8) {
     // Parse command line arguments
-    l1_size_kb = std::atoi(argv[1]);
-    l1_block_size = std::atoi(argv[2]);
-    l1_associativity = std::atoi(argv[3]);
-    dram_banks = std::atoi(argv[4]);
-    dram_tRCD = std::atoi(argv[5]);
-    dram_tCAS = std::atoi(argv[6]);
-    dram_tRP = std::atoi(argv[7]);
-    dram_tRAS = std::atoi(argv[8]);
+    l1_size_kb = std::atoi(args[0]);
+    l1_block_size = std::atoi(args[1]);
+    l1_associativity = std::atoi(args[2]);
+    dram_banks = std::atoi(args[3]);
+    dram_tRCD = std::atoi(args[4]);
+    dram_tCAS = std::atoi(args[5]);
+    dram_tRP = std::atoi(args[6]);
+    dram_tRAS = std::atoi(args[7]);
   }
 
   memsim::CacheConfig l1_config(l1_size_kb, l1_block_size, l1_associativity);
   memsim::DRAMConfig dram_config(dram_banks, dram_tRCD, dram_tCAS, dram_tRP, dram_tRAS);
 
   memsim::SimConfig config(l1_config, dram_config);
-  memsim::Statistics stats;
+  if (l1_type == memsim::L1Type::DIRECT_MAPPED &&
+      prefetcher != PrefetcherType::NONE) {
+    std::cerr << "--prefetch needs the set-associative L1" << std::endl;
+    return 1;
+  }
+  if (mshrs > 0 && (l1_type == memsim::L1Type::DIRECT_MAPPED ||
+                    prefetcher != PrefetcherType::NONE)) {
+    std::cerr << "--mshrs can't be combined with --direct-mapped or --prefetch"
+              << std::endl;
+    return 1;
+  }
+  if (use_controller && mshrs == 0) {
+    std::cerr << "--controller, --mapping and --xor-banks need --mshrs"
+              << std::endl;
+    return 1;
+  }
 
-  // 2. Simulation Loop (Reading from stdin for now)
-  // Format expectation: [Rw] [Address in Hex]
-  // Example: R 0x12345678
+  // Blocking L1 (MemorySystem) or event-driven non-blocking L1
+  std::unique_ptr<memsim::MemorySystem> memory;
+  std::unique_ptr<memsim::NonBlockingCache> nonblocking;
+  if (mshrs > 0) {
+    nonblocking.reset(new memsim::NonBlockingCache(
+        config, mshrs, 4, 8, use_controller ? &controller_config : nullptr));
+  } else {
+    memory.reset(new memsim::MemorySystem(config, l1_type, 4, prefetcher));
+  }
+  if (!memory && (!restore_path.empty() || !save_path.empty())) {
+    std::cerr << "Checkpoints need the blocking L1 (no --mshrs)" << std::endl;
+    return 1;
+  }
+  if (!restore_path.empty()) {
+    try {
+      CheckpointReader in(restore_path);
+      memory->restore(in);
+      std::cout << "Restored warm state from " << restore_path << " (cycle "
+                << memory->current_cycle() << ")" << std::endl;
+    } catch (const std::exception &e) {
+      std::cerr << "Error: " << e.what() << std::endl;
+      return 1;
+    }
+  }
 
-  char access_char;
-  memsim::Address addr;
-  size_t line_count = 0;
+#ifdef CACHESIM_INSTRUMENT
+  std::unique_ptr<CacheInstrument> instrument;
+  if (!instrument_prefix.empty()) {
+    if (!memory || l1_type != memsim::L1Type::SET_ASSOCIATIVE) {
+      std::cerr << "--instrument needs the blocking set-associative L1"
+                << std::endl;
+      return 1;
+    }
+    try {
+      size_t num_sets = static_cast<size_t>(l1_size_kb) * 1024 /
+                        (static_cast<size_t>(l1_block_size) * l1_associativity);
+      instrument_config.interval_csv = instrument_prefix + "_intervals.csv";
+      instrument_config.heatmap_csv = instrument_prefix + "_sets.csv";
+      instrument.reset(new CacheInstrument(num_sets, instrument_config));
+      memory->set_instrument(instrument.get());
+    } catch (const std::exception &e) {
+      std::cerr << "Error: " << e.what() << std::endl;
+      return 1;
+    }
+  }
+#endif
 
-  std::cout << "Reading trace from standard input (Ctrl+D to end)..."
-            << std::endl;
+  size_t line_count = 0;
+  memsim::Cycle arrival = 0;
 
-  while (std::cin >> access_char >> std::hex >> addr) {
-    memsim::AccessType type;
-    if (access_char == 'R' || access_char == 'r') {
-      type = memsim::AccessType::READ;
-    } else if (access_char == 'W' || access_char == 'w') {
-      type = memsim::AccessType::WRITE;
+  auto simulate = [&](const memsim::TraceRecord &r) {
+    if (!nonblocking) {
+      arrival += r.cycle_delta;
+      memory->access(r.to_request(arrival));
+    } else if (r.cycle_delta == 0) {
+      // Untimed: one cycle after the L1 took the previous request
+      arrival = nonblocking->accept(r.to_request(arrival)) + 1;
     } else {
-      // Skip malformed lines or comments
-      continue;
+      // Catch up to each batch's last arrival, so only requests that are
+      // still pending or in flight are held, whatever the trace length
+      arrival += r.cycle_delta;
+      nonblocking->issue(r.to_request(arrival));
+      if ((line_count + 1) % NONBLOCKING_BATCH == 0) {
+        nonblocking->run_until(arrival);
+      }
     }
+    line_count++;
+  };
+
+  if (!pattern.empty() && !binary_trace.empty()) {
+    std::cerr << "--generate can't be combined with --trace" << std::endl;
+    return 1;
+  }
 
-    // TODO: Pass to MemorySystem here
-    // For now, we simulate a "fake" result:
-    // 90% Hit Rate (Random), 4 cycle hit, 100 cycle miss
+  if (!pattern.empty()) {
+    // 2a. Simulation Loop over a synthetic trace, generated batch by batch
+    try {
+      memsim::TraceGenerator generator(memsim::parse_pattern(pattern, seed),
+                                       generate_count);
+      std::cout << "Generating " << generate_count << " records (" << pattern
+                << ")" << std::endl;
+      for (memsim::TraceSpan batch = generator.next_batch(); !batch.empty();
+           batch = generator.next_batch()) {
+        for (const memsim::TraceRecord &r : batch) {
+          simulate(r);
+        }
+      }
+    } catch (const std::exception &e) {
+      std::cerr << "Error: " << e.what() << std::endl;
+      return 1;
+    }
+  } else if (!binary_trace.empty()) {
+    // 2b. Simulation Loop over a binary trace (no parsing)
+    try {
+      if (memsim::detect_trace_compression(binary_trace) ==
+          memsim::TraceCompression::NONE) {
+        // Uncompressed: memory-map and walk the records in place
+        memsim::TraceReader reader(binary_trace);
+        std::cout << "Reading " << reader.size() << " records from "
+                  << binary_trace << std::endl;
+        for (const memsim::TraceRecord &r : reader.records()) {
+          simulate(r);
+        }
+      } else {
+        // Compressed: decompress on a background thread, batch by batch
+        memsim::CompressedTraceSource source(binary_trace);
+        std::cout << "Streaming " << source.header().record_count
+                  << " compressed records from " << binary_trace
+                  << std::endl;
+        for (memsim::TraceSpan batch = source.next_batch(); !batch.empty();
+             batch = source.next_batch()) {
+          for (const memsim::TraceRecord &r : batch) {
+            simulate(r);
+          }
+        }
+      }
+    } catch (const std::exception &e) {
+      std::cerr << "Error: " << e.what() << std::endl;
+      return 1;
+    }
+  } else {
+    // 2c. Simulation Loop (Reading text from stdin)
+    // Format expectation: [Rw] [Address in Hex]
+    // Example: R 0x12345678
 
-    bool is_hit =
-        (addr % 10 != 0); // Fake logic: addresses ending in 0 are misses
-    memsim::Cycle latency = is_hit ? 4 : 100;
+    char access_char;
+    memsim::Address addr;
 
-    stats.record_access(is_hit, latency);
-    line_count++;
+    std::cout << "Reading trace from standard input (Ctrl+D to end)..."
+              << std::endl;
+
+    while (std::cin >> access_char >> std::hex >> addr) {
+      memsim::AccessType type;
+      if (access_char == 'R' || access_char == 'r') {
+        type = memsim::AccessType::READ;
+      } else if (access_char == 'W' || access_char == 'w') {
+        type = memsim::AccessType::WRITE;
+      } else {
+        // Skip malformed lines or comments
+        continue;
+      }
+      // Text traces carry no access size or timing
+      simulate(memsim::TraceRecord::make(addr, type, 8));
+    }
   }
 
   std::cout << "Processed " << std::dec << line_count << " requests."
             << std::endl;
   std::cout << "Simulation complete." << std::endl;
 
-  stats.print_summary(std::cout);
+#ifdef CACHESIM_INSTRUMENT
+  if (instrument) {
+    instrument->finish();
+    std::cout << "Wrote " << instrument->get_snapshots() << " intervals to "
+              << instrument_config.interval_csv << " and "
+              << instrument->get_num_sets() << " sets to "
+              << instrument_config.heatmap_csv << std::endl;
+  }
+#endif
+
+  if (!save_path.empty()) {
+    try {
+      CheckpointWriter out(save_path);
+      memory->save(out);
+      out.close();
+      std::cout << "Saved warm state to " << save_path << std::endl;
+    } catch (const std::exception &e) {
+      std::cerr << "Error: " << e.what() << std::endl;
+      return 1;
+    }
+  }
+
+  if (nonblocking) {
+    nonblocking->run();
+    nonblocking->print_stats(std::cout);
+  } else {
+    memory->print_stats(std::cout);
+  }
 
   return 0;
 }
@@ -0,0 +1,195 @@
+#include "memory_system.h"
+#include "../../cache sim/4-way cache/include/prefetching_cache.h"
+#include "../../cache sim/direct-way/include/direct_mapped_cache.h"
+#include "../../cache sim/4-way cache/include/checkpoint.h"
+#ifdef CACHESIM_INSTRUMENT
+#include "../../cache sim/4-way cache/include/cache_instrument.h"
+#endif
+#include <algorithm>
+#include <stdexcept>
+
+namespace memsim {
+
+MemorySystem::MemorySystem(const SimConfig &config, L1Type l1_type,
+                           Cycle l1_latency, PrefetcherType prefetcher,
+                           uint32_t prefetch_degree)
+    : config_(config), l1_type_(l1_type), l1_latency_(l1_latency),
+      block_mask_(~static_cast<Address>(config.l1_cache.block_size - 1)),
+      dram_(config.dram), writebacks_(0), prefetch_reads_(0),
+      current_cycle_(0) {
+  if (l1_type_ == L1Type::DIRECT_MAPPED) {
+    if (prefetcher != PrefetcherType::NONE) {
+      throw std::invalid_argument(
+          "prefetching needs the set-associative L1");
+    }
+    direct_.reset(new DirectMappedCache(config.l1_cache, l1_latency));
+  } else {
+    size_t ways = config.l1_cache.associativity;
+    StorageMode mode = ways <= TagStore::MAX_WAYS ? StorageMode::FLAT
+                                                  : StorageMode::PER_SET;
+    set_assoc_.reset(new ::PrefetchingCache(
+        static_cast<size_t>(config.l1_cache.size_kb) * 1024,
+        config.l1_cache.block_size, ways, prefetcher, prefetch_degree, 64,
+        mode));
+  }
+}
+
+MemorySystem::~MemorySystem() = default;
+
+Cycle MemorySystem::access(const MemoryRequest &req) {
+  Cycle now = std::max(current_cycle_, req.arrival_cycle);
+
+  bool hit;
+  Cycle wait = 0;
+  bool writeback = false;
+  Address victim = 0;
+  if (direct_) {
+    AccessResult r = direct_->access(req.addr, req.type);
+    hit = r.hit;
+    writeback = r.writeback;
+    victim = r.writeback_addr;
+  } else {
+    ::AccessType type = req.type == AccessType::WRITE ? ::AccessType::WRITE
+                                                      : ::AccessType::READ;
+    uint64_t ready = 0;
+#ifdef CACHESIM_INSTRUMENT
+    if (instrument_) {
+      instrument_->advance(now);
+    }
+#endif
+    ::AccessResult r = set_assoc_->access(req.addr, type, now, &ready);
+    hit = r.hit;
+    if (hit && ready > now + l1_latency_) {
+      // Late prefetch: the block is allocated but its data is still coming
+      wait = ready - (now + l1_latency_);
+    }
+    if (r.evicted_dirty) {
+      writeback = true;
+      victim = set_assoc_->get_cache().reconstruct_address(r.evicted_tag,
+                                                           r.set_index);
+    }
+  }
+
+  Cycle latency = l1_latency_ + wait;
+  if (!hit) {
+    // Fill: read the whole block from DRAM after the L1 lookup
+    latency += dram_.access(req.addr & block_mask_, false, now + l1_latency_);
+  }
+  if (writeback) {
+    // Posted write-back of the victim, issued behind the fill
+    dram_.access(victim, true, now + latency);
+    writebacks_++;
+  }
+  if (set_assoc_) {
+    // Prefetch fills leave with the lookup and queue behind the demand read
+    for (const ::PrefetchFill &fill : set_assoc_->last_fills()) {
+      Cycle issue = now + l1_latency_;
+      Cycle arrival = issue + dram_.access(fill.address, false, issue);
+      set_assoc_->set_ready(fill.address, arrival);
+      prefetch_reads_++;
+      if (fill.evicted_dirty) {
+        dram_.access(fill.victim_address, true, arrival);
+        writebacks_++;
+      }
+    }
+  }
+
+  stats_.record_access(hit, latency);
+  current_cycle_ = now + latency;
+  return latency;
+}
+
+PrefetchStats MemorySystem::prefetch_stats() const {
+  return set_assoc_ ? set_assoc_->get_prefetch_stats() : PrefetchStats();
+}
+
+#ifdef CACHESIM_INSTRUMENT
+void MemorySystem::set_instrument(::CacheInstrument *inst) {
+  if (!set_assoc_) {
+    throw std::invalid_argument(
+        "instrumentation needs the set-associative L1");
+  }
+  set_assoc_->set_instrument(inst);
+  instrument_ = inst;
+}
+#endif
+
+void MemorySystem::save(::CheckpointWriter &out) const {
+  out.begin_section("MEMSYS");
+  out.put(static_cast<uint32_t>(l1_type_));
+  if (direct_) {
+    direct_->save(out);
+  } else {
+    set_assoc_->save(out);
+  }
+  dram_.save(out);
+  out.put(stats_);
+  out.put(writebacks_);
+  out.put(prefetch_reads_);
+  out.put(current_cycle_);
+  out.end_section();
+}
+
+void MemorySystem::restore(::CheckpointReader &in) {
+  // Decode into copies; nothing changes unless the whole section reads back
+  in.enter_section("MEMSYS");
+  in.expect(static_cast<uint32_t>(l1_type_), "L1 type");
+  std::unique_ptr<DirectMappedCache> direct;
+  std::unique_ptr<::PrefetchingCache> set_assoc;
+  if (direct_) {
+    direct = std::make_unique<DirectMappedCache>(*direct_);
+    direct->restore(in);
+  } else {
+    set_assoc = std::make_unique<::PrefetchingCache>(*set_assoc_);
+    set_assoc->restore(in);
+  }
+  DRAMModel dram(dram_);
+  dram.restore(in);
+  Statistics stats = in.get<Statistics>();
+  uint64_t writebacks = in.get<uint64_t>();
+  uint64_t prefetch_reads = in.get<uint64_t>();
+  Cycle current_cycle = in.get<Cycle>();
+  in.leave_section();
+
+  if (direct_) {
+    *direct_ = std::move(*direct);
+  } else {
+    *set_assoc_ = std::move(*set_assoc);
+  }
+  dram_ = std::move(dram);
+  stats_ = stats;
+  writebacks_ = writebacks;
+  prefetch_reads_ = prefetch_reads;
+  current_cycle_ = current_cycle;
+}
+
+void MemorySystem::print_stats(std::ostream &out) const {
+  out << "L1: "
+      << (l1_type_ == L1Type::DIRECT_MAPPED ? "direct-mapped"
+                                            : "set-associative")
+      << ", " << config_.l1_cache.size_kb << " KB, "
+      << config_.l1_cache.block_size << " B blocks";
+  if (l1_type_ == L1Type::SET_ASSOCIATIVE) {
+    out << ", " << config_.l1_cache.associativity << "-way";
+  }
+  out << std::endl;
+  stats_.print_summary(out);
+  out << "Write-backs:    " << writebacks_ << std::endl;
+  if (set_assoc_ &&
+      set_assoc_->get_prefetcher_type() != PrefetcherType::NONE) {
+    PrefetchStats p = prefetch_stats();
+    out << "Prefetcher:     "
+        << prefetcher_name(set_assoc_->get_prefetcher_type()) << std::endl;
+    out << "  Issued:       " << p.issued << " (" << p.redundant
+        << " redundant candidates dropped)" << std::endl;
+    out << "  Useful:       " << p.useful << std::endl;
+    out << "  Late:         " << p.late << std::endl;
+    out << "  Polluting:    " << p.polluting << std::endl;
+    out << "  Accuracy:     " << p.accuracy() * 100.0 << "%" << std::endl;
+  }
+  out << "Total Cycles:   " << current_cycle_ << std::endl;
+  out << std::endl;
+  dram_.print_stats(out);
+}
+
+} // namespace memsim
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "../../cache sim/4-way cache/include/prefetcher.h"
+#include "config.h"
+#include "dram_model.h"
+#include "statistics.h"
+#include "types.h"
+#include <iostream>
+#include <memory>
+
+// L1 implementations live in the sibling cache simulators
+class PrefetchingCache; // cache sim/4-way cache (global namespace)
+class CheckpointWriter; // cache sim/4-way cache/include/checkpoint.h
+class CheckpointReader;
+#ifdef CACHESIM_INSTRUMENT
+class CacheInstrument; // cache sim/4-way cache/include/cache_instrument.h
+#endif
+
+namespace memsim {
+
+class DirectMappedCache; // cache sim/direct-way
+
+/**
+ * L1Type - Which cache model sits in front of DRAM
+ */
+enum class L1Type { SET_ASSOCIATIVE, DIRECT_MAPPED };
+
+/**
+ * MemorySystem - L1 cache backed by a banked DRAM model
+ *
+ * Requests are served in order by a blocking core:
+ *  - hit:  l1_latency
+ *  - miss: l1_latency + DRAM read of the block (row hit/miss/conflict)
+ * A dirty victim is written back to DRAM after the fill. The write is posted
+ * (it doesn't add to the request's latency) but it keeps its bank busy and
+ * changes the open row, so later requests see its cost.
+ *
+ * The set-associative L1 can have a hardware prefetcher. Prefetch fills are
+ * DRAM reads issued with the demand lookup; like write-backs they cost bank
+ * time and bandwidth, not request latency. A demand hit on a prefetch whose
+ * data hasn't arrived yet (late) waits for it.
+ */
+class MemorySystem {
+public:
+  /**
+   * Constructor
+   * @param config L1 geometry and DRAM organization/timings
+   * @param l1_type Set-associative or direct-mapped L1
+   * @param l1_latency L1 hit latency in cycles
+   * @param prefetcher L1 prefetcher (set-associative L1 only)
+   * @param prefetch_degree Prefetcher degree / depth (0 = model default)
+   * @throws std::invalid_argument for a prefetcher on the direct-mapped L1
+   */
+  explicit MemorySystem(const SimConfig &config,
+                        L1Type l1_type = L1Type::SET_ASSOCIATIVE,
+                        Cycle l1_latency = 4,
+                        PrefetcherType prefetcher = PrefetcherType::NONE,
+                        uint32_t prefetch_degree = 0);
+  ~MemorySystem();
+
+  MemorySystem(const MemorySystem &) = delete;
+  MemorySystem &operator=(const MemorySystem &) = delete;
+
+  /**
+   * Serve one request
+   * @param req Address, type and arrival cycle
+   * @return Latency from issue until the data is returned
+   */
+  Cycle access(const MemoryRequest &req);
+
+  const Statistics &get_stats() const { return stats_; }
+  const DRAMModel &dram() const { return dram_; }
+  Cycle current_cycle() const { return current_cycle_; }
+  uint64_t writebacks() const { return writebacks_; }
+  uint64_t prefetch_reads() const { return prefetch_reads_; }
+
+  /**
+   * Fate of the L1's prefetches (all zero without a prefetcher)
+   */
+  PrefetchStats prefetch_stats() const;
+
+#ifdef CACHESIM_INSTRUMENT
+  /**
+   * Attach a CacheInstrument to the set-associative L1
+   * Cycle windows advance with each request's issue cycle.
+   * @throws std::invalid_argument for the direct-mapped L1
+   */
+  void set_instrument(::CacheInstrument *inst);
+#endif
+
+  /**
+   * Print L1 and DRAM statistics
+   */
+  void print_stats(std::ostream &out) const;
+
+  /**
+   * Write the warm state: L1 (with prefetcher), DRAM row buffers and bank
+   * timing, counters and the current cycle
+   */
+  void save(::CheckpointWriter &out) const;
+
+  /**
+   * Continue from a saved state instead of re-running the warmup
+   * The L1 type and geometry and the DRAM layout must match; latencies,
+   * DRAM timings and (for the set-associative L1) the prefetcher may differ.
+   * A restore that throws leaves the whole system as it was.
+   * @throws std::invalid_argument on a mismatch
+   */
+  void restore(::CheckpointReader &in);
+
+private:
+  SimConfig config_;
+  L1Type l1_type_;
+  Cycle l1_latency_;
+  Address block_mask_;
+
+  std::unique_ptr<::PrefetchingCache> set_assoc_;
+  std::unique_ptr<DirectMappedCache> direct_;
+  DRAMModel dram_;
+
+  Statistics stats_;
+  uint64_t writebacks_;
+  uint64_t prefetch_reads_;
+  Cycle current_cycle_;
+#ifdef CACHESIM_INSTRUMENT
+  ::CacheInstrument *instrument_ = nullptr;
+#endif
+};
+
+} // namespace memsim
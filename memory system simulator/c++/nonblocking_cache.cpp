@@ -0,0 +1,251 @@
+#include "nonblocking_cache.h"
+#include "../../cache sim/4-way cache/include/set_associative_cache.h"
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+namespace memsim {
+
+NonBlockingCache::NonBlockingCache(const SimConfig &config, uint32_t num_mshrs,
+                                   Cycle hit_latency,
+                                   uint32_t targets_per_mshr,
+                                   const DRAMControllerConfig *controller)
+    : config_(config), hit_latency_(hit_latency),
+      targets_per_mshr_(targets_per_mshr),
+      block_mask_(~static_cast<Address>(config.l1_cache.block_size - 1)),
+      dram_(config.dram), service_at_(0), mshrs_(num_mshrs), outstanding_(0),
+      primary_misses_(0), merged_misses_(0),
+      stalled_requests_(0), stall_cycles_(0), max_outstanding_(0),
+      writebacks_(0), finish_cycle_(0) {
+  assert(num_mshrs > 0 && "Need at least one MSHR");
+  assert(targets_per_mshr > 0 && "An MSHR must hold its primary miss");
+  size_t ways = config.l1_cache.associativity;
+  StorageMode mode =
+      ways <= TagStore::MAX_WAYS ? StorageMode::FLAT : StorageMode::PER_SET;
+  tags_.reset(new ::SetAssociativeCache(
+      static_cast<size_t>(config.l1_cache.size_kb) * 1024,
+      config.l1_cache.block_size, ways, 64, mode, PolicyType::LRU, false));
+  if (controller) {
+    DRAMControllerConfig setup = *controller;
+    setup.block_bytes = config.l1_cache.block_size;
+    controller_.reset(new DRAMController(config.dram, setup));
+  }
+}
+
+NonBlockingCache::~NonBlockingCache() = default;
+
+void NonBlockingCache::issue(const MemoryRequest &req) {
+  assert(req.arrival_cycle >= events_.now() &&
+         (arriving_.empty() ||
+          req.arrival_cycle >= requests_[arriving_.back()].arrival_cycle) &&
+         "Requests must be issued in arrival order");
+  uint32_t slot;
+  if (!free_slots_.empty()) {
+    slot = free_slots_.back();
+    free_slots_.pop_back();
+    requests_[slot] = req;
+  } else {
+    slot = static_cast<uint32_t>(requests_.size());
+    requests_.push_back(req);
+  }
+  arriving_.push_back(slot);
+}
+
+Cycle NonBlockingCache::run_until(Cycle limit) {
+  Cycle now;
+  Event event;
+  for (;;) {
+    // An arrival goes before every event at its cycle
+    Cycle arrival = arriving_.empty()
+                        ? std::numeric_limits<Cycle>::max()
+                        : requests_[arriving_.front()].arrival_cycle;
+    if (events_.pop_before(std::min(arrival, limit), now, event)) {
+      dispatch(event, now);
+    } else if (!arriving_.empty() && arrival <= limit) {
+      uint32_t slot = arriving_.front();
+      arriving_.pop_front();
+      arrive(slot, arrival);
+    } else {
+      return finish_cycle_;
+    }
+  }
+}
+
+Cycle NonBlockingCache::accept(const MemoryRequest &req) {
+  issue(req);
+  run_until(req.arrival_cycle);
+  Cycle now = req.arrival_cycle;
+  Event event;
+  while (!blocked_.empty() && events_.pop(now, event)) {
+    dispatch(event, now);
+  }
+  return now;
+}
+
+Cycle NonBlockingCache::run() {
+  return run_until(std::numeric_limits<Cycle>::max());
+}
+
+Cycle NonBlockingCache::run(const std::vector<MemoryRequest> &requests) {
+  std::vector<const MemoryRequest *> order;
+  order.reserve(requests.size());
+  for (const MemoryRequest &req : requests) {
+    order.push_back(&req);
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   [](const MemoryRequest *a, const MemoryRequest *b) {
+                     return a->arrival_cycle < b->arrival_cycle;
+                   });
+  for (const MemoryRequest *req : order) {
+    issue(*req);
+  }
+  return run();
+}
+
+void NonBlockingCache::arrive(uint32_t slot, Cycle now) {
+  if (!blocked_.empty() || !serve(slot, now)) {
+    // Stalled: wait behind any older stalled request
+    blocked_.push_back(slot);
+    stalled_requests_++;
+  }
+}
+
+void NonBlockingCache::dispatch(const Event &event, Cycle now) {
+  if (event.kind == EventKind::FILL) {
+    fill(event.index, now);
+  } else if (event.kind == EventKind::SEND) {
+    controller_->enqueue(mshrs_[event.index].block, false, event.index, now);
+    service_dram(now);
+  } else {
+    service_dram(now);
+  }
+}
+
+bool NonBlockingCache::serve(uint32_t slot, Cycle now) {
+  const MemoryRequest &req = requests_[slot];
+  Address block = req.addr & block_mask_;
+  bool is_write = req.type == AccessType::WRITE;
+
+  // Secondary miss: the block is already on its way
+  for (MSHR &m : mshrs_) {
+    if (m.busy && m.block == block) {
+      if (m.targets.size() >= targets_per_mshr_) {
+        return false;
+      }
+      m.targets.push_back(slot);
+      m.dirty = m.dirty || is_write;
+      merged_misses_++;
+      return true;
+    }
+  }
+
+  if (tags_->probe(block)) {
+    tags_->access(req.addr, is_write ? ::AccessType::WRITE : ::AccessType::READ);
+    complete(slot, true, now + hit_latency_);
+    return true;
+  }
+
+  // Primary miss: needs a free MSHR
+  auto free_mshr = std::find_if(mshrs_.begin(), mshrs_.end(),
+                                [](const MSHR &m) { return !m.busy; });
+  if (free_mshr == mshrs_.end()) {
+    return false;
+  }
+  free_mshr->busy = true;
+  free_mshr->block = block;
+  free_mshr->dirty = is_write;
+  free_mshr->targets.assign(1, slot);
+  outstanding_++;
+  max_outstanding_ = std::max(max_outstanding_, outstanding_);
+  primary_misses_++;
+
+  uint32_t index = static_cast<uint32_t>(free_mshr - mshrs_.begin());
+  Cycle issue = now + hit_latency_;
+  if (controller_) {
+    // The controller decides when it is served; the fill follows from that
+    events_.schedule(issue, Event{EventKind::SEND, index});
+  } else {
+    Cycle done = issue + dram_.access(block, false, issue);
+    events_.schedule(done, Event{EventKind::FILL, index});
+  }
+  return true;
+}
+
+void NonBlockingCache::fill(uint32_t mshr, Cycle now) {
+  MSHR &m = mshrs_[mshr];
+  ::AccessResult r = tags_->install(m.block, m.dirty);
+  if (r.evicted_dirty) {
+    Address victim = tags_->reconstruct_address(r.evicted_tag, r.set_index);
+    if (controller_) {
+      controller_->enqueue(victim, true, DRAMController::NO_TAG, now);
+      service_dram(now);
+    } else {
+      dram_.access(victim, true, now);
+    }
+    writebacks_++;
+  }
+  for (uint32_t slot : m.targets) {
+    complete(slot, false, now);
+  }
+  m.busy = false;
+  m.targets.clear();
+  outstanding_--;
+  retry_blocked(now);
+}
+
+void NonBlockingCache::complete(uint32_t slot, bool hit, Cycle done) {
+  stats_.record_access(hit, done - requests_[slot].arrival_cycle);
+  finish_cycle_ = std::max(finish_cycle_, done);
+  free_slots_.push_back(slot);
+}
+
+void NonBlockingCache::retry_blocked(Cycle now) {
+  while (!blocked_.empty()) {
+    uint32_t slot = blocked_.front();
+    Cycle arrival = requests_[slot].arrival_cycle;
+    if (!serve(slot, now)) {
+      return;
+    }
+    stall_cycles_ += now - arrival;
+    blocked_.pop_front();
+  }
+}
+
+void NonBlockingCache::service_dram(Cycle now) {
+  completed_.clear();
+  Cycle wake = controller_->service(now, completed_);
+  for (const DRAMCompletion &c : completed_) {
+    if (c.tag != DRAMController::NO_TAG) {
+      events_.schedule(c.done, Event{EventKind::FILL, c.tag});
+    }
+  }
+  // One wake-up in the future is enough: it reschedules the next itself
+  if (wake != DRAMController::NEVER &&
+      (service_at_ <= now || wake < service_at_)) {
+    events_.schedule(wake, Event{EventKind::SERVICE, 0});
+    service_at_ = wake;
+  }
+}
+
+void NonBlockingCache::print_stats(std::ostream &out) const {
+  out << "L1: non-blocking, " << config_.l1_cache.size_kb << " KB, "
+      << config_.l1_cache.block_size << " B blocks, "
+      << config_.l1_cache.associativity << "-way, " << mshrs_.size()
+      << " MSHRs" << std::endl;
+  stats_.print_summary(out);
+  out << "Primary misses: " << primary_misses_ << std::endl;
+  out << "Merged misses:  " << merged_misses_ << std::endl;
+  out << "MSHR stalls:    " << stalled_requests_ << " requests, "
+      << stall_cycles_ << " cycles" << std::endl;
+  out << "Max in flight:  " << max_outstanding_ << std::endl;
+  out << "Write-backs:    " << writebacks_ << std::endl;
+  out << "Total Cycles:   " << finish_cycle_ << std::endl;
+  out << std::endl;
+  if (controller_) {
+    controller_->print_stats(out);
+  } else {
+    dram_.print_stats(out);
+  }
+}
+
+} // namespace memsim
@@ -0,0 +1,184 @@
+#pragma once
+
+#include "calendar_queue.h"
+#include "config.h"
+#include "dram_controller.h"
+#include "dram_model.h"
+#include "statistics.h"
+#include "types.h"
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+// Tag array from the 4-way simulator (global namespace)
+class SetAssociativeCache;
+
+namespace memsim {
+
+/**
+ * NonBlockingCache - Event-driven L1 with MSHRs in front of DRAM
+ *
+ * Unlike MemorySystem, requests don't wait for the one before them. Each
+ * request arrives at its own arrival_cycle:
+ *  - hit: done after hit_latency
+ *  - miss to a block already in flight: merged into that block's MSHR
+ *    (secondary miss), done when the fill returns
+ *  - other miss: allocates an MSHR and sends a DRAM read after the lookup;
+ *    the block is installed when the fill returns
+ * If no MSHR is free, or the matching MSHR already holds targets_per_mshr
+ * requests, the cache stalls. That request and everything after it wait,
+ * in order, until a fill frees room. Independent misses therefore overlap
+ * up to the MSHR count (memory-level parallelism) instead of adding up.
+ *
+ * All timing runs on a CalendarQueue. Call issue() for each request, in
+ * arrival order, then run() to drain the queue. Requests that have not
+ * arrived yet wait in their own FIFO and go before any event at their
+ * cycle. To stream a long trace in bounded memory, run_until() each batch's
+ * last arrival before issuing the next batch; the result is the same as
+ * issuing everything up front. An untimed trace has no arrivals to honour:
+ * accept() each request instead, one cycle after the last was taken.
+ *
+ * By default misses and write-backs go straight to a DRAMModel. Given a
+ * DRAMControllerConfig they queue in a DRAMController instead, which the
+ * same CalendarQueue drives, so DRAM bandwidth and queueing show up in
+ * the fill times.
+ */
+class NonBlockingCache {
+public:
+  /**
+   * Constructor
+   * @param config L1 geometry and DRAM organization/timings
+   * @param num_mshrs Miss status holding registers (outstanding blocks)
+   * @param hit_latency Tag lookup / hit latency in cycles
+   * @param targets_per_mshr Requests one MSHR can merge
+   * @param controller Queue DRAM requests in an FR-FCFS controller with
+   *                   this setup (nullptr = DRAMModel, no queueing)
+   */
+  explicit NonBlockingCache(const SimConfig &config, uint32_t num_mshrs = 8,
+                            Cycle hit_latency = 4,
+                            uint32_t targets_per_mshr = 8,
+                            const DRAMControllerConfig *controller = nullptr);
+  ~NonBlockingCache();
+
+  NonBlockingCache(const NonBlockingCache &) = delete;
+  NonBlockingCache &operator=(const NonBlockingCache &) = delete;
+
+  /**
+   * Queue a request to arrive at req.arrival_cycle
+   * Arrivals must not decrease from one issue() to the next, nor be earlier
+   * than the limit of the last run_until().
+   */
+  void issue(const MemoryRequest &req);
+
+  /**
+   * Process arrivals up to and including cycle limit, and events before it
+   * Only requests still to arrive, stalled or in flight stay in memory.
+   * @return Cycle the last request so far completed
+   */
+  Cycle run_until(Cycle limit);
+
+  /**
+   * Issue req and run until the cache takes it, as a core that stalls on
+   * full MSHRs would: the way to feed untimed traces
+   * @return Cycle req was served (its arrival, unless it stalled)
+   */
+  Cycle accept(const MemoryRequest &req);
+
+  /**
+   * Process arrivals and events until both are exhausted
+   * @return Cycle the last request completed
+   */
+  Cycle run();
+
+  /**
+   * issue() every request (in any order; sorted by arrival), then run()
+   */
+  Cycle run(const std::vector<MemoryRequest> &requests);
+
+  /** Hits, misses and per-request latency (arrival to completion) */
+  const Statistics &get_stats() const { return stats_; }
+  const DRAMModel &dram() const { return dram_; }
+
+  /** The DRAM controller, or nullptr when misses go to dram() */
+  const DRAMController *controller() const { return controller_.get(); }
+
+  uint64_t primary_misses() const { return primary_misses_; }
+  uint64_t merged_misses() const { return merged_misses_; }
+  uint64_t stalled_requests() const { return stalled_requests_; }
+  Cycle stall_cycles() const { return stall_cycles_; }
+  uint32_t max_outstanding() const { return max_outstanding_; }
+  uint64_t writebacks() const { return writebacks_; }
+  Cycle finish_cycle() const { return finish_cycle_; }
+  uint32_t num_mshrs() const { return static_cast<uint32_t>(mshrs_.size()); }
+
+  /**
+   * Print L1, MSHR and DRAM statistics
+   */
+  void print_stats(std::ostream &out) const;
+
+private:
+  // SEND: an MSHR's read reaches the controller; SERVICE: controller wake-up
+  enum class EventKind : uint8_t { FILL, SEND, SERVICE };
+
+  struct Event {
+    EventKind kind;
+    uint32_t index; // MSHR (FILL, SEND)
+  };
+
+  struct MSHR {
+    bool busy = false;
+    Address block = 0;
+    bool dirty = false;          // Some target is a write
+    std::vector<uint32_t> targets; // Request slots waiting for the fill
+  };
+
+  SimConfig config_;
+  Cycle hit_latency_;
+  uint32_t targets_per_mshr_;
+  Address block_mask_;
+
+  std::unique_ptr<::SetAssociativeCache> tags_;
+  DRAMModel dram_;
+  std::unique_ptr<DRAMController> controller_;
+  std::vector<DRAMCompletion> completed_;
+  Cycle service_at_; // Latest controller wake-up scheduled
+  CalendarQueue<Event> events_;
+  std::vector<MSHR> mshrs_;
+  uint32_t outstanding_;
+
+  // Issued requests live in reusable slots until they complete
+  std::vector<MemoryRequest> requests_;
+  std::vector<uint32_t> free_slots_;
+  std::deque<uint32_t> arriving_; // Not arrived yet, in arrival order
+  std::deque<uint32_t> blocked_;  // Stalled requests, oldest first
+
+  Statistics stats_;
+  uint64_t primary_misses_;
+  uint64_t merged_misses_;
+  uint64_t stalled_requests_;
+  Cycle stall_cycles_;
+  uint32_t max_outstanding_;
+  uint64_t writebacks_;
+  Cycle finish_cycle_;
+
+  /**
+   * Try to serve a request at cycle now
+   * @return false if it must stall (no MSHR room)
+   */
+  bool serve(uint32_t slot, Cycle now);
+
+  /** A request arrives: serve it, or stall it behind older stalls */
+  void arrive(uint32_t slot, Cycle now);
+  void dispatch(const Event &event, Cycle now);
+
+  void fill(uint32_t mshr, Cycle now);
+  void complete(uint32_t slot, bool hit, Cycle done);
+  void retry_blocked(Cycle now);
+
+  /** Let the controller issue what it can, then schedule fills and wake-up */
+  void service_dram(Cycle now);
+};
+
+} // namespace memsim
@@ -14,6 +14,10 @@ public:
 
   void print_summary(std::ostream &out) const;
 
+  uint64_t total_accesses() const { return total_accesses_; }
+  uint64_t total_hits() const { return total_hits_; }
+  Cycle total_latency() const { return total_latency_; }
+
 private:
   uint64_t total_accesses_ = 0;
   uint64_t total_hits_ = 0;
@@ -0,0 +1,274 @@
+#include "sweep.h"
+#include "../../cache sim/4-way cache/include/set_associative_cache.h"
+#include "../../cache sim/4-way cache/include/fixed_cache.h"
+#include "../../cache sim/4-way cache/include/checkpoint.h"
+#include <algorithm>
+#include <iomanip>
+#include <stdexcept>
+
+namespace memsim {
+
+/**
+ * SweepCache - One configuration's cache, whichever engine models it
+ * One virtual call per chunk of records; the loop inside is the engine's.
+ */
+class SweepCache {
+public:
+  virtual ~SweepCache() = default;
+  virtual void access(const ::TraceEntry *chunk, size_t n) = 0;
+  virtual ::CacheStats stats() const = 0;
+  virtual void save(::CheckpointWriter &out) const = 0;
+  virtual void restore(::CheckpointReader &in) = 0;
+  virtual std::unique_ptr<SweepCache> clone() const = 0;
+};
+
+namespace {
+bool is_pow2(uint64_t n) { return n > 0 && (n & (n - 1)) == 0; }
+
+// SetAssociativeCache prefetches the sets of a chunk ahead of the accesses
+void access_chunk(::SetAssociativeCache &cache, const ::TraceEntry *chunk,
+                  size_t n) {
+  cache.access_batch(chunk, n);
+}
+
+template <typename Cache>
+void access_chunk(Cache &cache, const ::TraceEntry *chunk, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    cache.access(chunk[i].address, chunk[i].type);
+  }
+}
+
+template <typename Cache> class SweepCacheOf : public SweepCache {
+public:
+  explicit SweepCacheOf(Cache cache) : cache_(std::move(cache)) {}
+
+  void access(const ::TraceEntry *chunk, size_t n) override {
+    access_chunk(cache_, chunk, n);
+  }
+  ::CacheStats stats() const override { return cache_.get_stats(); }
+  void save(::CheckpointWriter &out) const override { cache_.save(out); }
+  void restore(::CheckpointReader &in) override { cache_.restore(in); }
+  std::unique_ptr<SweepCache> clone() const override {
+    return std::unique_ptr<SweepCache>(new SweepCacheOf(*this));
+  }
+
+private:
+  Cache cache_;
+};
+
+std::unique_ptr<SweepCache> make_sweep_cache(const CacheConfig &c) {
+  size_t bytes = static_cast<size_t>(c.size_kb) * 1024;
+  std::unique_ptr<SweepCache> cache;
+  if (c.size_kb < SweepEngine::SPARSE_SWEEP_KB) {
+    dispatch_fixed_type(bytes, c.block_size, c.associativity, [&](auto *type) {
+      using Cache = std::remove_pointer_t<decltype(type)>;
+      cache.reset(new SweepCacheOf<Cache>(Cache(bytes)));
+    });
+  }
+  if (!cache) {
+    StorageMode mode = c.size_kb >= SweepEngine::SPARSE_SWEEP_KB
+                           ? StorageMode::SPARSE
+                           : StorageMode::FLAT;
+    cache.reset(new SweepCacheOf<::SetAssociativeCache>(
+        ::SetAssociativeCache(bytes, c.block_size, c.associativity, 64, mode,
+                              PolicyType::LRU, false)));
+  }
+  return cache;
+}
+} // namespace
+
+bool valid_cache_config(const CacheConfig &config) {
+  if (!is_pow2(config.block_size) || !is_pow2(config.associativity) ||
+      config.associativity > TagStore::MAX_WAYS || config.size_kb == 0) {
+    return false;
+  }
+  uint64_t bytes = static_cast<uint64_t>(config.size_kb) * 1024;
+  uint64_t lines = bytes / config.block_size;
+  return lines >= config.associativity && is_pow2(lines / config.associativity);
+}
+
+std::vector<CacheConfig> make_config_grid(const std::vector<uint32_t> &sizes_kb,
+                                          const std::vector<uint32_t> &blocks,
+                                          const std::vector<uint32_t> &ways) {
+  std::vector<CacheConfig> grid;
+  for (uint32_t size : sizes_kb) {
+    for (uint32_t block : blocks) {
+      for (uint32_t assoc : ways) {
+        CacheConfig config(size, block, assoc);
+        if (valid_cache_config(config)) {
+          grid.push_back(config);
+        }
+      }
+    }
+  }
+  return grid;
+}
+
+// ============================================================================
+// SweepEngine
+// ============================================================================
+
+SweepEngine::SweepEngine(const std::vector<CacheConfig> &configs,
+                         size_t threads)
+    : configs_(configs) {
+  for (const CacheConfig &c : configs_) {
+    if (!valid_cache_config(c)) {
+      throw std::invalid_argument(
+          "Invalid cache configuration: " + std::to_string(c.size_kb) + "KB/" +
+          std::to_string(c.block_size) + "B/" +
+          std::to_string(c.associativity) + "-way");
+    }
+    caches_.push_back(make_sweep_cache(c));
+  }
+
+  if (threads == 0) {
+    threads = std::thread::hardware_concurrency();
+  }
+  if (threads > configs_.size()) {
+    threads = configs_.size();
+  }
+  if (threads == 0) {
+    threads = 1;
+  }
+  for (size_t i = 0; i < threads; ++i) {
+    workers_.emplace_back(&SweepEngine::worker, this);
+  }
+}
+
+SweepEngine::~SweepEngine() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  start_.notify_all();
+  for (std::thread &w : workers_) {
+    w.join();
+  }
+}
+
+void SweepEngine::worker() {
+  uint64_t seen = 0;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    start_.wait(lock, [&] { return stop_ || generation_ != seen; });
+    if (stop_) {
+      return;
+    }
+    seen = generation_;
+    TraceSpan batch = batch_;
+    lock.unlock();
+
+    // Claim configurations until none are left for this batch
+    for (size_t c = next_config_++; c < configs_.size(); c = next_config_++) {
+      simulate(c, batch);
+    }
+
+    lock.lock();
+    if (--busy_ == 0) {
+      done_.notify_one();
+    }
+  }
+}
+
+void SweepEngine::simulate(size_t config, TraceSpan batch) {
+  SweepCache &cache = *caches_[config];
+  // Repack records a chunk at a time: one virtual call per chunk, and a
+  // SetAssociativeCache prefetches the chunk's sets
+  constexpr size_t CHUNK = 256;
+  ::TraceEntry chunk[CHUNK];
+  for (size_t base = 0; base < batch.size; base += CHUNK) {
+    size_t n = std::min(CHUNK, batch.size - base);
+    for (size_t i = 0; i < n; ++i) {
+      const TraceRecord &r = batch[base + i];
+      chunk[i] = {r.addr, r.type() == AccessType::WRITE ? ::AccessType::WRITE
+                                                        : ::AccessType::READ};
+    }
+    cache.access(chunk, n);
+  }
+}
+
+void SweepEngine::run_batch(TraceSpan batch) {
+  if (batch.empty() || configs_.empty()) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  batch_ = batch;
+  next_config_ = 0;
+  busy_ = workers_.size();
+  generation_++;
+  start_.notify_all();
+  done_.wait(lock, [&] { return busy_ == 0; });
+}
+
+std::vector<SweepResult> SweepEngine::results() const {
+  std::vector<SweepResult> results;
+  for (size_t i = 0; i < configs_.size(); ++i) {
+    CacheStats s = caches_[i]->stats();
+    SweepResult r;
+    r.config = configs_[i];
+    r.accesses = s.hits + s.misses;
+    r.hits = s.hits;
+    r.misses = s.misses;
+    r.writebacks = s.dirty_evictions;
+    results.push_back(r);
+  }
+  return results;
+}
+
+void SweepEngine::save(::CheckpointWriter &out) const {
+  out.begin_section("SWEEP");
+  out.put(static_cast<uint64_t>(caches_.size()));
+  for (const auto &cache : caches_) {
+    cache->save(out);
+  }
+  out.end_section();
+}
+
+void SweepEngine::restore(::CheckpointReader &in) {
+  in.enter_section("SWEEP");
+  in.expect(static_cast<uint64_t>(caches_.size()), "sweep configuration count");
+  // All configurations or none: decode into copies, then commit
+  std::vector<std::unique_ptr<SweepCache>> staged;
+  staged.reserve(caches_.size());
+  for (const auto &cache : caches_) {
+    staged.push_back(cache->clone());
+    staged.back()->restore(in);
+  }
+  in.leave_section();
+  caches_.swap(staged);
+}
+
+// ============================================================================
+// Output
+// ============================================================================
+
+void write_sweep_csv(std::ostream &out,
+                     const std::vector<SweepResult> &results) {
+  out << "size_kb,block_size,associativity,accesses,hits,misses,hit_rate,"
+         "writebacks\n";
+  for (const SweepResult &r : results) {
+    out << r.config.size_kb << ',' << r.config.block_size << ','
+        << r.config.associativity << ',' << r.accesses << ',' << r.hits << ','
+        << r.misses << ',' << std::fixed << std::setprecision(6)
+        << r.hit_rate() << ',' << r.writebacks << '\n';
+  }
+}
+
+void write_sweep_json(std::ostream &out,
+                      const std::vector<SweepResult> &results) {
+  out << "[\n";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const SweepResult &r = results[i];
+    out << "  {\"size_kb\": " << r.config.size_kb
+        << ", \"block_size\": " << r.config.block_size
+        << ", \"associativity\": " << r.config.associativity
+        << ", \"accesses\": " << r.accesses << ", \"hits\": " << r.hits
+        << ", \"misses\": " << r.misses << ", \"hit_rate\": " << std::fixed
+        << std::setprecision(6) << r.hit_rate()
+        << ", \"writebacks\": " << r.writebacks << "}"
+        << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  out << "]\n";
+}
+
+} // namespace memsim
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "config.h"
+#include "trace_format.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class CheckpointWriter; // cache sim/4-way cache/include/checkpoint.h
+class CheckpointReader;
+
+namespace memsim {
+
+class SweepCache; // One configuration's cache (sweep.cpp)
+
+/**
+ * SweepResult - Outcome of one configuration in a sweep
+ */
+struct SweepResult {
+  CacheConfig config;
+  uint64_t accesses = 0;
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t writebacks = 0; // Dirty evictions
+
+  double hit_rate() const {
+    return accesses > 0 ? static_cast<double>(hits) / accesses : 0.0;
+  }
+};
+
+/**
+ * Whether a configuration can be simulated: power-of-2 block size,
+ * associativity (<= 64) and number of sets
+ */
+bool valid_cache_config(const CacheConfig &config);
+
+/**
+ * Cartesian product of sizes x block sizes x associativities,
+ * skipping combinations that fail valid_cache_config()
+ */
+std::vector<CacheConfig> make_config_grid(const std::vector<uint32_t> &sizes_kb,
+                                          const std::vector<uint32_t> &blocks,
+                                          const std::vector<uint32_t> &ways);
+
+/**
+ * SweepEngine - Many cache configurations, one pass over the trace
+ *
+ * Each batch of decoded trace records is handed to every cache instance.
+ * A pool of worker threads (created once) pulls configurations off a shared
+ * counter, so the trace is read and decoded once no matter how many
+ * configurations are swept. Geometries with a FixedCache instantiation
+ * (1-16 ways x 32/64/128-byte blocks) run on it, with every per-way loop
+ * unrolled; the rest use a FLAT SetAssociativeCache. Configurations of
+ * SPARSE_SWEEP_KB and up use SPARSE storage, so huge caches only pay for
+ * the sets the trace touches:
+ *
+ *   SweepEngine sweep(make_config_grid({16, 32, 64}, {64}, {1, 2, 4, 8}));
+ *   for (TraceSpan b = reader.next_batch(n); !b.empty(); b = ...)
+ *     sweep.run_batch(b);
+ *   write_sweep_csv(std::cout, sweep.results());
+ */
+class SweepEngine {
+public:
+  static constexpr uint32_t SPARSE_SWEEP_KB = 32 * 1024;
+
+  /**
+   * @param configs Configurations to simulate
+   * @param threads Worker threads (0 = hardware concurrency)
+   * @throws std::invalid_argument if a configuration is invalid
+   */
+  explicit SweepEngine(const std::vector<CacheConfig> &configs,
+                       size_t threads = 0);
+  ~SweepEngine();
+
+  SweepEngine(const SweepEngine &) = delete;
+  SweepEngine &operator=(const SweepEngine &) = delete;
+
+  /**
+   * Feed one batch to every configuration; returns when all are done
+   */
+  void run_batch(TraceSpan batch);
+
+  /**
+   * Per-configuration results so far, in configuration order
+   */
+  std::vector<SweepResult> results() const;
+
+  /**
+   * Write every configuration's cache (call between batches)
+   */
+  void save(::CheckpointWriter &out) const;
+
+  /**
+   * Continue every configuration from a sweep saved with the same grid
+   * Either every cache is restored or, if this throws, none is.
+   * @throws std::invalid_argument if the configurations differ
+   */
+  void restore(::CheckpointReader &in);
+
+  size_t num_configs() const { return configs_.size(); }
+  size_t num_threads() const { return workers_.size(); }
+
+private:
+  std::vector<CacheConfig> configs_;
+  std::vector<std::unique_ptr<SweepCache>> caches_;
+
+  // Worker pool: run_batch() publishes a batch and bumps generation_
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable start_;
+  std::condition_variable done_;
+  uint64_t generation_ = 0;
+  size_t busy_ = 0;
+  bool stop_ = false;
+  TraceSpan batch_;
+  std::atomic<size_t> next_config_{0};
+
+  void worker();
+  void simulate(size_t config, TraceSpan batch);
+};
+
+/**
+ * One row per configuration:
+ * size_kb,block_size,associativity,accesses,hits,misses,hit_rate,writebacks
+ */
+void write_sweep_csv(std::ostream &out, const std::vector<SweepResult> &results);
+
+/**
+ * JSON array with one object per configuration (same fields as the CSV)
+ */
+void write_sweep_json(std::ostream &out,
+                      const std::vector<SweepResult> &results);
+
+} // namespace memsim
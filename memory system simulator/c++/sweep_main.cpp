@@ -0,0 +1,173 @@
+#include "compressed_trace.h"
+#include "sweep.h"
+#include "trace_reader.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Sweep many L1 geometries over one trace in a single pass
+//
+// Usage: memory_sweep [--trace file.mtr] [--sizes 16,32,64] [--blocks 64]
+//                     [--ways 1,2,4,8] [--config KB:BLOCK:WAYS ...]
+//                     [--threads N] [--format csv|json] [--output file]
+//
+// Without --trace, a text trace ("R 0x1234" lines) is read from stdin.
+// --config entries replace the --sizes/--blocks/--ways grid.
+
+namespace {
+
+std::vector<uint32_t> parse_list(const char *arg) {
+  std::vector<uint32_t> values;
+  std::stringstream ss(arg);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if (!item.empty()) {
+      values.push_back(static_cast<uint32_t>(std::atoi(item.c_str())));
+    }
+  }
+  return values;
+}
+
+bool parse_config(const char *arg, memsim::CacheConfig &out) {
+  unsigned size, block, ways;
+  if (std::sscanf(arg, "%u:%u:%u", &size, &block, &ways) != 3) {
+    return false;
+  }
+  out = memsim::CacheConfig(size, block, ways);
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  std::string binary_trace;
+  std::string format = "csv";
+  std::string output;
+  size_t threads = 0;
+  std::vector<uint32_t> sizes = {16, 32, 64, 128, 256};
+  std::vector<uint32_t> blocks = {64};
+  std::vector<uint32_t> ways = {1, 2, 4, 8, 16};
+  std::vector<memsim::CacheConfig> configs;
+
+  for (int i = 1; i < argc; ++i) {
+    bool has_value = i + 1 < argc;
+    if (std::strcmp(argv[i], "--trace") == 0 && has_value) {
+      binary_trace = argv[++i];
+    } else if (std::strcmp(argv[i], "--sizes") == 0 && has_value) {
+      sizes = parse_list(argv[++i]);
+    } else if (std::strcmp(argv[i], "--blocks") == 0 && has_value) {
+      blocks = parse_list(argv[++i]);
+    } else if (std::strcmp(argv[i], "--ways") == 0 && has_value) {
+      ways = parse_list(argv[++i]);
+    } else if (std::strcmp(argv[i], "--config") == 0 && has_value) {
+      memsim::CacheConfig c;
+      if (!parse_config(argv[++i], c)) {
+        std::cerr << "Error: --config expects KB:BLOCK:WAYS, got " << argv[i]
+                  << std::endl;
+        return 1;
+      }
+      configs.push_back(c);
+    } else if (std::strcmp(argv[i], "--threads") == 0 && has_value) {
+      threads = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "--format") == 0 && has_value) {
+      format = argv[++i];
+    } else if (std::strcmp(argv[i], "--output") == 0 && has_value) {
+      output = argv[++i];
+    } else {
+      std::cerr << "Error: Unknown argument " << argv[i] << std::endl;
+      return 1;
+    }
+  }
+  if (format != "csv" && format != "json") {
+    std::cerr << "Error: --format must be csv or json" << std::endl;
+    return 1;
+  }
+  if (configs.empty()) {
+    configs = memsim::make_config_grid(sizes, blocks, ways);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  uint64_t records = 0;
+  try {
+    memsim::SweepEngine sweep(configs, threads);
+    std::cerr << "Sweeping " << sweep.num_configs() << " configurations on "
+              << sweep.num_threads() << " threads" << std::endl;
+
+    const size_t batch_records = 64 * 1024;
+    if (!binary_trace.empty()) {
+      if (memsim::detect_trace_compression(binary_trace) ==
+          memsim::TraceCompression::NONE) {
+        memsim::TraceReader reader(binary_trace);
+        for (memsim::TraceSpan b = reader.next_batch(batch_records); !b.empty();
+             b = reader.next_batch(batch_records)) {
+          sweep.run_batch(b);
+          records += b.size;
+        }
+      } else {
+        memsim::CompressedTraceSource source(binary_trace, batch_records);
+        for (memsim::TraceSpan b = source.next_batch(); !b.empty();
+             b = source.next_batch()) {
+          sweep.run_batch(b);
+          records += b.size;
+        }
+      }
+    } else {
+      // Decode text once per batch; every configuration shares the records
+      std::vector<memsim::TraceRecord> batch;
+      batch.reserve(batch_records);
+      char access_char;
+      memsim::Address addr;
+      auto flush = [&]() {
+        sweep.run_batch(memsim::TraceSpan{batch.data(), batch.size()});
+        records += batch.size();
+        batch.clear();
+      };
+      while (std::cin >> access_char >> std::hex >> addr) {
+        if (access_char == 'R' || access_char == 'r') {
+          batch.push_back(
+              memsim::TraceRecord::make(addr, memsim::AccessType::READ, 8));
+        } else if (access_char == 'W' || access_char == 'w') {
+          batch.push_back(
+              memsim::TraceRecord::make(addr, memsim::AccessType::WRITE, 8));
+        } else {
+          continue;
+        }
+        if (batch.size() == batch_records) {
+          flush();
+        }
+      }
+      flush();
+    }
+
+    std::vector<memsim::SweepResult> results = sweep.results();
+    std::ofstream file;
+    if (!output.empty()) {
+      file.open(output);
+      if (!file.is_open()) {
+        std::cerr << "Error: Could not open " << output << std::endl;
+        return 1;
+      }
+    }
+    std::ostream &out = output.empty() ? std::cout : file;
+    if (format == "json") {
+      memsim::write_sweep_json(out, results);
+    } else {
+      memsim::write_sweep_csv(out, results);
+    }
+  } catch (const std::exception &e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
+  }
+
+  double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                              start)
+                    .count();
+  std::cerr << "Processed " << std::dec << records << " records in " << secs
+            << " s" << std::endl;
+  return 0;
+}
@@ -0,0 +1,43 @@
+#include "trace_reader.h"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+// Convert a text trace ("R 0x1234" lines) into the binary .mtr format
+//
+// Usage: trace_convert <input.txt|-> <output.mtr> [block_size] [access_size]
+
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+    std::cerr << "Usage: " << argv[0]
+              << " <input.txt|-> <output.mtr> [block_size] [access_size]\n";
+    return 1;
+  }
+
+  std::string input = argv[1];
+  std::string output = argv[2];
+  uint32_t block_size = argc > 3 ? std::atoi(argv[3]) : 0;
+  uint16_t access_size = argc > 4 ? std::atoi(argv[4]) : 8;
+
+  try {
+    memsim::TraceWriter writer(output, block_size);
+    uint64_t n;
+    if (input == "-") {
+      n = memsim::convert_text_trace(std::cin, writer, access_size);
+    } else {
+      std::ifstream in(input);
+      if (!in.is_open()) {
+        std::cerr << "Error: Could not open " << input << "\n";
+        return 1;
+      }
+      n = memsim::convert_text_trace(in, writer, access_size);
+    }
+    writer.close();
+    std::cout << "Converted " << n << " records to " << output << std::endl;
+  } catch (const std::exception &e) {
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
+  }
+
+  return 0;
+}
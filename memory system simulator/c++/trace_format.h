@@ -0,0 +1,105 @@
+#pragma once
+
+#include "types.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace memsim {
+
+/**
+ * Binary trace format (.mtr)
+ *
+ * A fixed 32-byte header followed by record_count fixed 16-byte records,
+ * all little-endian. The layout is designed to be mmap'ed and read in place:
+ *
+ * ┌────────────────┬──────────┬──────────┬─────┬──────────┐
+ * │  TraceHeader   │ record 0 │ record 1 │ ... │ record N │
+ * │   (32 bytes)   │ (16 B)   │ (16 B)   │     │ (16 B)   │
+ * └────────────────┴──────────┴──────────┴─────┴──────────┘
+ */
+
+constexpr char TRACE_MAGIC[8] = {'M', 'E', 'M', 'T', 'R', 'A', 'C', 'E'};
+constexpr uint32_t TRACE_VERSION = 1;
+
+/**
+ * TraceOp - Operation stored in a TraceRecord
+ */
+enum class TraceOp : uint8_t { READ = 0, WRITE = 1 };
+
+/**
+ * TraceHeader - File header for binary traces
+ */
+struct TraceHeader {
+  char magic[8];         // "MEMTRACE"
+  uint32_t version;      // TRACE_VERSION
+  uint32_t record_size;  // sizeof(TraceRecord), for forward compatibility
+  uint64_t record_count; // Number of records following the header
+  uint32_t block_size;   // Block size the trace was captured for (0 = any)
+  uint32_t flags;        // Reserved, must be 0
+
+  TraceHeader()
+      : version(TRACE_VERSION), record_size(16), record_count(0),
+        block_size(0), flags(0) {
+    std::memcpy(magic, TRACE_MAGIC, sizeof(magic));
+  }
+
+  bool valid_magic() const {
+    return std::memcmp(magic, TRACE_MAGIC, sizeof(magic)) == 0;
+  }
+};
+
+/**
+ * TraceRecord - One memory access
+ */
+struct TraceRecord {
+  Address addr;         // Byte address
+  uint32_t cycle_delta; // Cycles since the previous record (0 if untimed)
+  uint16_t size_bytes;  // Access size
+  uint8_t op;           // TraceOp
+  uint8_t core;         // Issuing core (0 for single-core traces)
+
+  AccessType type() const {
+    return op == static_cast<uint8_t>(TraceOp::WRITE) ? AccessType::WRITE
+                                                      : AccessType::READ;
+  }
+
+  /**
+   * Convert to a MemoryRequest
+   * @param arrival Absolute arrival cycle (running sum of cycle_delta)
+   */
+  MemoryRequest to_request(Cycle arrival) const {
+    return MemoryRequest(addr, arrival, type(), size_bytes);
+  }
+
+  static TraceRecord make(Address addr, AccessType type, uint16_t size_bytes,
+                          uint32_t cycle_delta = 0, uint8_t core = 0) {
+    TraceRecord r;
+    r.addr = addr;
+    r.cycle_delta = cycle_delta;
+    r.size_bytes = size_bytes;
+    r.op = static_cast<uint8_t>(type == AccessType::WRITE ? TraceOp::WRITE
+                                                          : TraceOp::READ);
+    r.core = core;
+    return r;
+  }
+};
+
+static_assert(sizeof(TraceHeader) == 32, "TraceHeader must be 32 bytes");
+static_assert(sizeof(TraceRecord) == 16, "TraceRecord must be 16 bytes");
+
+/**
+ * TraceSpan - Non-owning view of contiguous records (C++17 stand-in for
+ * std::span<const TraceRecord>)
+ */
+struct TraceSpan {
+  const TraceRecord *data = nullptr;
+  size_t size = 0;
+
+  const TraceRecord *begin() const { return data; }
+  const TraceRecord *end() const { return data + size; }
+  const TraceRecord &operator[](size_t i) const { return data[i]; }
+  bool empty() const { return size == 0; }
+};
+
+} // namespace memsim
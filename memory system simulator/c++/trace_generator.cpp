@@ -0,0 +1,520 @@
+#include "trace_generator.h"
+#include "trace_reader.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+
+namespace memsim {
+
+const char *pattern_name(PatternKind kind) {
+  switch (kind) {
+  case PatternKind::SEQUENTIAL:
+    return "sequential";
+  case PatternKind::STRIDED:
+    return "strided";
+  case PatternKind::UNIFORM:
+    return "uniform";
+  case PatternKind::ZIPFIAN:
+    return "zipf";
+  case PatternKind::POINTER_CHASE:
+    return "chase";
+  }
+  return "unknown";
+}
+
+namespace {
+
+// ============================================================================
+// Patterns
+// ============================================================================
+
+/**
+ * Shared state: spec, generator and the read/write draw
+ */
+class BasicPattern : public TracePattern {
+public:
+  BasicPattern(const PatternSpec &spec, uint64_t seed)
+      : spec_(spec), seed_(seed), rng_(seed) {
+    // Write when a 64-bit draw falls under the threshold
+    if (spec.write_fraction >= 1.0) {
+      write_threshold_ = ~0ULL;
+    } else if (spec.write_fraction <= 0.0) {
+      write_threshold_ = 0;
+    } else {
+      write_threshold_ =
+          static_cast<uint64_t>(spec.write_fraction * 18446744073709551616.0);
+    }
+  }
+
+  void reset() override {
+    rng_.seed(seed_);
+    restart();
+  }
+
+protected:
+  PatternSpec spec_;
+  uint64_t seed_;
+  Xoshiro256 rng_;
+  uint64_t write_threshold_;
+
+  virtual void restart() = 0;
+
+  TraceRecord record(Address addr) {
+    bool write = write_threshold_ != 0 &&
+                 (write_threshold_ == ~0ULL || rng_.next() < write_threshold_);
+    return TraceRecord::make(addr, write ? AccessType::WRITE : AccessType::READ,
+                             spec_.access_size, spec_.cycle_delta);
+  }
+
+  uint64_t granules() const { return spec_.footprint / spec_.stride; }
+};
+
+/** SEQUENTIAL and STRIDED: fixed step, wrapping at the footprint */
+class StridePattern : public BasicPattern {
+public:
+  StridePattern(const PatternSpec &spec, uint64_t seed, uint64_t step)
+      : BasicPattern(spec, seed), step_(step), offset_(0) {}
+
+  void generate(TraceRecord *out, size_t n) override {
+    for (size_t i = 0; i < n; ++i) {
+      out[i] = record(spec_.base + offset_);
+      offset_ += step_;
+      if (offset_ >= spec_.footprint) {
+        offset_ %= spec_.footprint;
+      }
+    }
+  }
+
+private:
+  uint64_t step_;
+  uint64_t offset_;
+
+  void restart() override { offset_ = 0; }
+};
+
+/** UNIFORM: any stride-sized granule of the footprint, equally likely */
+class UniformPattern : public BasicPattern {
+public:
+  using BasicPattern::BasicPattern;
+
+  void generate(TraceRecord *out, size_t n) override {
+    uint64_t count = granules();
+    for (size_t i = 0; i < n; ++i) {
+      out[i] = record(spec_.base + rng_.below(count) * spec_.stride);
+    }
+  }
+
+private:
+  void restart() override {}
+};
+
+/**
+ * ZIPFIAN: Gray et al.'s closed-form sampler, O(1) per record
+ *
+ * zeta(n) is summed exactly for the first 2^20 ranks and integrated beyond
+ * that, so setup stays fast for billion-block footprints. Ranks are spread
+ * over the footprint by an affine bijection, so hot granules aren't
+ * neighbours that share a few cache sets.
+ */
+class ZipfPattern : public BasicPattern {
+public:
+  ZipfPattern(const PatternSpec &spec, uint64_t seed)
+      : BasicPattern(spec, seed), n_(granules()) {
+    const double theta = spec.theta;
+    const uint64_t exact = std::min<uint64_t>(n_, 1 << 20);
+    double zetan = 0.0;
+    for (uint64_t i = 1; i <= exact; ++i) {
+      zetan += std::pow(static_cast<double>(i), -theta);
+    }
+    if (n_ > exact) {
+      zetan += (std::pow(n_ + 0.5, 1.0 - theta) -
+                std::pow(exact + 0.5, 1.0 - theta)) /
+               (1.0 - theta);
+    }
+    zetan_ = zetan;
+    half_pow_theta_ = std::pow(0.5, theta);
+    alpha_ = 1.0 / (1.0 - theta);
+    double zeta2 = 1.0 + half_pow_theta_;
+    eta_ = (1.0 - std::pow(2.0 / n_, 1.0 - theta)) / (1.0 - zeta2 / zetan);
+
+    // Multiplier coprime with n makes rank -> granule a bijection
+    multiplier_ = n_ > 1 ? 0x9E3779B97F4A7C15ULL % n_ : 0;
+    while (n_ > 1 && std::gcd(multiplier_, n_) != 1) {
+      multiplier_ = (multiplier_ + 1) % n_;
+    }
+  }
+
+  void generate(TraceRecord *out, size_t n) override {
+    for (size_t i = 0; i < n; ++i) {
+      uint64_t granule = static_cast<uint64_t>(
+          (static_cast<unsigned __int128>(rank()) * multiplier_) % n_);
+      out[i] = record(spec_.base + granule * spec_.stride);
+    }
+  }
+
+private:
+  uint64_t n_;
+  double zetan_;
+  double half_pow_theta_;
+  double alpha_;
+  double eta_;
+  uint64_t multiplier_;
+
+  uint64_t rank() {
+    double u = rng_.uniform();
+    double uz = u * zetan_;
+    if (uz < 1.0) {
+      return 0;
+    }
+    if (uz < 1.0 + half_pow_theta_) {
+      return n_ > 1 ? 1 : 0;
+    }
+    uint64_t r =
+        static_cast<uint64_t>(n_ * std::pow(eta_ * u - eta_ + 1.0, alpha_));
+    return std::min(r, n_ - 1);
+  }
+
+  void restart() override {}
+};
+
+/**
+ * POINTER_CHASE: each address follows from the previous one
+ *
+ * Models walking a randomly linked list that covers 2^k nodes (the largest
+ * power of two that fits the footprint). The walk uses a full-period LCG
+ * over k bits: a = 1 (mod 4) and an odd increment visit every state exactly
+ * once per cycle. A k-bit bijective mix of that state picks the node, so
+ * the permutation looks random but costs O(1) memory for any footprint.
+ */
+class ChasePattern : public BasicPattern {
+public:
+  ChasePattern(const PatternSpec &spec, uint64_t seed)
+      : BasicPattern(spec, seed) {
+    uint64_t nodes = granules();
+    bits_ = 63 - __builtin_clzll(nodes);
+    mask_ = bits_ == 64 ? ~0ULL : (1ULL << bits_) - 1;
+    shift_ = std::max(1u, (bits_ + 1) / 2);
+    restart();
+  }
+
+  void generate(TraceRecord *out, size_t n) override {
+    for (size_t i = 0; i < n; ++i) {
+      state_ = (state_ * 6364136223846793005ULL + increment_) & mask_;
+      out[i] = record(spec_.base + mix(state_) * spec_.stride);
+    }
+  }
+
+private:
+  unsigned bits_;
+  uint64_t mask_;
+  unsigned shift_;
+  uint64_t state_;
+  uint64_t increment_;
+
+  /** Bijection on [0, 2^bits): odd multiplies and xor-shifts, both invertible */
+  uint64_t mix(uint64_t x) const {
+    x = (x * 0xD6E8FEB86659FD93ULL) & mask_;
+    x ^= x >> shift_;
+    x = (x * 0xA0761D6478BD642FULL) & mask_;
+    x ^= x >> shift_;
+    return x;
+  }
+
+  void restart() override {
+    Xoshiro256 setup(seed_ ^ 0xC4A5E0ULL);
+    state_ = setup.next() & mask_;
+    increment_ = setup.next() | 1;
+  }
+};
+
+// ============================================================================
+// Markov phase mix
+// ============================================================================
+
+class PhaseMix : public TracePattern {
+public:
+  PhaseMix(std::vector<std::unique_ptr<TracePattern>> phases,
+           const std::vector<std::vector<double>> &transitions,
+           uint64_t mean_phase_length, uint64_t seed)
+      : phases_(std::move(phases)), mean_(mean_phase_length), seed_(seed),
+        rng_(seed) {
+    if (phases_.empty()) {
+      throw std::invalid_argument("Phase mix needs at least one phase");
+    }
+    if (mean_ == 0) {
+      throw std::invalid_argument("Mean phase length must be at least 1");
+    }
+    if (transitions.size() != phases_.size()) {
+      throw std::invalid_argument("Transition matrix needs one row per phase");
+    }
+    for (const std::vector<double> &row : transitions) {
+      if (row.size() != phases_.size()) {
+        throw std::invalid_argument(
+            "Transition matrix needs one column per phase");
+      }
+      std::vector<double> cumulative(row.size());
+      double total = 0.0;
+      for (size_t j = 0; j < row.size(); ++j) {
+        if (row[j] < 0.0) {
+          throw std::invalid_argument("Transition weights must be >= 0");
+        }
+        total += row[j];
+        cumulative[j] = total;
+      }
+      if (total <= 0.0) {
+        throw std::invalid_argument("Every phase needs a successor");
+      }
+      for (double &c : cumulative) {
+        c /= total;
+      }
+      cumulative_.push_back(cumulative);
+    }
+    restart();
+  }
+
+  void generate(TraceRecord *out, size_t n) override {
+    while (n > 0) {
+      if (remaining_ == 0) {
+        const std::vector<double> &row = cumulative_[current_];
+        double u = rng_.uniform();
+        current_ = std::upper_bound(row.begin(), row.end() - 1, u) - row.begin();
+        remaining_ = draw_length();
+      }
+      size_t take = static_cast<size_t>(std::min<uint64_t>(n, remaining_));
+      phases_[current_]->generate(out, take);
+      out += take;
+      n -= take;
+      remaining_ -= take;
+    }
+  }
+
+  void reset() override {
+    for (std::unique_ptr<TracePattern> &phase : phases_) {
+      phase->reset();
+    }
+    rng_.seed(seed_);
+    restart();
+  }
+
+private:
+  std::vector<std::unique_ptr<TracePattern>> phases_;
+  std::vector<std::vector<double>> cumulative_;
+  uint64_t mean_;
+  uint64_t seed_;
+  Xoshiro256 rng_;
+  size_t current_;
+  uint64_t remaining_;
+
+  /** Exponential with the requested mean, at least one record */
+  uint64_t draw_length() {
+    double u = rng_.uniform();
+    return 1 + static_cast<uint64_t>(-std::log1p(-u) * (mean_ - 1));
+  }
+
+  void restart() {
+    current_ = 0;
+    remaining_ = draw_length();
+  }
+};
+
+// ============================================================================
+// Spec parsing
+// ============================================================================
+
+uint64_t parse_bytes(const std::string &key, const std::string &value) {
+  size_t used = 0;
+  uint64_t n;
+  try {
+    n = std::stoull(value, &used, 0);
+  } catch (const std::exception &) {
+    throw std::invalid_argument("Bad value for " + key + ": " + value);
+  }
+  std::string suffix = value.substr(used);
+  if (suffix == "K" || suffix == "k") {
+    n <<= 10;
+  } else if (suffix == "M" || suffix == "m") {
+    n <<= 20;
+  } else if (suffix == "G" || suffix == "g") {
+    n <<= 30;
+  } else if (!suffix.empty()) {
+    throw std::invalid_argument("Bad value for " + key + ": " + value);
+  }
+  return n;
+}
+
+double parse_double(const std::string &key, const std::string &value) {
+  size_t used = 0;
+  double d;
+  try {
+    d = std::stod(value, &used);
+  } catch (const std::exception &) {
+    used = 0;
+  }
+  if (used == 0 || used != value.size()) {
+    throw std::invalid_argument("Bad value for " + key + ": " + value);
+  }
+  return d;
+}
+
+} // namespace
+
+// ============================================================================
+// Factories
+// ============================================================================
+
+std::unique_ptr<TracePattern> make_pattern(const PatternSpec &spec,
+                                           uint64_t seed) {
+  if (spec.stride == 0) {
+    throw std::invalid_argument("Stride must be positive");
+  }
+  if (spec.footprint < spec.stride || spec.footprint == 0) {
+    throw std::invalid_argument("Footprint must hold at least one stride");
+  }
+  if (spec.access_size == 0) {
+    throw std::invalid_argument("Access size must be positive");
+  }
+
+  switch (spec.kind) {
+  case PatternKind::SEQUENTIAL:
+    return std::unique_ptr<TracePattern>(
+        new StridePattern(spec, seed, spec.access_size));
+  case PatternKind::STRIDED:
+    return std::unique_ptr<TracePattern>(
+        new StridePattern(spec, seed, spec.stride));
+  case PatternKind::UNIFORM:
+    return std::unique_ptr<TracePattern>(new UniformPattern(spec, seed));
+  case PatternKind::ZIPFIAN:
+    if (!(spec.theta > 0.0 && spec.theta < 1.0)) {
+      throw std::invalid_argument("Zipf theta must be in (0, 1)");
+    }
+    return std::unique_ptr<TracePattern>(new ZipfPattern(spec, seed));
+  case PatternKind::POINTER_CHASE:
+    return std::unique_ptr<TracePattern>(new ChasePattern(spec, seed));
+  }
+  throw std::invalid_argument("Unknown pattern kind");
+}
+
+std::unique_ptr<TracePattern>
+make_phase_mix(std::vector<std::unique_ptr<TracePattern>> phases,
+               const std::vector<std::vector<double>> &transitions,
+               uint64_t mean_phase_length, uint64_t seed) {
+  return std::unique_ptr<TracePattern>(
+      new PhaseMix(std::move(phases), transitions, mean_phase_length, seed));
+}
+
+PatternSpec parse_pattern_spec(const std::string &text) {
+  PatternSpec spec;
+  size_t colon = text.find(':');
+  std::string kind = text.substr(0, colon);
+  if (kind == "sequential") {
+    spec.kind = PatternKind::SEQUENTIAL;
+  } else if (kind == "strided") {
+    spec.kind = PatternKind::STRIDED;
+  } else if (kind == "uniform" || kind == "random") {
+    spec.kind = PatternKind::UNIFORM;
+  } else if (kind == "zipf" || kind == "zipfian") {
+    spec.kind = PatternKind::ZIPFIAN;
+  } else if (kind == "chase" || kind == "pointer-chase") {
+    spec.kind = PatternKind::POINTER_CHASE;
+  } else {
+    throw std::invalid_argument("Unknown pattern: " + kind);
+  }
+  if (colon == std::string::npos) {
+    return spec;
+  }
+
+  std::istringstream params(text.substr(colon + 1));
+  std::string param;
+  while (std::getline(params, param, ',')) {
+    size_t eq = param.find('=');
+    if (eq == std::string::npos) {
+      throw std::invalid_argument("Expected key=value, got: " + param);
+    }
+    std::string key = param.substr(0, eq);
+    std::string value = param.substr(eq + 1);
+    if (key == "base") {
+      spec.base = parse_bytes(key, value);
+    } else if (key == "footprint") {
+      spec.footprint = parse_bytes(key, value);
+    } else if (key == "stride") {
+      spec.stride = parse_bytes(key, value);
+    } else if (key == "size") {
+      spec.access_size = static_cast<uint16_t>(parse_bytes(key, value));
+    } else if (key == "theta") {
+      spec.theta = parse_double(key, value);
+    } else if (key == "writes") {
+      spec.write_fraction = parse_double(key, value);
+    } else if (key == "gap") {
+      spec.cycle_delta = static_cast<uint32_t>(parse_bytes(key, value));
+    } else {
+      throw std::invalid_argument("Unknown pattern parameter: " + key);
+    }
+  }
+  return spec;
+}
+
+std::unique_ptr<TracePattern> parse_pattern(const std::string &text,
+                                            uint64_t seed,
+                                            uint64_t mean_phase_length) {
+  std::vector<std::string> parts;
+  std::istringstream in(text);
+  std::string part;
+  while (std::getline(in, part, '+')) {
+    parts.push_back(part);
+  }
+  if (parts.empty()) {
+    throw std::invalid_argument("Empty pattern");
+  }
+  if (parts.size() == 1) {
+    return make_pattern(parse_pattern_spec(parts[0]), seed);
+  }
+
+  // Every phase moves to any other phase with equal probability
+  std::vector<std::unique_ptr<TracePattern>> phases;
+  std::vector<std::vector<double>> transitions;
+  for (size_t i = 0; i < parts.size(); ++i) {
+    phases.push_back(make_pattern(parse_pattern_spec(parts[i]), seed + i + 1));
+    std::vector<double> row(parts.size(), 1.0);
+    row[i] = 0.0;
+    transitions.push_back(row);
+  }
+  return make_phase_mix(std::move(phases), transitions, mean_phase_length,
+                        seed);
+}
+
+// ============================================================================
+// TraceGenerator
+// ============================================================================
+
+TraceGenerator::TraceGenerator(std::unique_ptr<TracePattern> pattern,
+                               uint64_t count, size_t batch_records)
+    : pattern_(std::move(pattern)), count_(count), produced_(0),
+      buffer_(std::max<size_t>(batch_records, 1)) {}
+
+TraceSpan TraceGenerator::next_batch() {
+  size_t n = static_cast<size_t>(
+      std::min<uint64_t>(buffer_.size(), count_ - produced_));
+  if (n > 0) {
+    pattern_->generate(buffer_.data(), n);
+    produced_ += n;
+  }
+  return TraceSpan{buffer_.data(), n};
+}
+
+uint64_t TraceGenerator::write(TraceWriter &out) {
+  uint64_t written = 0;
+  for (TraceSpan batch = next_batch(); !batch.empty(); batch = next_batch()) {
+    out.write(batch.data, batch.size);
+    written += batch.size;
+  }
+  return written;
+}
+
+void TraceGenerator::rewind() {
+  pattern_->reset();
+  produced_ = 0;
+}
+
+} // namespace memsim
@@ -0,0 +1,210 @@
+#pragma once
+
+#include "trace_format.h"
+#include "types.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace memsim {
+
+class TraceWriter;
+
+/**
+ * Xoshiro256 - xoshiro256** pseudo-random generator
+ *
+ * 256 bits of state, a few shifts, rotates and xors per draw: several times
+ * faster than std::mt19937_64 with better statistical quality than an LCG.
+ * Seeded through splitmix64, so any 64-bit seed gives a well-mixed state.
+ */
+class Xoshiro256 {
+public:
+  explicit Xoshiro256(uint64_t seed = 1) { this->seed(seed); }
+
+  void seed(uint64_t seed) {
+    for (uint64_t &word : s_) {
+      seed += 0x9E3779B97F4A7C15ULL; // splitmix64
+      uint64_t z = seed;
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+      word = z ^ (z >> 31);
+    }
+  }
+
+  /** Set the raw state (must not be all zero) */
+  void set_state(uint64_t s0, uint64_t s1, uint64_t s2, uint64_t s3) {
+    s_[0] = s0;
+    s_[1] = s1;
+    s_[2] = s2;
+    s_[3] = s3;
+  }
+
+  uint64_t next() {
+    uint64_t result = rotl(s_[1] * 5, 7) * 9;
+    uint64_t t = s_[1] << 17;
+    s_[2] ^= s_[0];
+    s_[3] ^= s_[1];
+    s_[1] ^= s_[2];
+    s_[0] ^= s_[3];
+    s_[2] ^= t;
+    s_[3] = rotl(s_[3], 45);
+    return result;
+  }
+
+  /** Uniform in [0, bound) by multiply-shift (no division) */
+  uint64_t below(uint64_t bound) {
+    return static_cast<uint64_t>(
+        (static_cast<unsigned __int128>(next()) * bound) >> 64);
+  }
+
+  /** Uniform in [0, 1) with 53 bits of precision */
+  double uniform() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+
+private:
+  uint64_t s_[4];
+
+  static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+};
+
+/**
+ * PatternKind - Synthetic access pattern
+ */
+enum class PatternKind {
+  SEQUENTIAL,   // base, base+size, base+2*size, ... wrapping at footprint
+  STRIDED,      // base, base+stride, ... wrapping at footprint
+  UNIFORM,      // uniform random block in the footprint
+  ZIPFIAN,      // block popularity ~ 1 / rank^theta, ranks scattered
+  POINTER_CHASE // dependent walk through one random cycle of all nodes
+};
+
+const char *pattern_name(PatternKind kind);
+
+/**
+ * PatternSpec - Parameters of one synthetic pattern
+ */
+struct PatternSpec {
+  PatternKind kind = PatternKind::SEQUENTIAL;
+  Address base = 0;           // First byte of the region
+  uint64_t footprint = 1 << 20; // Bytes the pattern touches
+  uint64_t stride = 64;       // STRIDED step; UNIFORM/ZIPFIAN/CHASE granule
+  double theta = 0.99;        // ZIPFIAN skew, 0 < theta < 1
+  double write_fraction = 0.0; // Probability that a record is a write
+  uint16_t access_size = 8;   // size_bytes of every record (SEQUENTIAL step)
+  uint32_t cycle_delta = 0;   // Gap between records (0 = untimed)
+};
+
+/**
+ * TracePattern - Source of synthetic records
+ *
+ * Records are produced a batch at a time, so the pattern's virtual call and
+ * any setup are paid once per batch, not once per record.
+ */
+class TracePattern {
+public:
+  virtual ~TracePattern() = default;
+
+  /** Fill out[0..n) with the next n records */
+  virtual void generate(TraceRecord *out, size_t n) = 0;
+
+  /** Restart from the first record (same seed, same stream) */
+  virtual void reset() = 0;
+};
+
+/**
+ * Build a pattern
+ * @throws std::invalid_argument if the spec is inconsistent (e.g. empty
+ *         footprint, stride of 0, theta outside (0, 1))
+ */
+std::unique_ptr<TracePattern> make_pattern(const PatternSpec &spec,
+                                           uint64_t seed = 1);
+
+/**
+ * Build a Markov phase mix
+ *
+ * Runs one phase at a time. Phase lengths are drawn from an exponential
+ * distribution with mean mean_phase_length records. At the end of a phase
+ * the next one is drawn from row `current` of the transition matrix (rows
+ * needn't be normalized). Every phase keeps its own position, so a
+ * sequential phase resumes where it stopped.
+ * @param phases Patterns to switch between
+ * @param transitions phases.size() x phases.size() weights
+ * @param mean_phase_length Mean records per phase (>= 1)
+ * @throws std::invalid_argument on a malformed matrix
+ */
+std::unique_ptr<TracePattern>
+make_phase_mix(std::vector<std::unique_ptr<TracePattern>> phases,
+               const std::vector<std::vector<double>> &transitions,
+               uint64_t mean_phase_length, uint64_t seed = 1);
+
+/**
+ * Parse one pattern, "kind[:key=value,...]"
+ *
+ * Kinds: sequential, strided, uniform (or random), zipf (or zipfian),
+ * chase (or pointer-chase). Keys: base, footprint, stride, size, theta,
+ * writes (write fraction), gap (cycle_delta). Byte amounts accept K/M/G
+ * suffixes, e.g. "zipf:footprint=64M,theta=0.9,writes=0.3".
+ * @throws std::invalid_argument on unknown kinds/keys or bad values
+ */
+PatternSpec parse_pattern_spec(const std::string &text);
+
+/**
+ * Build a pattern from the command-line form
+ * A single spec, or several joined with '+' for a phase mix in which every
+ * phase jumps to any other with equal probability, e.g.
+ * "sequential:footprint=8M+chase:footprint=256M".
+ * @throws std::invalid_argument on a bad spec
+ */
+std::unique_ptr<TracePattern> parse_pattern(const std::string &text,
+                                            uint64_t seed = 1,
+                                            uint64_t mean_phase_length = 100000);
+
+/**
+ * TraceGenerator - Streams a fixed number of synthetic records
+ *
+ * Has the same next_batch() interface as TraceReader and
+ * CompressedTraceSource. That means a simulation can run straight off the
+ * generator with no trace file, using memory for one batch:
+ *
+ *   TraceGenerator gen(parse_pattern("zipf:footprint=1G"), 1000000000);
+ *   for (TraceSpan b = gen.next_batch(); !b.empty(); b = gen.next_batch())
+ *     cache.access_batch(b);
+ */
+class TraceGenerator {
+public:
+  /**
+   * @param pattern Record source
+   * @param count Records to produce in total
+   * @param batch_records Records per batch
+   */
+  TraceGenerator(std::unique_ptr<TracePattern> pattern, uint64_t count,
+                 size_t batch_records = 64 * 1024);
+
+  /**
+   * Next batch of records
+   * The span stays valid until the following call.
+   * @return Up to batch_records records; empty once count are produced
+   */
+  TraceSpan next_batch();
+
+  /**
+   * Write the remaining records to a binary trace
+   * @return Number of records written
+   */
+  uint64_t write(TraceWriter &out);
+
+  /** Start over from the first record */
+  void rewind();
+
+  uint64_t size() const { return count_; }
+  uint64_t produced() const { return produced_; }
+
+private:
+  std::unique_ptr<TracePattern> pattern_;
+  uint64_t count_;
+  uint64_t produced_;
+  std::vector<TraceRecord> buffer_;
+};
+
+} // namespace memsim
@@ -0,0 +1,195 @@
+#include "trace_reader.h"
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace memsim {
+
+// ============================================================================
+// TraceReader
+// ============================================================================
+
+TraceReader::TraceReader(const std::string &path)
+    : map_(nullptr), map_size_(0), records_(nullptr), count_(0), cursor_(0) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Could not open trace file: " + path);
+  }
+
+  struct stat st;
+  if (::fstat(fd, &st) != 0 ||
+      static_cast<size_t>(st.st_size) < sizeof(TraceHeader)) {
+    ::close(fd);
+    throw std::runtime_error("Trace file too small: " + path);
+  }
+  map_size_ = static_cast<size_t>(st.st_size);
+
+  map_ = ::mmap(nullptr, map_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd); // The mapping keeps the file alive
+  if (map_ == MAP_FAILED) {
+    map_ = nullptr;
+    throw std::runtime_error("Could not mmap trace file: " + path);
+  }
+  // Records are consumed front to back: let the kernel read ahead
+  ::madvise(map_, map_size_, MADV_SEQUENTIAL);
+
+  std::memcpy(&header_, map_, sizeof(TraceHeader));
+  const char *error = nullptr;
+  if (!header_.valid_magic()) {
+    error = "Not a binary trace (bad magic): ";
+  } else if (header_.version != TRACE_VERSION) {
+    error = "Unsupported trace version: ";
+  } else if (header_.record_size != sizeof(TraceRecord)) {
+    error = "Unsupported trace record size: ";
+  } else if (header_.record_count >
+             (map_size_ - sizeof(TraceHeader)) / sizeof(TraceRecord)) {
+    error = "Trace file truncated: ";
+  }
+  if (error) {
+    ::munmap(map_, map_size_);
+    map_ = nullptr;
+    throw std::runtime_error(error + path);
+  }
+
+  records_ = reinterpret_cast<const TraceRecord *>(
+      static_cast<const char *>(map_) + sizeof(TraceHeader));
+  count_ = static_cast<size_t>(header_.record_count);
+}
+
+TraceReader::~TraceReader() {
+  if (map_) {
+    ::munmap(map_, map_size_);
+  }
+}
+
+TraceSpan TraceReader::next_batch(size_t max_records) {
+  size_t n = count_ - cursor_;
+  if (n > max_records) {
+    n = max_records;
+  }
+  TraceSpan span{records_ + cursor_, n};
+  cursor_ += n;
+  return span;
+}
+
+// ============================================================================
+// TraceWriter
+// ============================================================================
+
+namespace {
+constexpr size_t WRITER_BUFFER_RECORDS = 64 * 1024; // 1 MB of records
+}
+
+TraceWriter::TraceWriter(const std::string &path, uint32_t block_size)
+    : file_(std::fopen(path.c_str(), "wb")) {
+  if (!file_) {
+    throw std::runtime_error("Could not create trace file: " + path);
+  }
+  header_.block_size = block_size;
+  buffer_.reserve(WRITER_BUFFER_RECORDS);
+  // Placeholder header; record_count is rewritten on close()
+  if (std::fwrite(&header_, sizeof(header_), 1, file_) != 1) {
+    std::fclose(file_);
+    throw std::runtime_error("Could not write trace header: " + path);
+  }
+}
+
+TraceWriter::~TraceWriter() {
+  // A destructor can't report a failed write; call close() to see it
+  try {
+    close();
+  } catch (const std::exception &) {
+  }
+}
+
+void TraceWriter::write(const TraceRecord &record) {
+  buffer_.push_back(record);
+  header_.record_count++;
+  if (buffer_.size() == WRITER_BUFFER_RECORDS) {
+    flush();
+  }
+}
+
+void TraceWriter::write(const TraceRecord *records, size_t count) {
+  flush();
+  if (count > 0 &&
+      std::fwrite(records, sizeof(TraceRecord), count, file_) != count) {
+    throw std::runtime_error("Short write to trace file");
+  }
+  header_.record_count += count;
+}
+
+void TraceWriter::flush() {
+  if (!buffer_.empty()) {
+    if (std::fwrite(buffer_.data(), sizeof(TraceRecord), buffer_.size(),
+                    file_) != buffer_.size()) {
+      throw std::runtime_error("Short write to trace file");
+    }
+    buffer_.clear();
+  }
+}
+
+void TraceWriter::close() {
+  if (!file_) {
+    return;
+  }
+  // The file is closed even when a write fails, so close() runs once
+  bool ok = true;
+  try {
+    flush();
+  } catch (const std::runtime_error &) {
+    ok = false;
+  }
+  ok = ok && std::fseek(file_, 0, SEEK_SET) == 0 &&
+       std::fwrite(&header_, sizeof(header_), 1, file_) == 1;
+  ok = std::fclose(file_) == 0 && ok;
+  file_ = nullptr;
+  if (!ok) {
+    throw std::runtime_error("Could not finish writing trace file");
+  }
+}
+
+// ============================================================================
+// Text Conversion
+// ============================================================================
+
+uint64_t convert_text_trace(std::istream &in, TraceWriter &out,
+                            uint16_t size_bytes) {
+  uint64_t converted = 0;
+  std::string line;
+
+  while (std::getline(in, line)) {
+    // Skip leading whitespace, then expect an op character
+    const char *p = line.c_str();
+    while (*p == ' ' || *p == '\t') {
+      p++;
+    }
+
+    AccessType type;
+    if (*p == 'R' || *p == 'r') {
+      type = AccessType::READ;
+    } else if (*p == 'W' || *p == 'w') {
+      type = AccessType::WRITE;
+    } else {
+      continue; // Blank line, comment or garbage
+    }
+
+    // strtoull with base 16 accepts an optional 0x prefix
+    char *end = nullptr;
+    Address addr = std::strtoull(p + 1, &end, 16);
+    if (end == p + 1) {
+      continue; // No address on this line
+    }
+
+    out.write(TraceRecord::make(addr, type, size_bytes));
+    converted++;
+  }
+
+  return converted;
+}
+
+} // namespace memsim
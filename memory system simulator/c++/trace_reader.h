@@ -0,0 +1,111 @@
+#pragma once
+
+#include "trace_format.h"
+#include <cstdint>
+#include <cstdio>
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace memsim {
+
+/**
+ * TraceReader - Zero-copy reader for binary traces
+ *
+ * The whole file is mmap'ed read-only; records() and next_batch() return
+ * spans pointing straight into the mapping, so no record is ever copied or
+ * parsed. The mapping lives as long as the reader.
+ */
+class TraceReader {
+public:
+  /**
+   * Map a binary trace file
+   * @param path Path to a .mtr file
+   * @throws std::runtime_error if the file can't be mapped or is malformed
+   */
+  explicit TraceReader(const std::string &path);
+  ~TraceReader();
+
+  TraceReader(const TraceReader &) = delete;
+  TraceReader &operator=(const TraceReader &) = delete;
+
+  const TraceHeader &header() const { return header_; }
+  size_t size() const { return count_; }
+
+  /**
+   * Every record in the trace
+   */
+  TraceSpan records() const { return TraceSpan{records_, count_}; }
+
+  /**
+   * Next sequential batch of records
+   * @param max_records Upper bound on the batch size
+   * @return Span of up to max_records records; empty at end of trace
+   */
+  TraceSpan next_batch(size_t max_records);
+
+  /**
+   * Restart next_batch() from the first record
+   */
+  void rewind() { cursor_ = 0; }
+
+private:
+  TraceHeader header_;
+  void *map_;
+  size_t map_size_;
+  const TraceRecord *records_;
+  size_t count_;
+  size_t cursor_;
+};
+
+/**
+ * TraceWriter - Buffered writer for binary traces
+ *
+ * The header's record_count is patched in on close().
+ */
+class TraceWriter {
+public:
+  /**
+   * Create (truncate) a binary trace file
+   * @param path Output path
+   * @param block_size Block size recorded in the header (0 = any)
+   * @throws std::runtime_error if the file can't be created
+   */
+  TraceWriter(const std::string &path, uint32_t block_size = 0);
+  ~TraceWriter();
+
+  TraceWriter(const TraceWriter &) = delete;
+  TraceWriter &operator=(const TraceWriter &) = delete;
+
+  void write(const TraceRecord &record);
+  void write(const TraceRecord *records, size_t count);
+
+  /**
+   * Flush buffered records and finalize the header
+   * The destructor closes too, but swallows errors; call this to see them.
+   * @throws std::runtime_error if a write, seek or close fails
+   */
+  void close();
+
+  uint64_t count() const { return header_.record_count; }
+
+private:
+  std::FILE *file_;
+  TraceHeader header_;
+  std::vector<TraceRecord> buffer_;
+
+  void flush();
+};
+
+/**
+ * Convert a text trace ("R 0x1234" / "W 0x1234" per line) to binary
+ * Blank lines, comments and malformed lines are skipped.
+ * @param in Text trace stream
+ * @param out Destination writer
+ * @param size_bytes Access size stored in every record
+ * @return Number of records written
+ */
+uint64_t convert_text_trace(std::istream &in, TraceWriter &out,
+                            uint16_t size_bytes = 8);
+
+} // namespace memsim
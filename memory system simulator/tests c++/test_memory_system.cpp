@@ -0,0 +1,1001 @@
+#include "../../cache sim/4-way cache/include/checkpoint.h"
+#include "../c++/calendar_queue.h"
+#include "../c++/compressed_trace.h"
+#include "../c++/dram_controller.h"
+#include "../c++/dram_model.h"
+#include "../c++/memory_system.h"
+#include "../c++/nonblocking_cache.h"
+#include "../c++/sweep.h"
+#include "../c++/trace_generator.h"
+#include "../c++/trace_reader.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#ifdef MEMSIM_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+using namespace memsim;
+
+/**
+ * Test 1: Binary Trace Round Trip
+ *
+ * Records written by TraceWriter come back unchanged through the mmap'ed
+ * TraceReader, both as one span and in batches.
+ */
+void test_binary_trace_round_trip() {
+  std::cout << "\n=== Test 1: Binary Trace Round Trip ===\n";
+
+  const std::string path = "test_round_trip.mtr";
+  const uint32_t num_records = 100000;
+  {
+    TraceWriter writer(path, 64);
+    for (uint32_t i = 0; i < num_records; ++i) {
+      AccessType type = (i % 3 == 0) ? AccessType::WRITE : AccessType::READ;
+      writer.write(TraceRecord::make(i * 64ULL, type, 8, i % 5, i % 4));
+    }
+    writer.close();
+    assert(writer.count() == num_records);
+  }
+
+  TraceReader reader(path);
+  assert(reader.size() == num_records);
+  assert(reader.header().block_size == 64);
+
+  TraceSpan all = reader.records();
+  for (uint32_t i = 0; i < num_records; ++i) {
+    assert(all[i].addr == i * 64ULL);
+    assert(all[i].cycle_delta == i % 5);
+    assert(all[i].core == i % 4);
+    assert((all[i].type() == AccessType::WRITE) == (i % 3 == 0));
+  }
+
+  // Batches cover the trace exactly once, without copying
+  size_t seen = 0;
+  for (TraceSpan batch = reader.next_batch(4096); !batch.empty();
+       batch = reader.next_batch(4096)) {
+    assert(batch.data == all.data + seen && "Batches must point into the map");
+    seen += batch.size;
+  }
+  assert(seen == num_records);
+
+  // A failed write surfaces from close(); the destructor stays quiet
+  if (std::FILE *probe = std::fopen("/dev/full", "wb")) {
+    std::fclose(probe);
+    TraceWriter full("/dev/full");
+    full.write(TraceRecord::make(0x40, AccessType::READ, 8));
+    bool threw = false;
+    try {
+      full.close();
+    } catch (const std::runtime_error &) {
+      threw = true;
+    }
+    assert(threw && "Writing to a full device must fail on close()");
+    TraceWriter dropped("/dev/full");
+    dropped.write(TraceRecord::make(0x40, AccessType::READ, 8));
+  }
+
+  std::remove(path.c_str());
+  std::cout << "✓ Binary trace round trip test passed!\n";
+}
+
+/**
+ * Test 2: Text To Binary Conversion
+ */
+void test_text_conversion() {
+  std::cout << "\n=== Test 2: Text To Binary Conversion ===\n";
+
+  std::istringstream text("R 0x1000\n"
+                          "w 0x2000\n"
+                          "# comment line\n"
+                          "\n"
+                          "  R 0xdeadbeef\n"
+                          "X 0x3000\n");
+  const std::string path = "test_convert.mtr";
+  {
+    TraceWriter writer(path);
+    uint64_t n = convert_text_trace(text, writer, 4);
+    assert(n == 3 && "Comments and bad ops must be skipped");
+  }
+
+  TraceReader reader(path);
+  assert(reader.size() == 3);
+  assert(reader.records()[0].addr == 0x1000);
+  assert(reader.records()[1].type() == AccessType::WRITE);
+  assert(reader.records()[2].addr == 0xdeadbeef);
+  assert(reader.records()[2].size_bytes == 4);
+
+  std::remove(path.c_str());
+  std::cout << "✓ Text conversion test passed!\n";
+}
+
+/**
+ * Test 3: Malformed Trace Files Are Rejected
+ */
+void test_malformed_trace() {
+  std::cout << "\n=== Test 3: Malformed Trace Files ===\n";
+
+  const std::string path = "test_bad.mtr";
+  {
+    std::ofstream out(path, std::ios::binary);
+    out << "this is not a binary trace, just some text";
+  }
+  bool threw = false;
+  try {
+    TraceReader reader(path);
+  } catch (const std::runtime_error &) {
+    threw = true;
+  }
+  assert(threw && "Bad magic must be rejected");
+
+  // Header claims more records than the file holds
+  {
+    TraceHeader header;
+    header.record_count = 10;
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  }
+  threw = false;
+  try {
+    TraceReader reader(path);
+  } catch (const std::runtime_error &) {
+    threw = true;
+  }
+  assert(threw && "Truncated trace must be rejected");
+
+  std::remove(path.c_str());
+  std::cout << "✓ Malformed trace test passed!\n";
+}
+
+/**
+ * Test 4: Streaming Compressed Traces
+ *
+ * A gzip-compressed binary trace streams through the background
+ * decompression thread in order, across many small ring batches.
+ */
+void test_compressed_trace() {
+  std::cout << "\n=== Test 4: Streaming Compressed Traces ===\n";
+
+  const std::string plain = "test_stream.mtr";
+  const uint32_t num_records = 50000;
+  {
+    TraceWriter writer(plain);
+    for (uint32_t i = 0; i < num_records; ++i) {
+      writer.write(TraceRecord::make(i * 8ULL, AccessType::READ, 8));
+    }
+  }
+
+  // Uncompressed files go through the same source
+  {
+    assert(detect_trace_compression(plain) == TraceCompression::NONE);
+    CompressedTraceSource source(plain, 1000, 3);
+    size_t seen = 0;
+    for (TraceSpan b = source.next_batch(); !b.empty(); b = source.next_batch()) {
+      seen += b.size;
+    }
+    assert(seen == num_records);
+  }
+
+#ifdef MEMSIM_HAVE_ZLIB
+  const std::string packed = "test_stream.mtr.gz";
+  {
+    std::ifstream in(plain, std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(in)),
+                            std::istreambuf_iterator<char>());
+    gzFile gz = gzopen(packed.c_str(), "wb");
+    gzwrite(gz, bytes.data(), static_cast<unsigned>(bytes.size()));
+    gzclose(gz);
+  }
+
+  assert(detect_trace_compression(packed) == TraceCompression::GZIP);
+  CompressedTraceSource source(packed, 777, 4);
+  assert(source.header().record_count == num_records);
+
+  uint64_t expected = 0;
+  size_t batches = 0;
+  for (TraceSpan b = source.next_batch(); !b.empty(); b = source.next_batch()) {
+    for (const TraceRecord &r : b) {
+      assert(r.addr == expected * 8 && "Records must arrive in order");
+      expected++;
+    }
+    batches++;
+  }
+  assert(expected == num_records);
+  assert(batches > 4 && "Trace should span more batches than ring slots");
+  std::remove(packed.c_str());
+#else
+  std::cout << "  (zlib not available, gzip path skipped)\n";
+#endif
+
+  std::remove(plain.c_str());
+  std::cout << "✓ Compressed trace test passed!\n";
+}
+
+/**
+ * Test 5: DRAM Row Buffer Timing
+ *
+ * Row hits pay tCAS, idle banks tRCD + tCAS, conflicts tRP + tRCD + tCAS and
+ * may not precharge before tRAS. Requests to a busy bank queue behind it.
+ */
+void test_dram_row_buffer() {
+  std::cout << "\n=== Test 5: DRAM Row Buffer Timing ===\n";
+
+  // 4 banks, tRCD=10 tCAS=12 tRP=8 tRAS=30, 8 KB rows, 4-cycle burst
+  DRAMModel dram(DRAMConfig(4, 10, 12, 8, 30), 8192, 4);
+  const Address row_stride = 8192 * 4; // Next row, same bank
+
+  assert(dram.bank_of(0) == 0 && dram.bank_of(8192) == 1);
+  assert(dram.row_of(row_stride) == 1);
+
+  assert(dram.peek(0) == RowBufferOutcome::MISS);
+  assert(dram.access(0, false, 0) == 10 + 12 + 4);
+  assert(dram.peek(64) == RowBufferOutcome::HIT);
+  assert(dram.access(64, false, 100) == 12 + 4);
+  assert(dram.peek(row_stride) == RowBufferOutcome::CONFLICT);
+  assert(dram.access(row_stride, true, 200) == 8 + 10 + 12 + 4);
+
+  // Conflict right after an activate waits for tRAS
+  assert(dram.access(8192, false, 300) == 26); // Activates at 300
+  assert(dram.access(8192 + row_stride, false, 326) == (330 - 326) + 34);
+
+  // Second request to a busy bank waits for the first
+  assert(dram.access(2 * 8192, false, 1000) == 26);
+  assert(dram.access(2 * 8192 + 64, false, 1000) == 26 + 16);
+
+  assert(dram.row_hits() == 2);
+  assert(dram.row_misses() == 3);
+  assert(dram.row_conflicts() == 2);
+  assert(dram.bank_stats()[0].writes == 1);
+  assert(dram.utilization(3) == 0.0);
+  assert(dram.utilization(0) > 0.0 && dram.utilization(0) < 1.0);
+
+  std::cout << "✓ DRAM row buffer test passed!\n";
+}
+
+/**
+ * Test 6: L1 Through To DRAM
+ *
+ * Both L1 models: hits cost the L1 latency, misses add a DRAM read, and a
+ * dirty victim turns into a DRAM write.
+ */
+void test_memory_system() {
+  std::cout << "\n=== Test 6: L1 Through To DRAM ===\n";
+
+  // 1 KB, 64 B blocks, 2-way (8 sets / 16 direct-mapped lines)
+  SimConfig config(CacheConfig(1, 64, 2), DRAMConfig(4, 10, 12, 8, 30));
+
+  for (L1Type type : {L1Type::SET_ASSOCIATIVE, L1Type::DIRECT_MAPPED}) {
+    {
+      MemorySystem memory(config, type, 4);
+      assert(memory.access(MemoryRequest(0, 0, AccessType::READ, 8)) ==
+             4 + 26);
+      assert(memory.access(MemoryRequest(0, 0, AccessType::READ, 8)) == 4);
+      // Next block is in the row the first miss opened
+      assert(memory.access(MemoryRequest(64, 0, AccessType::READ, 8)) ==
+             4 + 16);
+      assert(memory.current_cycle() == 30 + 4 + 20);
+
+      assert(memory.get_stats().total_accesses() == 3);
+      assert(memory.get_stats().total_hits() == 1);
+      assert(memory.dram().total_accesses() == 2);
+      assert(memory.writebacks() == 0);
+    }
+
+    {
+      // 0, 1024 and 2048 share set 0 (and line 0 when direct-mapped)
+      MemorySystem memory(config, type, 4);
+      memory.access(MemoryRequest(0, 0, AccessType::WRITE, 8));
+      memory.access(MemoryRequest(1024, 0, AccessType::READ, 8));
+      memory.access(MemoryRequest(2048, 0, AccessType::READ, 8));
+      assert(memory.writebacks() == 1);
+      assert(memory.dram().bank_stats()[0].writes == 1);
+      assert(memory.dram().bank_stats()[0].reads == 3);
+    }
+  }
+
+  std::cout << "✓ Memory system test passed!\n";
+}
+
+/**
+ * Test 7: Configuration Sweep
+ *
+ * One pass of the sweep engine gives each configuration exactly the stats
+ * of its own serial run, whatever the thread count or batching.
+ */
+void test_sweep_engine() {
+  std::cout << "\n=== Test 7: Configuration Sweep ===\n";
+
+  std::vector<CacheConfig> grid =
+      make_config_grid({1, 3, 4, 16}, {32, 64}, {1, 2, 8, 128});
+  // 3 KB (not a power-of-2 set count) and 128 ways are skipped
+  assert(grid.size() == 3 * 2 * 3);
+  assert(!valid_cache_config(CacheConfig(1, 64, 32))); // 16 lines < 32 ways
+
+  std::vector<TraceRecord> trace;
+  uint64_t x = 42;
+  for (int i = 0; i < 40000; ++i) {
+    x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    AccessType type = ((x >> 21) & 3) == 0 ? AccessType::WRITE : AccessType::READ;
+    trace.push_back(TraceRecord::make((x >> 33) % (64 * 1024), type, 8));
+  }
+
+  for (size_t threads : {1, 4}) {
+    SweepEngine sweep(grid, threads);
+    assert(sweep.num_threads() == threads);
+    // Uneven batches, like a streamed trace
+    size_t pos = 0;
+    for (size_t n : {size_t(1), size_t(9999), size_t(30000)}) {
+      sweep.run_batch(TraceSpan{trace.data() + pos, n});
+      pos += n;
+    }
+    assert(pos == trace.size());
+
+    std::vector<SweepResult> results = sweep.results();
+    assert(results.size() == grid.size());
+    for (const SweepResult &r : results) {
+      // Reference: the same L1 driven serially through MemorySystem
+      MemorySystem serial(SimConfig(r.config, DRAMConfig(4, 10, 12, 8, 30)));
+      for (const TraceRecord &t : trace) {
+        serial.access(t.to_request(0));
+      }
+      assert(r.accesses == trace.size());
+      assert(r.hits == serial.get_stats().total_hits());
+      assert(r.writebacks == serial.writebacks());
+    }
+
+    std::ostringstream csv;
+    write_sweep_csv(csv, results);
+    size_t lines = 0;
+    for (char c : csv.str()) {
+      lines += (c == '\n');
+    }
+    assert(lines == results.size() + 1);
+  }
+
+  // A 64 MB configuration sweeps with sparse sets, same answer
+  CacheConfig huge(SweepEngine::SPARSE_SWEEP_KB * 2, 64, 8);
+  SweepEngine sparse_sweep({huge}, 1);
+  sparse_sweep.run_batch(TraceSpan{trace.data(), trace.size()});
+  MemorySystem dense(SimConfig(huge, DRAMConfig(4, 10, 12, 8, 30)));
+  for (const TraceRecord &t : trace) {
+    dense.access(t.to_request(0));
+  }
+  assert(sparse_sweep.results()[0].hits == dense.get_stats().total_hits());
+
+  // Geometries without a FixedCache instantiation fall back to FLAT
+  std::vector<CacheConfig> odd = {CacheConfig(16, 256, 4), CacheConfig(16, 64, 32)};
+  SweepEngine odd_sweep(odd, 2);
+  odd_sweep.run_batch(TraceSpan{trace.data(), trace.size()});
+  for (const SweepResult &r : odd_sweep.results()) {
+    MemorySystem serial(SimConfig(r.config, DRAMConfig(4, 10, 12, 8, 30)));
+    for (const TraceRecord &t : trace) {
+      serial.access(t.to_request(0));
+    }
+    assert(r.hits == serial.get_stats().total_hits());
+    assert(r.writebacks == serial.writebacks());
+  }
+
+  bool threw = false;
+  try {
+    SweepEngine bad({CacheConfig(3, 64, 4)});
+  } catch (const std::invalid_argument &) {
+    threw = true;
+  }
+  assert(threw && "Invalid configurations must be rejected");
+
+  std::cout << "✓ Sweep engine test passed!\n";
+}
+
+/**
+ * Test 8: Prefetch Traffic
+ *
+ * A stream prefetcher removes most misses of a sequential walk, but its
+ * fills still reach DRAM. Back-to-back requests catch some of those fills
+ * still in flight (late).
+ */
+void test_prefetch_traffic() {
+  std::cout << "\n=== Test 8: Prefetch Traffic ===\n";
+
+  SimConfig config(CacheConfig(8, 64, 4), DRAMConfig(4, 10, 12, 8, 30));
+  MemorySystem plain(config);
+  MemorySystem prefetching(config, L1Type::SET_ASSOCIATIVE, 4,
+                           PrefetcherType::STREAM);
+  for (Address a = 0; a < 128 * 1024; a += 16) {
+    plain.access(MemoryRequest(a, 0, AccessType::READ, 8));
+    prefetching.access(MemoryRequest(a, 0, AccessType::READ, 8));
+  }
+
+  uint64_t plain_misses = plain.get_stats().total_accesses() -
+                          plain.get_stats().total_hits();
+  uint64_t misses = prefetching.get_stats().total_accesses() -
+                    prefetching.get_stats().total_hits();
+  assert(plain_misses == 2048 && misses < 16);
+  assert(prefetching.current_cycle() < plain.current_cycle());
+
+  // Every DRAM read is a demand miss or a prefetch fill
+  PrefetchStats p = prefetching.prefetch_stats();
+  assert(prefetching.prefetch_reads() == p.issued);
+  assert(prefetching.dram().total_accesses() == misses + p.issued);
+  assert(p.useful + p.late + p.polluting <= p.issued);
+  assert(p.late > 0 && p.accuracy() > 0.95);
+  assert(plain.prefetch_stats().issued == 0);
+
+  bool threw = false;
+  try {
+    MemorySystem bad(config, L1Type::DIRECT_MAPPED, 4,
+                     PrefetcherType::NEXT_LINE);
+  } catch (const std::invalid_argument &) {
+    threw = true;
+  }
+  assert(threw && "Direct-mapped L1 has no prefetcher");
+
+  std::cout << "✓ Prefetch traffic test passed!\n";
+}
+
+/**
+ * Test 9: Calendar Queue
+ *
+ * Events come out in time order, same-cycle events in schedule order,
+ * whether they went into the wheel or the overflow heap.
+ */
+void test_calendar_queue() {
+  std::cout << "\n=== Test 9: Calendar Queue ===\n";
+
+  CalendarQueue<uint32_t> queue(16);
+  std::vector<std::pair<Cycle, uint32_t>> expected;
+  uint64_t x = 3;
+  for (uint32_t i = 0; i < 2000; ++i) {
+    x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    // Mostly near (wheel), sometimes far beyond it (overflow)
+    Cycle when = (x >> 60) < 12 ? (x >> 33) % 8 : (x >> 33) % 5000;
+    queue.schedule(when, i);
+    expected.push_back({when, i});
+  }
+  std::stable_sort(expected.begin(), expected.end(),
+                   [](const std::pair<Cycle, uint32_t> &a,
+                      const std::pair<Cycle, uint32_t> &b) {
+                     return a.first < b.first;
+                   });
+  assert(queue.size() == expected.size());
+
+  Cycle when;
+  uint32_t event;
+  for (size_t i = 0; i < expected.size(); ++i) {
+    assert(queue.pop(when, event));
+    assert(when == expected[i].first && event == expected[i].second);
+  }
+  assert(queue.empty() && !queue.pop(when, event));
+
+  // Scheduling at the current cycle still goes before anything later
+  Cycle last = queue.now();
+  queue.schedule(last + 10000, 2);
+  queue.schedule(last, 1);
+  assert(queue.pop(when, event) && when == last && event == 1);
+  assert(queue.pop(when, event) && when == last + 10000 && event == 2);
+
+  // pop_before() stops short of its limit without moving time there
+  last = queue.now();
+  queue.schedule(last + 5, 3);
+  queue.schedule(last + 9000, 4);
+  assert(!queue.pop_before(last + 5, when, event) && queue.now() < last + 5);
+  queue.schedule(last + 5, 5);
+  assert(queue.pop_before(last + 6, when, event) && event == 3);
+  assert(queue.pop_before(last + 6, when, event) && event == 5);
+  assert(!queue.pop_before(last + 9000, when, event));
+  queue.schedule(last + 100, 6);
+  assert(queue.pop(when, event) && when == last + 100 && event == 6);
+  assert(queue.pop(when, event) && when == last + 9000 && event == 4);
+
+  std::cout << "✓ Calendar queue test passed!\n";
+}
+
+/**
+ * Test 10: Non-Blocking Cache
+ *
+ * Independent misses overlap up to the MSHR count, secondary misses merge
+ * into one DRAM read, and a full MSHR file stalls in order.
+ */
+void test_nonblocking_cache() {
+  std::cout << "\n=== Test 10: Non-Blocking Cache ===\n";
+
+  SimConfig config(CacheConfig(32, 64, 8), DRAMConfig(16, 10, 12, 8, 30));
+
+  // 64 misses to different banks, all issued at cycle 0
+  std::vector<MemoryRequest> misses;
+  for (Address i = 0; i < 64; ++i) {
+    misses.push_back(MemoryRequest(i * 8192, 0, AccessType::READ, 8));
+  }
+  NonBlockingCache one(config, 1);
+  NonBlockingCache eight(config, 8);
+  Cycle serial = one.run(misses);
+  Cycle parallel = eight.run(misses);
+  assert(one.max_outstanding() == 1 && eight.max_outstanding() == 8);
+  assert(parallel * 4 < serial);
+  assert(eight.stalled_requests() > 0 && eight.stall_cycles() > 0);
+  assert(eight.get_stats().total_accesses() == 64);
+  assert(eight.primary_misses() == 64 && eight.dram().total_accesses() == 64);
+
+  // One MSHR but every request to the same block: one DRAM read
+  NonBlockingCache merge(config, 1);
+  for (Cycle t = 0; t < 6; ++t) {
+    merge.issue(MemoryRequest(0x40 + 8 * t, t, AccessType::READ, 8));
+  }
+  merge.issue(MemoryRequest(0x40, 1000, AccessType::WRITE, 8));
+  merge.run();
+  assert(merge.primary_misses() == 1 && merge.merged_misses() == 5);
+  assert(merge.dram().total_accesses() == 1);
+  assert(merge.get_stats().total_hits() == 1 && merge.stalled_requests() == 0);
+  // Merged targets complete with the fill, the late write hits
+  assert(merge.finish_cycle() == 1000 + 4);
+
+  // Same blocking behaviour as MemorySystem with one MSHR and 1 target
+  NonBlockingCache blocking(config, 1, 4, 1);
+  MemorySystem reference(config);
+  uint64_t y = 11;
+  Cycle arrival = 0;
+  for (int i = 0; i < 500; ++i) {
+    y = y * 6364136223846793005ULL + 1442695040888963407ULL;
+    arrival += (y >> 60);
+    MemoryRequest req((y >> 33) % (256 * 1024), arrival, AccessType::READ, 8);
+    blocking.issue(req);
+    reference.access(req);
+  }
+  blocking.run();
+  assert(blocking.get_stats().total_hits() ==
+         reference.get_stats().total_hits());
+
+  // Streamed in batches with run_until(): same run as issuing it all
+  std::vector<MemoryRequest> trace;
+  arrival = 0;
+  for (int i = 0; i < 20000; ++i) {
+    y = y * 6364136223846793005ULL + 1442695040888963407ULL;
+    arrival += (y >> 61);
+    trace.push_back(MemoryRequest((y >> 33) % (1024 * 1024), arrival,
+                                  (y >> 20) % 4 ? AccessType::READ
+                                                : AccessType::WRITE,
+                                  8));
+  }
+  NonBlockingCache whole(config, 4);
+  NonBlockingCache streamed(config, 4);
+  Cycle whole_finish = whole.run(trace);
+  for (size_t i = 0; i < trace.size(); ++i) {
+    streamed.issue(trace[i]);
+    if (i % 97 == 96) {
+      streamed.run_until(trace[i].arrival_cycle);
+    }
+  }
+  assert(streamed.run() == whole_finish);
+  assert(streamed.get_stats().total_hits() == whole.get_stats().total_hits());
+  assert(streamed.get_stats().total_latency() ==
+         whole.get_stats().total_latency());
+  assert(streamed.merged_misses() == whole.merged_misses() &&
+         streamed.stall_cycles() == whole.stall_cycles() &&
+         streamed.writebacks() == whole.writebacks());
+
+  // Catching up to a cycle takes the arrivals at that cycle too
+  NonBlockingCache at_zero(config, 4);
+  at_zero.issue(MemoryRequest(0x1000, 0, AccessType::READ, 8));
+  at_zero.run_until(0);
+  assert(at_zero.primary_misses() == 1);
+
+  // Untimed: with one MSHR, every miss after the first waits for the fill
+  // before it, and the next request only arrives once it was taken
+  NonBlockingCache untimed(config, 1);
+  Cycle next = 0;
+  Cycle taken = 0;
+  for (int i = 0; i < 1000; ++i) {
+    taken = untimed.accept(
+        MemoryRequest(static_cast<Address>(i) * 4096, next, AccessType::READ, 8));
+    assert(taken >= next);
+    next = taken + 1;
+  }
+  assert(untimed.stalled_requests() == 999);
+  assert(untimed.run() > taken);
+
+  std::cout << "Finish cycle, 1 MSHR: " << serial << ", 8 MSHRs: " << parallel
+            << "\n";
+  std::cout << "✓ Non-blocking cache test passed!\n";
+}
+
+/**
+ * Test 11: Synthetic Trace Generator
+ *
+ * Each pattern produces the addresses it promises, streams are
+ * reproducible from their seed, and generated traces round-trip through
+ * the binary format.
+ */
+void test_trace_generator() {
+  std::cout << "\n=== Test 11: Synthetic Trace Generator ===\n";
+
+  // xoshiro256** reference output for state {1, 2, 3, 4}
+  Xoshiro256 rng;
+  rng.set_state(1, 2, 3, 4);
+  assert(rng.next() == 11520 && rng.next() == 0 && rng.next() == 1509978240);
+
+  auto collect = [](const std::string &pattern, uint64_t count,
+                    uint64_t seed = 1) {
+    TraceGenerator gen(parse_pattern(pattern, seed, 1000), count, 1000);
+    std::vector<TraceRecord> out;
+    for (TraceSpan b = gen.next_batch(); !b.empty(); b = gen.next_batch()) {
+      out.insert(out.end(), b.begin(), b.end());
+    }
+    assert(out.size() == count && gen.produced() == count);
+    return out;
+  };
+
+  // Sequential / strided wrap at the footprint
+  std::vector<TraceRecord> seq = collect("sequential:base=0x1000,footprint=64", 10);
+  assert(seq[0].addr == 0x1000 && seq[1].addr == 0x1008 && seq[8].addr == 0x1000);
+  std::vector<TraceRecord> strided = collect("strided:stride=4K,footprint=16K,gap=3", 6);
+  assert(strided[3].addr == 12288 && strided[4].addr == 0);
+  assert(strided[5].cycle_delta == 3 && strided[5].type() == AccessType::READ);
+
+  // Uniform: inside the footprint, granule-aligned, write fraction honoured
+  std::vector<TraceRecord> uni = collect("uniform:footprint=1M,writes=0.25", 100000);
+  size_t writes = 0;
+  for (const TraceRecord &r : uni) {
+    assert(r.addr < (1 << 20) && r.addr % 64 == 0);
+    writes += r.type() == AccessType::WRITE;
+  }
+  assert(writes > 24000 && writes < 26000);
+
+  // Zipf: the hottest granule takes a large share, all in range
+  std::vector<TraceRecord> zipf = collect("zipf:footprint=64M,theta=0.99", 200000);
+  std::vector<uint32_t> counts(1 << 20, 0);
+  for (const TraceRecord &r : zipf) {
+    assert(r.addr < (64 << 20));
+    counts[r.addr / 64]++;
+  }
+  uint32_t hottest = *std::max_element(counts.begin(), counts.end());
+  assert(hottest > 200000 / 100);
+
+  // Pointer chase: one cycle through every node, then it repeats
+  std::vector<TraceRecord> chase = collect("chase:footprint=64K", 2048);
+  std::unordered_set<Address> nodes;
+  for (size_t i = 0; i < 1024; ++i) {
+    nodes.insert(chase[i].addr);
+    assert(chase[i + 1024].addr == chase[i].addr);
+  }
+  assert(nodes.size() == 1024);
+
+  // Same seed, same stream; rewind() restarts it
+  assert(collect("zipf", 1000, 7)[999].addr == collect("zipf", 1000, 7)[999].addr);
+  TraceGenerator gen(parse_pattern("uniform+chase+zipf", 3, 50), 5000);
+  TraceRecord first = gen.next_batch()[0];
+  gen.rewind();
+  assert(gen.next_batch()[0].addr == first.addr);
+
+  // Phase mix switches between its phases' address ranges
+  std::vector<TraceRecord> mix =
+      collect("sequential:footprint=1M+uniform:base=1G,footprint=1M", 100000);
+  size_t switches = 0;
+  for (size_t i = 1; i < mix.size(); ++i) {
+    switches += (mix[i].addr >= (1u << 30)) != (mix[i - 1].addr >= (1u << 30));
+  }
+  assert(switches > 50 && switches < 200);
+
+  // Generated traces round-trip through the binary format
+  const std::string path = "test_generated.mtr";
+  {
+    TraceGenerator out(parse_pattern("zipf:writes=0.5", 9), 12345);
+    TraceWriter writer(path);
+    assert(out.write(writer) == 12345);
+    writer.close();
+  }
+  std::vector<TraceRecord> expected = collect("zipf:writes=0.5", 12345, 9);
+  {
+    TraceReader reader(path);
+    assert(reader.size() == 12345);
+    for (size_t i = 0; i < reader.size(); ++i) {
+      assert(reader.records()[i].addr == expected[i].addr &&
+             reader.records()[i].op == expected[i].op);
+    }
+  }
+  std::remove(path.c_str());
+
+  // Bad specs are rejected
+  for (const char *bad : {"zipf:theta=1.5", "foo", "uniform:stride=0",
+                          "uniform:footprint=8,stride=64", "strided:what=1"}) {
+    bool threw = false;
+    try {
+      parse_pattern(bad);
+    } catch (const std::invalid_argument &) {
+      threw = true;
+    }
+    assert(threw);
+  }
+
+  std::cout << "Hottest zipf block: " << hottest << " of " << zipf.size()
+            << " accesses\n";
+  std::cout << "✓ Trace generator test passed!\n";
+}
+
+/**
+ * Test 12: Warm-State Checkpoints
+ *
+ * A memory system or sweep restored from a snapshot continues cycle for
+ * cycle like the one that was saved, and refuses a different layout.
+ */
+void test_checkpoint() {
+  std::cout << "\n=== Test 12: Warm-State Checkpoints ===\n";
+
+  const std::string path = "test_warm.ckpt";
+  SimConfig config(CacheConfig(8, 64, 4), DRAMConfig(8, 10, 12, 8, 30));
+  std::vector<MemoryRequest> trace;
+  uint64_t x = 7;
+  for (int i = 0; i < 40000; ++i) {
+    x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    // Strided walks mixed with random blocks, so the prefetcher trains
+    Address addr = (x >> 60) < 8 ? (i % 4096) * 192 : (x >> 33) % (1 << 20);
+    AccessType type = ((x >> 21) & 7) == 0 ? AccessType::WRITE : AccessType::READ;
+    trace.push_back(MemoryRequest(addr, 0, type, 8));
+  }
+  const size_t warmup = trace.size() / 2;
+
+  for (L1Type type : {L1Type::SET_ASSOCIATIVE, L1Type::DIRECT_MAPPED}) {
+    PrefetcherType pf = type == L1Type::SET_ASSOCIATIVE ? PrefetcherType::STRIDE
+                                                        : PrefetcherType::NONE;
+    MemorySystem warm(config, type, 4, pf);
+    for (size_t i = 0; i < warmup; ++i) {
+      warm.access(trace[i]);
+    }
+    const uint64_t warm_hits = warm.get_stats().total_hits();
+    {
+      CheckpointWriter out(path);
+      warm.save(out);
+      out.close();
+    }
+    MemorySystem forked(config, type, 4, pf);
+    CheckpointReader in(path);
+    forked.restore(in);
+    assert(forked.current_cycle() == warm.current_cycle());
+    for (size_t i = warmup; i < trace.size(); ++i) {
+      assert(warm.access(trace[i]) == forked.access(trace[i]));
+    }
+    assert(forked.writebacks() == warm.writebacks());
+    assert(forked.prefetch_reads() == warm.prefetch_reads());
+    assert(forked.dram().row_hits() == warm.dram().row_hits());
+    assert(forked.prefetch_stats().useful == warm.prefetch_stats().useful);
+
+    // Other DRAM timings fork from the same state; other banks don't
+    in.rewind();
+    MemorySystem slower(SimConfig(config.l1_cache, DRAMConfig(8, 20, 24, 16, 60)),
+                        type, 4, pf);
+    slower.restore(in);
+    assert(slower.get_stats().total_hits() == warm_hits);
+    for (size_t i = warmup; i < trace.size(); ++i) {
+      slower.access(trace[i]);
+    }
+    assert(slower.get_stats().total_hits() == forked.get_stats().total_hits());
+    assert(slower.current_cycle() > forked.current_cycle());
+    in.rewind();
+    MemorySystem banks(SimConfig(config.l1_cache, DRAMConfig(4, 10, 12, 8, 30)),
+                       type, 4, pf);
+    bool threw = false;
+    try {
+      banks.restore(in);
+    } catch (const std::invalid_argument &) {
+      threw = true;
+    }
+    assert(threw);
+  }
+
+  // A sweep resumes between batches
+  std::vector<TraceRecord> records;
+  for (const MemoryRequest &r : trace) {
+    records.push_back(TraceRecord::make(r.addr, r.type, 8));
+  }
+  std::vector<CacheConfig> grid = make_config_grid({4, 64}, {64}, {1, 8});
+  SweepEngine whole(grid, 2);
+  whole.run_batch(TraceSpan{records.data(), warmup});
+  {
+    CheckpointWriter out(path);
+    whole.save(out);
+    out.close();
+  }
+  SweepEngine resumed(grid, 2);
+  {
+    CheckpointReader in(path);
+    resumed.restore(in);
+  }
+  TraceSpan rest{records.data() + warmup, records.size() - warmup};
+  whole.run_batch(rest);
+  resumed.run_batch(rest);
+  for (size_t i = 0; i < grid.size(); ++i) {
+    assert(whole.results()[i].hits == resumed.results()[i].hits);
+    assert(whole.results()[i].writebacks == resumed.results()[i].writebacks);
+  }
+  std::remove(path.c_str());
+
+  std::cout << "✓ Checkpoint test passed!\n";
+}
+
+/**
+ * Test 13: FR-FCFS DRAM Controller
+ *
+ * Address mapping schemes, row hits served ahead of older conflicts, write
+ * drains, refresh, XOR bank hashing against bank conflicts, and the
+ * non-blocking L1 driving the controller from its event queue.
+ */
+void test_dram_controller() {
+  std::cout << "\n=== Test 13: FR-FCFS DRAM Controller ===\n";
+
+  const DRAMConfig timing(4, 10, 12, 8, 30);
+  const Address row_stride = 8192 * 4; // Next row, same bank (page mapping)
+  DRAMControllerConfig setup;
+  setup.tREFI = 0;
+
+  // Page mapping matches DRAMModel; line mapping rotates blocks over banks
+  AddressMapper page(4, 8192, 64, MappingScheme::ROW_BANK_COLUMN, false);
+  AddressMapper line(4, 8192, 64, MappingScheme::ROW_COLUMN_BANK, false);
+  AddressMapper hashed(4, 8192, 64, MappingScheme::ROW_BANK_COLUMN, true);
+  DRAMModel model(timing);
+  for (Address a = 0; a < 16 * row_stride; a += 4096 + 64) {
+    assert(page.decode(a).bank == model.bank_of(a));
+    assert(page.decode(a).row == model.row_of(a));
+  }
+  assert(line.decode(64).bank == 1 && line.decode(4 * 64).bank == 0);
+  assert(line.decode(4 * 64).column == 1 && line.decode(8192 * 4).row == 1);
+  for (uint32_t r = 0; r < 4; ++r) {
+    assert(hashed.decode(r * row_stride).bank == r);
+    assert(hashed.decode(r * row_stride).row == r);
+  }
+
+  // A row miss, then a conflict and a younger hit: the hit goes first
+  DRAMController frfcfs(timing, setup);
+  std::vector<DRAMCompletion> done;
+  frfcfs.enqueue(0, false, 0, 0);
+  assert(frfcfs.service(0, done) == DRAMController::NEVER);
+  assert(done.size() == 1);
+  frfcfs.enqueue(row_stride, false, 1, 1);
+  frfcfs.enqueue(64, false, 2, 1);
+  assert(frfcfs.service(1, done) == 14);
+  assert(frfcfs.service(14, done) == 18);
+  assert(frfcfs.service(18, done) == DRAMController::NEVER);
+  assert(done.size() == 3 && done[0].done == 26);
+  assert(done[1].tag == 2 && done[1].done == 30); // Row hit, bus after A
+  assert(done[2].tag == 1 && done[2].done == 30 + 8 + 10 + 12 + 4);
+  assert(frfcfs.row_hits() == 1 && frfcfs.row_conflicts() == 1);
+  assert(frfcfs.pending() == 0);
+
+  // Reads go ahead of buffered writes until write_high forces a drain
+  DRAMController reads_first(timing, setup);
+  for (uint32_t i = 0; i < 10; ++i) {
+    reads_first.enqueue(i * 64, true, 100 + i, 0);
+  }
+  for (uint32_t i = 0; i < 5; ++i) {
+    reads_first.enqueue(i * 64, false, i, 0);
+  }
+  done.clear();
+  for (Cycle t = 0; t != DRAMController::NEVER;) {
+    t = reads_first.service(t, done);
+  }
+  for (uint32_t i = 0; i < 5; ++i) {
+    assert(done[i].tag == i);
+  }
+  assert(reads_first.write_drains() == 0 && reads_first.writes() == 10);
+
+  DRAMControllerConfig deep = setup;
+  deep.queue_depth = 64;
+  DRAMController drain(timing, deep);
+  for (uint32_t i = 0; i < 40; ++i) {
+    drain.enqueue(i * 64, true, 100 + i, 0);
+  }
+  drain.enqueue(0, false, 0, 0);
+  done.clear();
+  for (Cycle t = 0; t != DRAMController::NEVER;) {
+    t = drain.service(t, done);
+  }
+  assert(drain.write_drains() == 1);
+  auto read = std::find_if(done.begin(), done.end(),
+                           [](const DRAMCompletion &c) { return c.tag == 0; });
+  // Drained down to write_low (8) writes before the read
+  assert(read - done.begin() == 40 - 8);
+
+  // Refresh: a read at a refresh boundary waits tRFC
+  DRAMControllerConfig refreshing = setup;
+  refreshing.tREFI = 1000;
+  refreshing.tRFC = 200;
+  DRAMController refresh(timing, refreshing);
+  std::vector<MemoryRequest> spaced;
+  for (Cycle t = 0; t <= 10000; t += 500) {
+    spaced.push_back(MemoryRequest(t * 64, t, AccessType::READ, 64));
+  }
+  refresh.run(spaced);
+  assert(refresh.refreshes() == 10);
+  assert(refresh.delay_histogram()[0] == 11);  // Between refreshes
+  assert(refresh.delay_histogram()[8] == 10);  // 200 cycles: [128, 256)
+
+  // Rows of one bank: all conflicts in one bank, unless XOR spreads them
+  std::vector<MemoryRequest> same_bank;
+  for (Address r = 0; r < 4096; ++r) {
+    same_bank.push_back(MemoryRequest((r % 64) * row_stride + (r / 64) * 64,
+                                      0, AccessType::READ, 64));
+  }
+  DRAMControllerConfig xored = setup;
+  xored.xor_banks = true;
+  DRAMController plain(timing, setup);
+  DRAMController spread(timing, xored);
+  plain.run(same_bank);
+  spread.run(same_bank);
+  assert(plain.row_conflicts() == same_bank.size() - 1);
+  assert(spread.row_conflicts() < plain.row_conflicts());
+  assert(spread.bandwidth() > 4 * plain.bandwidth());
+
+  // Sequential reads at the line mapping run at the data bus rate (64 B / 4)
+  DRAMControllerConfig by_line = setup;
+  by_line.mapping = MappingScheme::ROW_COLUMN_BANK;
+  DRAMController stream(timing, by_line);
+  std::vector<MemoryRequest> sequential;
+  for (Address a = 0; a < 4096 * 64; a += 64) {
+    sequential.push_back(MemoryRequest(a, 0, AccessType::READ, 64));
+  }
+  stream.run(sequential);
+  assert(stream.bandwidth() > 15.0 && stream.row_hit_rate() > 0.9);
+
+  // The non-blocking L1 through the controller: same requests, all served
+  SimConfig config(CacheConfig(32, 64, 8), DRAMConfig(16, 10, 12, 8, 30));
+  std::vector<MemoryRequest> misses;
+  for (Address i = 0; i < 256; ++i) {
+    misses.push_back(MemoryRequest(i * 8192, i, i % 4 ? AccessType::READ
+                                                      : AccessType::WRITE, 8));
+  }
+  for (Address i = 0; i < 1024; ++i) {
+    misses.push_back(MemoryRequest(4 * 1024 * 1024 + i * 64, 300 + i,
+                                   AccessType::READ, 8));
+  }
+  DRAMControllerConfig fleet;
+  NonBlockingCache direct(config, 8);
+  NonBlockingCache queued(config, 8, 4, 8, &fleet);
+  direct.run(misses);
+  queued.run(misses);
+  assert(queued.controller() && !direct.controller());
+  assert(queued.get_stats().total_accesses() == misses.size());
+  assert(queued.get_stats().total_hits() == direct.get_stats().total_hits());
+  assert(queued.controller()->reads() == queued.primary_misses());
+  assert(queued.controller()->writes() == queued.writebacks());
+  assert(queued.controller()->pending() == 0);
+
+  std::cout << "Same-bank rows: " << plain.bandwidth() << " B/cycle, XOR: "
+            << spread.bandwidth() << " B/cycle; stream " << stream.bandwidth()
+            << " B/cycle\n";
+  std::cout << "✓ DRAM controller test passed!\n";
+}
+
+int main() {
+  std::cout << "======================================\n";
+  std::cout << "Memory System Simulator Tests\n";
+  std::cout << "======================================\n";
+
+  try {
+    test_binary_trace_round_trip();
+    test_text_conversion();
+    test_malformed_trace();
+    test_compressed_trace();
+    test_dram_row_buffer();
+    test_memory_system();
+    test_sweep_engine();
+    test_prefetch_traffic();
+    test_calendar_queue();
+    test_nonblocking_cache();
+    test_trace_generator();
+    test_checkpoint();
+    test_dram_controller();
+
+    std::cout << "\n======================================\n";
+    std::cout << "✓ All tests passed!\n";
+    std::cout << "======================================\n";
+
+    return 0;
+  } catch (const std::exception &e) {
+    std::cerr << "\n✗ Test failed with exception: " << e.what() << "\n";
+    return 1;
+  }
+}